@@ -586,6 +586,9 @@ void abort_routine();
 #define LACKS_SYS_TYPES_H
 //#define LACKS_ERRNO_H
 #define LACKS_SCHED_H
+#ifndef HAVE_MREMAP
+#define HAVE_MREMAP 1 /* in-place only, see win32mremap */
+#endif /* HAVE_MREMAP */
 #ifndef MALLOC_FAILURE_ACTION
 #define MALLOC_FAILURE_ACTION
 #endif /* MALLOC_FAILURE_ACTION */
@@ -676,7 +679,7 @@ void abort_routine();
 #define MMAP_CLEARS 1
 #endif  /* MMAP_CLEARS */
 #ifndef HAVE_MREMAP
-#ifdef linux
+#if defined(linux) || defined(__linux__)
 #define HAVE_MREMAP 1
 #define _GNU_SOURCE /* Turns on mremap() definition */
 #else   /* linux */
@@ -1519,7 +1522,7 @@ DLMALLOC_EXPORT int mspace_mallopt(int, int);
 #if HAVE_MMAP
 #ifndef LACKS_SYS_MMAN_H
 /* On some versions of linux, mremap decl in mman.h needs __USE_GNU set */
-#if (defined(linux) && !defined(__USE_GNU))
+#if ((defined(linux) || defined(__linux__)) && !defined(__USE_GNU))
 #define __USE_GNU 1
 #include <sys/mman.h>    /* for mmap */
 #undef __USE_GNU
@@ -1739,6 +1742,22 @@ static FORCEINLINE void* win32direct_mmap(size_t size, size_t commit_size, void*
   return (ptr != 0)? ptr: MFAIL;
 }
 
+#if HAVE_MREMAP
+/* Direct mmap reserving twice the address space, so that the chunk can
+   grow in place, see win32mremap */
+static FORCEINLINE void* win32growable_mmap(size_t size) {
+  void* ptr = 0;
+  if (sizeof(size_t) == 8 && size <= MAX_SIZE_T / 2) {
+    ptr = VirtualAlloc(0, size * 2, MEM_RESERVE, PAGE_READWRITE);
+    if (ptr && VirtualAlloc(ptr, size, MEM_COMMIT, PAGE_READWRITE) == 0) {
+      VirtualFree(ptr, 0, MEM_RELEASE);
+      ptr = 0;
+    }
+  }
+  return (ptr != 0)? ptr: win32direct_mmap(size, 0, 0);
+}
+#endif /* HAVE_MREMAP */
+
 /*static FORCEINLINE void* win32mmap_commit(void* ptr, size_t commit_size) {
     return VirtualAlloc(ptr, commit_size, MEM_COMMIT, PAGE_READWRITE);
 }*/
@@ -1768,15 +1787,181 @@ static FORCEINLINE int win32munmap(void* ptr, size_t size, int v) {
   return 0;
 }
 
+#if HAVE_MREMAP
+/* In-place mremap: grows by committing the reserved headroom of the
+   allocation, shrinks by decommitting. Pages can't be moved, so a failed
+   growth falls back to malloc-copy-free even with MREMAP_MAYMOVE */
+static void* win32mremap(void* addr, size_t osz, size_t nsz, int mv) {
+  MEMORY_BASIC_INFORMATION minfo;
+  char* cptr = (char*)addr;
+  size_t committed;
+  (void)osz; (void)mv;
+  if (VirtualQuery(cptr, &minfo, sizeof(minfo)) == 0 ||
+      minfo.AllocationBase != addr || minfo.State != MEM_COMMIT)
+    return MFAIL;
+  committed = minfo.RegionSize;
+  if (nsz <= committed) {
+    if (nsz < committed && VirtualFree(cptr + nsz, committed - nsz, MEM_DECOMMIT) == 0)
+      return MFAIL;
+    return addr;
+  }
+  if (VirtualQuery(cptr + committed, &minfo, sizeof(minfo)) == 0 ||
+      minfo.AllocationBase != addr || minfo.State != MEM_RESERVE ||
+      minfo.RegionSize < nsz - committed)
+    return MFAIL;
+  if (VirtualAlloc(cptr + committed, nsz - committed, MEM_COMMIT, PAGE_READWRITE) == 0)
+    return MFAIL;
+  return addr;
+}
+#endif /* HAVE_MREMAP */
+
 #define MMAP_DEFAULT(s)             win32mmap(s)
 #define MUNMAP_DEFAULT(a, s, v)     win32munmap((a), (s), (v))
 #define DIRECT_MMAP_DEFAULT(s,cs,p) win32direct_mmap(s,cs,p)
 #endif /* WIN32 */
 #endif /* HAVE_MMAP */
 
+/* Virtual reservations with page size and NUMA placement options */
+#if HAVE_MMAP
+
+#define HUGE_PAGE_SIZE ((size_t)2U << 20)
+
+#ifndef WIN32
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif /* __linux__ */
+
+#if defined(__linux__) && defined(SYS_mbind)
+static void linux_mbind(void* ptr, size_t size, unsigned flags, int node) {
+  unsigned long mask[16]; /* 1024 nodes */
+  unsigned long nmask = sizeof(mask) * 8;
+  int mode;
+  memset(mask, 0, sizeof(mask));
+  if (flags & MSPACE_VIRTUAL_NUMA_INTERLEAVE) {
+    /* the kernel intersects the mask with the allowed nodes */
+    memset(mask, 0xff, sizeof(mask));
+    mode = 3; /* MPOL_INTERLEAVE */
+  }
+  else {
+#ifdef SYS_getcpu
+    if (node < 0) {
+      unsigned cpu, cnode;
+      if (syscall(SYS_getcpu, &cpu, &cnode, 0) == 0)
+        node = (int)cnode;
+    }
+#endif /* SYS_getcpu */
+    if (node < 0 || (unsigned long)node >= nmask)
+      return;
+    mask[node / (sizeof(unsigned long) * 8)] |= 1UL << (node % (sizeof(unsigned long) * 8));
+    mode = 2; /* MPOL_BIND */
+  }
+  syscall(SYS_mbind, ptr, size, mode, mask, nmask, 0);
+}
+#else /* __linux__ && SYS_mbind */
+static void linux_mbind(void* ptr, size_t size, unsigned flags, int node) {
+  (void)ptr; (void)size; (void)flags; (void)node;
+}
+#endif /* __linux__ && SYS_mbind */
+
+/* Reserve address space, mmap commits lazily on first touch */
+static void* virtual_reserve(size_t size, size_t commit_size, unsigned flags, int node) {
+  (void)commit_size;
+  char* ptr = CMFAIL;
+#ifdef MAP_HUGETLB
+  if (flags & MSPACE_VIRTUAL_HUGE_EXPLICIT)
+    ptr = (char*)mmap(0, size, MMAP_PROT, MMAP_FLAGS|MAP_HUGETLB, -1, 0);
+#endif /* MAP_HUGETLB */
+  if (ptr == CMFAIL) {
+    if (flags & (MSPACE_VIRTUAL_HUGE_PAGES|MSPACE_VIRTUAL_HUGE_EXPLICIT)) {
+      /* over-reserve and trim to get a huge page aligned range */
+      char* mm = (char*)MMAP_DEFAULT(size + HUGE_PAGE_SIZE);
+      if (mm == CMFAIL)
+        return MFAIL;
+      ptr = (char*)(((size_t)mm + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1));
+      if (ptr > mm)
+        munmap(mm, ptr - mm);
+      munmap(ptr + size, mm + HUGE_PAGE_SIZE - ptr);
+#ifdef MADV_HUGEPAGE
+      madvise(ptr, size, MADV_HUGEPAGE);
+#endif /* MADV_HUGEPAGE */
+    }
+    else {
+      ptr = (char*)MMAP_DEFAULT(size);
+      if (ptr == CMFAIL)
+        return MFAIL;
+    }
+  }
+  if (flags & (MSPACE_VIRTUAL_NUMA_BIND|MSPACE_VIRTUAL_NUMA_INTERLEAVE))
+    linux_mbind(ptr, size, flags, node);
+  return ptr;
+}
+
+/* Fault in a page range, MADV_POPULATE_WRITE where available (linux 5.14+) */
+static void virtual_prefault(char* ptr, size_t size, size_t page) {
+  volatile char* p;
+#ifdef MADV_POPULATE_WRITE
+  if (madvise(ptr, size, MADV_POPULATE_WRITE) == 0)
+    return;
+#endif /* MADV_POPULATE_WRITE */
+  for (p = ptr; p < ptr + size; p += page)
+    *p = *p;
+}
+
+#else /* WIN32 */
+
+/* Reserve address space and commit the first page, large pages must be committed upfront */
+static void* virtual_reserve(size_t size, size_t commit_size, unsigned flags, int node) {
+  void* ptr = 0;
+  HANDLE proc = GetCurrentProcess();
+  if (flags & MSPACE_VIRTUAL_NUMA_BIND) {
+    if (node < 0) {
+      PROCESSOR_NUMBER pn;
+      USHORT cnode;
+      GetCurrentProcessorNumberEx(&pn);
+      node = GetNumaProcessorNodeEx(&pn, &cnode) ? (int)cnode : -1;
+    }
+  }
+  else
+    node = -1;
+
+  if (flags & MSPACE_VIRTUAL_HUGE_EXPLICIT) {
+    size_t lp = GetLargePageMinimum();
+    if (lp != 0 && (size & (lp - 1)) == 0) {
+      DWORD type = MEM_RESERVE|MEM_COMMIT|MEM_LARGE_PAGES;
+      ptr = node >= 0
+        ? VirtualAllocExNuma(proc, 0, size, type, PAGE_READWRITE, (DWORD)node)
+        : VirtualAlloc(0, size, type, PAGE_READWRITE);
+      if (ptr)
+        return ptr;
+    }
+  }
+
+  ptr = node >= 0
+    ? VirtualAllocExNuma(proc, 0, size, MEM_RESERVE, PAGE_READWRITE, (DWORD)node)
+    : VirtualAlloc(0, size, MEM_RESERVE, PAGE_READWRITE);
+  if (ptr == 0)
+    return MFAIL;
+  VirtualAlloc(ptr, commit_size, MEM_COMMIT, PAGE_READWRITE);
+  return ptr;
+}
+
+/* Commit and fault in a page range */
+static void virtual_prefault(char* ptr, size_t size, size_t page) {
+  volatile char* p;
+  if (VirtualAlloc(ptr, size, MEM_COMMIT, PAGE_READWRITE) == 0)
+    return;
+  for (p = ptr; p < ptr + size; p += page)
+    *p = *p;
+}
+
+#endif /* WIN32 */
+#endif /* HAVE_MMAP */
+
 #if HAVE_MREMAP
 #ifndef WIN32
 #define MREMAP_DEFAULT(addr, osz, nsz, mv) mremap((addr), (osz), (nsz), (mv))
+#else /* WIN32 */
+#define MREMAP_DEFAULT(addr, osz, nsz, mv) win32mremap((addr), (osz), (nsz), (mv))
 #endif /* WIN32 */
 #endif /* HAVE_MREMAP */
 
@@ -3302,7 +3487,7 @@ static void do_check_top_chunk(mstate m, mchunkptr p) {
 /* Check properties of (inuse) mmapped chunks */
 static void do_check_mmapped_chunk(mstate m, mchunkptr p) {
   size_t  sz = chunksize(p);
-  size_t len = (sz + MALLOC_ALIGNMENT + MMAP_FOOT_PAD);
+  size_t len = (sz + p->prev_foot + MALLOC_ALIGNMENT + MMAP_FOOT_PAD);
   assert(is_mmapped(p));
   assert(use_mmap(m));
   assert((is_aligned(chunk2mem(p), m->modalign)) || (p->head == FENCEPOST_HEAD));
@@ -3905,10 +4090,17 @@ static void* mmap_alloc(mstate m, size_t nb) {
       return 0;
   }
   if (mmsize > nb) {     /* Check for wrap around 0 */
+#if defined(WIN32) && HAVE_MMAP && HAVE_MREMAP && !defined(DIRECT_MMAP)
+    /* only array mspaces (nonzero modalign) get the headroom for in-place growth */
+    char* mm = (char*)(m->modalign != 0
+      ? win32growable_mmap(mmsize)
+      : CALL_DIRECT_MMAP(mmsize, 0, 0));
+#else /* WIN32 && HAVE_MREMAP */
     char* mm = (char*)(CALL_DIRECT_MMAP(mmsize, 0, 0));
+#endif /* WIN32 && HAVE_MREMAP */
     if (mm != CMFAIL) {
       size_t offset = align_offset(chunk2mem(mm), m->modalign);
-      size_t psize = mmsize - MALLOC_ALIGNMENT - MMAP_FOOT_PAD;
+      size_t psize = mmsize - offset - MALLOC_ALIGNMENT - MMAP_FOOT_PAD;
       assert((psize & FLAG_BITS) == 0);
       mchunkptr p = (mchunkptr)(mm + offset);
       p->prev_foot = offset;
@@ -3931,13 +4123,19 @@ static void* mmap_alloc(mstate m, size_t nb) {
 
 /* Alloc a reserved virtual memory block.
    prev_foot contains the reserved memory + alignment offset on lower bits
+   flags contain MSPACE_VIRTUAL_* placement options, huge page blocks are
+   sized to whole huge pages
 */
 
-static void* mmap_alloc_virtual(mstate m, size_t nb) {
+static void* mmap_alloc_virtual(mstate m, size_t nb, unsigned flags, int node) {
   size_t mmsize = mmap_align(nb + m->modalign + TWO_SIZE_T_SIZES);
+  if (flags & (MSPACE_VIRTUAL_HUGE_PAGES|MSPACE_VIRTUAL_HUGE_EXPLICIT))
+    mmsize = (mmsize + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
   if (mmsize > nb) {     /* Check for wrap around 0 */
     size_t commit_size = mparams.page_size;
-    char* mm = (char*)(CALL_DIRECT_MMAP(mmsize, commit_size, 0));
+    char* mm = flags
+      ? (char*)virtual_reserve(mmsize, commit_size, flags, node)
+      : (char*)(CALL_DIRECT_MMAP(mmsize, commit_size, 0));
     if (mm != CMFAIL) {
       size_t offset = align_offset(chunk2mem(mm), m->modalign);
       assert((mmsize & FLAG_BITS) == 0);
@@ -3981,13 +4179,15 @@ static mchunkptr mmap_resize(mstate m, mchunkptr oldp, size_t nb, int flags) {
     return oldp;
   else {
     size_t offset = oldp->prev_foot;
-    size_t oldmmsize = oldsize + offset /*+ m->modalign*/ + MMAP_FOOT_PAD;
+    /* the same length that free unmaps */
+    size_t oldmmsize = oldsize + offset + MALLOC_ALIGNMENT + MMAP_FOOT_PAD;
     size_t newmmsize = mmap_align(nb + SIX_SIZE_T_SIZES + CHUNK_ALIGN_MASK);
     char* cp = (char*)CALL_MREMAP((char*)oldp - offset,
                                   oldmmsize, newmmsize, flags);
     if (cp != CMFAIL) {
       mchunkptr newp = (mchunkptr)(cp + offset);
-      size_t psize = newmmsize /*- offset - m->modalign*/ - MMAP_FOOT_PAD;
+      /* same layout as mmap_alloc, free unmaps offset + psize + MALLOC_ALIGNMENT + MMAP_FOOT_PAD */
+      size_t psize = newmmsize - offset - MALLOC_ALIGNMENT - MMAP_FOOT_PAD;
       newp->head = psize;
       mark_inuse_foot(m, newp, psize);
       chunk_plus_offset(newp, psize)->head = FENCEPOST_HEAD;
@@ -5630,7 +5830,17 @@ void* mspace_malloc_virtual(mspace msp, size_t bytes) {
         return 0;
     }
 
-    return mmap_alloc_virtual(ms, bytes);
+    return mmap_alloc_virtual(ms, bytes, 0, -1);
+}
+
+void* mspace_malloc_virtual_ex(mspace msp, size_t bytes, unsigned flags, int node) {
+    mstate ms = (mstate)msp;
+    if (!ok_magic(ms)) {
+        USAGE_ERROR_ACTION(ms, ms);
+        return 0;
+    }
+
+    return mmap_alloc_virtual(ms, bytes, flags, node);
 }
 
 void* mspace_malloc_stack(mspace msp, size_t bytes, void* buffer) {
@@ -5801,7 +6011,7 @@ void mspace_free(/*mspace msp,*/ void* mem) {
         if (!pinuse(p)) {
           size_t prevsize = p->prev_foot;
           if (is_mmapped(p)) {
-            psize += MALLOC_ALIGNMENT + MMAP_FOOT_PAD;
+            psize += prevsize + MALLOC_ALIGNMENT + MMAP_FOOT_PAD;
             if (CALL_MUNMAP((char*)p - prevsize, psize, 0) == 0)
               fm->footprint -= psize;
             goto postaction;
@@ -6189,6 +6399,26 @@ size_t mspace_virtual_size(const void* mem) {
   return 0;
   }
 
+//prefault [offset, offset+bytes) range of a virtual block, disjoint ranges can be done concurrently
+//@return number of bytes prefaulted
+size_t mspace_virtual_prefault(void* mem, size_t offset, size_t bytes) {
+  size_t vsize = mspace_virtual_size(mem);
+  if (offset >= vsize)
+    return 0;
+  if (bytes > vsize - offset)
+    bytes = vsize - offset;
+  if (bytes > 0) {
+    /* the mapping is page aligned so the rounded range stays within it */
+    size_t page = mparams.page_size;
+    size_t beg = (size_t)mem + offset;
+    size_t end = beg + bytes;
+    beg &= ~(page - SIZE_T_ONE);
+    end = (end + page - SIZE_T_ONE) & ~(page - SIZE_T_ONE);
+    virtual_prefault((char*)beg, end - beg, page);
+  }
+  return bytes;
+}
+
 //@return size of reserved stack space or 0 if it wasn't a stack allocation
 size_t mspace_stack_size(const void* mem) {
     if (mem != 0) {
@@ -6215,6 +6445,18 @@ mspace mspace_from_ptr(const void* mem) {
     return 0;
 }
 
+//@return usable size of a regular (non-mmapped, non-virtual, non-stack) chunk and its owning mspace, or 0
+size_t mspace_usable_size_owner(const void* mem, mspace* owner) {
+    if (mem != 0) {
+        mchunkptr p = mem2chunk(mem);
+        if (!flag4inuse(p) && !is_mmapped(p) && is_inuse(p)) {
+            *owner = get_mstate_for(p);
+            return chunksize(p) - overhead_for(p);
+        }
+    }
+    return 0;
+}
+
 int mspace_mallopt(int param_number, int value) {
   return change_mparam(param_number, value);
 }
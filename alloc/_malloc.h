@@ -595,12 +595,30 @@ struct mallinfo mspace_mallinfo(mspace msp);
 */
 int mspace_mallopt(int, int);
 
+/*
+  Placement options for mspace_malloc_virtual_ex. Options the system
+  cannot honor are dropped and the block falls back to a regular
+  virtual reservation.
+  HUGE_PAGES      transparent huge pages (MADV_HUGEPAGE), the block is
+                  sized and aligned to 2MB
+  HUGE_EXPLICIT   explicit huge pages (MAP_HUGETLB / MEM_LARGE_PAGES),
+                  falls back to HUGE_PAGES
+  NUMA_BIND       bind pages to the given NUMA node, or to the node of
+                  the calling thread if node is negative
+  NUMA_INTERLEAVE interleave pages across all allowed nodes (linux only)
+*/
+#define MSPACE_VIRTUAL_HUGE_PAGES       0x01
+#define MSPACE_VIRTUAL_HUGE_EXPLICIT    0x02
+#define MSPACE_VIRTUAL_NUMA_BIND        0x04
+#define MSPACE_VIRTUAL_NUMA_INTERLEAVE  0x08
+
 /*
   The following operate identically to their malloc counterparts
   but operate only for the given mspace argument
 */
 void* mspace_malloc(mspace msp, size_t bytes);
 void* mspace_malloc_virtual(mspace msp, size_t bytes);
+void* mspace_malloc_virtual_ex(mspace msp, size_t bytes, unsigned flags, int node);
 void* mspace_malloc_stack(mspace msp, size_t bytes, void* buffer);
 void mspace_free(/*mspace msp,*/ void* mem);
 void* mspace_calloc(mspace msp, size_t n_elements, size_t elem_size);
@@ -614,8 +632,10 @@ void** mspace_independent_comalloc(mspace msp, size_t n_elements,
 size_t mspace_bulk_free(mspace msp, void**, size_t n_elements);
 size_t mspace_usable_size(const void* mem);
 size_t mspace_virtual_size(const void* mem);
+size_t mspace_virtual_prefault(void* mem, size_t offset, size_t bytes);
 size_t mspace_stack_size(const void* mem);
 mspace mspace_from_ptr(const void* mem);
+size_t mspace_usable_size_owner(const void* mem, mspace* owner);
 void mspace_malloc_stats(mspace msp);
 int mspace_trim(mspace msp, size_t pad);
 size_t mspace_footprint(mspace msp);
@@ -4,9 +4,18 @@
 
 #include <comm/commtypes.h>
 #include <comm/alloc/slotalloc.h>
+#include <comm/dynarray.h>
+#include <algorithm>
 
 COID_NAMESPACE_BEGIN
 
+/// @brief Placement strategy of alloc_2d
+enum class alloc_2d_mode
+{
+    tree,                               //< recursive binary split of the area (default)
+    guillotine,                         //< guillotine cuts with a sorted index of free rectangles
+};
+
 /// @brief Allocator that manages 2D regions associated with user data.
 /// @tparam vec2d_type Type used for size and position.  
 ///         Must provide accessible members `x` and `y`,  
@@ -34,18 +43,48 @@ public: // internal definitions only
     using vec2d_t = vec2d_type;
     using value_type = vec2d_type::value_type;
 
+    /// @brief Occupancy and fragmentation of the allocation area
+    struct stats
+    {
+        uint64 used_area = 0;           //< area of allocated regions
+        uint64 free_area = 0;           //< area not allocated
+        uint64 largest_free_area = 0;   //< area of the largest free rectangle
+        uint allocated = 0;             //< number of allocated regions
+        uint free_rects = 0;            //< number of free rectangles
+
+        /// @return fraction of the area that is allocated
+        float occupancy() const {
+            uint64 total = used_area + free_area;
+            return total ? float(double(used_area) / double(total)) : 0.0f;
+        }
+
+        /// @return 0 if the free space is a single rectangle, approaching 1 as it gets split into small pieces
+        float fragmentation() const {
+            return free_area ? 1.0f - float(double(largest_free_area) / double(free_area)) : 0.0f;
+        }
+    };
+
 public: // method only
 
     /// @brief Constructor for alloc_2d.
     /// @param size Length of a side of the rectangular allocation area.
     /// @param initial_split_size Size of the initial subdivision of the area. (TODO: clarify)
-    alloc_2d(const value_type size, const value_type initial_split_size)
+    /// @param mode Placement strategy, initial_split_size is used only by the tree mode.
+    alloc_2d(const value_type size, const value_type initial_split_size, const alloc_2d_mode mode = alloc_2d_mode::tree)
         : _node_pool()
-        , _root(_node_pool.new_node(vec2d_type(0, 0), vec2d_type(size), handle()))
+        , _root()
         , _initial_split_size(initial_split_size)
         , _size(size)
+        , _mode(mode)
     {
-        if (_initial_split_size > 0) {
+        if (_mode == alloc_2d_mode::guillotine) {
+            insert_free(free_rect(0, 0, _size, _size));
+        }
+        else {
+            _root = _node_pool.new_node(vec2d_type(0, 0), vec2d_type(size), handle());
+        }
+
+        if (_mode == alloc_2d_mode::tree && _initial_split_size > 0) {
             int depth = 0;
             node::divide(_root, vec2d_type(_initial_split_size, _initial_split_size), _node_pool, depth);
         }
@@ -58,17 +97,99 @@ public: // method only
     /// @return A handle to the allocated region, or an invalid handle if allocation fails.
     handle alloc(const vec2d_type& size)
     {
+        if (_mode == alloc_2d_mode::guillotine)
+            return alloc_guillotine(size);
+
         const handle id = node::insert(_root, size, _node_pool);
         return id;
     }
 
+    /// @brief Allocates multiple regions, placing the larger ones first for better packing.
+    /// @param sizes Sizes of the regions to allocate.
+    /// @param n Number of regions.
+    /// @param ids [out] Handles in the order of \a sizes, invalid for regions that did not fit.
+    /// @return Number of allocated regions.
+    uints alloc_many(const vec2d_type* sizes, uints n, handle* ids)
+    {
+        dynarray<uints> order;
+        uints* po = order.alloc(n);
+        for (uints i = 0; i < n; ++i)
+            po[i] = i;
+
+        //by the longer side, then by the shorter one
+        std::sort(po, po + n, [sizes](uints a, uints b) {
+            const vec2d_type& sa = sizes[a];
+            const vec2d_type& sb = sizes[b];
+            const value_type la = std::max(sa.x, sa.y), lb = std::max(sb.x, sb.y);
+            if (la != lb)
+                return la > lb;
+            return std::min(sa.x, sa.y) > std::min(sb.x, sb.y);
+        });
+
+        uints count = 0;
+        for (uints i = 0; i < n; ++i) {
+            handle& id = ids[po[i]];
+            id = alloc(sizes[po[i]]);
+            if (id.is_valid())
+                ++count;
+        }
+
+        return count;
+    }
+
     /// @brief Frees a previously allocated region.
     /// @param id Handle of the region to free.
     void free(handle id)
     {
-        free_internal(id, true);
+        if (_mode == alloc_2d_mode::guillotine)
+            free_guillotine(id);
+        else
+            free_internal(id, true);
     }
 
+    /// @brief Computes occupancy and fragmentation of the allocation area.
+    /// @note Walks all free rectangles (guillotine) or all nodes (tree).
+    stats get_stats() const
+    {
+        stats st;
+
+        if (_mode == alloc_2d_mode::guillotine) {
+            st.allocated = _allocated;
+            st.used_area = _used_area;
+            st.free_rects = uint(_by_size.size());
+
+            for (const free_rect& f : _by_size) {
+                const uint64 area = uint64(f.w) * uint64(f.h);
+                st.free_area += area;
+                if (area > st.largest_free_area)
+                    st.largest_free_area = area;
+            }
+            return st;
+        }
+
+        _node_pool.for_each([&st](const node& n) {
+            if (!n.is_leaf())
+                return;
+
+            const uint64 area = uint64(n._size.x) * uint64(n._size.y);
+            if (n.has_data()) {
+                ++st.allocated;
+                st.used_area += area;
+            }
+            else {
+                ++st.free_rects;
+                st.free_area += area;
+                if (area > st.largest_free_area)
+                    st.largest_free_area = area;
+            }
+        });
+
+        return st;
+    }
+
+    /// @return Placement strategy.
+    alloc_2d_mode mode() const { return _mode; }
+
     /// @brief Retrieves the data associated with a region.
     /// @param id Handle of the allocated region.
     /// @return The data associated with the region.
@@ -94,7 +215,14 @@ public: // method only
     void reset()
     {
         _node_pool.clear();
-        _root = _node_pool.new_node(vec2d_type(0, 0), vec2d_type(_size), handle());
+
+        if (_mode == alloc_2d_mode::guillotine) {
+            clear_free();
+            insert_free(free_rect(0, 0, _size, _size));
+        }
+        else {
+            _root = _node_pool.new_node(vec2d_type(0, 0), vec2d_type(_size), handle());
+        }
     }
 
 protected: // methods only 
@@ -102,24 +230,203 @@ protected: // methods only
     {
         node* const n = _node_pool.ptr(id);
 
-        const handle parent_id = n->_parent;
+        if (is_leaf)
+            n->_flags = 0; // clean data flag
 
-        if (parent_id.is_valid()) {
-            node* const parent = _node_pool.ptr(n->_parent);
+        //merge released siblings up the tree
+        handle parent_id = n->_parent;
+
+        while (parent_id.is_valid()) {
+            node* const parent = _node_pool.ptr(parent_id);
             const node* const child0 = _node_pool.ptr(parent->_child.x);
             const node* const child1 = _node_pool.ptr(parent->_child.y);
 
-            if (is_leaf)
-                n->_flags = 0; // clean data flag
+            if (!child0->can_release() || !child1->can_release())
+                break;
+
+            _node_pool.delete_node(parent->_child.x);
+            _node_pool.delete_node(parent->_child.y);
+            parent->_child.x = parent->_child.y = handle();
+            parent_id = parent->_parent;
+        }
+    }
+
+    ///Free rectangle of the guillotine mode
+    struct free_rect
+    {
+        value_type x, y, w, h;
+
+        free_rect() : x(0), y(0), w(0), h(0) {}
+
+        free_rect(value_type x, value_type y, value_type w, value_type h)
+            : x(x), y(y), w(w), h(h)
+        {}
+    };
+
+    ///Order by height, width, then position, for best-fit lookups
+    static bool less_size(const free_rect& a, const free_rect& b) {
+        if (a.h != b.h) return a.h < b.h;
+        if (a.w != b.w) return a.w < b.w;
+        if (a.y != b.y) return a.y < b.y;
+        return a.x < b.x;
+    }
+
+    ///Order by the top-left corner
+    static bool less_min(const free_rect& a, const free_rect& b) {
+        if (a.y != b.y) return a.y < b.y;
+        return a.x < b.x;
+    }
+
+    ///Order by the bottom-right corner
+    static bool less_max(const free_rect& a, const free_rect& b) {
+        if (a.y + a.h != b.y + b.h) return a.y + a.h < b.y + b.h;
+        return a.x + a.w < b.x + b.w;
+    }
+
+    template<class FN>
+    static uints find_rect(const dynarray<free_rect>& index, const free_rect& key, FN fn) {
+        const uints i = index.lower_bound(key, fn);
+        return i < index.size() && !fn(key, index[i]) ? i : UMAXS;
+    }
+
+    void insert_free(const free_rect& r)
+    {
+        _by_size.push_sort(r, &less_size);
+        _by_min.push_sort(r, &less_min);
+        _by_max.push_sort(r, &less_max);
+    }
+
+    void remove_free(const free_rect& r)
+    {
+        _by_size.del(find_rect(_by_size, r, &less_size));
+        _by_min.del(find_rect(_by_min, r, &less_min));
+        _by_max.del(find_rect(_by_max, r, &less_max));
+    }
+
+    void clear_free()
+    {
+        _by_size.reset();
+        _by_min.reset();
+        _by_max.reset();
+        _allocated = 0;
+        _used_area = 0;
+    }
+
+    /// @return index of the lowest free rectangle that fits, with the narrowest width among those, or UMAXS
+    uints find_free(const value_type w, const value_type h) const
+    {
+        const uints n = _by_size.size();
+        uints i = _by_size.lower_bound(free_rect(0, 0, w, h), &less_size);
+
+        while (i < n) {
+            const free_rect& f = _by_size[i];
+            if (f.w >= w)
+                return i;
+
+            //nothing wide enough with this height, skip to the next height class
+            i = _by_size.lower_bound(free_rect(0, 0, w, f.h), &less_size);
+        }
+
+        return UMAXS;
+    }
+
+    handle alloc_guillotine(const vec2d_type& size)
+    {
+        const uints i = find_free(size.x, size.y);
+        if (i == UMAXS)
+            return handle();
+
+        const free_rect f = _by_size[i];
+        remove_free(f);
+
+        //split along the shorter leftover axis, keeping the larger remainder whole
+        const value_type dw = f.w - size.x;
+        const value_type dh = f.h - size.y;
+        free_rect right, bottom;
 
-            if (child0->can_release() && child1->can_release())
-            {
-                _node_pool.delete_node(parent->_child.x);
-                _node_pool.delete_node(parent->_child.y);
-                parent->_child.x = parent->_child.y = handle();
-                free_internal(parent_id, false);
+        if (dw < dh) {
+            right = free_rect(f.x + size.x, f.y, dw, size.y);
+            bottom = free_rect(f.x, f.y + size.y, f.w, dh);
+        }
+        else {
+            right = free_rect(f.x + size.x, f.y, dw, f.h);
+            bottom = free_rect(f.x, f.y + size.y, size.x, dh);
+        }
+
+        if (right.w > 0 && right.h > 0)
+            insert_free(right);
+        if (bottom.w > 0 && bottom.h > 0)
+            insert_free(bottom);
+
+        const handle id = _node_pool.new_node(vec2d_type(f.x, f.y), size, handle());
+        _node_pool.ptr(id)->_flags = 1;
+
+        ++_allocated;
+        _used_area += uint64(size.x) * uint64(size.y);
+        return id;
+    }
+
+    void free_guillotine(handle id)
+    {
+        const node* const n = _node_pool.ptr(id);
+        free_rect r(n->_pos.x, n->_pos.y, n->_size.x, n->_size.y);
+
+        --_allocated;
+        _used_area -= uint64(r.w) * uint64(r.h);
+        _node_pool.delete_node(id);
+
+        if (_allocated == 0) {
+            clear_free();
+            insert_free(free_rect(0, 0, _size, _size));
+            return;
+        }
+
+        //merge with free neighbors that share a whole edge
+        for (;;) {
+            uints k;
+
+            //right
+            k = find_rect(_by_min, free_rect(r.x + r.w, r.y, 0, 0), &less_min);
+            if (k != UMAXS && _by_min[k].h == r.h) {
+                const free_rect o = _by_min[k];
+                remove_free(o);
+                r.w += o.w;
+                continue;
+            }
+
+            //below
+            k = find_rect(_by_min, free_rect(r.x, r.y + r.h, 0, 0), &less_min);
+            if (k != UMAXS && _by_min[k].w == r.w) {
+                const free_rect o = _by_min[k];
+                remove_free(o);
+                r.h += o.h;
+                continue;
             }
+
+            //left
+            k = find_rect(_by_max, free_rect(r.x, r.y + r.h, 0, 0), &less_max);
+            if (k != UMAXS && _by_max[k].h == r.h) {
+                const free_rect o = _by_max[k];
+                remove_free(o);
+                r.x = o.x;
+                r.w += o.w;
+                continue;
+            }
+
+            //above
+            k = find_rect(_by_max, free_rect(r.x + r.w, r.y, 0, 0), &less_max);
+            if (k != UMAXS && _by_max[k].w == r.w) {
+                const free_rect o = _by_max[k];
+                remove_free(o);
+                r.y = o.y;
+                r.h += o.h;
+                continue;
+            }
+
+            break;
         }
+
+        insert_free(r);
     }
 
 private: // internal definitions only
@@ -151,6 +458,9 @@ private: // internal definitions only
         handle id(const node* const ptr) const { return _nodes.get_item_id(ptr); }
 
         void clear() { _nodes.reset(); }
+
+        template<typename Func>
+        void for_each(Func f) const { _nodes.for_each(f); }
     };
 
     class node
@@ -268,6 +578,13 @@ private: // members only
     handle _root;
     const value_type _initial_split_size;
     const value_type _size;
+    const alloc_2d_mode _mode;
+
+    dynarray<free_rect> _by_size;       //< free rectangles sorted by size (guillotine mode)
+    dynarray<free_rect> _by_min;        //< free rectangles sorted by top-left corner
+    dynarray<free_rect> _by_max;        //< free rectangles sorted by bottom-right corner
+    uint _allocated = 0;
+    uint64 _used_area = 0;
 
 };
 
@@ -0,0 +1,172 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is COID/comm module.
+ *
+ * The Initial Developer of the Original Code is
+ * Brano Kemen
+ * Portions created by the Initial Developer are Copyright (C) 2009
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+
+#include "arena.h"
+
+namespace coid {
+
+static thread_local arena* _current_arena = 0;
+
+////////////////////////////////////////////////////////////////////////////////
+arena::scope::scope(arena& a)
+    : _arena(&a)
+    , _prev(_current_arena)
+    , _mark(a.mark())
+{
+    _current_arena = &a;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+arena::scope::~scope()
+{
+    _arena->rewind(_mark);
+    _current_arena = _prev;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+arena& arena::local()
+{
+    static thread_local arena _local;
+    return _local;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+arena& arena::current()
+{
+    arena* a = _current_arena;
+    return a ? *a : local();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+char* arena::alloc_slow(uints size, uints align)
+{
+    //try the retained chunks first
+    chunk* c = _chunk ? _chunk->next : _first;
+    for (; c; c = c->next) {
+        char* p = align_up(c->begin(), align);
+        if (p + size <= c->end())
+            break;
+    }
+
+    if (!c) {
+        //leave room for the block to grow in place
+        uints csize = 2 * (size + align);
+        if (csize < _chunk_size)
+            csize = _chunk_size;
+        c = static_cast<chunk*>(::dlmalloc(sizeof(chunk) + csize));
+        if (!c)
+            throw std::bad_alloc();
+        c->size = csize;
+
+        //link after the current chunk, chunks too small for this request stay behind it
+        c->prev = _chunk;
+        c->next = _chunk ? _chunk->next : _first;
+        if (c->next)
+            c->next->prev = c;
+        if (_chunk)
+            _chunk->next = c;
+        else
+            _first = c;
+    }
+    else if (c->prev != _chunk) {
+        //move the fitting retained chunk right after the current one
+        c->prev->next = c->next;
+        if (c->next)
+            c->next->prev = c->prev;
+
+        c->prev = _chunk;
+        c->next = _chunk ? _chunk->next : _first;
+        c->next->prev = c;
+        if (_chunk)
+            _chunk->next = c;
+        else
+            _first = c;
+    }
+
+    _chunk = c;
+    _end = c->end();
+    return align_up(c->begin(), align);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void arena::rewind(const marker& m)
+{
+    _chunk = static_cast<chunk*>(m.chunk);
+
+    if (_chunk) {
+        _top = m.top;
+        _end = _chunk->end();
+    }
+    else
+        _top = _end = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void arena::release()
+{
+    chunk* c = _first;
+    while (c) {
+        chunk* n = c->next;
+        ::dlfree(c);
+        c = n;
+    }
+
+    _chunk = _first = 0;
+    _top = _end = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uints arena::used() const
+{
+    uints n = 0;
+    for (chunk* c = _first; c && c != _chunk; c = c->next)
+        n += c->size;
+
+    return _chunk ? n + (_top - _chunk->begin()) : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uints arena::reserved() const
+{
+    uints n = 0;
+    for (chunk* c = _first; c; c = c->next)
+        n += c->size;
+
+    return n;
+}
+
+} //namespace coid
@@ -0,0 +1,395 @@
+#pragma once
+/* ***** BEGIN LICENSE BLOCK *****
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is COID/comm module.
+ *
+ * The Initial Developer of the Original Code is
+ * Brano Kemen
+ * Portions created by the Initial Developer are Copyright (C) 2009-2017
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef __COID_ARENA__HEADER_FILE__
+#define __COID_ARENA__HEADER_FILE__
+
+#include "../namespace.h"
+#include "../dynarray.h"
+
+COID_NAMESPACE_BEGIN
+
+////////////////////////////////////////////////////////////////////////////////
+///Bump-pointer arena for short-lived temporaries
+/// Memory is carved from chained chunks, individual blocks are not freed (except the
+/// last one); the whole arena or its part since a marker is released by a pointer reset.
+/// Chunks are retained after rewinding and reused by subsequent allocations.
+class arena
+{
+public:
+
+    static const uints DEFAULT_CHUNK_SIZE = 64 << 10;
+    static const uints ALIGNMENT = 16;
+
+    ///Arena position to rewind to
+    struct marker {
+        void* chunk = 0;
+        char* top = 0;
+    };
+
+    ///Scope that makes an arena current for arena_array_allocator and rewinds it on exit
+    class scope
+    {
+    public:
+        explicit scope(arena& a = local());
+        ~scope();
+
+        arena& get() const { return *_arena; }
+
+    private:
+        scope(const scope&) = delete;
+        scope& operator = (const scope&) = delete;
+
+        arena* _arena;
+        arena* _prev;
+        marker _mark;
+    };
+
+
+    explicit arena(uints chunk_size = DEFAULT_CHUNK_SIZE)
+        : _chunk_size(chunk_size)
+    {}
+
+    ~arena() {
+        release();
+    }
+
+    ///Allocate memory
+    /// @param size size in bytes
+    /// @param align power of 2 alignment
+    void* alloc(uints size, uints align = ALIGNMENT)
+    {
+        char* p = align_up(_top, align);
+        if (!p || p + size > _end)
+            p = alloc_slow(size, align);
+        _top = p + size;
+        return p;
+    }
+
+    ///Allocate uninitialized array of \a n items
+    template<class T>
+    T* alloc_array(uints n) {
+        return static_cast<T*>(alloc(n * sizeof(T), alignof(T) > ALIGNMENT ? alignof(T) : ALIGNMENT));
+    }
+
+    ///Get a buffer for dynarray/charstr constructors accepting a stack_buffer (like STACK_RESERVE or STACK_STRING)
+    /// @note the container treats the memory as stack memory: it's never freed by it and
+    ///       the content is copied to the heap if the container outgrows the buffer
+    template<class T>
+    stack_buffer<T> buffer(uints count) {
+        return stack_buffer<T>(count, alloc(stack_buffer<T>::required_size(count)));
+    }
+
+    ///Resize the last allocated block in place
+    /// @param p block pointer
+    /// @param size current block size
+    /// @param newsize new block size, 0 frees the block
+    /// @return true if the block was the last one and it fits into the chunk
+    bool resize_last(void* p, uints size, uints newsize)
+    {
+        char* c = static_cast<char*>(p);
+        if (c + size != _top || c + newsize > _end)
+            return false;
+
+        _top = c + newsize;
+        return true;
+    }
+
+    /// @return current position
+    marker mark() const {
+        marker m;
+        m.chunk = _chunk;
+        m.top = _top;
+        return m;
+    }
+
+    ///Rewind to a marker obtained by mark(), releasing everything allocated since
+    void rewind(const marker& m);
+
+    ///Rewind to the beginning, keeping the chunks for reuse
+    void reset() {
+        rewind(marker());
+    }
+
+    ///Free all chunks
+    void release();
+
+    /// @return number of bytes allocated (including alignment padding)
+    uints used() const;
+
+    /// @return number of bytes in all chunks
+    uints reserved() const;
+
+
+    ///Thread-local default arena
+    static arena& local();
+
+    ///Arena of the innermost scope on this thread, or the thread-local default arena
+    static arena& current();
+
+private:
+
+    arena(const arena&) = delete;
+    arena& operator = (const arena&) = delete;
+
+    struct chunk {
+        chunk* next;                    //< next chunk in the chain
+        chunk* prev;
+        uints size;                     //< usable size
+
+        char* begin() { return reinterpret_cast<char*>(this + 1); }
+        char* end() { return begin() + size; }
+    };
+
+    static char* align_up(char* p, uints align) {
+        return reinterpret_cast<char*>((reinterpret_cast<uints>(p) + align - 1) & ~(align - 1));
+    }
+
+    char* alloc_slow(uints size, uints align);
+
+    chunk* _chunk = 0;                  //< current chunk
+    chunk* _first = 0;                  //< first chunk of the chain
+    char* _top = 0;                     //< first free byte in the current chunk
+    char* _end = 0;                     //< end of the current chunk
+    uints _chunk_size;                  //< default chunk size
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+///Array allocator policy allocating from the current arena (see arena::scope)
+/// Usage: dynarray<T, uints, arena_array_allocator>
+/// Blocks use the stack-chunk layout of comm_array_mspace, so that dlmalloc never tries to
+/// free them. Freeing or shrinking the last block of the arena returns the memory, growing
+/// it extends it in place, otherwise the array is copied to a new block.
+/// @note arrays must not outlive the arena scope they were allocated in
+struct arena_array_allocator : comm_array_allocator
+{
+    ///Typed array alloc
+    template<class T>
+    static T* alloc(uints n, mspace m = 0) {
+        return (T*)alloc(n, sizeof(T), &coid::type_info::get<T[]>(), m);
+    }
+
+    ///Typed array realloc
+    template<class T>
+    static T* realloc(const T* p, uints n, mspace m = 0)
+    {
+        if (!p)
+            return alloc<T>(n, m);
+
+        T* pn = realloc_in_place<T>(p, n);
+        if (!pn) {
+            pn = alloc<T>(n, m);
+            uints co = count(p);
+            if (co > n)
+                co = n;
+
+            if (has_trivial_rebase<T>::value)
+                ::memcpy(pn, p, co * sizeof(T));
+            else
+                rebase<has_trivial_rebase<T>::value, T>::perform((T*)p, (T*)p + co, pn);
+
+            free(p);
+        }
+        return pn;
+    }
+
+    ///Typed array realloc_in_place
+    template<class T>
+    static T* realloc_in_place(const T* p, uints n, mspace m = 0) {
+        return (T*)realloc_in_place(p, n, sizeof(T));
+    }
+
+    ///Typed array add
+    template<class T>
+    static T* add(const T* p, uints n) {
+        return (T*)add(p, n, sizeof(T));
+    }
+
+    ///Typed array free
+    template<class T>
+    static void free(const T* p) {
+        free((const void*)p);
+    }
+
+    ///Virtual reservation is served from the arena as a regular array
+    template<class T>
+    static T* reserve_virtual(uints n, mspace m = 0) {
+        return alloc<T>(n, m);
+    }
+
+    ///Placement options don't apply to arena memory
+    template<class T>
+    static T* reserve_virtual(uints n, reserve_mode mode, mspace m = 0) {
+        return alloc<T>(n, m);
+    }
+
+    ///Stack reservation is served from the arena as a regular array, the buffer is unused
+    template<class T>
+    static T* reserve_stack(uints n, void* buffer, uints buffer_size) {
+        return alloc<T>(n);
+    }
+
+
+    ///Untyped array alloc
+    static void* alloc(
+        uints n,
+        uints elemsize,
+        const coid::type_info* tracking = 0,
+        mspace m = 0
+    )
+    {
+        uints bytes = block_size(n * elemsize);
+        void* buf = arena::current().alloc(bytes);
+        return make_block(buf, bytes, n);
+    }
+
+    ///Untyped array realloc, trivially rebased items only
+    static void* realloc(
+        const void* p,
+        uints n,
+        uints elemsize,
+        const coid::type_info* tracking = 0,
+        mspace m = 0
+    )
+    {
+        if (!p)
+            return alloc(n, elemsize, tracking, m);
+
+        void* pn = realloc_in_place(p, n, elemsize, tracking);
+        if (!pn) {
+            uints co = count(p);
+            pn = alloc(n, elemsize, tracking, m);
+            ::memcpy(pn, p, (co < n ? co : n) * elemsize);
+            free(p);
+        }
+        return pn;
+    }
+
+    ///Untyped array realloc in place, succeeds only for the last block of the current arena
+    static void* realloc_in_place(
+        const void* p,
+        uints n,
+        uints elemsize,
+        const coid::type_info* tracking = 0
+    )
+    {
+        if (!p)
+            return 0;
+
+        uints bytes = block_size(n * elemsize);
+        if (n * elemsize <= size(p)) {
+            set_count(p, n);
+            return const_cast<void*>(p);
+        }
+
+        char* buf = block_ptr(p);
+        if (!arena::current().resize_last(buf, block_size(size(p)), bytes))
+            return 0;
+
+        return make_block(buf, bytes, n);
+    }
+
+    ///Untyped array free, releases the memory only if it's the last block of the current arena
+    static void free(
+        const void* p,
+        const coid::type_info* tracking = 0
+    )
+    {
+        if (p)
+            arena::current().resize_last(block_ptr(p), block_size(size(p)), 0);
+    }
+
+    ///Untyped uninitialized add
+    /// @return pointer to array
+    static void* add(
+        const void* p,
+        uints nitems,
+        uints elemsize,
+        const coid::type_info* tracking = 0,
+        mspace m = 0)
+    {
+        uints n = count(p);
+        if (!nitems)
+            return const_cast<void*>(p);
+
+        uints nto = nitems + n;
+        uints nalloc = nto;
+
+        void* np = const_cast<void*>(p);
+
+        if (nalloc * elemsize > size(p)) {
+            if (nalloc < 2 * n)
+                nalloc = 2 * n;
+
+            np = realloc(p, nalloc, elemsize, tracking, m);
+        }
+
+        set_count(np, nto);
+        return np;
+    }
+
+    ///Arena blocks are owned by the arena, containers can move them freely
+    static uints reserved_stack_size(const void* p) {
+        return 0;
+    }
+
+private:
+
+    //block header size, payload keeps the 16B alignment of comm_array_mspace blocks
+    static const uints HEADER = 16;
+
+    static uints block_size(uints bytes) {
+        return HEADER + ((bytes + arena::ALIGNMENT - 1) & ~(arena::ALIGNMENT - 1));
+    }
+
+    static char* block_ptr(const void* p) {
+        return (char*)p - HEADER;
+    }
+
+    static void* make_block(void* buf, uints bytes, uints n)
+    {
+        //format as a stack chunk, dlmalloc then reports its size and never frees it
+        uints* p = (uints*)mspace_malloc_stack(SINGLETON(comm_array_mspace).msp, bytes, buf);
+        p[0] = n;
+        return p + 1;
+    }
+};
+
+COID_NAMESPACE_END
+
+#endif //#ifndef __COID_ARENA__HEADER_FILE__
@@ -0,0 +1,101 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is COID/comm module.
+ *
+ * The Initial Developer of the Original Code is
+ * Brano Kemen
+ * Portions created by the Initial Developer are Copyright (C) 2009
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+
+#include "commalloc.h"
+#include <thread>
+
+namespace coid {
+
+////////////////////////////////////////////////////////////////////////////////
+uints comm_array_allocator::prefault_virtual(const void* p, uints bytes, uint nthreads)
+{
+    if (!p)
+        return 0;
+
+    void* mem = (uints*)p - 1;
+    uints vsize = ::mspace_virtual_size(mem);
+    if (vsize == 0)
+        return 0;
+
+    //include the count header
+    bytes = bytes < vsize - sizeof(uints) ? bytes + sizeof(uints) : vsize;
+
+    //slices of at least 64MB, boundaries on huge pages so that threads don't share them
+    static const uints SLICE_MIN = 64 << 20;
+    static const uints SLICE_ALIGN = 2 << 20;
+    static const uint MAX_THREADS = 64;
+
+    if (nthreads == 0)
+        nthreads = std::thread::hardware_concurrency();
+
+    uints nslices = (bytes + SLICE_MIN - 1) / SLICE_MIN;
+    if (nslices > nthreads)
+        nslices = nthreads;
+    if (nslices > MAX_THREADS)
+        nslices = MAX_THREADS;
+    if (nslices < 1)
+        nslices = 1;
+
+    //the block is only page aligned, the first slice also takes the part before the first huge page boundary
+    uints head = (SLICE_ALIGN - (uints(mem) & (SLICE_ALIGN - 1))) & (SLICE_ALIGN - 1);
+    if (head > bytes)
+        head = bytes;
+
+    uints slice = ((bytes - head + nslices - 1) / nslices + SLICE_ALIGN - 1) & ~(SLICE_ALIGN - 1);
+
+    std::thread workers[MAX_THREADS];
+    for (uints i = 1; i < nslices; ++i) {
+        uints offset = head + i * slice;
+        if (offset >= bytes)
+            break;
+        uints size = offset + slice > bytes ? bytes - offset : slice;
+        workers[i] = std::thread([mem, offset, size]() {
+            ::mspace_virtual_prefault(mem, offset, size);
+        });
+    }
+
+    ::mspace_virtual_prefault(mem, 0, head + slice < bytes ? head + slice : bytes);
+
+    for (uints i = 1; i < nslices; ++i) {
+        if (workers[i].joinable())
+            workers[i].join();
+    }
+
+    return bytes - sizeof(uints);
+}
+
+} //namespace coid
@@ -54,12 +54,41 @@ void* memaligned_alloc(size_t size, size_t alignment);
 void memaligned_free(void* p);
 uints memaligned_used();
 
+////////////////////////////////////////////////////////////////////////////////
+///Reservation mode for linear containers
+/// Placement options combine with virtual_space, e.g. reserve_mode::virtual_space | reserve_mode::huge_pages,
+/// options the system can't honor are dropped
+enum class reserve_mode : uint
+{
+    memory = 0,                 //< reserve & commit memory to use initially, resizeable with rebase allowed
+    virtual_space = 1,          //< reserve virtual address space for use for the whole lifetime, allocated dynamically
+
+    huge_pages = 0x10,          //< back with transparent huge pages (MADV_HUGEPAGE), reservation is rounded to 2MB
+    huge_pages_explicit = 0x20, //< explicit huge pages (MAP_HUGETLB, MEM_LARGE_PAGES), falls back to huge_pages
+    numa_bind = 0x40,           //< bind pages to the node given by reserve_numa_node(), or to the node of the reserving thread
+    numa_interleave = 0x80,     //< interleave pages across all allowed NUMA nodes (linux only)
+    prefault = 0x100,           //< commit and fault in the whole reservation upfront, in parallel
+};
+
+inline constexpr reserve_mode operator | (reserve_mode a, reserve_mode b) {
+    return reserve_mode(uint(a) | uint(b));
+}
+
+inline constexpr bool operator & (reserve_mode a, reserve_mode b) {
+    return (uint(a) & uint(b)) != 0;
+}
+
+///Virtual space reservation bound to given NUMA node
+inline constexpr reserve_mode reserve_numa_node(uint node) {
+    return reserve_mode::virtual_space | reserve_mode::numa_bind | reserve_mode((node + 1) << 16);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 template<class T>
 struct comm_allocator
 {
-    static T* alloc() { return (T*)::dlmalloc(sizeof(T)); }
-    static void free(T* p) { ::dlfree(p); }
+    static T* alloc() { return (T*)thread_cache::alloc(sizeof(T)); }
+    static void free(T* p) { thread_cache::free(p); }
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -100,6 +129,12 @@ struct comm_array_allocator
         return (T*)reserve_virtual(n, sizeof(T), &coid::type_info::get<T[]>(), m);
     }
 
+    ///Typed array reserve of virtual memory with placement options
+    template<class T>
+    static T* reserve_virtual(uints n, reserve_mode mode, mspace m = 0) {
+        return (T*)reserve_virtual(n, sizeof(T), &coid::type_info::get<T[]>(), m, mode);
+    }
+
     ///Typed array reserve of virtual memory
     template<class T>
     static T* reserve_stack(uints n, void* buffer, uints buffer_size) {
@@ -155,9 +190,20 @@ struct comm_array_allocator
     }
 
     ///Typed array add
+    /// @note types with non-trivial rebase grow through realloc<T> instead of the byte copy
     template<class T>
     static T* add(const T* p, uints n) {
-        return (T*)add(p, n, sizeof(T), &coid::type_info::get<T[]>());
+        if (has_trivial_rebase<T>::value)
+            return (T*)add(p, n, sizeof(T), &coid::type_info::get<T[]>());
+
+        uints nto = count(p) + n;
+        T* np = const_cast<T*>(p);
+
+        if (nto * sizeof(T) > size(p))
+            np = realloc<T>(p, nto < 2 * count(p) ? 2 * count(p) : nto);
+
+        set_count(np, nto);
+        return np;
     }
 
     ///Typed array free
@@ -168,24 +214,40 @@ struct comm_array_allocator
 
 
     ///Untyped array reserve of virtual space
+    /// @param mode placement options, see reserve_mode
     static void* reserve_virtual(
         uints n,
         uints elemsize,
         const coid::type_info* tracking = 0,
-        mspace m = 0
+        mspace m = 0,
+        reserve_mode mode = reserve_mode::virtual_space
     )
     {
-        uints* p = (uints*)::mspace_malloc_virtual(
-            m ? m : SINGLETON(comm_array_mspace).msp,
-            sizeof(uints) + n * elemsize);
+        ::mspace msp = m ? m : SINGLETON(comm_array_mspace).msp;
+        uints size = sizeof(uints) + n * elemsize;
+        uint flags = virtual_flags(mode);
+
+        uints* p = (uints*)(flags
+            ? ::mspace_malloc_virtual_ex(msp, size, flags, int(uint(mode) >> 16) - 1)
+            : ::mspace_malloc_virtual(msp, size));
 
-        dbg_memtrack_alloc(tracking, ::mspace_usable_size(p));
+        dbg_memtrack_alloc(tracking, ::mspace_usable_size(p), p);
 
         if (!p) throw std::bad_alloc();
         p[0] = n;
+
+        if (mode & reserve_mode::prefault)
+            prefault_virtual(p + 1, n * elemsize);
         return p + 1;
     }
 
+    ///Commit and fault in the leading part of a virtual reservation, in parallel
+    /// @param p array created with reserve_virtual()
+    /// @param bytes number of bytes to prefault, clamped to the reserved size
+    /// @param nthreads number of threads to use, 0 for hardware concurrency
+    /// @return number of bytes prefaulted, 0 if the array isn't a virtual reservation
+    static uints prefault_virtual(const void* p, uints bytes, uint nthreads = 0);
+
     ///Untyped array reserve of stack space
     /// @param buffer needs to be _alloca buffer of (2*sizeof(size_t) + n*elemsize) size
     static void* reserve_stack(
@@ -211,11 +273,12 @@ struct comm_array_allocator
         mspace m = 0
     )
     {
-        uints* p = (uints*)::mspace_malloc(
-            m ? m : SINGLETON(comm_array_mspace).msp,
-            sizeof(uints) + n * elemsize);
+        uints size = sizeof(uints) + n * elemsize;
+        uints* p = (uints*)(m
+            ? ::mspace_malloc(m, size)
+            : thread_cache::alloc_array(size, SINGLETON(comm_array_mspace).msp));
 
-        dbg_memtrack_alloc(tracking, ::mspace_usable_size(p));
+        dbg_memtrack_alloc(tracking, ::mspace_usable_size(p), p);
 
         if (!p) throw std::bad_alloc();
         p[0] = n;
@@ -234,7 +297,7 @@ struct comm_array_allocator
         if (!p)
             return alloc(n, elemsize, tracking, m);
 
-        dbg_memtrack_free(tracking, ::mspace_usable_size((uints*)p - 1));
+        dbg_memtrack_free(tracking, ::mspace_usable_size((uints*)p - 1), (uints*)p - 1);
 
         uints* pn = (uints*)::mspace_realloc(
             m ? m : SINGLETON(comm_array_mspace).msp,
@@ -243,7 +306,7 @@ struct comm_array_allocator
         if (!pn)
             throw std::bad_alloc();
 
-        dbg_memtrack_alloc(tracking, ::mspace_usable_size(pn));
+        dbg_memtrack_alloc(tracking, ::mspace_usable_size(pn), pn);
 
         pn[0] = n;
         return pn + 1;
@@ -269,8 +332,8 @@ struct comm_array_allocator
         if (!pn)
             return 0;
 
-        dbg_memtrack_free(tracking, so);
-        dbg_memtrack_alloc(tracking, ::mspace_usable_size(pn));
+        dbg_memtrack_free(tracking, so, po);
+        dbg_memtrack_alloc(tracking, ::mspace_usable_size(pn), pn);
 
         pn[0] = n;
         return pn + 1;
@@ -284,8 +347,8 @@ struct comm_array_allocator
     {
         if (!p)  return;
 
-        dbg_memtrack_free(tracking, ::mspace_usable_size((uints*)p - 1));
-        ::mspace_free((uints*)p - 1);
+        dbg_memtrack_free(tracking, ::mspace_usable_size((uints*)p - 1), (uints*)p - 1);
+        thread_cache::free((uints*)p - 1);
     }
 
     ///Untyped uninitialized add
@@ -328,6 +391,14 @@ struct comm_array_allocator
         return size ? size - sizeof(uints) : 0;
     }
 
+    ///Map reserve_mode placement options to dlmalloc MSPACE_VIRTUAL_* flags
+    static constexpr uint virtual_flags(reserve_mode mode) {
+        return ((mode & reserve_mode::huge_pages) ? MSPACE_VIRTUAL_HUGE_PAGES : 0)
+            | ((mode & reserve_mode::huge_pages_explicit) ? MSPACE_VIRTUAL_HUGE_EXPLICIT : 0)
+            | ((mode & reserve_mode::numa_bind) ? MSPACE_VIRTUAL_NUMA_BIND : 0)
+            | ((mode & reserve_mode::numa_interleave) ? MSPACE_VIRTUAL_NUMA_INTERLEAVE : 0);
+    }
+
     /// @return size of virtual memory, if the block was created using reserve_virtual(), else 0
     static uints reserved_virtual_size(const void* p) {
         if (!p)
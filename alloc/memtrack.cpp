@@ -43,6 +43,9 @@
 
 #include "../binstream/filestream.h"
 
+#include <atomic>
+#include <cmath>
+
 #ifdef _DEBUG
 static const bool default_enabled = true;
 #else
@@ -99,9 +102,15 @@ static void name_filter(charstr& dst, token name)
 //    uint operator()(size_t x) const { return (uint)x; }
 //};
 
+///Merged record with the lifetime counters at the last list call
+struct memtrack_rec : memtrack {
+    size_t listed_lifesize = 0;
+    uint listed_nallocs = 0;
+};
+
 struct memtrack_key_extractor {
     using ret_type = uint;
-    ret_type  operator()(const memtrack& m) const { return m.hash; }
+    ret_type  operator()(const memtrack_rec& m) const { return m.hash; }
 };
 
 /// @brief  dummy hasher just return uint as it as because memtrack key is already hash
@@ -112,32 +121,235 @@ struct memtrack_key_hasher
 
 };
 
-typedef hash_keyset<memtrack, memtrack_key_extractor, memtrack_key_hasher>
+typedef hash_keyset<memtrack_rec, memtrack_key_extractor, memtrack_key_hasher>
 memtrack_hash_t;
 
+///Live blocks with a recorded stack trace
+typedef hash_keyset<const void*, _Select_Copy<const void*, const void*>>
+memtrack_block_set_t;
+
+////////////////////////////////////////////////////////////////////////////////
+///Counters of a type within a single thread
+/// Written only by the owning thread, read by the merge in memtrack_list & co.
+/// Current size may be negative when blocks are freed by another thread than allocated them.
+struct thread_entry
+{
+    uint hash;
+    token name;
+    std::atomic<int64> cursize;
+    std::atomic<int64> lifesize;
+    std::atomic<int> ncurallocs;
+    std::atomic<uint> nlifeallocs;
+
+    template<class T>
+    static void add(std::atomic<T>& v, T d) {
+        //single writer, no need for a locked add
+        v.store(v.load(std::memory_order_relaxed) + d, std::memory_order_relaxed);
+    }
+};
+
+struct thread_chunk
+{
+    static const uint SIZE = 256;
+
+    thread_entry entries[SIZE];
+    thread_chunk* next = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+///Per-thread table of counters, reused by new threads after the owner exits
+struct thread_table
+{
+    std::atomic<bool> owned{true};
+    std::atomic<uint> count{0};         //< number of published entries
+    thread_chunk* first = 0;
+    thread_table* next = 0;             //< next table in the registrar list
+
+    //owner-only data
+    thread_chunk** chunks = 0;          //< chunk pointers for indexed access
+    uint nchunks = 0;
+    uint* index = 0;                    //< open addressing index to entries (1-based)
+    uint index_mask = 0;
+    int64 bytes_until_sample = 0;       //< sampling countdown
+    uint64 rng = 0;
+
+    thread_entry& entry(uint i) {
+        return chunks[i / thread_chunk::SIZE]->entries[i % thread_chunk::SIZE];
+    }
+
+    /// @return entry or null if the thread didn't count the type yet
+    thread_entry* find(uint hash)
+    {
+        uint i = hash & index_mask;
+        for (uint k; (k = index[i]) != 0; i = (i + 1) & index_mask) {
+            thread_entry& e = entry(k - 1);
+            if (e.hash == hash)
+                return &e;
+        }
+        return 0;
+    }
+
+    /// @param created [out] set to true if a new entry was inserted
+    thread_entry* find_or_insert(uint hash, const token& name, bool* created = 0)
+    {
+        uint i = hash & index_mask;
+        for (uint k; (k = index[i]) != 0; i = (i + 1) & index_mask) {
+            thread_entry& e = entry(k - 1);
+            if (e.hash == hash)
+                return &e;
+        }
+
+        if (created)
+            *created = true;
+
+        uint n = count.load(std::memory_order_relaxed);
+        if (n == nchunks * thread_chunk::SIZE && !add_chunk())
+            return 0;
+
+        thread_entry& e = entry(n);
+        e.hash = hash;
+        e.name = name;
+        index[i] = n + 1;
+
+        //publish to the merge
+        count.store(n + 1, std::memory_order_release);
+
+        if (2 * (n + 1) > index_mask)
+            grow_index();
+        return &e;
+    }
+
+    bool add_chunk()
+    {
+        thread_chunk** nc = (thread_chunk**)::dlrealloc(chunks, (nchunks + 1) * sizeof(thread_chunk*));
+        void* mem = ::dlmalloc(sizeof(thread_chunk));
+        if (!nc || !mem) {
+            if (nc) chunks = nc;
+            ::dlfree(mem);
+            return false;
+        }
+
+        thread_chunk* c = new(mem) thread_chunk();
+        chunks = nc;
+        chunks[nchunks] = c;
+        if (nchunks)
+            chunks[nchunks - 1]->next = c;
+        else
+            first = c;
+
+        ++nchunks;
+        return true;
+    }
+
+    void grow_index()
+    {
+        uint size = 2 * (index_mask + 1);
+        uint* ni = (uint*)::dlmalloc(size * sizeof(uint));
+        if (!ni)
+            return;
+
+        ::memset(ni, 0, size * sizeof(uint));
+        uint n = count.load(std::memory_order_relaxed);
+        for (uint k = 0; k < n; ++k) {
+            uint i = entry(k).hash & (size - 1);
+            while (ni[i])
+                i = (i + 1) & (size - 1);
+            ni[i] = k + 1;
+        }
+
+        ::dlfree(index);
+        index = ni;
+        index_mask = size - 1;
+    }
+
+    ///Draw the number of bytes until the next sample, exponentially distributed with given mean
+    int64 next_sample(size_t mean)
+    {
+        //xorshift64*
+        rng ^= rng >> 12;
+        rng ^= rng << 25;
+        rng ^= rng >> 27;
+        uint64 r = rng * 2685821657736338717ULL;
+
+        double u = double((r >> 11) + 1) * (1.0 / 9007199254740992.0);
+        return int64(-std::log(u) * double(mean)) + 1;
+    }
+
+    static thread_table* create()
+    {
+        void* mem = ::dlmalloc(sizeof(thread_table));
+        uint* idx = (uint*)::dlmalloc(64 * sizeof(uint));
+        if (!mem || !idx) {
+            ::dlfree(mem);
+            ::dlfree(idx);
+            return 0;
+        }
+
+        thread_table* t = new(mem) thread_table;
+        ::memset(idx, 0, 64 * sizeof(uint));
+        t->index = idx;
+        t->index_mask = 63;
+        t->rng = (uint64(uints(t)) * 0x9e3779b97f4a7c15ULL) | 1;
+        return t;
+    }
+};
+
+static thread_local thread_table* _thread_table = 0;
+static thread_local bool _thread_reentry = false;
+static thread_local bool _thread_exited = false;
+
+////////////////////////////////////////////////////////////////////////////////
+///Releases the thread table for adoption on thread exit
+struct thread_table_guard
+{
+    bool active = false;
+
+    ~thread_table_guard() {
+        if (_thread_table) {
+            _thread_table->owned.store(false, std::memory_order_release);
+            _thread_table = 0;
+        }
+        _thread_exited = true;
+    }
+};
+
+static thread_local thread_table_guard _thread_table_guard;
+
 ///
 struct memtrack_registrar
 {
-    inline static bool inside_alloc_in_progress = false;
-
     volatile bool running = false;
 
     memtrack_hash_t* hash = 0;
     comm_mutex* mux = 0;
 
     coid::dynarray32<memtrack_stacktrace> stacktrace_records;
+    memtrack_block_set_t* recorded_blocks = 0;  //< guarded by stacktrace_mux
+    std::atomic<uint> nrecorded_blocks{0};
     comm_mutex* stacktrace_mux = 0;
 
     bool enabled = default_enabled;
     bool ready = false;
     bool enable_stacktrace_recording = false;
 
+    std::atomic<thread_table*> tables{0};   //< per-thread counter tables
+    size_t sample_interval = 0;             //< mean bytes between stack trace samples, 0 records all
+    thread_table* exited = 0;               //< shared table for threads past their table release
+    std::atomic_flag exited_lock = ATOMIC_FLAG_INIT;
+
+    uint* known = 0;                        //< open addressing set of allocated type hashes
+    uint known_mask = 0;
+    uint nknown = 0;
+    bool known_zero = false;                //< zero hash is the empty marker in the set
+    std::atomic_flag known_lock = ATOMIC_FLAG_INIT;
+
     memtrack_registrar()
     {
         mux = new comm_mutex(500, false);
         hash = new memtrack_hash_t;
         
         stacktrace_mux = new comm_mutex(500, false);
+        recorded_blocks = new memtrack_block_set_t;
 
         ready = true;
     }
@@ -166,6 +378,8 @@ public:
     virtual void dump(const char* file, bool diff) const
     {
         GUARDTHIS(*mux);
+        merge();
+
         memtrack_hash_t::iterator ib = hash->begin();
         memtrack_hash_t::iterator ie = hash->end();
 
@@ -229,17 +443,22 @@ public:
 
     virtual uint count() const {
         GUARDTHIS(*mux);
+        merge();
         return (uint)hash->size();
     }
 
     virtual void reset() {
         {
             GUARDTHIS(*mux);
+            merge();
+
             memtrack_hash_t::iterator ib = hash->begin();
             memtrack_hash_t::iterator ie = hash->end();
 
             for (; ib != ie; ++ib) {
-                memtrack& p = *ib;
+                memtrack_rec& p = *ib;
+                p.listed_lifesize = p.lifesize;
+                p.listed_nallocs = p.nlifeallocs;
                 p.nallocs = 0;
                 p.size = 0;
             }
@@ -248,88 +467,353 @@ public:
         {
             GUARDTHIS(*stacktrace_mux);
             stacktrace_records.reset();
+            recorded_blocks->clear();
+            nrecorded_blocks.store(0, std::memory_order_relaxed);
         }
     }
 
     ///Track allocation
     virtual void alloc(const coid::type_info* tracking, size_t size)
     {
-        if (inside_alloc_in_progress)
-            return;     //avoid stack overlow from hashmap and stacktrace add
+        alloc_block(tracking, size, 0);
+    }
+
+    ///Track freeing
+    virtual void free(const coid::type_info* tracking, size_t size)
+    {
+        free_block(tracking, size, 0);
+    }
+
+    virtual uint list(memtrack* dst, uint nmax, bool modified_only) const
+    {
+        GUARDTHIS(*mux);
+        merge();
+
+        memtrack_hash_t::iterator ib = hash->begin();
+        memtrack_hash_t::iterator ie = hash->end();
+
+        uint i = 0;
+        for (; ib != ie && i < nmax; ++ib) {
+            memtrack_rec& p = *ib;
+            if (p.nallocs == 0 && modified_only)
+                continue;
+
+            dst[i++] = p;
+            p.listed_lifesize = p.lifesize;
+            p.listed_nallocs = p.nlifeallocs;
+            p.nallocs = 0;
+            p.size = 0;
+        }
+
+        return i;
+    }
+
+    ///Track allocation of a block
+    /// @param ptr block pointer, null if unknown
+    virtual void alloc_block(const coid::type_info* tracking, size_t size, const void* ptr)
+    {
+        if (_thread_reentry)
+            return;     //avoid stack overflow from table growth and stacktrace add
 
         constexpr token_literal unknown = "unknown"_T;
         constexpr uint unknown_hash = unknown.hash();
 
-        GUARDTHIS(*mux);
-        inside_alloc_in_progress = true;
-        memtrack* val = hash->find_or_insert_value_slot(
-            tracking != nullptr ? tracking->hash : unknown_hash
-        );
+        token name = tracking != nullptr ? tracking->name : unknown;
+        uint hash = tracking != nullptr ? tracking->hash : unknown_hash;
+
+        thread_table* t = local_table();
+        if (!t) {
+            if (_thread_exited)
+                exited_update(hash, name, int64(size), true);
+            return;
+        }
 
-        val->name = tracking != nullptr ? tracking->name : unknown;
-        val->hash = tracking != nullptr ? tracking->hash : unknown_hash;
+        bool created = false;
+        thread_entry* e = t->find_or_insert(hash, name, &created);
+        if (!e)
+            return;
+
+        if (created)
+            add_known(hash);
 
-        ++val->nallocs;
-        ++val->ncurallocs;
-        ++val->nlifeallocs;
-        val->size += size;
-        val->cursize += size;
-        val->lifesize += size;
+        update(e, int64(size), true);
 
         if (enable_stacktrace_recording)
         {
-            GUARDTHIS(*stacktrace_mux);
-
-            memtrack_stacktrace* memtrack_trace_ptr = stacktrace_records.add();
-            memtrack_trace_ptr->_name = val->name;
-            memtrack_trace_ptr->_size = size;
-            memtrack_trace_ptr->_stack_trace = stacktrace::get_current_stack_trace();
+            size_t interval = sample_interval;
+            if (interval == 0)
+                record_stacktrace(name, size, size, ptr);
+            else if ((t->bytes_until_sample -= int64(size)) <= 0) {
+                //unbiased estimate of bytes represented by the sample
+                double p = 1.0 - std::exp(-double(size) / double(interval));
+                t->bytes_until_sample = t->next_sample(interval);
+                record_stacktrace(name, size, uints(double(size) / p), ptr);
+            }
         }
-
-        inside_alloc_in_progress = false;
     }
 
-    ///Track freeing
-    virtual void free(const coid::type_info* tracking, size_t size)
+    ///Track freeing of a block
+    /// @param ptr block pointer, null if unknown
+    virtual void free_block(const coid::type_info* tracking, size_t size, const void* ptr)
     {
+        if (_thread_reentry) // this must be from realloc of stacktrace_records from alloc method so don't record it
+            return;
+
         constexpr token_literal unknown = "unknown"_T;
         constexpr uint unknown_hash = unknown.hash();
 
-        GUARDTHIS(*mux);
-        if (inside_alloc_in_progress) // this must be from realloc of stacktrace_records from alloc method so don't record it
-        {
+        token name = tracking != nullptr ? tracking->name : unknown;
+        uint hash = tracking != nullptr ? tracking->hash : unknown_hash;
+
+        thread_table* t = local_table();
+        if (!t) {
+            if (_thread_exited)
+                exited_update(hash, name, -int64(size), false);
             return;
         }
 
-        memtrack* val = const_cast<memtrack*>(hash->find_value(
-            tracking != nullptr ? tracking->hash : unknown_hash
-        ));
+        //a thread may free blocks allocated by others, but types never allocated are ignored
+        thread_entry* e = t->find(hash);
+        if (!e && is_known(hash))
+            e = t->find_or_insert(hash, name);
+
+        if (e)
+            update(e, -int64(size), false);
+
+        if (ptr && nrecorded_blocks.load(std::memory_order_relaxed))
+            record_free(name, size, ptr);
+    }
+
+private:
+
+    static void update(thread_entry* e, int64 size, bool alloc)
+    {
+        thread_entry::add(e->cursize, size);
+        thread_entry::add(e->ncurallocs, alloc ? 1 : -1);
 
-        if (val) {
-            //val->size -= size;
-            val->cursize -= size;
-            --val->ncurallocs;
+        if (alloc) {
+            thread_entry::add(e->lifesize, size);
+            thread_entry::add(e->nlifeallocs, 1u);
         }
     }
 
-    virtual uint list(memtrack* dst, uint nmax, bool modified_only) const
+    ///Count into the shared table, used by thread-local destructors running after the table was released
+    void exited_update(uint hash, const token& name, int64 size, bool alloc)
+    {
+        while (exited_lock.test_and_set(std::memory_order_acquire))
+            ;
+
+        if (!exited) {
+            exited = thread_table::create();
+            if (exited)
+                link(exited);
+        }
+
+        thread_entry* e = 0;
+        if (exited) {
+            e = exited->find(hash);
+            if (!e && (alloc || is_known(hash)))
+                e = exited->find_or_insert(hash, name);
+        }
+
+        if (e) {
+            if (alloc)
+                add_known(hash);
+            update(e, size, alloc);
+        }
+
+        exited_lock.clear(std::memory_order_release);
+    }
+
+    ///Remember a type hash as allocated, called when a thread counts the type for the first time
+    void add_known(uint hash)
+    {
+        while (known_lock.test_and_set(std::memory_order_acquire))
+            ;
+
+        if (hash == 0)
+            known_zero = true;
+        else if (!find_known(hash)) {
+            if (2 * (nknown + 1) > known_mask)
+                grow_known();
+
+            if (known) {
+                uint i = hash & known_mask;
+                while (known[i])
+                    i = (i + 1) & known_mask;
+                known[i] = hash;
+                ++nknown;
+            }
+        }
+
+        known_lock.clear(std::memory_order_release);
+    }
+
+    /// @return true if the type was allocated by any thread
+    bool is_known(uint hash)
+    {
+        while (known_lock.test_and_set(std::memory_order_acquire))
+            ;
+
+        bool r = hash == 0 ? known_zero : find_known(hash);
+
+        known_lock.clear(std::memory_order_release);
+        return r;
+    }
+
+    bool find_known(uint hash) const
+    {
+        if (!known)
+            return false;
+
+        for (uint i = hash & known_mask; known[i]; i = (i + 1) & known_mask)
+            if (known[i] == hash)
+                return true;
+        return false;
+    }
+
+    void grow_known()
+    {
+        uint size = known ? 2 * (known_mask + 1) : 256;
+        uint* nk = (uint*)::dlmalloc(size * sizeof(uint));
+        if (!nk)
+            return;
+
+        ::memset(nk, 0, size * sizeof(uint));
+        for (uint k = 0; known && k <= known_mask; ++k) {
+            if (!known[k])
+                continue;
+
+            uint i = known[k] & (size - 1);
+            while (nk[i])
+                i = (i + 1) & (size - 1);
+            nk[i] = known[k];
+        }
+
+        ::dlfree(known);
+        known = nk;
+        known_mask = size - 1;
+    }
+
+    void link(thread_table* t)
+    {
+        t->next = tables.load(std::memory_order_relaxed);
+        while (!tables.compare_exchange_weak(t->next, t, std::memory_order_release))
+            ;
+    }
+
+    ///Get or create the calling thread's counter table
+    thread_table* local_table()
+    {
+        thread_table* t = _thread_table;
+        if (t || _thread_exited)
+            return t;
+
+        _thread_reentry = true;
+
+        //adopt a table of an exited thread
+        for (t = tables.load(std::memory_order_acquire); t; t = t->next) {
+            bool exp = false;
+            if (!t->owned.load(std::memory_order_relaxed)
+                && t->owned.compare_exchange_strong(exp, true, std::memory_order_acquire))
+                break;
+        }
+
+        if (!t) {
+            t = thread_table::create();
+            if (t) {
+                t->bytes_until_sample = t->next_sample(sample_interval ? sample_interval : 1);
+                link(t);
+            }
+        }
+
+        _thread_table_guard.active = true;
+        _thread_table = t;
+        _thread_reentry = false;
+        return t;
+    }
+
+    ///Sum per-thread counters into the merged records, must be called under mux
+    void merge() const
     {
-        GUARDTHIS(*mux);
         memtrack_hash_t::iterator ib = hash->begin();
         memtrack_hash_t::iterator ie = hash->end();
 
-        uint i = 0;
-        for (; ib != ie && i < nmax; ++ib) {
-            memtrack& p = *ib;
-            if (p.nallocs == 0 && modified_only)
-                continue;
+        for (; ib != ie; ++ib) {
+            memtrack_rec& p = *ib;
+            p.cursize = 0;
+            p.lifesize = 0;
+            p.ncurallocs = 0;
+            p.nlifeallocs = 0;
+        }
 
-            dst[i++] = p;
-            p.nallocs = 0;
-            p.size = 0;
+        for (thread_table* t = tables.load(std::memory_order_acquire); t; t = t->next)
+        {
+            uint n = t->count.load(std::memory_order_acquire);
+            thread_chunk* c = t->first;
+
+            for (uint k = 0; k < n; ++k)
+            {
+                if (k > 0 && k % thread_chunk::SIZE == 0)
+                    c = c->next;
+
+                const thread_entry& e = c->entries[k % thread_chunk::SIZE];
+                memtrack_rec* p = hash->find_or_insert_value_slot(e.hash);
+                p->name = e.name;
+                p->hash = e.hash;
+                p->cursize += size_t(e.cursize.load(std::memory_order_relaxed));
+                p->lifesize += size_t(e.lifesize.load(std::memory_order_relaxed));
+                p->ncurallocs += uint(e.ncurallocs.load(std::memory_order_relaxed));
+                p->nlifeallocs += e.nlifeallocs.load(std::memory_order_relaxed);
+            }
         }
 
-        return i;
+        for (ib = hash->begin(); ib != ie; ++ib) {
+            memtrack_rec& p = *ib;
+            p.size = ptrdiff_t(p.lifesize - p.listed_lifesize);
+            p.nallocs = p.nlifeallocs - p.listed_nallocs;
+        }
+    }
+
+    void record_stacktrace(const token& name, size_t size, size_t weight, const void* ptr)
+    {
+        _thread_reentry = true;
+        {
+            GUARDTHIS(*stacktrace_mux);
+
+            memtrack_stacktrace* memtrack_trace_ptr = stacktrace_records.add();
+            memtrack_trace_ptr->_name = name;
+            memtrack_trace_ptr->_size = size;
+            memtrack_trace_ptr->_weight = weight;
+            memtrack_trace_ptr->_ptr = ptr;
+            memtrack_trace_ptr->_stack_trace = stacktrace::get_current_stack_trace();
+
+            if (ptr) {
+                recorded_blocks->insert_value(ptr);
+                nrecorded_blocks.store(uint(recorded_blocks->size()), std::memory_order_relaxed);
+            }
+        }
+        _thread_reentry = false;
+    }
+
+    ///Record freeing of a block if its allocation was recorded
+    void record_free(const token& name, size_t size, const void* ptr)
+    {
+        _thread_reentry = true;
+        {
+            GUARDTHIS(*stacktrace_mux);
+
+            if (recorded_blocks->erase(ptr)) {
+                nrecorded_blocks.store(uint(recorded_blocks->size()), std::memory_order_relaxed);
+
+                memtrack_stacktrace* memtrack_trace_ptr = stacktrace_records.add();
+                memtrack_trace_ptr->_name = name;
+                memtrack_trace_ptr->_size = size;
+                memtrack_trace_ptr->_ptr = ptr;
+                memtrack_trace_ptr->_free = true;
+            }
+        }
+        _thread_reentry = false;
     }
 };
 
@@ -384,6 +868,24 @@ void memtrack_free(const coid::type_info* tracking, size_t size)
     mtr->free(tracking, size);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void memtrack_alloc(const coid::type_info* tracking, size_t size, const void* ptr)
+{
+    memtrack_registrar* mtr = memtrack_register();
+    if (!mtr || !mtr->running) return;
+
+    mtr->alloc_block(tracking, size, ptr);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void memtrack_free(const coid::type_info* tracking, size_t size, const void* ptr)
+{
+    memtrack_registrar* mtr = memtrack_register();
+    if (!mtr || !mtr->running) return;
+
+    mtr->free_block(tracking, size, ptr);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 uint memtrack_list(memtrack* dst, uint nmax, bool modified_only)
 {
@@ -430,6 +932,16 @@ void enable_record_memtrack_stacktrace(bool enable)
     mtr->enable_stacktrace_recording = enable;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void memtrack_stacktrace_sampling(size_t mean_bytes)
+{
+    memtrack_registrar* mtr = memtrack_register();
+    if (!mtr || !mtr->ready)
+        return;
+
+    mtr->sample_interval = mean_bytes;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 uint memtrack_stacktrace_list(memtrack_stacktrace* destionaion, uint max_count)
 {
@@ -41,6 +41,7 @@
 #include "../namespace.h"
 #include "../type_info.h"
 #include "_malloc.h"
+#include "thread_cache.h"
 #include <new>
 #include <utility>
 
@@ -52,19 +53,21 @@ namespace coid {
 //fwd
 void memtrack_alloc(const coid::type_info* tracking, size_t size);
 void memtrack_free(const coid::type_info* tracking, size_t size);
+void memtrack_alloc(const coid::type_info* tracking, size_t size, const void* ptr);
+void memtrack_free(const coid::type_info* tracking, size_t size, const void* ptr);
 
 template <class T>
-inline void dbg_memtrack_alloc(size_t size) { coid::memtrack_alloc(&coid::type_info::get<T>(), size); }
+inline void dbg_memtrack_alloc(size_t size, const void* ptr = 0) { coid::memtrack_alloc(&coid::type_info::get<T>(), size, ptr); }
 
 template <class T>
-inline void dbg_memtrack_free(size_t size) { coid::memtrack_free(&coid::type_info::get<T>(), size); }
+inline void dbg_memtrack_free(size_t size, const void* ptr = 0) { coid::memtrack_free(&coid::type_info::get<T>(), size, ptr); }
 
-inline void dbg_memtrack_alloc(const coid::type_info* tracking, size_t size) {
-    coid::memtrack_alloc(tracking, size);
+inline void dbg_memtrack_alloc(const coid::type_info* tracking, size_t size, const void* ptr = 0) {
+    coid::memtrack_alloc(tracking, size, ptr);
 }
 
-inline void dbg_memtrack_free(const coid::type_info* tracking, size_t size) {
-    coid::memtrack_free(tracking, size);
+inline void dbg_memtrack_free(const coid::type_info* tracking, size_t size, const void* ptr = 0) {
+    coid::memtrack_free(tracking, size, ptr);
 }
 
 #define MEMTRACK_ENABLED
@@ -72,13 +75,13 @@ inline void dbg_memtrack_free(const coid::type_info* tracking, size_t size) {
 #else
 
 template <class T>
-inline void dbg_memtrack_alloc(size_t size) {}
+inline void dbg_memtrack_alloc(size_t size, const void* ptr = 0) {}
 
 template <class T>
-inline void dbg_memtrack_free(size_t size) {}
+inline void dbg_memtrack_free(size_t size, const void* ptr = 0) {}
 
-inline void dbg_memtrack_alloc(const coid::type_info* tracking, size_t size) {}
-inline void dbg_memtrack_free(const coid::type_info* tracking, size_t size) {}
+inline void dbg_memtrack_alloc(const coid::type_info* tracking, size_t size, const void* ptr = 0) {}
+inline void dbg_memtrack_free(const coid::type_info* tracking, size_t size, const void* ptr = 0) {}
 
 #endif
 
@@ -87,35 +90,35 @@ inline void dbg_memtrack_free(const coid::type_info* tracking, size_t size) {}
 
 #define COIDNEWDELETE(T) \
     void* operator new( size_t size ) { \
-        void* p=::dlmalloc(size); \
+        void* p=::coid::thread_cache::alloc(size); \
         if(p==0) throw std::bad_alloc(); \
-        coid::dbg_memtrack_alloc<T>(dlmalloc_usable_size(p)); \
+        coid::dbg_memtrack_alloc<T>(dlmalloc_usable_size(p), p); \
         return p; } \
     void* operator new( size_t, void* p ) { return p; } \
     void operator delete(void* p) { \
-        coid::dbg_memtrack_free<T>(dlmalloc_usable_size(p)); \
-        ::dlfree(p); } \
+        coid::dbg_memtrack_free<T>(dlmalloc_usable_size(p), p); \
+        ::coid::thread_cache::free(p); } \
     void operator delete(void*, void*)  { }
 
 #define COIDNEWDELETE_ALIGN(T, alignment) \
     void* operator new( size_t size ) { \
         void* p=::dlmemalign(alignment,size); \
         if(p==0) throw std::bad_alloc(); \
-        coid::dbg_memtrack_alloc<T>(dlmalloc_usable_size(p)); \
+        coid::dbg_memtrack_alloc<T>(dlmalloc_usable_size(p), p); \
         return p; } \
     void* operator new( size_t, void* p ) { return p; } \
     void operator delete(void* p) { \
-        coid::dbg_memtrack_free<T>(dlmalloc_usable_size(p)); \
+        coid::dbg_memtrack_free<T>(dlmalloc_usable_size(p), p); \
         ::dlfree(p); } \
     void operator delete(void*, void*)  { }
 
 #define COIDNEWDELETE_NOTRACK \
     void* operator new( size_t size ) { \
-        void* p=::dlmalloc(size); \
+        void* p=::coid::thread_cache::alloc(size); \
         if(p==0) throw std::bad_alloc(); \
         return p; } \
     void* operator new( size_t, void* p ) { return p; } \
-    void operator delete(void* ptr)     { ::dlfree(ptr); } \
+    void operator delete(void* ptr)     { ::coid::thread_cache::free(ptr); } \
     void operator delete(void*, void*)  { }
 
 
@@ -153,6 +156,14 @@ void memtrack_alloc( const coid::type_info* tracking, size_t size );
 //@param size freed size
 void memtrack_free( const coid::type_info* tracking, size_t size );
 
+///Track allocation of a block
+//@param ptr allocated block, identifies sampled allocations when they are freed
+void memtrack_alloc( const coid::type_info* tracking, size_t size, const void* ptr );
+
+///Track freeing of a block
+//@param ptr freed block, as passed to memtrack_alloc
+void memtrack_free( const coid::type_info* tracking, size_t size, const void* ptr );
+
 ///List allocation request statistics since the last call
 //@param dst pointer to a buffer to receive the allocation lists
 //@param nmax maximum number of entries
@@ -179,9 +190,9 @@ void memtrack_shutdown();
 ///Allocate tracked memory
 inline void* tracked_alloc(const coid::type_info* tracking, size_t size)
 {
-    void* p = ::dlmalloc(size);
+    void* p = thread_cache::alloc(size);
     if (p)
-        memtrack_alloc(tracking, dlmalloc_usable_size(p));
+        memtrack_alloc(tracking, dlmalloc_usable_size(p), p);
     return p;
 }
 
@@ -189,8 +200,8 @@ inline void* tracked_alloc(const coid::type_info* tracking, size_t size)
 inline void tracked_free(const coid::type_info* tracking, void* p)
 {
     if (p)
-        memtrack_free(tracking, dlmalloc_usable_size(p));
-    ::dlfree(p);
+        memtrack_free(tracking, dlmalloc_usable_size(p), p);
+    thread_cache::free(p);
 }
 
 
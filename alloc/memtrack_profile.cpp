@@ -0,0 +1,389 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is COID/comm module.
+ *
+ * The Initial Developer of the Original Code is
+ * Brano Kemen
+ * Portions created by the Initial Developer are Copyright (C) 2009
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+
+#include "memtrack_profile.h"
+#include "../hash/hashfunc.h"
+#include "../binstream/filestream.h"
+
+#include <algorithm>
+
+namespace coid {
+
+////////////////////////////////////////////////////////////////////////////////
+uint memtrack_profile::collect()
+{
+    static const uint BATCH = 256;
+    memtrack_stacktrace records[BATCH];
+
+    uint total = 0;
+    uint n;
+    do {
+        n = memtrack_stacktrace_list(records, BATCH);
+
+        for (uint i = 0; i < n; ++i) {
+            const memtrack_stacktrace& r = records[i];
+
+            if (r._free) {
+                //blocks recorded before the profile existed or before memtrack_reset are unknown
+                live_block* lb = _live.find_value(r._ptr);
+                if (lb) {
+                    memtrack_site& site = _sites[lb->site];
+                    --site.count;
+                    site.bytes -= lb->weight;
+                    _live.erase(r._ptr);
+                }
+                continue;
+            }
+
+            memtrack_site& site = find_or_insert_site(r._name, r._stack_trace.get_first_stack_frame());
+            uint64 weight = r._weight ? r._weight : r._size;
+            ++site.count;
+            ++site.lifecount;
+            site.bytes += weight;
+            site.lifebytes += weight;
+
+            if (r._ptr) {
+                live_block lb = { uint(&site - _sites.ptr()), weight };
+                live_block* plb = _live.find_value(r._ptr);
+                if (plb)
+                    *plb = lb;
+                else
+                    _live.insert_key_value(r._ptr, lb);
+            }
+
+            records[i]._stack_trace = stacktrace();
+        }
+
+        total += n;
+    }
+    while (n == BATCH);
+
+    return total;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+memtrack_site& memtrack_profile::find_or_insert_site(const token& name, const stack_frame* frames)
+{
+    uint fp = name.hash();
+    uint nframes = 0;
+    for (const stack_frame* f = frames; f; f = f->get_next_frame(), ++nframes) {
+        const void* a = f->get_frame_address();
+        fp = __coid_hash_bytes(&a, sizeof(a), fp);
+    }
+
+    if (_index.size() < 2 * (_sites.size() + 1)) {
+        //rebuild the index at double size
+        uints size = _index.size() ? 2 * _index.size() : 64;
+        _index.calloc(size);
+
+        for (uint k = 0; k < _sites.size(); ++k) {
+            uints i = _sites[k].fingerprint & (size - 1);
+            while (_index[i])
+                i = (i + 1) & (size - 1);
+            _index[i] = k + 1;
+        }
+    }
+
+    uints mask = _index.size() - 1;
+    uints i = fp & mask;
+
+    for (; _index[i]; i = (i + 1) & mask) {
+        memtrack_site& s = _sites[_index[i] - 1];
+        if (s.fingerprint != fp || s.name != name || s.frames.size() != nframes)
+            continue;
+
+        const stack_frame* f = frames;
+        uint k = 0;
+        for (; f && s.frames[k] == f->get_frame_address(); f = f->get_next_frame())
+            ++k;
+
+        if (!f)
+            return s;
+    }
+
+    memtrack_site* s = _sites.add();
+    s->fingerprint = fp;
+    s->name = name;
+
+    const void** pf = s->frames.alloc(nframes);
+    for (const stack_frame* f = frames; f; f = f->get_next_frame())
+        *pf++ = f->get_frame_address();
+
+    _index[i] = uint(_sites.size());
+    return *s;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void memtrack_profile::capture(snapshot_data& dst)
+{
+    collect();
+
+    site_totals* st = dst.sites.alloc(_sites.size());
+    for (const memtrack_site& s : _sites) {
+        st->count = s.count;
+        st->bytes = s.bytes;
+        st->lifecount = s.lifecount;
+        st->lifebytes = s.lifebytes;
+        ++st;
+    }
+
+    uint n = memtrack_count();
+    dst.types.alloc(n);
+    n = memtrack_list(dst.types.ptr(), n, false);
+    dst.types.resize(n);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void memtrack_profile::snapshot(const token& name)
+{
+    snapshot_data* sd = const_cast<snapshot_data*>(find_snapshot(name));
+    if (!sd) {
+        sd = _snapshots.add();
+        sd->name = name;
+    }
+
+    capture(*sd);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void memtrack_profile::drop_snapshot(const token& name)
+{
+    const snapshot_data* sd = find_snapshot(name);
+    if (sd)
+        _snapshots.del(sd - _snapshots.ptr());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const memtrack_profile::snapshot_data* memtrack_profile::find_snapshot(const token& name) const
+{
+    for (const snapshot_data& sd : _snapshots)
+        if (sd.name == name)
+            return &sd;
+
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool memtrack_profile::diff(const token& from, const token& to, memtrack_diff& dst)
+{
+    const snapshot_data* a = from ? find_snapshot(from) : 0;
+    const snapshot_data* b = to ? find_snapshot(to) : 0;
+    if ((from && !a) || (to && !b))
+        return false;
+
+    snapshot_data current;
+    if (!b) {
+        capture(current);
+        b = &current;
+    }
+
+    dst.sites.reset();
+    dst.types.reset();
+
+    //sites are only appended, index in an older snapshot matches the newer one
+    for (uint i = 0; i < b->sites.size(); ++i)
+    {
+        const site_totals& sb = b->sites[i];
+        site_totals sa = { 0, 0, 0, 0 };
+        if (a && i < a->sites.size())
+            sa = a->sites[i];
+
+        if (sb.bytes == sa.bytes && sb.count == sa.count && sb.lifecount == sa.lifecount)
+            continue;
+
+        memtrack_site_delta* d = dst.sites.add();
+        d->site = i;
+        d->count = int64(sb.count - sa.count);
+        d->bytes = int64(sb.bytes - sa.bytes);
+        d->lifecount = int64(sb.lifecount - sa.lifecount);
+        d->lifebytes = int64(sb.lifebytes - sa.lifebytes);
+    }
+
+    for (const memtrack& tb : b->types)
+    {
+        const memtrack* ta = 0;
+        if (a) {
+            for (const memtrack& t : a->types)
+                if (t.hash == tb.hash) {
+                    ta = &t;
+                    break;
+                }
+        }
+
+        int64 cs = int64(tb.cursize) - (ta ? int64(ta->cursize) : 0);
+        int64 nc = int64(tb.ncurallocs) - (ta ? int64(ta->ncurallocs) : 0);
+        uint64 ls = tb.lifesize - (ta ? ta->lifesize : 0);
+        if (cs == 0 && nc == 0 && ls == 0)
+            continue;
+
+        memtrack_type_delta* d = dst.types.add();
+        d->name = tb.name;
+        d->cursize = cs;
+        d->ncurallocs = nc;
+        d->lifesize = ls;
+    }
+
+    std::sort(dst.sites.begin(), dst.sites.end(), [](const memtrack_site_delta& x, const memtrack_site_delta& y) {
+        return x.bytes > y.bytes;
+    });
+    std::sort(dst.types.begin(), dst.types.end(), [](const memtrack_type_delta& x, const memtrack_type_delta& y) {
+        return x.cursize > y.cursize;
+    });
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void memtrack_profile::append_frame(charstr& dst, const void* addr, fn_symbolize sym)
+{
+    if (sym && sym(addr, dst))
+        return;
+
+    dst << "0x";
+    dst.append_num(16, uints(addr));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+opcd memtrack_profile::write_folded(binstream& out, const memtrack_diff* diff, fn_symbolize sym) const
+{
+    charstr buf;
+    uints n = diff ? diff->sites.size() : _sites.size();
+
+    for (uints i = 0; i < n; ++i)
+    {
+        const memtrack_site& s = diff ? _sites[diff->sites[i].site] : _sites[i];
+        int64 bytes = diff ? diff->sites[i].bytes : int64(s.bytes);
+        if (bytes <= 0)
+            continue;
+
+        //root first
+        for (uints k = s.frames.size(); k > 0; --k) {
+            append_frame(buf, s.frames[k - 1], sym);
+            buf << ';';
+        }
+
+        buf << s.name << ' ';
+        buf.append_num(10, bytes);
+        buf << '\n';
+
+        if (buf.len() > 7900) {
+            opcd e = out.write_token_raw(buf);
+            if (e != NOERR) return e;
+            buf.reset();
+        }
+    }
+
+    return out.write_token_raw(buf);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+opcd memtrack_profile::write_pprof(binstream& out, const memtrack_diff* diff) const
+{
+    charstr buf;
+    uints n = diff ? diff->sites.size() : _sites.size();
+
+    //in-use columns are live numbers, alloc columns are allocation totals; shrinking sites are clamped
+    auto get = [&](uints i, int64& count, int64& bytes, int64& lifecount, int64& lifebytes) {
+        if (diff) {
+            const memtrack_site_delta& d = diff->sites[i];
+            count = d.count; bytes = d.bytes;
+            lifecount = d.lifecount; lifebytes = d.lifebytes;
+        }
+        else {
+            const memtrack_site& s = _sites[i];
+            count = int64(s.count); bytes = int64(s.bytes);
+            lifecount = int64(s.lifecount); lifebytes = int64(s.lifebytes);
+        }
+        if (bytes <= 0)
+            count = bytes = 0;
+    };
+
+    int64 tcount = 0, tbytes = 0, tlifecount = 0, tlifebytes = 0;
+    for (uints i = 0; i < n; ++i) {
+        int64 count, bytes, lifecount, lifebytes;
+        get(i, count, bytes, lifecount, lifebytes);
+        tcount += count;
+        tbytes += bytes;
+        tlifecount += lifecount;
+        tlifebytes += lifebytes;
+    }
+
+    buf << "heap profile: " << tcount << ": " << tbytes << " [" << tlifecount << ": " << tlifebytes << "] @ heapprofile\n";
+
+    for (uints i = 0; i < n; ++i)
+    {
+        const memtrack_site& s = diff ? _sites[diff->sites[i].site] : _sites[i];
+        int64 count, bytes, lifecount, lifebytes;
+        get(i, count, bytes, lifecount, lifebytes);
+        if (bytes <= 0 && lifebytes <= 0)
+            continue;
+
+        buf << count << ": " << bytes << " [" << lifecount << ": " << lifebytes << "] @";
+        for (const void* a : s.frames) {
+            buf << ' ';
+            append_frame(buf, a, 0);
+        }
+        buf << '\n';
+
+        if (buf.len() > 7900) {
+            opcd e = out.write_token_raw(buf);
+            if (e != NOERR) return e;
+            buf.reset();
+        }
+    }
+
+#ifdef SYSTYPE_LINUX
+    buf << "\nMAPPED_LIBRARIES:\n";
+
+    bifstream maps("/proc/self/maps");
+    if (maps.is_open()) {
+        char tmp[4096];
+        for (;;) {
+            uints len = sizeof(tmp);
+            maps.read_raw_full(tmp, len);
+            uints got = sizeof(tmp) - len;
+            buf << token(tmp, got);
+            if (len > 0)
+                break;
+        }
+    }
+#endif
+
+    return out.write_token_raw(buf);
+}
+
+} //namespace coid
@@ -0,0 +1,179 @@
+#pragma once
+/* ***** BEGIN LICENSE BLOCK *****
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is COID/comm module.
+ *
+ * The Initial Developer of the Original Code is
+ * Brano Kemen
+ * Portions created by the Initial Developer are Copyright (C) 2009-2017
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef __COID_MEMTRACK_PROFILE__HEADER_FILE__
+#define __COID_MEMTRACK_PROFILE__HEADER_FILE__
+
+#include "../namespace.h"
+#include "../str.h"
+#include "../dynarray.h"
+#include "../hash/hashmap.h"
+#include "../binstream/binstream.h"
+#include "memtrack.h"
+#include "memtrack_stacktrace.h"
+
+COID_NAMESPACE_BEGIN
+
+////////////////////////////////////////////////////////////////////////////////
+///Allocation site, memtrack stack trace records aggregated by type and call stack
+struct memtrack_site
+{
+    uint fingerprint = 0;               //< hash of the type and frame addresses
+    token name;                         //< allocated type
+    dynarray<const void*> frames;       //< frame addresses, innermost first
+    uint64 count = 0;                   //< number of live recorded allocations
+    uint64 bytes = 0;                   //< estimated live bytes (sum of weights of the live records)
+    uint64 lifecount = 0;               //< number of recorded allocations
+    uint64 lifebytes = 0;               //< estimated allocated bytes
+};
+
+///Change of an allocation site between two snapshots
+struct memtrack_site_delta
+{
+    uint site = 0;                      //< index into memtrack_profile::sites()
+    int64 count = 0;                    //< growth of live allocations
+    int64 bytes = 0;                    //< growth of live bytes
+    int64 lifecount = 0;                //< allocations in between
+    int64 lifebytes = 0;                //< bytes allocated in between
+};
+
+///Change of per-type counters between two snapshots
+struct memtrack_type_delta
+{
+    token name;
+    int64 cursize = 0;                  //< growth of live bytes
+    int64 ncurallocs = 0;               //< growth of live allocations
+    uint64 lifesize = 0;                //< bytes allocated in between
+};
+
+///Diff of two snapshots, sorted by growth in bytes (largest first)
+struct memtrack_diff
+{
+    dynarray<memtrack_type_delta> types;
+    dynarray<memtrack_site_delta> sites;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+///Aggregation of memtrack data for leak hunting
+/// Stack trace records (see enable_record_memtrack_stacktrace and memtrack_stacktrace_sampling)
+/// are drained and grouped by call stack fingerprint. Named snapshots capture per-site
+/// totals together with per-type memtrack counters, two snapshots can be diffed to find
+/// growth, and exported as folded stacks (flamegraph.pl, speedscope) or as a legacy
+/// text heap profile readable by pprof.
+/// @note live bytes per site are maintained only for blocks tracked with their pointer
+///       (tracked_alloc, COIDNEWDELETE, comm arrays), blocks tracked without it are never
+///       subtracted; live growth is exact per type
+class memtrack_profile
+{
+public:
+
+    ///Symbolizer for exported frames, writes a function name for given address
+    /// @return false to use the hex address
+    typedef bool (*fn_symbolize)(const void* addr, charstr& dst);
+
+    memtrack_profile() {}
+
+    ///Drain pending memtrack stack trace records into the allocation sites
+    /// @return number of records processed
+    uint collect();
+
+    ///Collect and store current state under given name, replacing an existing snapshot
+    /// @note calls memtrack_list, which resets its "since the last call" counters
+    void snapshot(const token& name);
+
+    /// @return true if snapshot exists
+    bool has_snapshot(const token& name) const {
+        return find_snapshot(name) != 0;
+    }
+
+    ///Drop a snapshot
+    void drop_snapshot(const token& name);
+
+    ///Compute growth between two snapshots
+    /// @param from older snapshot name, empty for an empty baseline
+    /// @param to newer snapshot name, empty for the current (collected) state
+    /// @return false if a named snapshot doesn't exist
+    bool diff(const token& from, const token& to, memtrack_diff& dst);
+
+    ///Write sites in the folded stack format: "root;...;leaf;type bytes" per line
+    /// @param diff growth to write, or 0 to write the current totals
+    opcd write_folded(binstream& out, const memtrack_diff* diff = 0, fn_symbolize sym = 0) const;
+
+    ///Write sites as a legacy text heap profile for pprof
+    /// @param diff growth to write, or 0 to write the current totals
+    /// @note on Linux the mapped libraries are appended for pprof symbolization
+    opcd write_pprof(binstream& out, const memtrack_diff* diff = 0) const;
+
+    /// @return aggregated allocation sites
+    const dynarray<memtrack_site>& sites() const { return _sites; }
+
+private:
+
+    struct site_totals {
+        uint64 count;
+        uint64 bytes;
+        uint64 lifecount;
+        uint64 lifebytes;
+    };
+
+    ///Live recorded block
+    struct live_block {
+        uint site;
+        uint64 weight;
+    };
+
+    struct snapshot_data {
+        charstr name;
+        dynarray<site_totals> sites;    //< totals indexed as _sites at the time of the snapshot
+        dynarray<memtrack> types;
+    };
+
+    const snapshot_data* find_snapshot(const token& name) const;
+    memtrack_site& find_or_insert_site(const token& name, const stack_frame* frames);
+    void capture(snapshot_data& dst);
+
+    static void append_frame(charstr& dst, const void* addr, fn_symbolize sym);
+
+    dynarray<memtrack_site> _sites;
+    dynarray<uint> _index;              //< open addressing index to _sites (1-based)
+    hash_map<const void*, live_block> _live;
+    dynarray<snapshot_data> _snapshots;
+};
+
+COID_NAMESPACE_END
+
+#endif //#ifndef __COID_MEMTRACK_PROFILE__HEADER_FILE__
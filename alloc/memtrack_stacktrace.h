@@ -9,11 +9,21 @@ struct memtrack_stacktrace
     coid::token _name = 0;               //< class identifier
     uints _size = 0;                    //< size of memory operation        
     stacktrace _stack_trace;             //< stack trace of memory operation call
+    uints _weight = 0;                  //< estimated bytes this record represents (equals _size when not sampling)
+    const void* _ptr = 0;               //< allocated block, null if the allocation was tracked without it
+    bool _free = false;                 //< the recorded block was freed, no stack trace
 
     memtrack_stacktrace() = default;
 };
 
+/// @brief Record stack traces of allocations
+/// @note freeing of a recorded block is reported by a record with _free set, if the block pointer was passed to memtrack_alloc and memtrack_free
 void enable_record_memtrack_stacktrace(bool enable);
+
+/// @brief Sample recorded stack traces instead of recording all allocations
+/// @param mean_bytes mean number of allocated bytes between two recorded allocations (Poisson sampling), 0 records every allocation
+void memtrack_stacktrace_sampling(size_t mean_bytes);
+
 uint memtrack_stacktrace_list(memtrack_stacktrace* destionaion, uint max_count);
 uint memtrack_stacktrace_count();
 
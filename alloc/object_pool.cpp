@@ -0,0 +1,415 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is COID/comm module.
+ *
+ * The Initial Developer of the Original Code is
+ * Brano Kemen
+ * Portions created by the Initial Developer are Copyright (C) 2009
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+
+#include "object_pool.h"
+#include "_malloc.h"
+#include "../sync/mutex.h"
+#include "../sync/guard.h"
+#include <cstring>
+
+namespace coid {
+
+//Internal arrays and lists are allocated outside of the tracked allocators, memtrack
+// stack sampling uses pools and may re-enter from any tracked allocation
+
+////////////////////////////////////////////////////////////////////////////////
+struct object_pool_base::magazine
+{
+    magazine* next = 0;                 //< link in depot lists
+    uint count = 0;
+    void* items[MAGAZINE_SIZE];
+
+    bool full() const { return count == MAGAZINE_SIZE; }
+};
+
+struct object_pool_base::depot
+{
+    comm_mutex mx;
+    magazine* full = 0;                 //< magazines with free items
+    magazine* empty = 0;                //< empty magazines for reuse
+    stats st;
+
+    depot() : mx(500, false) {}
+
+    static void push(magazine*& list, magazine* m) {
+        m->next = list;
+        list = m;
+    }
+
+    static magazine* pop(magazine*& list) {
+        magazine* m = list;
+        if (m) {
+            list = m->next;
+            m->next = 0;
+        }
+        return m;
+    }
+};
+
+///Per-thread magazines of a pool
+struct object_pool_base::slot
+{
+    uint64 serial;                      //< serial of the owning pool, 0 if unused
+    fn_delete del;
+    magazine* loaded;
+    magazine* previous;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+///Grow raw array of trivial elements, new elements are zeroed
+/// @param msp mspace to allocate from, module heap if null
+template<class T>
+static void grow_array(T*& ptr, uint& size, uint n, ::mspace msp = 0)
+{
+    if (n <= size)
+        return;
+
+    uint ns = size ? size * 2 : 16;
+    if (ns < n)
+        ns = n;
+
+    ptr = static_cast<T*>(msp
+        ? ::mspace_realloc(msp, ptr, ns * sizeof(T))
+        : ::dlrealloc(ptr, ns * sizeof(T)));
+    ::memset(ptr + size, 0, (ns - size) * sizeof(T));
+    size = ns;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+///Registry of live pools, looked up by id when a thread releases its magazines
+/// Process-wide, global pools are shared across modules and their ids and serials index
+/// the per-thread slots of every module. Arrays are kept in an own mspace for the same reason.
+struct pool_registry
+{
+    comm_mutex mx;
+    ::mspace msp = 0;
+    object_pool_base** pools = 0;
+    uint64* serials = 0;
+    uint npools = 0;
+    uint capacity = 0;
+    uint64 next_serial = 1;
+
+    pool_registry() : mx(500, false) {
+        msp = ::create_mspace(0, false, 0);
+    }
+
+    ///Process-wide holder, the registry is not destroyed as pools and threads may outlive static destructors
+    struct holder {
+        pool_registry* reg = new pool_registry;
+    };
+
+    static pool_registry& get() {
+        LOCAL_FUNCTION_PROCWIDE_SINGLETON_DEF(holder) h;
+        return *h->reg;
+    }
+
+    /// @return free id
+    uint insert(object_pool_base* pool, uint64& serial)
+    {
+        GUARDTHIS(mx);
+
+        uint id = 0;
+        while (id < npools && pools[id])
+            ++id;
+
+        if (id == npools) {
+            uint cap = capacity;
+            grow_array(pools, cap, id + 1, msp);
+            grow_array(serials, capacity, id + 1, msp);
+            ++npools;
+        }
+
+        serial = next_serial++;
+        pools[id] = pool;
+        serials[id] = serial;
+        return id;
+    }
+
+    void remove(uint id)
+    {
+        GUARDTHIS(mx);
+        pools[id] = 0;
+        serials[id] = 0;
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+///Per-thread pool slots, magazines are released on thread exit
+struct object_pool_thread
+{
+    object_pool_base::slot* slots = 0;
+    uint nslots = 0;
+
+    ~object_pool_thread();
+};
+
+static thread_local object_pool_thread* _tls = 0;
+static thread_local bool _tls_detached = false;
+
+object_pool_thread::~object_pool_thread()
+{
+    _tls = 0;
+    _tls_detached = true;
+
+    for (uint i = 0; i < nslots; ++i)
+        object_pool_base::release_slot(slots[i], i);
+
+    ::dlfree(slots);
+    slots = 0;
+    nslots = 0;
+}
+
+static thread_local object_pool_thread _thread;
+
+////////////////////////////////////////////////////////////////////////////////
+object_pool_base::object_pool_base(fn_delete del)
+    : _depot(new depot)
+    , _delete(del)
+{
+    _id = pool_registry::get().insert(this, _serial);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+object_pool_base::~object_pool_base()
+{
+    pool_registry::get().remove(_id);
+
+    //magazines of the calling thread, other threads delete theirs on exit
+    object_pool_thread* t = _tls;
+    if (t && _id < t->nslots && t->slots[_id].serial == _serial)
+        release_slot(t->slots[_id], _id);
+
+    purge();
+
+    while (magazine* m = depot::pop(_depot->empty))
+        delete m;
+    delete _depot;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+object_pool_base::stats object_pool_base::depot_stats() const
+{
+    GUARDTHIS(_depot->mx);
+    return _depot->st;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void object_pool_base::flush_thread()
+{
+    object_pool_thread* t = _tls;
+    if (t && _id < t->nslots && t->slots[_id].serial == _serial)
+        release_slot(t->slots[_id], _id);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void object_pool_base::purge()
+{
+    magazine* full;
+    {
+        GUARDTHIS(_depot->mx);
+        full = _depot->full;
+        _depot->full = 0;
+        _depot->st.depot_items = 0;
+    }
+
+    //item destructors may use pools, delete outside of the lock
+    for (magazine* m = full; m; m = m->next) {
+        for (uint i = 0; i < m->count; ++i)
+            _delete(m->items[i]);
+        m->count = 0;
+    }
+
+    GUARDTHIS(_depot->mx);
+    while (magazine* m = depot::pop(full))
+        depot::push(_depot->empty, m);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+object_pool_base::slot& object_pool_base::local_slot()
+{
+    object_pool_thread* t = _tls;
+    if (!t) {
+        //after thread-local destruction the magazines would leak, use a temporary slot
+        static thread_local slot detached;
+        if (_tls_detached) {
+            release_slot(detached, _id);
+            detached.serial = _serial;
+            detached.del = _delete;
+            return detached;
+        }
+
+        t = _tls = &_thread;
+    }
+
+    if (_id >= t->nslots)
+        grow_array(t->slots, t->nslots, _id + 1);
+
+    slot& s = t->slots[_id];
+    if (s.serial != _serial) {
+        //left over from a destroyed pool that had the same id
+        release_slot(s, _id);
+        s.serial = _serial;
+        s.del = _delete;
+    }
+
+    return s;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void object_pool_base::release_slot(slot& s, uint id)
+{
+    if (!s.serial)
+        return;
+
+    magazine* mags[2] = { s.loaded, s.previous };
+    fn_delete del = s.del;
+    uint64 serial = s.serial;
+    s = slot();
+
+    bool orphaned = true;
+    {
+        pool_registry& r = pool_registry::get();
+        GUARDTHIS(r.mx);
+
+        object_pool_base* pool = r.serials[id] == serial ? r.pools[id] : 0;
+        if (pool) {
+            //partially filled magazines go to the full list as well
+            depot* d = pool->_depot;
+            GUARDTHIS(d->mx);
+
+            for (magazine* m : mags) {
+                if (!m)
+                    continue;
+
+                if (m->count) {
+                    depot::push(d->full, m);
+                    d->st.depot_items += m->count;
+                }
+                else
+                    depot::push(d->empty, m);
+            }
+            orphaned = false;
+        }
+    }
+
+    if (orphaned) {
+        for (magazine* m : mags) {
+            if (!m)
+                continue;
+
+            for (uint i = 0; i < m->count; ++i)
+                del(m->items[i]);
+            delete m;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void* object_pool_base::pop()
+{
+    slot& s = local_slot();
+
+    magazine* m = s.loaded;
+    if (m && m->count)
+        return m->items[--m->count];
+
+    if (s.previous && s.previous->count) {
+        s.loaded = s.previous;
+        s.previous = m;
+        return s.loaded->items[--s.loaded->count];
+    }
+
+    //both magazines empty, exchange one for a full magazine from the depot
+    magazine* f;
+    {
+        GUARDTHIS(_depot->mx);
+        f = depot::pop(_depot->full);
+        if (!f)
+            return 0;
+
+        _depot->st.depot_items -= f->count;
+        ++_depot->st.depot_gets;
+
+        if (s.previous)
+            depot::push(_depot->empty, s.previous);
+    }
+
+    s.previous = s.loaded;
+    s.loaded = f;
+    return f->items[--f->count];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void object_pool_base::push(void* p)
+{
+    slot& s = local_slot();
+
+    magazine* m = s.loaded;
+    if (m && !m->full()) {
+        m->items[m->count++] = p;
+        return;
+    }
+
+    if (s.previous && !s.previous->count) {
+        s.loaded = s.previous;
+        s.previous = m;
+        s.loaded->items[s.loaded->count++] = p;
+        return;
+    }
+
+    //both magazines full (or missing), hand one to the depot and load an empty one
+    magazine* e;
+    {
+        GUARDTHIS(_depot->mx);
+        if (s.previous) {
+            depot::push(_depot->full, s.previous);
+            _depot->st.depot_items += s.previous->count;
+            ++_depot->st.depot_puts;
+        }
+
+        e = depot::pop(_depot->empty);
+    }
+
+    if (!e)
+        e = new magazine;
+
+    s.previous = s.loaded;
+    s.loaded = e;
+    e->items[e->count++] = p;
+}
+
+} //namespace coid
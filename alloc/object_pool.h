@@ -0,0 +1,157 @@
+#pragma once
+/* ***** BEGIN LICENSE BLOCK *****
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is COID/comm module.
+ *
+ * The Initial Developer of the Original Code is
+ * Brano Kemen
+ * Portions created by the Initial Developer are Copyright (C) 2009-2017
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef __COID_OBJECT_POOL__HEADER_FILE__
+#define __COID_OBJECT_POOL__HEADER_FILE__
+
+#include "../namespace.h"
+#include "../commtypes.h"
+#include "../singleton.h"
+
+namespace coid {
+
+struct object_pool_thread;
+
+////////////////////////////////////////////////////////////////////////////////
+///Type-erased core of object_pool
+/// Free items are kept in per-thread magazines, bounded stacks of MAGAZINE_SIZE items.
+/// Each thread holds a loaded and a previous magazine so that alternating gets and
+/// releases stay local. Only full and empty magazines are exchanged with the pool depot,
+/// under a lock taken at most once per MAGAZINE_SIZE operations.
+/// Magazines of exiting threads go back to the depot, or have their items deleted if the
+/// pool has already been destroyed.
+class object_pool_base
+{
+public:
+    static const uint MAGAZINE_SIZE = 64;
+
+    typedef void (*fn_delete)(void*);
+
+    struct stats {
+        uint64 depot_gets = 0;          //< full magazines taken from the depot
+        uint64 depot_puts = 0;          //< full magazines returned to the depot
+        uints depot_items = 0;          //< free items held in the depot
+    };
+
+    /// @return depot statistics
+    stats depot_stats() const;
+
+    ///Return magazines of the calling thread to the depot
+    void flush_thread();
+
+    ///Delete free items held in the depot
+    void purge();
+
+protected:
+
+    explicit object_pool_base(fn_delete del);
+    ~object_pool_base();
+
+    object_pool_base(const object_pool_base&) = delete;
+    object_pool_base& operator = (const object_pool_base&) = delete;
+
+    /// @return free item or nullptr if the pool is empty
+    void* pop();
+
+    ///Put a free item into the pool
+    void push(void* p);
+
+private:
+
+    friend struct object_pool_thread;
+
+    struct magazine;
+    struct depot;
+    struct slot;
+
+    slot& local_slot();
+
+    static void release_slot(slot& s, uint id);
+
+    depot* _depot = 0;
+    fn_delete _delete = 0;
+    uint _id = 0;                       //< index of per-thread slots
+    uint64 _serial = 0;                 //< unique pool serial, ids get reused
+};
+
+////////////////////////////////////////////////////////////////////////////////
+///Pool of reusable objects with per-thread magazines
+/// Items are created with new T and deleted with the pool. Released items are not reset
+/// by the pool, callers reset the object state (as policy_pooled does).
+template<class T>
+class object_pool
+    : public object_pool_base
+{
+public:
+
+    object_pool()
+        : object_pool_base(&destroy)
+    {}
+
+    /// return global pool for type T
+    static object_pool& global() { return SINGLETON(object_pool<T>); }
+
+    /// @brief Get item from pool
+    /// @return item from pool or nullptr
+    T* get_item() {
+        return static_cast<T*>(pop());
+    }
+
+    /// @brief Create instance or take one from pool
+    T* create_item() {
+        T* inst = get_item();
+        if (!inst)
+            inst = new T;
+        return inst;
+    }
+
+    /// return instance to pool
+    void release_item(T*& o) {
+        push(o);
+        o = 0;
+    }
+
+private:
+
+    static void destroy(void* p) {
+        delete static_cast<T*>(p);
+    }
+};
+
+} //namespace coid
+
+#endif //#ifndef __COID_OBJECT_POOL__HEADER_FILE__
@@ -47,6 +47,7 @@
 #include "../trait.h"
 
 #include "slotalloc_tracker.h"
+#include "slotalloc_snapshot.h"
 
 COID_NAMESPACE_BEGIN
 
@@ -115,10 +116,11 @@ public:
     ///Constructor, reserve memory (non-virtual, will rebase when overflows)
     /// @param nitems number of items to reserve memory for
     /// @param mode virtual address space reservation (constant pointers, reserve large address space, cannot rebase) or physical reservation (will rebase if crossed)
+    ///        virtual reservations can add placement options, see reserve_mode
     slotalloc_base(uints nitems, reserve_mode mode)
     {
-        if (mode == reserve_mode::virtual_space)
-            reserve_virtual(nitems);
+        if (mode & reserve_mode::virtual_space)
+            reserve_virtual(nitems, mode);
         else
             reserve(nitems);
     }
@@ -285,14 +287,15 @@ public:
         extarray_reserve(nitems, reserve_mode::memory);
     }
 
-    void reserve_virtual(uints nitems)
+    /// @param mode placement options (huge pages, NUMA, prefault) for the item and ext arrays
+    void reserve_virtual(uints nitems, reserve_mode mode = reserve_mode::virtual_space)
     {
         uints na = align_to_chunks(nitems, BITMASK_BITS);
 
         if coid_constexpr_if (LINEAR) {
             discard();
 
-            this->_array.reserve_virtual(nitems);
+            this->_array.reserve_virtual(nitems, mode);
         }
         else {
             this->_pages.reserve_virtual(na);
@@ -300,7 +303,7 @@ public:
 
         _allocated.reserve_virtual(na);
 
-        extarray_reserve(nitems, reserve_mode::virtual_space);
+        extarray_reserve(nitems, mode | reserve_mode::virtual_space);
     }
 
 
@@ -939,6 +942,156 @@ public:
         }
     }
 
+    ///Incrementally compact live items into the lowest slots, so that iteration touches fewer pages
+    /// Moves items from the highest used slots into free slots below count(), at most \a budget items per call.
+    /// Once dense, trailing storage is released, except in pool, tracking and versioning modes that keep per-slot state.
+    /// @param budget max number of items to relocate in this call
+    /// @param fn functor(uints old_id, uints new_id) invoked after each relocation, to update ids held elsewhere
+    /// @return number of relocated items, 0 if the container was already dense
+    /// @note relocation bumps versions of both slots (versioning mode), so stale versionids get rejected, and marks
+    ///       both slots modified (tracking mode), for_each_modified then reports the old slot as deleted
+    template<typename Func>
+    uints compact(uints budget, Func fn) COID_REQUIRES((!ATOMIC))
+    {
+        static_assert(!ATOMIC, "not available in atomic mode");
+
+        const uints n = _count;
+        const uints ncr = created();
+        uints hole = 0;
+        uints tail = n;
+        uints nmoved = 0;
+
+        //free slots below n are matched by the same number of live items above it
+        while (nmoved < budget) {
+            hole = find_slot(hole, n, false);
+            if (hole >= n)
+                break;
+
+            tail = find_slot(tail, ncr, true);
+            DASSERT_RET(tail < ncr, nmoved);
+
+            relocate_item(tail, hole);
+            fn(uints(tail), uints(hole));
+
+            ++nmoved;
+            ++hole;
+            ++tail;
+        }
+
+        if coid_constexpr_if(!POOL && !TRACKING && !VERSIONING) {
+            if (find_slot(hole, n, false) >= n)
+                shrink_created(n);
+        }
+
+        return nmoved;
+    }
+
+    ///Compact without reporting relocations, see compact(budget, fn)
+    uints compact(uints budget = UMAXS) COID_REQUIRES((!ATOMIC))
+    {
+        return compact(budget, [](uints, uints) {});
+    }
+
+    /// @return number of live items outside of the dense [0, count()) range, that compact() would relocate
+    uints compact_pending() const
+    {
+        const uints n = _count;
+        const uints ncr = created();
+        uints np = 0;
+
+        for (uints id = find_slot(n, ncr, true); id < ncr; id = find_slot(id + 1, ncr, true))
+            ++np;
+
+        return np;
+    }
+
+    ///Create an immutable snapshot of items, that can be read and released by concurrent readers
+    /// @param prev previous snapshot of this container; with tracking containers, chunks of items
+    ///        not modified since the previous snapshot are shared with it instead of being copied
+    /// @note must be called on the thread that modifies the container; with tracking, call it right
+    ///       after advance_frame() so that changes made before the previous snapshot aren't counted again
+    /// @note non-tracking containers have no record of modified items, so \a prev is ignored and
+    ///       every snapshot copies all items
+    slotalloc_snapshot<T> snapshot(const slotalloc_snapshot<T>* prev = 0) const
+    {
+        using snapshot_t = slotalloc_snapshot<T>;
+        using chunk_t = typename snapshot_t::chunk;
+        static_assert(int(snapshot_t::BITMASK_BITS) == int(BITMASK_BITS), "snapshot chunk mask must match the allocation bit array");
+
+        constexpr uint NMASK = snapshot_t::NMASK;
+
+        snapshot_t snap;
+        snap._source = this;
+        snap._count = _count;
+        snap._created = created();
+
+        const uints nchunks = align_to_chunks(snap._created, snapshot_t::ITEMS);
+        snap._chunks.alloc(nchunks);
+
+        //changeset bits of frames since the previous snapshot, zero if nothing can be shared
+        const changeset_t* chs = 0;
+        uints nchs = 0;
+        uint planemask = 0;
+
+        if coid_constexpr_if (TRACKING) {
+            snap._frame = *tracker_t::get_frame();
+
+            if (prev && prev->_source == this && prev->_frame <= snap._frame) {
+                int bp = changeset_t::bitplane(-int(snap._frame - prev->_frame) - 1);
+                if (bp < changeset_t::BITPLANE_COUNT) {
+                    auto ch = tracker_t::get_changeset();
+                    chs = ch->ptr();
+                    nchs = ch->size();
+                    planemask = changeset_t::bitplane_mask(bp);
+                }
+            }
+        }
+
+        bitmask_type const* bm = const_cast<bitmask_type const*>(_allocated.ptr());
+        const uints nbm = _allocated.size();
+
+        for (uints c = 0; c < nchunks; ++c)
+        {
+            const uints base = c * snapshot_t::ITEMS;
+            uints mask[NMASK];
+
+            for (uint k = 0; k < NMASK; ++k)
+                mask[k] = c * NMASK + k < nbm ? uints(bm[c * NMASK + k]) : 0U;
+
+            if (planemask && c < prev->_chunks.size()) {
+                chunk_t* pc = prev->_chunks[c];
+                bool shared = ::memcmp(pc->mask, mask, sizeof(mask)) == 0;
+
+                //slots without a changeset entry count as modified
+                const uints end = stdmin(base + snapshot_t::ITEMS, snap._created);
+                for (uints id = base; shared && id < end; ++id)
+                    shared = id < nchs && (chs[id].mask & planemask) == 0;
+
+                if (shared) {
+                    pc->addref();
+                    snap._chunks[c] = pc;
+                    continue;
+                }
+            }
+
+            chunk_t* nc = chunk_t::create();
+            ::memcpy(nc->mask, mask, sizeof(mask));
+            T* d = nc->items();
+
+            for (uint k = 0; k < NMASK; ++k) {
+                for (uints m = mask[k]; m; m &= m - 1) {
+                    const uint i = k * BITMASK_BITS + lsb_bit_set(m);
+                    new(d + i) T(*ptr(base + i));
+                }
+            }
+
+            snap._chunks[c] = nc;
+            ++snap._copied;
+        }
+
+        return snap;
+    }
+
 #ifdef COID_CONSTEXPR_IF
 
 protected:
@@ -1076,6 +1229,17 @@ protected:
         p->~Te();
     }
 
+    template <class Te>
+    static void relocate_extarray_value(Te* src, Te* dst) {
+        if coid_constexpr_if(POOL) {
+            *dst = std::move(*src);
+        }
+        else {
+            new(dst) Te(std::move(*src));
+            src->~Te();
+        }
+    }
+
     void destruct()
     {
         for_each([](T& v) { destroy(v); });
@@ -1946,6 +2110,16 @@ private:
         extarray_reset_count_(make_index_sequence<tracker_t::extarray_size>());
     }
 
+    ///Helper to set_size all ext arrays
+    template<size_t... Index>
+    void extarray_set_size_(index_sequence<Index...>, uints n) {
+        int dummy[] = {0, ((void)std::get<Index>(this->_exts).set_size(n), 0)...};
+    }
+
+    void extarray_set_size(uints n) {
+        extarray_set_size_(make_index_sequence<tracker_t::extarray_size>(), n);
+    }
+
     ///Helper to discard all ext arrays
     template<size_t... Index>
     void extarray_discard_(index_sequence<Index...>) {
@@ -1963,13 +2137,13 @@ private:
     }
 
     template<size_t... Index>
-    void extarray_reserve_virtual_(index_sequence<Index...>, uints size) {
-        int dummy[] = {0, ((void)std::get<Index>(this->_exts).reserve_virtual(size), 0)...};
+    void extarray_reserve_virtual_(index_sequence<Index...>, uints size, reserve_mode mode) {
+        int dummy[] = {0, ((void)std::get<Index>(this->_exts).reserve_virtual(size, mode), 0)...};
     }
 
     void extarray_reserve(uints size, reserve_mode mode) {
-        if (mode == reserve_mode::virtual_space)
-            extarray_reserve_virtual_(make_index_sequence<tracker_t::extarray_size>(), size);
+        if (mode & reserve_mode::virtual_space)
+            extarray_reserve_virtual_(make_index_sequence<tracker_t::extarray_size>(), size, mode);
         else
             extarray_reserve_(make_index_sequence<tracker_t::extarray_size>(), size);
     }
@@ -2017,6 +2191,16 @@ private:
         extarray_destruct_(make_index_sequence<tracker_t::extarray_size>(), id);
     }
 
+    ///Helper to move values of user ext arrays between slots, version and changeset arrays stay per-slot
+    template<size_t... Index>
+    void extarray_relocate_(index_sequence<Index...>, uints src, uints dst) {
+        int dummy[] = { 0, (relocate_extarray_value(std::get<Index>(this->_exts).ptr() + src, std::get<Index>(this->_exts).ptr() + dst), 0)... };
+    }
+
+    void extarray_relocate(uints src, uints dst) {
+        extarray_relocate_(make_index_sequence<sizeof...(Es)>(), src, dst);
+    }
+
 #ifdef __clang__
 #pragma clang diagnostic pop
 #endif
@@ -2281,6 +2465,78 @@ private:
     bool clear_bit(uints k) { return _allocated.clear_bit(k); }
     bool get_bit(uints k) const { return _allocated.get_bit(k); }
 
+    /// @return first slot in [from, end) that is used (used == true) or free, or end if none
+    uints find_slot(uints from, uints end, bool used) const
+    {
+        const bitmask_type* bm = _allocated.ptr();
+        const uints nw = _allocated.size();
+
+        while (from < end) {
+            const uints w = from / BITMASK_BITS;
+            if (w >= nw)
+                return used ? end : from;
+
+            uints m = used ? uints(bm[w]) : ~uints(bm[w]);
+            m &= UMAXS << (from % BITMASK_BITS);
+
+            if (m) {
+                const uints id = w * BITMASK_BITS + lsb_bit_set(m);
+                return id < end ? id : end;
+            }
+
+            from = (w + 1) * BITMASK_BITS;
+        }
+
+        return end;
+    }
+
+    ///Move item and its ext array values to a free slot
+    void relocate_item(uints src, uints dst)
+    {
+        T* ps = ptr(src);
+        T* pd = ptr(dst);
+
+        if coid_constexpr_if(POOL) {
+            //free slots hold constructed objects in pool mode
+            *pd = std::move(*ps);
+        }
+        else {
+            new(pd) T(std::move(*ps));
+            ps->~T();
+        }
+
+        extarray_relocate(src, dst);
+
+        set_bit(dst);
+        clear_bit(src);
+
+        this->bump_version(src);
+        this->bump_version(dst);
+        this->set_modified(src);
+        this->set_modified(dst);
+    }
+
+    ///Release storage above the dense range of n items
+    void shrink_created(uints n)
+    {
+        if coid_constexpr_if(LINEAR) {
+            this->_array.set_size(n);
+        }
+        else {
+            //using page = typename storage_t::page;
+            typedef typename storage_t::page page;
+
+            uints np = align_to_chunks(n, page::ITEMS);
+            if (np < this->_pages.size())
+                this->_pages.popn(this->_pages.size() - np);
+
+            this->_created = n;
+        }
+
+        _allocated.set_size(align_to_chunks(n, BITMASK_BITS));
+        extarray_set_size(n);
+    }
+
     //WA for lambda template error
     void static destroy(T& p) { p.~T(); }
 
@@ -0,0 +1,257 @@
+#pragma once
+/* ***** BEGIN LICENSE BLOCK *****
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is COID/comm module.
+ *
+ * The Initial Developer of the Original Code is
+ * Brano Kemen
+ * Portions created by the Initial Developer are Copyright (C) 2009-2017
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef __COID_COMM_SLOTALLOC_SNAPSHOT__HEADER_FILE__
+#define __COID_COMM_SLOTALLOC_SNAPSHOT__HEADER_FILE__
+
+#include <atomic>
+#include "../namespace.h"
+#include "../dynarray.h"
+#include "../function.h"
+
+COID_NAMESPACE_BEGIN
+
+////////////////////////////////////////////////////////////////////////////////
+/**
+@brief Immutable view of slotalloc items, created by slotalloc_base::snapshot()
+
+Items are kept in refcounted chunks of ITEMS slots. When a snapshot is created from a tracking
+slotalloc with a previous snapshot, the chunks without modifications since the previous one are
+shared instead of copied, so that a snapshot per frame costs only the chunks that changed.
+Snapshots of non-tracking containers copy all chunks every time.
+Not available for slothash, as the snapshot doesn't include the hash table for lookups by key.
+
+Snapshots can be read, copied and destroyed from other threads, but must be created on the
+thread that modifies the container.
+**/
+template<class T>
+class slotalloc_snapshot
+{
+public:
+
+    static constexpr uint ITEMS = 256;
+
+    slotalloc_snapshot()
+    {}
+
+    ~slotalloc_snapshot() {
+        release();
+    }
+
+    slotalloc_snapshot(const slotalloc_snapshot& o) {
+        assign(o);
+    }
+
+    slotalloc_snapshot& operator = (const slotalloc_snapshot& o)
+    {
+        if (this != &o) {
+            release();
+            assign(o);
+        }
+        return *this;
+    }
+
+    slotalloc_snapshot(slotalloc_snapshot&& o) {
+        swap(o);
+    }
+
+    slotalloc_snapshot& operator = (slotalloc_snapshot&& o)
+    {
+        swap(o);
+        return *this;
+    }
+
+    void swap(slotalloc_snapshot& o)
+    {
+        _chunks.swap(o._chunks);
+        std::swap(_count, o._count);
+        std::swap(_created, o._created);
+        std::swap(_copied, o._copied);
+        std::swap(_frame, o._frame);
+        std::swap(_source, o._source);
+    }
+
+    friend void swap(slotalloc_snapshot& a, slotalloc_snapshot& b) {
+        a.swap(b);
+    }
+
+    /// @return number of valid items
+    uints count() const { return _count; }
+
+    /// @return number of slots, all valid ids are below
+    uints allocated_count() const { return _created; }
+
+    /// @return true if item with id was valid when the snapshot was made
+    bool is_valid_id(uints id) const
+    {
+        if (id >= _created)
+            return false;
+
+        const chunk* c = _chunks[id / ITEMS];
+        const uints i = id % ITEMS;
+        return ((c->mask[i / BITMASK_BITS] >> (i % BITMASK_BITS)) & 1) != 0;
+    }
+
+    /// @return item with given id or null if not valid
+    const T* get_item(uints id) const
+    {
+        return is_valid_id(id)
+            ? _chunks[id / ITEMS]->items() + id % ITEMS
+            : 0;
+    }
+
+    const T& operator [] (uints id) const
+    {
+        DASSERT(is_valid_id(id));
+        return _chunks[id / ITEMS]->items()[id % ITEMS];
+    }
+
+    ///Invoke a functor on each valid item
+    /// @param f functor with (const T&) or (const T&, uints id) arguments
+    template<typename Func>
+    void for_each(Func f) const
+    {
+        uints base = 0;
+
+        for (const chunk* c : _chunks) {
+            const T* d = c->items();
+
+            for (uint k = 0; k < NMASK; ++k) {
+                uints m = c->mask[k];
+
+                while (m) {
+                    const uint i = k * BITMASK_BITS + lsb_bit_set(m);
+                    m &= m - 1;
+
+                    if coid_constexpr_if (closure_traits<Func>::arity::value <= 1)
+                        f(d[i]);
+                    else
+                        f(d[i], base + i);
+                }
+            }
+
+            base += ITEMS;
+        }
+    }
+
+    /// @return number of chunks
+    uints chunk_count() const { return _chunks.size(); }
+
+    /// @return number of chunks copied from the container, the rest was shared with the previous snapshot
+    uints copied_chunks() const { return _copied; }
+
+    /// @return tracking frame of the container at the time of the snapshot
+    uint frame() const { return _frame; }
+
+private:
+
+    template<class, slotalloc_mode, class...>
+    friend class slotalloc_base;
+
+    static constexpr int BITMASK_BITS = 8 * sizeof(uints);
+    static constexpr uint NMASK = ITEMS / BITMASK_BITS;
+
+    ///Chunk header, followed by storage for ITEMS items, of which only the masked ones are constructed
+    struct alignas(alignof(T) > alignof(uints) ? alignof(T) : alignof(uints)) chunk
+    {
+        std::atomic<int32> refs;
+        uints mask[NMASK];
+
+        T* items() { return reinterpret_cast<T*>(this + 1); }
+        const T* items() const { return reinterpret_cast<const T*>(this + 1); }
+
+        static chunk* create()
+        {
+            chunk* c = new(dlmalloc(sizeof(chunk) + ITEMS * sizeof(T))) chunk;
+            c->refs.store(1, std::memory_order_relaxed);
+            ::memset(c->mask, 0, sizeof(c->mask));
+            return c;
+        }
+
+        void addref() {
+            refs.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void release()
+        {
+            if (refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+                return;
+
+            T* d = items();
+            for (uint k = 0; k < NMASK; ++k) {
+                for (uints m = mask[k]; m; m &= m - 1)
+                    d[k * BITMASK_BITS + lsb_bit_set(m)].~T();
+            }
+
+            this->~chunk();
+            dlfree(this);
+        }
+    };
+
+    void assign(const slotalloc_snapshot& o)
+    {
+        _chunks = o._chunks;
+        for (chunk* c : _chunks)
+            c->addref();
+
+        _count = o._count;
+        _created = o._created;
+        _copied = o._copied;
+        _frame = o._frame;
+        _source = o._source;
+    }
+
+    void release()
+    {
+        for (chunk* c : _chunks)
+            c->release();
+
+        _chunks.reset();
+        _count = _created = _copied = 0;
+    }
+
+    dynarray<chunk*> _chunks;
+    uints _count = 0;
+    uints _created = 0;
+    uints _copied = 0;                  //< chunks copied from the container
+    uint _frame = 0;                    //< tracking frame of the container
+    const void* _source = 0;            //< container the snapshot was made from
+};
+
+COID_NAMESPACE_END
+
+#endif //__COID_COMM_SLOTALLOC_SNAPSHOT__HEADER_FILE__
@@ -330,6 +330,7 @@ struct base
     dynarray<changeset>* get_changeset() { return 0; }
     const dynarray<changeset>* get_changeset() const { return 0; }
     uint* get_frame() { return 0; }
+    const uint* get_frame() const { return 0; }
 #endif
 };
 
@@ -362,6 +363,7 @@ struct base<VERSIONING, true, Es...>
     dynarray<changeset>* get_changeset() { return &std::get<sizeof...(Es)>(this->_exts); }
     const dynarray<changeset>* get_changeset() const { return &std::get<sizeof...(Es)>(this->_exts); }
     uint* get_frame() { return &_frame; }
+    const uint* get_frame() const { return &_frame; }
 
 private:
 
@@ -0,0 +1,295 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is COID/comm module.
+ *
+ * The Initial Developer of the Original Code is
+ * Brano Kemen
+ * Portions created by the Initial Developer are Copyright (C) 2009
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+
+#include "thread_cache.h"
+#include <atomic>
+
+namespace coid {
+
+namespace {
+
+static const uint NCLASSES = uint(thread_cache::MAX_CACHED_SIZE / thread_cache::GRANULE) + 1;
+static const uints BIN_SIZE_LIMIT = 16 << 10;           //< max bytes kept in a single bin
+static const uints THREAD_SIZE_LIMIT = 1 << 20;         //< cached bytes per thread that trigger a trim
+static const uint TRIM_INTERVAL = 1 << 14;              //< number of cached frees between periodic trims
+static const uint MAX_HEAPS = 256;                      //< max threads with their own heaps
+
+struct free_block {
+    free_block* next;
+};
+
+struct heap {
+    ::mspace msp = 0;
+    free_block* bins[NCLASSES] = {};
+    uint count[NCLASSES] = {};
+
+    //@return bin size limit in number of blocks
+    static uint bin_capacity(uint c) {
+        uints n = BIN_SIZE_LIMIT / (c * thread_cache::GRANULE);
+        return n < 8 ? 8 : uint(n);
+    }
+
+    void* alloc(size_t size, thread_cache::stats& st)
+    {
+        uint c = uint((size + thread_cache::GRANULE - 1) / thread_cache::GRANULE);
+        if (c == 0)
+            c = 1;
+
+        if (c < NCLASSES) {
+            free_block* b = bins[c];
+            if (b) {
+                bins[c] = b->next;
+                --count[c];
+                st.cached_size -= c * thread_cache::GRANULE;
+                ++st.hits;
+                return b;
+            }
+        }
+
+        ++st.misses;
+        return ::mspace_malloc(msp, size);
+    }
+
+    //@return true if the block was cached
+    bool cache(void* p, uints usable, thread_cache::stats& st)
+    {
+        //blocks are binned by the size class they can fully satisfy
+        uints c = usable / thread_cache::GRANULE;
+        if (c == 0 || c >= NCLASSES || count[c] >= bin_capacity(uint(c)))
+            return false;
+
+        free_block* b = static_cast<free_block*>(p);
+        b->next = bins[c];
+        bins[c] = b;
+        ++count[c];
+        st.cached_size += c * thread_cache::GRANULE;
+        ++st.cached_frees;
+        return true;
+    }
+
+    ///Release cached blocks back to the mspace
+    /// @param keep_half keep the most recently freed half of each bin
+    void flush(bool keep_half, thread_cache::stats& st)
+    {
+        for (uint c = 1; c < NCLASSES; ++c)
+        {
+            uint keep = keep_half ? count[c] / 2 : 0;
+            free_block** pb = &bins[c];
+            for (uint i = 0; i < keep; ++i)
+                pb = &(*pb)->next;
+
+            free_block* b = *pb;
+            *pb = 0;
+
+            while (b) {
+                free_block* n = b->next;
+                ::mspace_free(b);
+                b = n;
+            }
+
+            st.cached_size -= (count[c] - keep) * c * thread_cache::GRANULE;
+            count[c] = keep;
+        }
+
+        ::mspace_trim(msp, 0);
+    }
+};
+
+struct heap_slot {
+    std::atomic<bool> used{false};
+    heap obj;                           //< object heap
+    heap arr;                           //< array heap, aligned as comm_array_mspace
+    uint nfrees = 0;                    //< cached frees since the last trim
+    thread_cache::stats st;
+
+    void trim(bool keep_half) {
+        obj.flush(keep_half, st);
+        arr.flush(keep_half, st);
+        nfrees = 0;
+    }
+};
+
+static heap_slot _slots[MAX_HEAPS];
+static std::atomic<bool> _enabled{true};
+
+static thread_local heap_slot* _tls = 0;
+static thread_local bool _tls_detached = false;
+
+////////////////////////////////////////////////////////////////////////////////
+///Returns the heaps to the pool on thread exit
+struct slot_guard {
+    bool active = false;
+
+    ~slot_guard() {
+        heap_slot* s = _tls;
+        _tls = 0;
+        _tls_detached = true;
+
+        if (s) {
+            s->trim(false);
+            s->st = thread_cache::stats();
+            s->used.store(false, std::memory_order_release);
+        }
+    }
+};
+
+static thread_local slot_guard _guard;
+
+////////////////////////////////////////////////////////////////////////////////
+static heap_slot* attach()
+{
+    for (uint i = 0; i < MAX_HEAPS; ++i)
+    {
+        heap_slot& s = _slots[i];
+        if (s.used.load(std::memory_order_relaxed))
+            continue;
+
+        bool exp = false;
+        if (!s.used.compare_exchange_strong(exp, true, std::memory_order_acquire))
+            continue;
+
+        //heaps of exited threads are reused, blocks still allocated from them stay valid
+        if (!s.obj.msp)
+            s.obj.msp = ::create_mspace(0, 1, 0);
+        if (!s.arr.msp)
+            s.arr.msp = ::create_mspace(0, 1, 16 - sizeof(uints));
+
+        if (!s.obj.msp || !s.arr.msp) {
+            s.used.store(false, std::memory_order_release);
+            break;
+        }
+
+        _guard.active = true;
+        _tls = &s;
+        return &s;
+    }
+
+    //no heap available, use the global path
+    _tls_detached = true;
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static inline heap_slot* local_slot()
+{
+    heap_slot* s = _tls;
+    if (s || _tls_detached)
+        return s;
+
+    return attach();
+}
+
+} //namespace
+
+
+////////////////////////////////////////////////////////////////////////////////
+void* thread_cache::alloc(size_t size)
+{
+    heap_slot* s = _enabled.load(std::memory_order_relaxed) ? local_slot() : 0;
+    return s
+        ? s->obj.alloc(size, s->st)
+        : ::dlmalloc(size);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void* thread_cache::alloc_array(size_t size, ::mspace fallback)
+{
+    heap_slot* s = _enabled.load(std::memory_order_relaxed) ? local_slot() : 0;
+    return s
+        ? s->arr.alloc(size, s->st)
+        : ::mspace_malloc(fallback, size);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void thread_cache::free(void* p)
+{
+    if (!p)
+        return;
+
+    //virtual, stack and mmapped blocks return 0
+    ::mspace owner = 0;
+    uints usable = ::mspace_usable_size_owner(p, &owner);
+    heap_slot* s = _tls;
+
+    if (usable && s) {
+        heap* h = owner == s->obj.msp ? &s->obj
+            : (owner == s->arr.msp ? &s->arr : 0);
+
+        if (!h) {
+            //owned by another thread's heap or the global one, the owner's lock is taken
+            ++s->st.foreign_frees;
+        }
+        else if (_enabled.load(std::memory_order_relaxed) && h->cache(p, usable, s->st)) {
+            if (++s->nfrees >= TRIM_INTERVAL || s->st.cached_size > THREAD_SIZE_LIMIT) {
+                ++s->st.trims;
+                s->trim(true);
+            }
+            return;
+        }
+    }
+
+    ::mspace_free(p);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void thread_cache::trim()
+{
+    heap_slot* s = _tls;
+    if (s)
+        s->trim(false);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool thread_cache::enable(bool en)
+{
+    return _enabled.exchange(en);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool thread_cache::enabled()
+{
+    return _enabled.load(std::memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+thread_cache::stats thread_cache::thread_stats()
+{
+    heap_slot* s = _tls;
+    return s ? s->st : stats();
+}
+
+} //namespace coid
@@ -0,0 +1,99 @@
+#pragma once
+/* ***** BEGIN LICENSE BLOCK *****
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is COID/comm module.
+ *
+ * The Initial Developer of the Original Code is
+ * Brano Kemen
+ * Portions created by the Initial Developer are Copyright (C) 2009-2017
+ * the Initial Developer. All Rights Reserved.
+ *
+ * Contributor(s):
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef __COID_THREAD_CACHE__HEADER_FILE__
+#define __COID_THREAD_CACHE__HEADER_FILE__
+
+#include "../namespace.h"
+#include "../commtypes.h"
+#include "_malloc.h"
+
+namespace coid {
+
+////////////////////////////////////////////////////////////////////////////////
+///Thread-caching front end for dlmalloc
+/// Each thread gets its own pair of locked mspaces (objects and arrays) and keeps
+/// small freed blocks in per-thread size-class bins, so that the common alloc/free
+/// pairs don't touch the global dlmalloc lock.
+/// Cached blocks remain in-use dlmalloc chunks, dlmalloc_usable_size() returns the
+/// same value for them as for any other block, so memtrack accounting is unchanged.
+/// Blocks can be freed from any thread; blocks owned by another thread's heap are
+/// returned directly to the owning mspace (under its lock) instead of being cached.
+/// Heaps of exited threads are flushed and handed over to newly started threads.
+struct thread_cache
+{
+    static const uints GRANULE = 16;            //< size class granularity
+    static const uints MAX_CACHED_SIZE = 1024;  //< largest usable size kept in the bins
+
+    struct stats {
+        uint64 hits = 0;                //< allocations served from the bins
+        uint64 misses = 0;              //< allocations that went to the thread mspace
+        uint64 cached_frees = 0;        //< frees that went into the bins
+        uint64 foreign_frees = 0;       //< frees of blocks owned by other heaps
+        uint64 trims = 0;               //< periodic trims performed
+        uints cached_size = 0;          //< bytes currently held in the bins
+    };
+
+    ///Allocate object memory, from the calling thread's heap if the cache is available
+    /// @return pointer to memory or 0 if out of memory
+    static void* alloc(size_t size);
+
+    ///Allocate array memory, with the alignment of comm_array_mspace
+    /// @param fallback mspace to use if the thread cache is not available
+    static void* alloc_array(size_t size, ::mspace fallback);
+
+    ///Free memory allocated by any dlmalloc/mspace function except virtual and stack reservations
+    static void free(void* p);
+
+    ///Return all blocks cached by the calling thread to its heaps and trim them
+    static void trim();
+
+    ///Enable or disable the thread cache (for all threads)
+    /// @note disabled cache routes allocations to the global dlmalloc path, blocks can still be freed normally
+    /// @return previous state
+    static bool enable(bool en);
+
+    /// @return true if thread cache is enabled
+    static bool enabled();
+
+    ///Get statistics of the calling thread's cache
+    static stats thread_stats();
+};
+
+} //namespace coid
+
+#endif //#ifndef __COID_THREAD_CACHE__HEADER_FILE__
@@ -222,7 +222,12 @@ inline bool b_cas128(
         vall,
         cmp) == 1;
 #elif defined(__GNUC__)
-    return (coid::int64*)__sync_bool_compare_and_swap((__int128_t*)ptr, (__int128_t*)cmp, (__int128_t(valh) << 64) + vall);
+    //like _InterlockedCompareExchange128, store the current value to cmp
+    __int128_t old = *(__int128_t*)cmp;
+    __int128_t val = (__int128_t(valh) << 64) | coid::uint64(vall);
+    __int128_t cur = __sync_val_compare_and_swap((__int128_t*)ptr, old, val);
+    *(__int128_t*)cmp = cur;
+    return cur == old;
 #endif
 }
 #endif
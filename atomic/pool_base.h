@@ -4,46 +4,13 @@
 #include "../namespace.h"
 #include "../alloc/commalloc.h"
 #include "../ref_base.h"
-#include "stack_base.h"
+#include "../alloc/object_pool.h"
 
 COID_NAMESPACE_BEGIN
 
-///
+///Pool of reusable objects, see object_pool
 template<class T>
-class pool
-    : protected atomic::stack_base<T>
-{
-    using stack_t = atomic::stack_base<T>;
-
-public:
-    pool()
-        : atomic::stack_base<T>()
-    {}
-
-    /// return global pool for type T
-    static pool& global() { return SINGLETON(pool<T>); }
-
-    /// @brief Get item from pool
-    /// @return item from pool or nullptr
-    T* get_item() {
-        return stack_t::pop();
-    }
-
-    /// @brief Create instance or take one from pool
-    T* create_item() {
-        T* inst = stack_t::pop();
-        if (!inst)
-            inst = new T;
-        return inst;
-    }
-
-    /// return instance to pool
-    void release_item(T*& o) {
-        // create trait for reset !!!
-        stack_t::push(o);
-        o = 0;
-    }
-};
+using pool = object_pool<T>;
 
 ////////////////////////////////////////////////////////////////////////////////
 ///
@@ -73,6 +40,10 @@ protected:
 
 public:
 
+    ~policy_pooled() {
+        delete _obj;
+    }
+
     T* get() const { return _obj; }
 
     ///
@@ -145,9 +116,9 @@ public:
     static T* create(pool_type* po)
     {
         DASSERTN(po!=0);
-        this_type* p = 0;
+        this_type* p = po->get_item();
 
-        if (!po->get_item(p)) {
+        if (!p) {
             p = new T;
             p->_pool = po;
         }
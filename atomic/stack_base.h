@@ -94,7 +94,7 @@ private:
 #ifdef SYSTYPE_MSVC
             __movsq((uint64*)&_data, (uint64*)&p._data, 2);
 #else
-            * ((__int128_t*)_data) = __sync_add_and_fetch((__int128_t*)&p._data, 0);
+            *((__int128_t*)&_data) = __sync_add_and_fetch((__int128_t*)&p._data, 0);
 #endif
 #else
             _data = p._data;
@@ -70,6 +70,15 @@ inline bstype::pointer<T> pointer(T* co& p) {
 }
 */
 
+////////////////////////////////////////////////////////////////////////////////
+///Memory segment descriptor for vectored (scatter-gather) writes
+/// @note the layout matches posix iovec, arrays of segments are passed to writev/sendmsg as they are
+struct binstream_iovec
+{
+    const void* ptr;
+    uints len;
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 ///Binstream base class
 /**
@@ -77,6 +86,7 @@ inline bstype::pointer<T> pointer(T* co& p) {
     virtual opcd read( void* p, type t );
     virtual opcd write_raw( const void* p, uints& len ) = 0;
     virtual opcd read_raw( void* p, uints& len ) = 0;
+    virtual opcd write_rawv( const binstream_iovec* iov, uints niov, uints& len );
     virtual opcd write_array_content( binstream_container_base& c, uints* count, metastream* m );
     virtual opcd read_array_content( binstream_container_base& c, uints n, uints* count, metastream* m );
 
@@ -522,6 +532,50 @@ public:
     /// @         all data has been read
     virtual opcd read_raw(void* p, uints& len) = 0;
 
+    ///Write multiple raw data segments at once
+    /// @param iov array of memory segments to write, in order
+    /// @param niov number of segments in the array
+    /// @param len on return the number of bytes remaining to write (from all segments)
+    /// @return 0 (no error), or the error returned by the underlying write
+    /// @note the default implementation calls write_raw() for each segment, streams that can pass
+    /// @      multiple segments to the underlying medium in a single call override it
+    virtual opcd write_rawv(const binstream_iovec* iov, uints niov, uints& len)
+    {
+        len = iovec_size(iov, niov);
+
+        opcd e;
+        for (uints i = 0; i < niov; ++i)
+        {
+            uints n = iov[i].len;
+            e = write_raw(iov[i].ptr, n);
+
+            len -= iov[i].len - n;
+            if (e != NOERR || n > 0)
+                break;
+        }
+
+        return e;
+    }
+
+    ///A write_rawv() wrapper throwing exception on error
+    /// @return number of bytes remaining to write
+    uints xwrite_rawv(const binstream_iovec* iov, uints niov)
+    {
+        uints len;
+        opcd e = write_rawv(iov, niov, len);
+        if (e != NOERR)  throw e;
+        return len;
+    }
+
+    ///Total number of bytes in the segment array
+    static uints iovec_size(const binstream_iovec* iov, uints niov)
+    {
+        uints len = 0;
+        for (uints i = 0; i < niov; ++i)
+            len += iov[i].len;
+        return len;
+    }
+
     ///Write raw data.
     /// @note This method is provided just for the symetry, write_raw specification doesn't allow returning ersRETRY error code
     /// @      to specify that only partial data has been written, this may change in the future if it turns out being needed
@@ -0,0 +1,134 @@
+#pragma once
+
+/* ***** BEGIN LICENSE BLOCK *****
+* Version: MPL 1.1/GPL 2.0/LGPL 2.1
+*
+* The contents of this file are subject to the Mozilla Public License Version
+* 1.1 (the "License"); you may not use this file except in compliance with
+* the License. You may obtain a copy of the License at
+* http://www.mozilla.org/MPL/
+*
+* Software distributed under the License is distributed on an "AS IS" basis,
+* WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+* for the specific language governing rights and limitations under the
+* License.
+*
+* The Original Code is COID/comm module.
+*
+* The Initial Developer of the Original Code is
+* Outerra.
+* Portions created by the Initial Developer are Copyright (C) 2026
+* the Initial Developer. All Rights Reserved.
+*
+* Contributor(s):
+* Brano Kemen
+*
+* Alternatively, the contents of this file may be used under the terms of
+* either the GNU General Public License Version 2 or later (the "GPL"), or
+* the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+* in which case the provisions of the GPL or the LGPL are applicable instead
+* of those above. If you wish to allow use of your version of this file only
+* under the terms of either the GPL or the LGPL, and not to allow others to
+* use your version of this file under the terms of the MPL, indicate your
+* decision by deleting the provisions above and replace them with the notice
+* and other provisions required by the GPL or the LGPL. If you do not delete
+* the provisions above, a recipient may use your version of this file under
+* the terms of any one of the MPL, the GPL or the LGPL.
+*
+* ***** END LICENSE BLOCK ***** */
+
+#ifndef __COID_COMM_BINSTREAMBATCH__HEADER_FILE__
+#define __COID_COMM_BINSTREAMBATCH__HEADER_FILE__
+
+#include "../namespace.h"
+
+#include "binstream.h"
+#include "../dynarray.h"
+#include "../token.h"
+
+COID_NAMESPACE_BEGIN
+
+////////////////////////////////////////////////////////////////////////////////
+///Collects memory segments to be written to a binstream by a single vectored write
+/// @note segments are referenced, not copied; the memory must stay valid until written
+class binstream_batch
+{
+public:
+
+    ///Append memory segment
+    /// @note adjacent segments are merged into one
+    binstream_batch& add(const void* p, uints len)
+    {
+        if (!len)
+            return *this;
+
+        binstream_iovec* last = _segs.last();
+        if (last && (const uchar*)last->ptr + last->len == p)
+            last->len += len;
+        else {
+            binstream_iovec* seg = _segs.add();
+            seg->ptr = p;
+            seg->len = len;
+        }
+
+        _size += len;
+        return *this;
+    }
+
+    binstream_batch& add(const token& tok) {
+        return add(tok.ptr(), tok.len());
+    }
+
+    ///Append a plain data object by reference
+    template <class T>
+    binstream_batch& add_pod(const T& v)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "type must be trivially copyable");
+        return add(&v, sizeof(T));
+    }
+
+    ///Write all segments to the binstream and reset the batch
+    /// @return 0 (no error), or the error returned by the binstream; ersNO_MORE if not all data could be written
+    opcd write_to(binstream& bin)
+    {
+        uints len = 0;
+        opcd e = _segs.size() > 0
+            ? bin.write_rawv(_segs.ptr(), _segs.size(), len)
+            : opcd(0);
+
+        reset();
+
+        if (e == NOERR && len > 0)
+            e = ersNO_MORE;
+        return e;
+    }
+
+    ///A write_to() wrapper throwing exception on error
+    void xwrite_to(binstream& bin)
+    {
+        opcd e = write_to(bin);
+        if (e != NOERR)  throw e;
+    }
+
+    void reset() {
+        _segs.reset();
+        _size = 0;
+    }
+
+    ///Total size of collected data in bytes
+    uints size() const { return _size; }
+
+    ///Number of collected segments
+    uints count() const { return _segs.size(); }
+
+    const binstream_iovec* segments() const { return _segs.ptr(); }
+
+private:
+
+    dynarray<binstream_iovec> _segs;
+    uints _size = 0;
+};
+
+COID_NAMESPACE_END
+
+#endif //__COID_COMM_BINSTREAMBATCH__HEADER_FILE__
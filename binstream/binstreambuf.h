@@ -178,6 +178,17 @@ public:
         return 0;
     }
 
+    virtual opcd write_rawv(const binstream_iovec* iov, uints niov, uints& len) override
+    {
+        char* b = _buf.add(iovec_size(iov, niov));
+        for (uints i = 0; i < niov; ++i) {
+            xmemcpy(b, iov[i].ptr, iov[i].len);
+            b += iov[i].len;
+        }
+        len = 0;
+        return 0;
+    }
+
     virtual opcd read_raw(void* p, uints& len) override
     {
         if (_buf.size() - _bgi < len)
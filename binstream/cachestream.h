@@ -195,6 +195,75 @@ public:
         return e;
     }
 
+    ///Merges the segments into the cache if they fit, otherwise the cache content and the segments
+    /// are passed to the underlying stream with vectored writes, without copying
+    virtual opcd write_rawv(const binstream_iovec* iov, uints niov, uints& len) override
+    {
+        if (_cot.reserved_total() == 0)
+            _cot.reserve(DEFAULT_CACHE_SIZE, false);
+
+        len = iovec_size(iov, niov);
+
+        if (len <= _cot.reserved_remaining())
+        {
+            for (uints i = 0; i < niov; ++i)
+                _cot.add_bin_from((const uchar*)iov[i].ptr, iov[i].len);
+            len = 0;
+            return 0;
+        }
+
+        opcd e = on_cache_flush(_cot.ptr(), _cot.size(), false);
+        if (e == ersNOT_IMPLEMENTED)  e = 0;
+        if (e != NOERR)
+            //cache content is being transformed on flush, data have to go through the cache
+            return binstream::write_rawv(iov, niov, len);
+
+        enum { NSEG = 32 };
+        binstream_iovec vec[NSEG];
+        uints nv = 0;
+
+        uints ncached = _cot.size();
+        if (ncached) {
+            vec[0].ptr = _cot.ptr();
+            vec[0].len = ncached;
+            nv = 1;
+        }
+
+        while (niov > 0 || nv > 0)
+        {
+            for (; nv < NSEG && niov > 0; --niov)
+                vec[nv++] = *iov++;
+
+            uints rem;
+            e = _bin->write_rawv(vec, nv, rem);
+
+            uints written = iovec_size(vec, nv) - rem;
+            _tcotwritten += written;
+            if (written > ncached)
+                len -= written - ncached;
+
+            if (ncached) {
+                //drop only the part of the cache that was actually written
+                if (written < ncached) {
+                    _cot.del(0, written);
+                    return e != NOERR ? e : ersNO_MORE;
+                }
+
+                _cot.reset();
+                ncached = 0;
+            }
+
+            if (e != NOERR)
+                return e;
+            if (rem)
+                return ersNO_MORE;
+
+            nv = 0;
+        }
+
+        return e;
+    }
+
     virtual opcd read_raw(void* p, uints& len) override
     {
         opcd e;
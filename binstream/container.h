@@ -387,6 +387,97 @@ protected:
 };
 
 
+////////////////////////////////////////////////////////////////////////////////
+///Container for reading arrays element by element, without storing them
+/**
+    Holds just a single element; each element is handed over to the callback once it's
+    been fully read, so arrays of any size can be processed with bounded memory.
+    The last element is delivered by flush(), which has to be called after the array
+    has been read (metastream::stream_array_in_each and member_stream_array do that).
+    @param Fn void function(T&&) receiving the elements
+**/
+template<class T, class Fn, class COUNT = uints>
+struct binstream_container_callback_in : binstream_containerT<T, COUNT>
+{
+    virtual const void* extract(uints n) override
+    {
+        DASSERT(0);
+        return 0;
+    }
+
+    virtual void* insert(uints n, const void* defval) override
+    {
+        DASSERT(n == 1);
+        flush();
+
+        if (defval)
+            _item = *static_cast<const T*>(defval);
+        else
+            _item = T();
+
+        _pending = true;
+        return &_item;
+    }
+
+    virtual bool is_continuous() const override { return false; }
+
+    virtual uints count() const override { return UMAXS; }
+
+    ///Deliver the last pending element
+    void flush()
+    {
+        if (_pending) {
+            _pending = false;
+            ++_count;
+            _fn(std::move(_item));
+        }
+    }
+
+    /// @return number of elements delivered
+    uints delivered() const { return _count; }
+
+    binstream_container_callback_in(Fn& fn)
+        : _fn(fn)
+    {}
+
+protected:
+    Fn& _fn;
+    T _item = T();
+    uints _count = 0;
+    bool _pending = false;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+///Container for writing arrays from a generator function, element by element
+/// @param Fn const T* function() returning the next element to write, or nullptr at the end
+template<class T, class Fn, class COUNT = uints>
+struct binstream_container_callback_out : binstream_containerT<T, COUNT>
+{
+    virtual const void* extract(uints n) override
+    {
+        DASSERT(n == 1);
+        return _fn();
+    }
+
+    virtual void* insert(uints n, const void* defval) override
+    {
+        DASSERT(0);
+        return 0;
+    }
+
+    virtual bool is_continuous() const override { return false; }
+
+    virtual uints count() const override { return UMAXS; }
+
+    binstream_container_callback_out(Fn& fn)
+        : _fn(fn)
+    {}
+
+protected:
+    Fn& _fn;
+};
+
+
 COID_NAMESPACE_END
 
 #endif //__COID_COMM_BINSTREAM_CONTAINER__HEADER_FILE__
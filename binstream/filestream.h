@@ -52,6 +52,11 @@
 # endif
 #else
 # include <unistd.h>
+# include <sys/uio.h>
+# include <climits>
+# ifndef IOV_MAX
+#  define IOV_MAX 1024
+# endif
 #endif
 
 #include <fcntl.h>
@@ -89,6 +94,43 @@ public:
         return 0;
     }
 
+    virtual opcd write_rawv(const binstream_iovec* iov, uints niov, uints& len) override
+    {
+#ifdef SYSTYPE_WIN
+        return binstream::write_rawv(iov, niov, len);
+#else
+        static_assert(sizeof(binstream_iovec) == sizeof(::iovec), "binstream_iovec doesn't match iovec");
+        DASSERT(_handle != -1);
+
+        if (_op > 0)
+            upd_rpos();
+
+        len = iovec_size(iov, niov);
+
+        while (niov > 0)
+        {
+            int n = niov > IOV_MAX ? IOV_MAX : int(niov);
+            uints batch = iovec_size(iov, n);
+
+            ssize_t k = ::writev(_handle, reinterpret_cast<const ::iovec*>(iov), n);
+            if (k < 0)
+                return ersIO_ERROR;
+
+            _wpos += k;
+            len -= k;
+
+            //partial write, same as in write_raw the remaining size is returned in len
+            if (uints(k) < batch)
+                break;
+
+            iov += n;
+            niov -= n;
+        }
+
+        return 0;
+#endif
+    }
+
     virtual opcd read_raw(void* p, uints& len) override
     {
         DASSERT(_handle != -1);
@@ -0,0 +1,873 @@
+#pragma once
+
+/* ***** BEGIN LICENSE BLOCK *****
+* Version: MPL 1.1/GPL 2.0/LGPL 2.1
+*
+* The contents of this file are subject to the Mozilla Public License Version
+* 1.1 (the "License"); you may not use this file except in compliance with
+* the License. You may obtain a copy of the License at
+* http://www.mozilla.org/MPL/
+*
+* Software distributed under the License is distributed on an "AS IS" basis,
+* WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+* for the specific language governing rights and limitations under the
+* License.
+*
+* The Original Code is COID/comm module.
+*
+* The Initial Developer of the Original Code is
+* Outerra.
+* Portions created by the Initial Developer are Copyright (C) 2026
+* the Initial Developer. All Rights Reserved.
+*
+* Contributor(s):
+* Brano Kemen
+*
+* Alternatively, the contents of this file may be used under the terms of
+* either the GNU General Public License Version 2 or later (the "GPL"), or
+* the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+* in which case the provisions of the GPL or the LGPL are applicable instead
+* of those above. If you wish to allow use of your version of this file only
+* under the terms of either the GPL or the LGPL, and not to allow others to
+* use your version of this file under the terms of the MPL, indicate your
+* decision by deleting the provisions above and replace them with the notice
+* and other provisions required by the GPL or the LGPL. If you do not delete
+* the provisions above, a recipient may use your version of this file under
+* the terms of any one of the MPL, the GPL or the LGPL.
+*
+* ***** END LICENSE BLOCK ***** */
+#ifndef __COID_COMM_NETSTREAMTCP__HEADER_FILE__
+#define __COID_COMM_NETSTREAMTCP__HEADER_FILE__
+
+#include "../namespace.h"
+#include "binstream.h"
+#include "../net.h"
+#include "../net_reactor.h"
+#include "../dynarray.h"
+
+#ifndef SYSTYPE_WIN
+# include <sys/socket.h>
+#endif
+
+#if defined(MSG_MORE)
+# define COID_NET_MSG_MORE MSG_MORE
+#else
+# define COID_NET_MSG_MORE 0
+#endif
+
+#if defined(MSG_NOSIGNAL)
+# define COID_NET_MSG_NOSIGNAL MSG_NOSIGNAL
+#else
+# define COID_NET_MSG_NOSIGNAL 0
+#endif
+
+
+COID_NAMESPACE_BEGIN
+
+////////////////////////////////////////////////////////////////////////////////
+///Buffered binstream over a TCP socket
+/**
+    Output is accumulated in a send ring and goes out on flush(), or earlier when the ring
+    fills up, in which case it's sent with MSG_MORE so the kernel can coalesce it with what
+    follows. Writes that don't fit the ring bypass it, and are sent together with the
+    buffered data in a single gathered send. Input is received into a receive ring with
+    a single scatter recv, and large reads go directly into the destination. The buffered
+    input can be accessed in place via peek()/consume().
+
+    In framed mode (default) each flush() terminates a packet, that the reading side reads
+    up to its end (read_raw returns ersNO_MORE there) and then acknowledges, so formatting
+    streams and metastream can be bound directly to the stream:
+        netstreamtcp net(sock.getHandle());
+        fmtstreambin fmt(net);
+        metastream meta(fmt);
+        meta.xstream_out(data);
+        meta.stream_flush();
+    Packets are sent as chunks prefixed with a 32-bit header holding the chunk length and
+    a continuation flag, so a packet doesn't have to fit into the send ring.
+    In raw mode data are passed unchanged, and the input ends when the peer closes the
+    connection.
+
+    Blocking mode (default): reads wait for data and writes wait until sent, honoring
+    set_timeout().
+    Reactor mode (attach()): the socket is switched to non-blocking mode and driven by
+    a netReactor. Incoming data are pulled into the receive ring, growing it as needed,
+    and the data callback is invoked; reads return ersNO_MORE when the buffered data run
+    out, use packet_ready() to check if a complete packet arrived. Unsent output is kept
+    in the send ring and sent when the socket becomes writable.
+**/
+class netstreamtcp : public binstream
+{
+public:
+
+    COIDNEWDELETE(netstreamtcp);
+
+    typedef function<void(netstreamtcp&)> data_fn;
+
+    /// @param handle connected socket handle, the stream takes ownership of it
+    /// @param framed true for packets terminated by flush(), false for raw data
+    /// @param rxsize receive ring size
+    /// @param txsize send ring size
+    explicit netstreamtcp(uints handle = UMAXS, bool framed = true, uints rxsize = 65536, uints txsize = 65536)
+        : _framed(framed)
+    {
+        _rx.alloc(rxsize);
+        _tx.alloc(txsize);
+        assign(handle);
+    }
+
+    ~netstreamtcp()
+    {
+        detach();
+    }
+
+    ///Assign a connected socket, the stream takes ownership of it
+    void assign(uints handle)
+    {
+        detach();
+        _sock.setHandle(handle);
+        reset_all();
+    }
+
+    netSocket& socket() { return _sock; }
+
+    virtual uint binstream_attributes(bool in0out1) const override
+    {
+        return _framed ? fATTR_HANDSHAKING : uint(fATTR_READ_UNTIL);
+    }
+
+    virtual opcd write_raw(const void* p, uints& len) override
+    {
+        if (!_sock.isValid())
+            return ersDISCONNECTED;
+
+        if (_framed && !_chunk_open) {
+            opcd e = open_chunk();
+            if (e != NOERR) return e;
+        }
+
+        if (len <= _tx.free() || _reactor) {
+            _tx.put(p, len);
+            len = 0;
+            return 0;
+        }
+
+        //doesn't fit, send the buffered data together with the new block
+        const uint8* data = (const uint8*)p;
+        while (len > 0)
+        {
+            uints n = len > MAX_CHUNK ? MAX_CHUNK : len;
+
+            if (_framed) {
+                if (!_chunk_open) {
+                    opcd e = open_chunk();
+                    if (e != NOERR) return e;
+                }
+                close_chunk(n, true);
+            }
+
+            binstream_iovec iov[3];
+            uint niov = _tx.data_segments(iov);
+            iov[niov].ptr = data;
+            iov[niov++].len = n;
+
+            opcd e = send_all(iov, niov, true);
+            _tx.clear();
+            if (e != NOERR)
+                return e;
+
+            data += n;
+            len -= n;
+        }
+
+        return 0;
+    }
+
+    virtual opcd write_rawv(const binstream_iovec* iov, uints niov, uints& len) override
+    {
+        uints total = iovec_size(iov, niov);
+
+        //gather into a single send only if it doesn't fit the ring anyway
+        if (total <= _tx.free() || _reactor || total > MAX_CHUNK || niov > MAX_IOV - 2)
+            return binstream::write_rawv(iov, niov, len);
+
+        if (!_sock.isValid())
+            return ersDISCONNECTED;
+
+        if (_framed) {
+            if (!_chunk_open) {
+                opcd e = open_chunk();
+                if (e != NOERR) return e;
+            }
+            close_chunk(total, true);
+        }
+
+        binstream_iovec all[MAX_IOV];
+        uint n = _tx.data_segments(all);
+        for (uints i = 0; i < niov; ++i)
+            all[n++] = iov[i];
+
+        opcd e = send_all(all, n, true);
+        _tx.clear();
+
+        len = e == NOERR ? 0 : total;
+        return e;
+    }
+
+    virtual opcd read_raw(void* p, uints& len) override
+    {
+        uint8* dst = (uint8*)p;
+
+        while (len > 0)
+        {
+            uints want = len;
+
+            if (_framed) {
+                if (_chunk_left == 0) {
+                    if (_chunk_final)
+                        return ersNO_MORE;      //end of packet
+
+                    opcd e = next_chunk();
+                    if (e != NOERR) return e;
+                    continue;
+                }
+                if (want > _chunk_left)
+                    want = _chunk_left;
+            }
+
+            uints avail = _rx.size();
+            if (avail == 0)
+            {
+                if (_reactor)
+                    return ersNO_MORE;
+
+                if (want >= _rx.capacity()) {
+                    //large read, receive directly into the destination
+                    uints k = 0;
+                    opcd e = recv_direct(dst, want, k);
+                    dst += k;
+                    len -= k;
+                    if (_framed)
+                        _chunk_left -= k;
+                    if (e != NOERR)
+                        return e;
+                    continue;
+                }
+
+                opcd e = fill(true);
+                if (e != NOERR)
+                    return e;
+                continue;
+            }
+
+            uints n = want < avail ? want : avail;
+            _rx.get(dst, n);
+            dst += n;
+            len -= n;
+            if (_framed)
+                _chunk_left -= n;
+        }
+
+        return 0;
+    }
+
+    ///Read until substring is found, only in raw mode
+    virtual opcd read_until(const substring& ss, binstream* bout, uints max_size = UMAXS) override
+    {
+        if (_framed)
+            return ersUNAVAILABLE;
+
+        for (;;)
+        {
+            _rx.linearize();
+            token t((const char*)_rx.head_ptr(), _rx.size());
+
+            uints n = t.count_until_substring(ss);
+            if (n < t.len()) {
+                if (bout) {
+                    uints k = n;
+                    bout->write_raw(t.ptr(), k);
+                }
+                _rx.consume(n + ss.len());
+                return 0;
+            }
+
+            if (t.len() >= max_size)
+                return ersNOT_FOUND;
+
+            if (_rx.free() == 0)
+                _rx.grow(_rx.capacity());
+
+            opcd e = _reactor ? ersNO_MORE : fill(true);
+            if (e != NOERR)
+                return e == ersNO_MORE ? ersNOT_FOUND : e;
+        }
+    }
+
+    virtual opcd peek_read(uint timeout) override
+    {
+        if (_rx.size() > 0)
+            return 0;
+        if (_reactor || !_sock.isValid())
+            return ersNO_MORE;
+
+        if (_sock.wait_read(timeout) <= 0)
+            return timeout ? ersTIMEOUT : ersNO_MORE;
+
+        return fill(false) == NOERR ? opcd(0) : ersNO_MORE;
+    }
+
+    virtual opcd peek_write(uint timeout) override
+    {
+        return 0;
+    }
+
+    virtual bool is_open() const override { return _sock.isValid(); }
+
+    virtual opcd close(bool linger = false) override
+    {
+        detach();
+        if (linger)
+            _sock.lingering_close();
+        else
+            _sock.close();
+        return 0;
+    }
+
+    ///Send the buffered data, terminating the current packet in framed mode
+    virtual void flush() override
+    {
+        if (_framed && _packet_open) {
+            if (!_chunk_open)
+                open_chunk();
+            close_chunk(0, false);
+            _packet_open = false;
+        }
+
+        opcd e = send_pending();
+        if (e != NOERR && e != ersRETRY)
+            throw e;
+    }
+
+    ///Finish reading the current packet
+    /// @param eat skip remaining data of the packet instead of throwing ersIO_ERROR
+    virtual void acknowledge(bool eat = false) override
+    {
+        if (!_framed)
+            return;
+
+        while (!_chunk_final || _chunk_left > 0)
+        {
+            if (_chunk_left == 0) {
+                opcd e = next_chunk();
+                if (e != NOERR)
+                    throw e;
+                continue;
+            }
+
+            if (!eat)
+                throw ersIO_ERROR "data left in received block";
+
+            if (_rx.size() == 0) {
+                opcd e = _reactor ? ersNO_MORE : fill(true);
+                if (e != NOERR)
+                    throw e;
+            }
+
+            uints n = _rx.size() < _chunk_left ? _rx.size() : _chunk_left;
+            _rx.consume(n);
+            _chunk_left -= n;
+        }
+
+        _chunk_final = false;
+    }
+
+    virtual void reset_read() override
+    {
+        _rx.clear();
+        _chunk_left = 0;
+        _chunk_final = false;
+        _eof = false;
+    }
+
+    virtual void reset_write() override
+    {
+        _tx.clear();
+        _chunk_open = false;
+        _packet_open = false;
+    }
+
+    ///Set timeout for blocking reads and writes
+    /// @param ms timeout in milliseconds, UMAX32 for infinite
+    virtual opcd set_timeout(uint ms) override
+    {
+        _timeout = ms;
+        return 0;
+    }
+
+
+    /// @return number of bytes buffered in the receive ring
+    uints available() const { return _rx.size(); }
+
+    /// @return number of bytes waiting to be sent
+    uints pending() const { return _tx.size(); }
+
+    /// @return true if the peer closed the connection
+    bool eof() const { return _eof; }
+
+    ///Access buffered input in place
+    /// @return contiguous part of the buffered input, limited to the current chunk in framed mode
+    /// @note in framed mode valid only after a read started the chunk
+    token peek() const
+    {
+        uints n = _rx.contiguous();
+        if (_framed && n > _chunk_left)
+            n = _chunk_left;
+        return token((const char*)_rx.head_ptr(), n);
+    }
+
+    ///Discard n bytes of buffered input returned by peek()
+    void consume(uints n)
+    {
+        DASSERT(n <= _rx.size());
+        _rx.consume(n);
+        if (_framed)
+            _chunk_left -= n;
+    }
+
+    ///Check if a complete packet is buffered
+    /// @note in reactor mode, call before reading a packet, to avoid parsing incomplete data
+    bool packet_ready() const
+    {
+        if (!_framed)
+            return _rx.size() > 0;
+
+        uint64 pos = _rx._head;
+        uint64 end = _rx._tail;
+        uint64 left = _chunk_left;
+        bool final = _chunk_final;
+
+        for (;;) {
+            if (end - pos < left)
+                return false;
+            pos += left;
+
+            if (final)
+                return true;
+            if (end - pos < 4)
+                return false;
+
+            uint32 h;
+            _rx.get_at(pos, &h, 4);
+            pos += 4;
+            left = h & ~fMORE;
+            final = (h & fMORE) == 0;
+        }
+    }
+
+
+    ///Drive the stream by a reactor
+    /// @param r reactor to register with, the stream has to be used from the reactor's thread
+    /// @param fn callback invoked when new data arrived or the connection was closed
+    bool attach(netReactor& r, data_fn&& fn)
+    {
+        detach();
+        if (!_sock.isValid())
+            return false;
+
+        _sock.setBlocking(false);
+        _on_data = std::move(fn);
+        _reactor = &r;
+        _reg = r.add(_sock.getHandle(), netReactor::EV_READ | netReactor::EV_WRITE, [this](uint events) {
+            on_event(events);
+        });
+
+        if (!_reg) {
+            _reactor = 0;
+            _sock.setBlocking(true);
+            return false;
+        }
+        return true;
+    }
+
+    ///Stop being driven by the reactor and return to blocking mode
+    void detach()
+    {
+        if (!_reactor)
+            return;
+
+        _reactor->remove(_reg);
+        _reactor = 0;
+        _reg = 0;
+        if (_sock.isValid())
+            _sock.setBlocking(true);
+    }
+
+private:
+
+    ///Chunk header flag signalling that the packet continues with another chunk
+    static const uint32 fMORE = 0x80000000U;
+    static const uints MAX_CHUNK = 0x40000000;
+    static const uint MAX_IOV = 64;
+
+    ///Ring buffer with monotonic head and tail positions
+    struct ring
+    {
+        dynarray<uint8> _buf;
+        uints _mask = 0;
+        uint64 _head = 0;
+        uint64 _tail = 0;
+
+        void alloc(uints size)
+        {
+            uints n = 4096;
+            while (n < size)
+                n <<= 1;
+            _buf.alloc(n);
+            _mask = n - 1;
+            _head = _tail = 0;
+        }
+
+        uints size() const { return uints(_tail - _head); }
+        uints capacity() const { return _mask + 1; }
+        uints free() const { return capacity() - size(); }
+        void clear() { _head = _tail = 0; }
+
+        const uint8* head_ptr() const { return _buf.ptr() + (_head & _mask); }
+
+        /// @return size of the contiguous part of data at the head
+        uints contiguous() const
+        {
+            uints h = uints(_head & _mask);
+            uints n = capacity() - h;
+            return n < size() ? n : size();
+        }
+
+        uint data_segments(binstream_iovec* iov) const
+        {
+            uints n = contiguous();
+            if (n == 0)
+                return 0;
+
+            iov[0].ptr = head_ptr();
+            iov[0].len = n;
+            if (n == size())
+                return 1;
+
+            iov[1].ptr = _buf.ptr();
+            iov[1].len = size() - n;
+            return 2;
+        }
+
+        uint free_segments(binstream_iovec* iov)
+        {
+            uints f = free();
+            if (f == 0)
+                return 0;
+
+            uints t = uints(_tail & _mask);
+            uints n = capacity() - t;
+
+            iov[0].ptr = _buf.ptr() + t;
+            iov[0].len = n < f ? n : f;
+            if (n >= f)
+                return 1;
+
+            iov[1].ptr = _buf.ptr();
+            iov[1].len = f - n;
+            return 2;
+        }
+
+        void put_at(uint64 pos, const void* p, uints n)
+        {
+            uints t = uints(pos & _mask);
+            uints k = capacity() - t;
+            if (k > n) k = n;
+
+            ::memcpy(_buf.ptr() + t, p, k);
+            ::memcpy(_buf.ptr(), (const uint8*)p + k, n - k);
+        }
+
+        void get_at(uint64 pos, void* p, uints n) const
+        {
+            uints h = uints(pos & _mask);
+            uints k = capacity() - h;
+            if (k > n) k = n;
+
+            ::memcpy(p, _buf.ptr() + h, k);
+            ::memcpy((uint8*)p + k, _buf.ptr(), n - k);
+        }
+
+        void put(const void* p, uints n)
+        {
+            if (n > free())
+                grow(n);
+            put_at(_tail, p, n);
+            _tail += n;
+        }
+
+        void get(void* p, uints n)
+        {
+            DASSERT(n <= size());
+            get_at(_head, p, n);
+            _head += n;
+        }
+
+        void consume(uints n) { _head += n; }
+
+        ///Grow to accommodate at least n more bytes, data become contiguous
+        void grow(uints n)
+        {
+            uints sz = size();
+            uints cap = capacity();
+            while (cap - sz < n)
+                cap <<= 1;
+
+            dynarray<uint8> buf;
+            buf.alloc(cap);
+            get_at(_head, buf.ptr(), sz);
+
+            _buf.swap(buf);
+            _mask = cap - 1;
+            _head = 0;
+            _tail = sz;
+        }
+
+        ///Make the data contiguous
+        void linearize()
+        {
+            if (contiguous() < size())
+                grow(0);
+        }
+    };
+
+
+    opcd open_chunk()
+    {
+        if (_tx.free() < 4 && !_reactor) {
+            opcd e = send_pending();
+            if (e != NOERR)
+                return e;
+        }
+
+        _hdr_pos = _tx._tail;
+        uint32 h = 0;
+        _tx.put(&h, 4);
+        _chunk_open = true;
+        _packet_open = true;
+        return 0;
+    }
+
+    /// @param extra bytes to be sent with the chunk beyond the ring content
+    /// @param more true if the packet continues with another chunk
+    void close_chunk(uints extra, bool more)
+    {
+        uint32 h = uint32(_tx._tail - _hdr_pos - 4 + extra);
+        if (more)
+            h |= fMORE;
+
+        _tx.put_at(_hdr_pos, &h, 4);
+        _chunk_open = false;
+    }
+
+    ///Read header of the next chunk
+    opcd next_chunk()
+    {
+        while (_rx.size() < 4) {
+            if (_reactor)
+                return ersNO_MORE;
+            if (_rx.free() == 0)
+                _rx.grow(4);
+
+            opcd e = fill(true);
+            if (e != NOERR)
+                return e;
+        }
+
+        uint32 h;
+        _rx.get(&h, 4);
+        _chunk_left = h & ~fMORE;
+        _chunk_final = (h & fMORE) == 0;
+        return 0;
+    }
+
+    ///Receive available data into the ring
+    /// @param wait true to block until something arrives
+    /// @return ersRETRY if nothing is available in non-blocking mode, ersNO_MORE if the connection was closed
+    opcd fill(bool wait)
+    {
+        binstream_iovec iov[2];
+        uint n = _rx.free_segments(iov);
+        if (n == 0)
+            return 0;
+
+        for (;;)
+        {
+            if (wait && !_reactor && _timeout != UMAX32 && _sock.wait_read(_timeout) <= 0)
+                return ersTIMEOUT;
+
+            int k = _sock.recvv(iov, n);
+            if (k > 0) {
+                _rx._tail += k;
+                return 0;
+            }
+            if (k == 0) {
+                _eof = true;
+                return ersNO_MORE;
+            }
+            if (!netSocket::isNonBlockingError())
+                return ersIO_ERROR;
+            if (!wait || _reactor)
+                return ersRETRY;
+        }
+    }
+
+    ///Receive directly into the destination buffer, bypassing the ring
+    /// @param k [out] number of bytes received
+    opcd recv_direct(uint8* p, uints len, uints& k)
+    {
+        if (_timeout != UMAX32 && _sock.wait_read(_timeout) <= 0)
+            return ersTIMEOUT;
+
+        int n = _sock.recv(p, len > MAX_CHUNK ? int(MAX_CHUNK) : int(len));
+        if (n == 0) {
+            _eof = true;
+            return ersNO_MORE;
+        }
+        if (n < 0)
+            return netSocket::isNonBlockingError() ? opcd(0) : ersIO_ERROR;
+
+        k = n;
+        return 0;
+    }
+
+    ///Send the content of the ring
+    /// @return ersRETRY if some data remain to be sent when the reactor signals writability
+    opcd send_pending()
+    {
+        if (_tx.size() == 0)
+            return 0;
+
+        //in framed mode an open chunk can't go out before its header is complete
+        uint64 end = _chunk_open ? _hdr_pos : _tx._tail;
+        if (end == _tx._head)
+            return 0;
+
+        uint64 tail = _tx._tail;
+        _tx._tail = end;
+
+        binstream_iovec iov[2];
+        uint n = _tx.data_segments(iov);
+        uints size = _tx.size();
+
+        opcd e = send_all(iov, n, false, &size);
+        _tx.consume(_tx.size() - size);
+        _tx._tail = tail;
+
+        if (_tx.size() == 0)
+            _tx.clear();
+        return e;
+    }
+
+    ///Send gathered data
+    /// @param more true if more data follow
+    /// @param left [out] optional number of bytes left unsent
+    opcd send_all(binstream_iovec* iov, uint niov, bool more, uints* left = 0)
+    {
+        int flags = COID_NET_MSG_NOSIGNAL | (more ? COID_NET_MSG_MORE : 0);
+        uints rem = iovec_size(iov, niov);
+
+        while (niov > 0)
+        {
+            int k = _sock.sendv(iov, niov, flags);
+            if (k < 0) {
+                opcd e = 0;
+                if (!netSocket::isNonBlockingError())
+                    e = ersIO_ERROR;
+                else if (_reactor)
+                    e = ersRETRY;
+                else if (_sock.wait_write(_timeout == UMAX32 ? -1 : int(_timeout)) <= 0)
+                    e = ersTIMEOUT;
+
+                if (e != NOERR) {
+                    if (left) *left = rem;
+                    return e;
+                }
+                continue;
+            }
+
+            rem -= k;
+            uints kk = k;
+            while (niov > 0 && kk >= iov->len) {
+                kk -= iov->len;
+                ++iov;
+                --niov;
+            }
+            if (niov > 0) {
+                iov->ptr = (const uint8*)iov->ptr + kk;
+                iov->len -= kk;
+            }
+        }
+
+        if (left) *left = 0;
+        return 0;
+    }
+
+    void on_event(uint events)
+    {
+        if (events & netReactor::EV_WRITE)
+            send_pending();
+
+        bool got = false;
+        if (events & (netReactor::EV_READ | netReactor::EV_HANGUP))
+        {
+            //edge triggered, drain the socket
+            for (;;) {
+                if (_rx.free() == 0)
+                    _rx.grow(_rx.capacity());
+
+                opcd e = fill(false);
+                if (e == NOERR) {
+                    got = true;
+                    continue;
+                }
+                if (e == ersNO_MORE || e == ersIO_ERROR)
+                    got = _eof = true;
+                break;
+            }
+        }
+
+        if (events & netReactor::EV_ERROR)
+            got = _eof = true;
+
+        if (got && _on_data)
+            _on_data(*this);
+    }
+
+
+    netSocket _sock;
+
+    ring _rx;
+    ring _tx;
+
+    bool _framed;
+    bool _eof = false;
+
+    //writing state
+    bool _chunk_open = false;           //< header of the current chunk reserved at _hdr_pos
+    bool _packet_open = false;          //< packet data written since the last flush
+    uint64 _hdr_pos = 0;
+
+    //reading state
+    uints _chunk_left = 0;              //< bytes left in the current chunk
+    bool _chunk_final = false;          //< current chunk is the last one of the packet
+
+    uint _timeout = UMAX32;
+
+    netReactor* _reactor = 0;
+    uint64 _reg = 0;
+    data_fn _on_data;
+};
+
+COID_NAMESPACE_END
+
+#endif //__COID_COMM_NETSTREAMTCP__HEADER_FILE__
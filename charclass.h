@@ -0,0 +1,120 @@
+#pragma once
+
+/* ***** BEGIN LICENSE BLOCK *****
+* Version: MPL 1.1/GPL 2.0/LGPL 2.1
+*
+* The contents of this file are subject to the Mozilla Public License Version
+* 1.1 (the "License"); you may not use this file except in compliance with
+* the License. You may obtain a copy of the License at
+* http://www.mozilla.org/MPL/
+*
+* Software distributed under the License is distributed on an "AS IS" basis,
+* WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+* for the specific language governing rights and limitations under the
+* License.
+*
+* The Original Code is COID/comm module.
+*
+* The Initial Developer of the Original Code is
+* Outerra.
+* Portions created by the Initial Developer are Copyright (C) 2026
+* the Initial Developer. All Rights Reserved.
+*
+* Contributor(s):
+* Brano Kemen
+*
+* Alternatively, the contents of this file may be used under the terms of
+* either the GNU General Public License Version 2 or later (the "GPL"), or
+* the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+* in which case the provisions of the GPL or the LGPL are applicable instead
+* of those above. If you wish to allow use of your version of this file only
+* under the terms of either the GPL or the LGPL, and not to allow others to
+* use your version of this file under the terms of the MPL, indicate your
+* decision by deleting the provisions above and replace them with the notice
+* and other provisions required by the GPL or the LGPL. If you do not delete
+* the provisions above, a recipient may use your version of this file under
+* the terms of any one of the MPL, the GPL or the LGPL.
+*
+* ***** END LICENSE BLOCK ***** */
+
+#ifndef __COID_COMM_CHARCLASS__HEADER_FILE__
+#define __COID_COMM_CHARCLASS__HEADER_FILE__
+
+#include "namespace.h"
+#include "commtypes.h"
+#include "strscan.h"
+#include <string.h>
+
+COID_NAMESPACE_BEGIN
+
+////////////////////////////////////////////////////////////////////////////////
+///Set of byte values with vectorized span scanning
+/// The set is kept in two 16 byte nibble tables: the byte at the low nibble of a character has
+/// bit (c >> 4) & 7 set if the character belongs to the set, the first table for characters
+/// 0..127 and the second for 128..255. A block of 16 (32 with AVX2) characters is then classified
+/// with a few pshufb lookups, with no restrictions on the set contents. The vectorized code is
+/// selected at runtime along with other strscan primitives.
+struct char_class
+{
+    ///Remove all characters from the set
+    void reset() {
+        ::memset(_lo, 0, sizeof(_lo));
+        ::memset(_hi, 0, sizeof(_hi));
+    }
+
+    ///Add character to the set
+    void set(uchar c) {
+        uint8* tab = c < 128 ? _lo : _hi;
+        tab[c & 15] |= uint8(1 << ((c >> 4) & 7));
+    }
+
+    /// @return true if character belongs to the set
+    bool has(uchar c) const {
+        const uint8* tab = c < 128 ? _lo : _hi;
+        return (tab[c & 15] & (1 << ((c >> 4) & 7))) != 0;
+    }
+
+    ///Vectorized part of a span scan
+    /// @param p input characters
+    /// @param off offset to start at
+    /// @param len input length
+    /// @param in true to skip characters from the set, false to skip characters not in the set
+    /// @return offset of the first character that stops the span, or the offset from which the
+    ///         remaining characters (less than a vector) have to be checked by the caller
+    uints span(const uchar* p, uints off, uints len, bool in) const
+    {
+        //implementation selected by the CPU features, see strscan
+        return off + strscan::MIN_VECTOR <= len
+            ? strscan::get().class_span(_lo, _hi, p, off, len, in)
+            : off;
+    }
+
+    ///Count characters from the set
+    /// @return offset of the first character not in the set, or len
+    uints count_in(const uchar* p, uints off, uints len) const
+    {
+        off = span(p, off, len, true);
+        while (off < len && has(p[off]))
+            ++off;
+        return off;
+    }
+
+    ///Count characters not in the set
+    /// @return offset of the first character from the set, or len
+    uints count_notin(const uchar* p, uints off, uints len) const
+    {
+        off = span(p, off, len, false);
+        while (off < len && !has(p[off]))
+            ++off;
+        return off;
+    }
+
+private:
+
+    alignas(16) uint8 _lo[16] = {0};    //< membership bits of characters 0..127
+    alignas(16) uint8 _hi[16] = {0};    //< membership bits of characters 128..255
+};
+
+COID_NAMESPACE_END
+
+#endif //__COID_COMM_CHARCLASS__HEADER_FILE__
@@ -1,4 +1,5 @@
 #include <comm/binstream/binstreambuf.h>
+#include <comm/binstream/binstreambatch.h>
 #include <comm/binstream/cachestream.h>
 #include <comm/binstream/enc_base64stream.h>
 #include <comm/binstream/enc_hexstream.h>
@@ -70,3 +71,96 @@ void test()
     xml << vec;
     xml << str;
 }
+
+void binstream_batch_test()
+{
+    const char* hdr = "head";
+    uint32 size = 11;
+    token body = "hello world";
+
+    binstream_batch batch;
+    batch.add(hdr, 4).add_pod(size).add(body);
+    RASSERT(batch.count() == 3 && batch.size() == 19);
+
+    binstreambuf buf;
+    RASSERT(batch.write_to(buf) == NOERR);
+    RASSERT(batch.count() == 0);
+
+    token out = buf;
+    RASSERT(out.len() == 19);
+    RASSERT(token(out.ptr(), 4) == "head");
+    RASSERT(*(const uint32*)(out.ptr() + 4) == 11);
+    RASSERT(token(out.ptr() + 8, 11) == body);
+
+    //through the cache into the buffer, both merged and passed through
+    binstreambuf dst;
+    cachestream cache(&dst);
+
+    batch.add(hdr, 4).add(body);
+    RASSERT(batch.write_to(cache) == NOERR);
+
+    charstr big;
+    big.appendn(2000, 'x');
+    batch.add(hdr, 4).add(big);
+    RASSERT(batch.write_to(cache) == NOERR);
+    cache.flush();
+
+    RASSERT(dst.get_buf().size() == 4 + 11 + 4 + 2000);
+}
+
+///Sink that accepts at most a given number of bytes in total, reporting the rest as unwritten
+struct short_sink : binstreambuf
+{
+    uints cap;
+
+    short_sink(uints cap) : cap(cap)
+    {}
+
+    opcd write_rawv(const binstream_iovec* iov, uints niov, uints& len) override
+    {
+        len = iovec_size(iov, niov);
+
+        for (uints i = 0; i < niov && cap > 0; ++i) {
+            uints n = iov[i].len < cap ? iov[i].len : cap;
+            uints k = n;
+            binstreambuf::write_raw(iov[i].ptr, k);
+            cap -= n;
+            len -= n;
+        }
+        return 0;
+    }
+};
+
+void binstream_batch_short_write_test()
+{
+    const char* hdr = "head";
+    charstr big;
+    big.appendn(2000, 'x');
+
+    //only a part of the cached data gets written
+    short_sink dst(10);
+    cachestream cache(&dst);
+
+    binstream_batch batch;
+    batch.add(hdr, 4).add(token("hello world"));
+    RASSERT(batch.write_to(cache) == NOERR);
+    RASSERT(cache.get_write_pos() == 15);
+
+    binstream_iovec iov[2] = { { hdr, 4 }, { big.ptr(), big.len() } };
+    uints len;
+    RASSERT(cache.write_rawv(iov, 2, len) == ersNO_MORE);
+    RASSERT(len == 2004);
+    RASSERT(dst.get_buf().size() == 10);
+    RASSERT(cache.get_write_pos() == 15);
+
+    //the rest of the cache goes out first, followed by a part of the segments
+    dst.cap = 105;
+    RASSERT(cache.write_rawv(iov, 2, len) == ersNO_MORE);
+    RASSERT(len == 2004 - 100);
+    RASSERT(cache.get_write_pos() == 15 + 100);
+
+    token out = dst;
+    RASSERT(out.len() == 115);
+    RASSERT(token(out.ptr(), 15) == "headhello world");
+    RASSERT(token(out.ptr() + 15, 4) == "head");
+}
@@ -1,6 +1,19 @@
 
 #include <comm/dynarray.h>
 #include <comm/str.h>
+#include <comm/pthreadx.h>
+#include <comm/timer.h>
+#include <comm/log/logger.h>
+#include <comm/alloc/thread_cache.h>
+#include <comm/alloc/arena.h>
+#include <comm/alloc/slotalloc.h>
+#include <comm/alloc/memtrack_profile.h>
+#include <comm/alloc/alloc2d.h>
+#include <comm/atomic/pool_base.h>
+#include <comm/atomic/stack_base.h>
+#include <comm/ref.h>
+#include <comm/binstream/binstreambuf.h>
+#include <atomic>
 
 using namespace coid;
 
@@ -70,6 +83,829 @@ dynarray<uint> test_return_stack()
     return buf;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+static void* thread_cache_free_fnc(void* arg)
+{
+    dynarray<void*>& blocks = *static_cast<dynarray<void*>*>(arg);
+    for (void* p : blocks)
+        thread_cache::free(p);
+
+    //blocks came from the main thread's heap, nothing gets cached here
+    DASSERT(thread_cache::thread_stats().foreign_frees == blocks.size());
+    DASSERT(thread_cache::thread_stats().cached_size == 0);
+    return 0;
+}
+
+static void test_thread_cache()
+{
+    void* p = thread_cache::alloc(40);
+    uints us = dlmalloc_usable_size(p);
+    DASSERT(us >= 40);
+    thread_cache::free(p);
+
+    //cached block is reused and keeps its usable size
+    void* q = thread_cache::alloc(40);
+    DASSERT(q == p);
+    DASSERT(dlmalloc_usable_size(q) == us);
+    thread_cache::free(q);
+
+    //blocks are interchangeable with plain dlmalloc ones
+    void* d = dlmalloc(50);
+    thread_cache::free(d);
+    d = thread_cache::alloc(50);
+    dlfree(d);
+
+    //cross-thread free
+    dynarray<void*> blocks;
+    for (int i = 0; i < 1000; ++i)
+        blocks.push(thread_cache::alloc(64));
+
+    coid::thread t;
+    t.create(thread_cache_free_fnc, &blocks);
+    coid::thread::join(t);
+
+    thread_cache::trim();
+    DASSERT(thread_cache::thread_stats().cached_size == 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+struct churn_arg
+{
+    int id = 0;
+    int nthreads = 0;
+    std::atomic<void*>* mailbox = 0;    //< blocks handed over between threads
+};
+
+static void* thread_cache_churn_fnc(void* arg)
+{
+    const churn_arg& a = *static_cast<churn_arg*>(arg);
+    static const int RING = 512;
+    void* ring[RING] = {};
+    uint seed = 12345 + a.id;
+
+    for (int i = 0; i < 1000000; ++i)
+    {
+        seed = seed * 1103515245 + 12345;
+        int k = (seed >> 8) % RING;
+
+        if (ring[k]) {
+            if ((seed >> 20) % 16 == 0) {
+                //pass the block to the next thread, free the one left there
+                void* o = a.mailbox[(a.id + 1) % a.nthreads].exchange(ring[k]);
+                thread_cache::free(o);
+            }
+            else
+                thread_cache::free(ring[k]);
+        }
+
+        ring[k] = thread_cache::alloc(8 + (seed >> 12) % 500);
+    }
+
+    for (void* p : ring)
+        thread_cache::free(p);
+    return 0;
+}
+
+///Multi-threaded alloc/free churn with ~6% of blocks freed by another thread,
+/// thread cache vs the global dlmalloc path
+static void benchmark_thread_cache()
+{
+    static const int MAXTHREADS = 8;
+
+    for (int nthreads = 1; nthreads <= MAXTHREADS; nthreads *= 2)
+    {
+        double t[2];
+
+        for (int cached = 0; cached < 2; ++cached)
+        {
+            thread_cache::enable(cached != 0);
+
+            std::atomic<void*> mailbox[MAXTHREADS];
+            churn_arg args[MAXTHREADS];
+            coid::thread threads[MAXTHREADS];
+
+            nsec_timer timer;
+
+            for (int i = 0; i < nthreads; ++i) {
+                mailbox[i] = 0;
+                args[i].id = i;
+                args[i].nthreads = nthreads;
+                args[i].mailbox = mailbox;
+                threads[i].create(thread_cache_churn_fnc, &args[i]);
+            }
+
+            for (int i = 0; i < nthreads; ++i)
+                coid::thread::join(threads[i]);
+
+            t[cached] = timer.time();
+
+            for (int i = 0; i < nthreads; ++i)
+                thread_cache::free(mailbox[i].exchange(0));
+        }
+
+        coidlog_info("thread_cache", nthreads << " threads: global " << uint(t[0] * 1000)
+            << "ms, thread cache " << uint(t[1] * 1000) << "ms");
+    }
+
+    thread_cache::enable(true);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void test_arena()
+{
+    arena& a = arena::local();
+    {
+        arena::scope s;
+        DASSERT(&arena::current() == &a);
+
+        dynarray<int, uints, arena_array_allocator> v;
+        for (int i = 0; i < 100000; ++i)
+            v.push(i);
+        DASSERT(v[99999] == 99999);
+
+        dynarray<charstr, uints, arena_array_allocator> sv;
+        for (int i = 0; i < 1000; ++i)
+            sv.push(charstr("item ") << i);
+        DASSERT(sv[999] == "item 999");
+
+        //arena buffer for a regular string, outgrowing it moves the string to the heap
+        charstr str(a.buffer<char>(256));
+        DASSERT(str.dynarray_ref().reserved_stack() >= 256);
+        for (int i = 0; i < 100; ++i)
+            str << "abcdefghij";
+        DASSERT(str.len() == 1000 && str.dynarray_ref().reserved_stack() == 0);
+
+        {
+            arena inner(1024);
+            arena::scope s2(inner);
+            DASSERT(&arena::current() == &inner);
+
+            dynarray<uint64, uints, arena_array_allocator> w;
+            w.alloc(10000);
+            DASSERT(inner.reserved() >= 10000 * sizeof(uint64));
+        }
+        DASSERT(&arena::current() == &a);
+    }
+
+    //everything released by the scope, chunks kept for reuse
+    DASSERT(a.used() == 0);
+    uints r = a.reserved();
+    {
+        arena::scope s;
+        dynarray<int, uints, arena_array_allocator> v;
+        for (int i = 0; i < 100000; ++i)
+            v.push(i);
+    }
+    DASSERT(a.reserved() == r);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+struct memtrack_thread_a { int x; };
+struct memtrack_thread_b { char c[100]; };
+struct memtrack_never { int x; };
+
+static const memtrack* find_memtrack(const dynarray<memtrack>& m, const coid::type_info& ti)
+{
+    for (const memtrack& t : m)
+        if (t.hash == ti.hash)
+            return &t;
+    return 0;
+}
+
+static void list_memtrack(dynarray<memtrack>& m)
+{
+    m.alloc(memtrack_count() + 64);
+    m.resize(memtrack_list(m.ptr(), uint(m.size()), false));
+}
+
+static void* memtrack_thread_fnc(void*)
+{
+    const coid::type_info* ta = &coid::type_info::get<memtrack_thread_a>();
+    const coid::type_info* tb = &coid::type_info::get<memtrack_thread_b>();
+
+    for (int i = 0; i < 10000; ++i) {
+        memtrack_alloc(ta, 16);
+        memtrack_alloc(tb, 100);
+    }
+    for (int i = 0; i < 5000; ++i)
+        memtrack_free(ta, 16);
+    return 0;
+}
+
+static void test_memtrack_threads()
+{
+    bool en = memtrack_enable(true);
+    const coid::type_info& ta = coid::type_info::get<memtrack_thread_a>();
+    const coid::type_info& tb = coid::type_info::get<memtrack_thread_b>();
+    const coid::type_info& tn = coid::type_info::get<memtrack_never>();
+
+    coid::thread threads[4];
+    for (coid::thread& t : threads)
+        t.create(memtrack_thread_fnc, 0);
+    for (coid::thread& t : threads)
+        coid::thread::join(t);
+
+    //free on another thread than allocated, merged from the tables of exited threads
+    for (int i = 0; i < 1000; ++i)
+        memtrack_free(&tb, 100);
+
+    //frees of types that were never allocated are ignored
+    memtrack_free(&tn, 100);
+
+    dynarray<memtrack> m;
+    list_memtrack(m);
+
+    const memtrack* a = find_memtrack(m, ta);
+    const memtrack* b = find_memtrack(m, tb);
+    DASSERT(a && a->nlifeallocs == 40000 && a->ncurallocs == 20000 && a->cursize == 20000 * 16);
+    DASSERT(b && b->nlifeallocs == 40000 && b->ncurallocs == 39000 && b->cursize == 39000 * 100);
+    DASSERT(!find_memtrack(m, tn));
+
+    for (int i = 0; i < 20000; ++i)
+        memtrack_free(&ta, 16);
+    for (int i = 0; i < 39000; ++i)
+        memtrack_free(&tb, 100);
+
+    list_memtrack(m);
+    a = find_memtrack(m, ta);
+    b = find_memtrack(m, tb);
+    DASSERT(a && a->ncurallocs == 0 && a->cursize == 0);
+    DASSERT(b && b->ncurallocs == 0 && b->cursize == 0);
+
+    //sampled stack traces, weights estimate the allocated bytes
+    static const int NALLOCS = 100000;
+    memtrack_reset();
+    enable_record_memtrack_stacktrace(true);
+    memtrack_stacktrace_sampling(64 << 10);
+
+    for (int i = 0; i < NALLOCS; ++i)
+        memtrack_alloc(&tb, 100);
+
+    dynarray<memtrack_stacktrace> st;
+    st.alloc(memtrack_stacktrace_count());
+    st.resize(memtrack_stacktrace_list(st.ptr(), uint(st.size())));
+
+    uint64 weight = 0;
+    uint nsamples = 0;
+    for (const memtrack_stacktrace& s : st) {
+        if (s._name == tb.name) {
+            weight += s._weight;
+            ++nsamples;
+        }
+    }
+
+    //about 150 samples, the estimate has ~8% deviation
+    DASSERT(nsamples > 50 && nsamples < uint(NALLOCS));
+    DASSERT(weight > NALLOCS * 100 * 7 / 10 && weight < NALLOCS * 100 * 13 / 10);
+
+    memtrack_stacktrace_sampling(0);
+    enable_record_memtrack_stacktrace(false);
+    memtrack_reset();
+
+    for (int i = 0; i < NALLOCS; ++i)
+        memtrack_free(&tb, 100);
+
+    memtrack_enable(en);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+struct memtrack_profile_test { int x; };
+struct memtrack_profile_sampled { int x; };
+
+///Block pointers only identify the allocations, no memory is needed
+static const void* memtrack_block(int i) {
+    return (const void*)(uints(i + 1) * 64);
+}
+
+///Sum of site growths of given type
+static memtrack_site_delta memtrack_site_growth(const memtrack_profile& prof, const memtrack_diff& diff, const token& name)
+{
+    memtrack_site_delta sum;
+    for (const memtrack_site_delta& d : diff.sites) {
+        if (prof.sites()[d.site].name != name)
+            continue;
+        sum.count += d.count;
+        sum.bytes += d.bytes;
+        sum.lifecount += d.lifecount;
+        sum.lifebytes += d.lifebytes;
+    }
+    return sum;
+}
+
+static void test_memtrack_profile()
+{
+    bool en = memtrack_enable(true);
+    const coid::type_info* ti = &coid::type_info::get<memtrack_profile_test>();
+    memtrack_reset();
+    enable_record_memtrack_stacktrace(true);
+
+    memtrack_profile prof;
+    prof.snapshot("before");
+
+    for (int i = 0; i < 100; ++i)
+        memtrack_alloc(ti, 64, memtrack_block(i));
+
+    prof.snapshot("after");
+
+    memtrack_diff diff;
+    DASSERT(prof.diff("before", "after", diff));
+    DASSERT(diff.types.size() > 0 && diff.types[0].cursize == 6400);
+
+    binstreambuf folded;
+    prof.write_folded(folded, &diff);
+    DASSERT(token(folded).contains(" 6400\n"));
+
+    binstreambuf pprof;
+    prof.write_pprof(pprof, &diff);
+    DASSERT(token(pprof).begins_with("heap profile: "));
+
+    //freed blocks are subtracted from the live bytes of their site
+    for (int i = 0; i < 50; ++i)
+        memtrack_free(ti, 64, memtrack_block(i));
+
+    prof.snapshot("half");
+
+    DASSERT(prof.diff("after", "half", diff));
+    memtrack_site_delta d = memtrack_site_growth(prof, diff, ti->name);
+    DASSERT(d.count == -50 && d.bytes == -3200 && d.lifecount == 0 && d.lifebytes == 0);
+
+    for (int i = 50; i < 100; ++i)
+        memtrack_free(ti, 64, memtrack_block(i));
+
+    DASSERT(prof.diff("before", token(), diff));
+    d = memtrack_site_growth(prof, diff, ti->name);
+    DASSERT(d.count == 0 && d.bytes == 0 && d.lifecount == 100 && d.lifebytes == 6400);
+
+    //sampled allocations, live bytes drop with the freed samples
+    static const int NALLOCS = 20000;
+    const coid::type_info* ts = &coid::type_info::get<memtrack_profile_sampled>();
+    memtrack_stacktrace_sampling(4096);
+
+    prof.snapshot("before");
+
+    for (int i = 0; i < NALLOCS; ++i)
+        memtrack_alloc(ts, 64, memtrack_block(i));
+
+    DASSERT(prof.diff("before", token(), diff));
+    d = memtrack_site_growth(prof, diff, ts->name);
+    DASSERT(d.count > 50 && d.count == d.lifecount && d.bytes == d.lifebytes);
+    DASSERT(d.lifebytes > NALLOCS * 64 * 7 / 10 && d.lifebytes < NALLOCS * 64 * 13 / 10);
+
+    for (int i = 0; i < NALLOCS; i += 2)
+        memtrack_free(ts, 64, memtrack_block(i));
+
+    DASSERT(prof.diff("before", token(), diff));
+    d = memtrack_site_growth(prof, diff, ts->name);
+    DASSERT(d.bytes > d.lifebytes * 3 / 10 && d.bytes < d.lifebytes * 7 / 10);
+
+    for (int i = 1; i < NALLOCS; i += 2)
+        memtrack_free(ts, 64, memtrack_block(i));
+
+    DASSERT(prof.diff("before", token(), diff));
+    d = memtrack_site_growth(prof, diff, ts->name);
+    DASSERT(d.count == 0 && d.bytes == 0 && d.lifecount > 50);
+
+    memtrack_stacktrace_sampling(0);
+    enable_record_memtrack_stacktrace(false);
+    memtrack_enable(en);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+struct realloc_selfref
+{
+    realloc_selfref* self;
+    int value = 0;
+
+    realloc_selfref() : self(this) {}
+    realloc_selfref(realloc_selfref&& o) : self(this), value(o.value) {}
+    ~realloc_selfref() {}
+};
+
+COID_TYPE_NONTRIVIAL_REBASE(realloc_selfref)
+
+static void test_large_realloc()
+{
+    //large blocks are mmapped and grow by remapping pages
+    dynarray<uint> a;
+    for (uint i = 0; i < (16u << 20); ++i)
+        *a.add() = i;
+    for (uint i = 0; i < (16u << 20); i += 4097)
+        DASSERT(a[i] == i);
+
+    //non-relocatable types get move-constructed on any growth path
+    dynarray<realloc_selfref> b;
+    for (int i = 0; i < 300000; ++i) {
+        realloc_selfref r;
+        r.value = i;
+        b.push(std::move(r));
+    }
+    for (int i = 0; i < 300000; ++i)
+        DASSERT(b[i].self == &b[i] && b[i].value == i);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void test_reserve_mode()
+{
+    //huge page reservation is rounded to whole 2MB pages
+    dynarray<uint64> a(1000000, reserve_mode::virtual_space | reserve_mode::huge_pages);
+    DASSERT(a.reserved_virtual() >= (2 << 20) - 64);
+    for (uint64 i = 0; i < 1000000; ++i)
+        a.push(i);
+    DASSERT(a[999999] == 999999);
+
+    dynarray<uint8> b;
+    b.reserve_virtual(64 << 20, reserve_mode::prefault | reserve_mode::numa_interleave);
+    DASSERT(b.reserved_virtual() >= (64 << 20));
+    DASSERT(comm_array_allocator::prefault_virtual(b.ptr(), 1 << 20) == 1 << 20);
+
+    slotalloc_linear<uint64> s(100000, reserve_numa_node(0) | reserve_mode::huge_pages_explicit);
+    for (int i = 0; i < 1000; ++i)
+        *s.add() = i;
+    DASSERT(s.count() == 1000);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+struct pooled_item
+{
+    static std::atomic<int> alive;
+
+    int value = 0;
+
+    pooled_item() { ++alive; }
+    ~pooled_item() { --alive; }
+
+    void reset() { value = 0; }
+};
+
+std::atomic<int> pooled_item::alive;
+
+static void* object_pool_hold_fnc(void* arg)
+{
+    object_pool<pooled_item>& pool = *static_cast<object_pool<pooled_item>*>(arg);
+    for (int i = 0; i < 100; ++i) {
+        pooled_item* p = pool.create_item();
+        pool.release_item(p);
+    }
+    //magazines of this thread return to the depot on exit
+    return 0;
+}
+
+static void test_object_pool()
+{
+    {
+        object_pool<pooled_item> pool;
+        DASSERT(pool.get_item() == 0);
+
+        pooled_item* a = pool.create_item();
+        pooled_item* b = a;
+        pool.release_item(a);
+        DASSERT(a == 0);
+        DASSERT(pool.get_item() == b);
+        pool.release_item(b);
+
+        //overflow the thread magazines into the depot
+        dynarray<pooled_item*> items;
+        for (int i = 0; i < 1000; ++i)
+            items.push(pool.create_item());
+        for (pooled_item*& p : items)
+            pool.release_item(p);
+        DASSERT(pool.depot_stats().depot_items > 0);
+
+        items.reset();
+        for (int i = 0; i < 1000; ++i)
+            items.push(pool.create_item());
+        DASSERT(pooled_item::alive == 1000);
+        for (pooled_item*& p : items)
+            pool.release_item(p);
+
+        coid::thread t;
+        t.create(object_pool_hold_fnc, &pool);
+        coid::thread::join(t);
+        DASSERT(pooled_item::alive == 1000);
+
+        pool.flush_thread();
+        pool.purge();
+        DASSERT(pooled_item::alive == 0);
+    }
+
+    //pooled refs
+    struct obj { int k = 0; void reset() { k = 0; } };
+    for (int i = 0; i < 1000; ++i) {
+        ref<obj> r;
+        r.create_pooled();
+        DASSERT(r->k == 0);
+        r->k = i;
+    }
+}
+
+static void* object_pool_churn_fnc(void* arg)
+{
+    object_pool<pooled_item>& pool = *static_cast<object_pool<pooled_item>*>(arg);
+    pooled_item* items[16];
+
+    for (int i = 0; i < 1000000; ++i) {
+        for (pooled_item*& p : items)
+            p = pool.create_item();
+        for (pooled_item*& p : items)
+            pool.release_item(p);
+    }
+    return 0;
+}
+
+static void* stack_pool_churn_fnc(void* arg)
+{
+    atomic::stack_base<pooled_item>& stack = *static_cast<atomic::stack_base<pooled_item>*>(arg);
+    pooled_item* items[16];
+
+    for (int i = 0; i < 1000000; ++i) {
+        for (pooled_item*& p : items) {
+            p = stack.pop();
+            if (!p)
+                p = new pooled_item;
+        }
+        for (pooled_item* p : items)
+            stack.push(p);
+    }
+    return 0;
+}
+
+///Multi-threaded get/release of pooled objects, magazine pool vs the lock-free stack
+static void benchmark_object_pool()
+{
+    static const int MAXTHREADS = 8;
+
+    for (int nthreads = 1; nthreads <= MAXTHREADS; nthreads *= 2)
+    {
+        object_pool<pooled_item> pool;
+        atomic::stack_base<pooled_item> stack;
+        coid::thread threads[MAXTHREADS];
+        double t[2];
+
+        for (int magazines = 0; magazines < 2; ++magazines)
+        {
+            nsec_timer timer;
+
+            for (int i = 0; i < nthreads; ++i) {
+                if (magazines)
+                    threads[i].create(object_pool_churn_fnc, &pool);
+                else
+                    threads[i].create(stack_pool_churn_fnc, &stack);
+            }
+
+            for (int i = 0; i < nthreads; ++i)
+                coid::thread::join(threads[i]);
+
+            t[magazines] = timer.time();
+        }
+
+        while (pooled_item* p = stack.pop())
+            delete p;
+
+        coidlog_info("object_pool", nthreads << " threads: stack " << uint(t[0] * 1000)
+            << "ms, magazines " << uint(t[1] * 1000) << "ms");
+    }
+}
+
+struct bench_obj { int k = 0; void reset() { k = 0; } };
+
+static void* ref_churn_fnc(void* arg)
+{
+    const bool pooled = arg != 0;
+    ref<bench_obj> refs[16];
+
+    for (int i = 0; i < 200000; ++i) {
+        for (ref<bench_obj>& r : refs) {
+            if (pooled)
+                r.create_pooled();
+            else
+                r.create(new bench_obj);
+        }
+        for (ref<bench_obj>& r : refs)
+            r.release();
+    }
+    return 0;
+}
+
+///Logger that drops the messages, leaving only message creation and pooling
+class bench_logger : public logger
+{
+public:
+    bench_logger() : logger(false, false)
+    {}
+
+    void enqueue(ref<logmsg>&& msg) override {
+        msg->set_logger(nullptr);
+        msg.release();
+    }
+};
+
+static void* logmsg_churn_fnc(void* arg)
+{
+    bench_logger& lg = *static_cast<bench_logger*>(arg);
+    ref<logmsg> msgs[16];
+
+    for (int i = 0; i < 20000; ++i) {
+        for (ref<logmsg>& m : msgs) {
+            m = lg.create_msg(log::level::info, log::target::primary_log, tokenhash(), nullptr);
+            m->str() << "message " << i;
+        }
+        for (ref<logmsg>& m : msgs)
+            m.release();
+    }
+    return 0;
+}
+
+///Multi-threaded pooled ref and log message creation, the hot paths using the object pool
+static void benchmark_pooled_refs()
+{
+    static const int MAXTHREADS = 8;
+    bench_logger lg;
+
+    for (int nthreads = 1; nthreads <= MAXTHREADS; nthreads *= 2)
+    {
+        coid::thread threads[MAXTHREADS];
+        double t[3];
+
+        for (int k = 0; k < 3; ++k)
+        {
+            nsec_timer timer;
+
+            for (int i = 0; i < nthreads; ++i) {
+                if (k < 2)
+                    threads[i].create(ref_churn_fnc, k ? &lg : nullptr);
+                else
+                    threads[i].create(logmsg_churn_fnc, &lg);
+            }
+
+            for (int i = 0; i < nthreads; ++i)
+                coid::thread::join(threads[i]);
+
+            t[k] = timer.time();
+        }
+
+        coidlog_info("object_pool", nthreads << " threads: ref new " << uint(t[0] * 1000)
+            << "ms, ref pooled " << uint(t[1] * 1000) << "ms, log messages " << uint(t[2] * 1000) << "ms");
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+struct alloc2d_vec
+{
+    typedef int value_type;
+
+    int x = 0, y = 0;
+
+    alloc2d_vec() {}
+    explicit alloc2d_vec(int v) : x(v), y(v) {}
+    alloc2d_vec(int x, int y) : x(x), y(y) {}
+
+    alloc2d_vec operator - (const alloc2d_vec& v) const { return alloc2d_vec(x - v.x, y - v.y); }
+};
+
+///Checks that allocated regions stay inside the area and don't overlap
+template <class A, class V>
+static bool alloc_2d_disjoint(const A& a, const dynarray<typename A::handle>& ids, int size)
+{
+    dynarray<uint8> cover;
+    cover.calloc(uints(size) * size);
+
+    for (uints i = 0; i < ids.size(); ++i) {
+        if (!ids[i].is_valid())
+            continue;
+
+        const V& pos = a.get_position(ids[i]);
+        const V& sz = a.get_size(ids[i]);
+        if (pos.x < 0 || pos.y < 0 || pos.x + sz.x > size || pos.y + sz.y > size)
+            return false;
+
+        for (int y = pos.y; y < pos.y + sz.y; ++y) {
+            uint8* row = cover.ptr() + uints(y) * size;
+            for (int x = pos.x; x < pos.x + sz.x; ++x) {
+                if (row[x])
+                    return false;
+                row[x] = 1;
+            }
+        }
+    }
+
+    return true;
+}
+
+static void test_alloc_2d()
+{
+    typedef alloc_2d<alloc2d_vec, int> alloc_type;
+    static const int SIZE = 1024;
+
+    dynarray<alloc2d_vec> sizes;
+    uint seed = 1;
+    for (int i = 0; i < 2000; ++i) {
+        seed = seed * 1103515245 + 12345;
+        *sizes.add() = alloc2d_vec(4 + (seed >> 8) % 40, 4 + (seed >> 16) % 40);
+    }
+
+    dynarray<alloc_type::handle> ids;
+    ids.alloc(sizes.size());
+
+    //guillotine: merging of adjacent free regions while others stay allocated
+    {
+        alloc_type g(64, 0, alloc_2d_mode::guillotine);
+        alloc_type::handle col[4];
+        for (int i = 0; i < 4; ++i) {
+            col[i] = g.alloc(alloc2d_vec(16, 64));
+            DASSERT(col[i].is_valid() && g.get_position(col[i]).x == 16 * i);
+        }
+
+        alloc_type::stats st = g.get_stats();
+        DASSERT(st.allocated == 4 && st.free_rects == 0);
+
+        g.free(col[1]);
+        g.free(col[2]);
+        st = g.get_stats();
+        DASSERT(st.allocated == 2 && st.free_rects == 1 && st.largest_free_area == 32 * 64);
+
+        g.free(col[3]);
+        st = g.get_stats();
+        DASSERT(st.allocated == 1 && st.free_rects == 1 && st.largest_free_area == 48 * 64);
+
+        const alloc_type::handle h = g.alloc(alloc2d_vec(48, 64));
+        DASSERT(h.is_valid() && g.get_position(h).x == 16);
+    }
+
+    //guillotine: batch packing
+    {
+        alloc_type a(SIZE, 0, alloc_2d_mode::guillotine);
+        uints n = a.alloc_many(sizes.ptr(), sizes.size(), ids.ptr());
+
+        alloc_type::stats st = a.get_stats();
+        DASSERT(st.allocated == n);
+        DASSERT(st.used_area + st.free_area == uint64(SIZE) * SIZE);
+
+        for (uints i = 0; i < ids.size(); ++i) {
+            if (ids[i].is_valid()) {
+                const alloc2d_vec& size = a.get_size(ids[i]);
+                DASSERT(size.x == sizes[i].x && size.y == sizes[i].y);
+            }
+        }
+        DASSERT((alloc_2d_disjoint<alloc_type, alloc2d_vec>(a, ids, SIZE)));
+
+        //free every other region, the rest must stay intact
+        for (uints i = 0; i < ids.size(); i += 2) {
+            if (ids[i].is_valid()) {
+                a.free(ids[i]);
+                ids[i] = alloc_type::handle();
+                --n;
+            }
+        }
+
+        st = a.get_stats();
+        DASSERT(st.allocated == n);
+        DASSERT(st.used_area + st.free_area == uint64(SIZE) * SIZE);
+        DASSERT((alloc_2d_disjoint<alloc_type, alloc2d_vec>(a, ids, SIZE)));
+
+        for (uints i = 1; i < ids.size(); i += 2)
+            if (ids[i].is_valid())
+                a.free(ids[i]);
+
+        st = a.get_stats();
+        DASSERT(st.allocated == 0 && st.free_rects == 1 && st.fragmentation() == 0);
+        DASSERT(a.alloc(alloc2d_vec(SIZE, SIZE)).is_valid());
+
+        coidlog_info("alloc_2d", "guillotine packed " << n << " of " << sizes.size() << " regions");
+    }
+
+    //tree: batch packing and merging of freed siblings back up to the root
+    {
+        alloc_type t(SIZE, 0);
+        DASSERT(t.mode() == alloc_2d_mode::tree);
+
+        //root-sized region must be released again
+        alloc_type::handle h = t.alloc(alloc2d_vec(SIZE, SIZE));
+        DASSERT(h.is_valid());
+        t.free(h);
+        DASSERT(t.get_stats().allocated == 0);
+        h = t.alloc(alloc2d_vec(SIZE, SIZE));
+        DASSERT(h.is_valid());
+        t.free(h);
+
+        const uints n = t.alloc_many(sizes.ptr(), sizes.size(), ids.ptr());
+
+        alloc_type::stats st = t.get_stats();
+        DASSERT(st.allocated == n);
+        DASSERT(st.used_area + st.free_area == uint64(SIZE) * SIZE);
+        DASSERT((alloc_2d_disjoint<alloc_type, alloc2d_vec>(t, ids, SIZE)));
+
+        for (uints i = 0; i < ids.size(); ++i)
+            if (ids[i].is_valid())
+                t.free(ids[i]);
+
+        st = t.get_stats();
+        DASSERT(st.allocated == 0 && st.free_rects == 1 && st.largest_free_area == uint64(SIZE) * SIZE);
+        DASSERT(t.alloc(alloc2d_vec(SIZE, SIZE)).is_valid());
+
+        coidlog_info("alloc_2d", "tree packed " << n << " of " << sizes.size() << " regions");
+    }
+}
+
 void test_malloc()
 {
     //test_miki();
@@ -129,4 +965,19 @@ void test_malloc()
 
     dlfree(r);
     dlfree(r0);
+
+    test_reserve_mode();
+    test_large_realloc();
+    test_thread_cache();
+    benchmark_thread_cache();
+
+    test_arena();
+    test_memtrack_profile();
+    test_memtrack_threads();
+
+    test_object_pool();
+    benchmark_object_pool();
+    benchmark_pooled_refs();
+
+    test_alloc_2d();
 }
@@ -3,8 +3,12 @@
 #include <comm/binstream/binstreambuf.h>
 #include <comm/metastream/metastream.h>
 #include <comm/metastream/fmtstreamjson.h>
+#include <comm/metastream/fmtstreamcxx.h>
+#include <comm/metastream/fmtstreambin.h>
 #include <comm/ref.h>
 #include <comm/metastream/metagen.h>
+#include <comm/log/logger.h>
+#include <comm/timer.h>
 
 using namespace coid;
 
@@ -629,6 +633,631 @@ void test_enum_class()
     }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+///Waypoint record without the obsolete member of rec
+struct waypoint
+{
+    double3 pos;
+    float4 rot;
+    float3 dir;
+    float weight;
+    float speed;
+
+    friend metastream& operator || (metastream& m, waypoint& w)
+    {
+        return m.compound("waypoint", [&]()
+        {
+            m.member("pos", w.pos);
+            m.member("rot", w.rot);
+            m.member("dir", w.dir);
+            m.member("weight", w.weight, 1);
+            m.member("speed", w.speed, 10.0f);
+        });
+    }
+};
+
+template <class T>
+static charstr compiled_write_rec(const T& r, bool compiled)
+{
+    binstreambuf buf;
+    fmtstreamjson fmt(buf, false);
+    metastream meta(fmt);
+
+    if (compiled)
+        meta.xstream_out_compiled(r);
+    else
+        meta.xstream_out(r);
+    meta.stream_flush();
+
+    charstr res;
+    buf.swap(res);
+    return res;
+}
+
+template <class T>
+static T compiled_read_rec(const token& text, bool compiled)
+{
+    binstreamconstbuf buf(text);
+    fmtstreamjson fmt(buf, false);
+    metastream meta(fmt);
+
+    T r;
+    if (compiled)
+        meta.xstream_in_compiled(r);
+    else
+        meta.xstream_in(r);
+    meta.stream_acknowledge();
+
+    return r;
+}
+
+template <class T>
+static bool same_rec(const T& a, const T& b)
+{
+    return ::memcmp(&a.pos, &b.pos, sizeof(a.pos)) == 0
+        && ::memcmp(&a.rot, &b.rot, sizeof(a.rot)) == 0
+        && ::memcmp(&a.dir, &b.dir, sizeof(a.dir)) == 0
+        && a.weight == b.weight
+        && a.speed == b.speed;
+}
+
+static bool operator == (const rec& a, const rec& b) { return same_rec(a, b); }
+static bool operator == (const waypoint& a, const waypoint& b) { return same_rec(a, b); }
+
+template <class T>
+static void set_rec(T& r)
+{
+    r.pos = {-1359985.5, -7982546.2, 1210054.45};
+    r.rot = {.973808f, -.082526f, -.015322f, .211312f};
+    r.dir = {898.872803f, 5680.9126f, 12642.0156f};
+    r.weight = 1.0f;
+    r.speed = 13888.8906f;
+}
+
+///Compiled streaming must produce the same results as the regular one
+static void test_compiled_stream()
+{
+    waypoint w;
+    set_rec(w);
+
+    charstr out = compiled_write_rec(w, false);
+    DASSERT(out == compiled_write_rec(w, true));
+
+    DASSERT(compiled_read_rec<waypoint>(out, true) == compiled_read_rec<waypoint>(out, false));
+    DASSERT(compiled_read_rec<waypoint>(out, true) == w);
+
+    //out of order and missing members with defaults
+    const token text = "{ \"dir\" : {\"z\" : 7, \"x\" : 5}, \"pos\" : {\"y\" : 2}, \"rot\" : {\"w\" : 1} }";
+    waypoint wc = compiled_read_rec<waypoint>(text, true);
+    DASSERT(wc == compiled_read_rec<waypoint>(text, false));
+    DASSERT(wc.pos.y == 2 && wc.rot.w == 1 && wc.dir.x == 5 && wc.dir.y == 0);
+    DASSERT(wc.weight == 1 && wc.speed == 10.0f);
+
+    //types with containers stream through the regular path
+    root rt;
+    rt.records.alloc(16);
+    for (rec& r : rt.records)
+        set_rec(r);
+
+    binstreambuf buf;
+    fmtstreamjson fmt(buf, false);
+    metastream meta(fmt);
+    DASSERT(meta.is_compiled<waypoint>() && !meta.is_compiled<root>());
+
+    meta.xstream_out_compiled(rt);
+    meta.stream_flush();
+    DASSERT(token(buf) == compiled_write_rec(rt, false));
+}
+
+///Obsolete member of rec consumes the "speed" value preceding the regular member of the same name
+static void test_compiled_stream_obsolete()
+{
+    rec r;
+    set_rec(r);
+
+    charstr out = compiled_write_rec(r, false);
+    DASSERT(out == compiled_write_rec(r, true));
+
+    //the written value is read by the obsolete member, the regular one gets its default
+    rec rc = compiled_read_rec<rec>(out, true);
+    DASSERT(rc == compiled_read_rec<rec>(out, false));
+    DASSERT(rc.speed == 10.0f && rc.weight == r.weight);
+    DASSERT(::memcmp(&rc.pos, &r.pos, sizeof(r.pos)) == 0);
+
+    //out of order members, obsolete member, and missing members with defaults
+    const token text = "{ \"dir\" : {\"z\" : 7, \"x\" : 5}, \"speed\" : 5.0, \"pos\" : {\"y\" : 2}, \"rot\" : {\"w\" : 1} }";
+    rc = compiled_read_rec<rec>(text, true);
+    DASSERT(rc == compiled_read_rec<rec>(text, false));
+    DASSERT(rc.pos.y == 2 && rc.rot.w == 1 && rc.dir.x == 5 && rc.dir.y == 0);
+    DASSERT(rc.weight == 1 && rc.speed == 10.0f);
+}
+
+///Compare regular and compiled streaming of given object to json
+template <class T>
+static void benchmark_compiled_stream(const char* name, const T& v, int n)
+{
+    charstr out[2];
+
+    for (int compiled = 0; compiled < 2; ++compiled)
+    {
+        binstreambuf wbuf;
+        fmtstreamjson wfmt(wbuf, false);
+        metastream wmeta(wfmt);
+
+        //a fallback to the regular path would make both timings the same
+        DASSERT(wmeta.is_compiled<T>());
+
+        nsec_timer timer;
+        for (int i = 0; i < n; ++i) {
+            wbuf.reset_write();
+            compiled ? wmeta.xstream_out_compiled(v) : wmeta.xstream_out(v);
+            wmeta.stream_flush();
+        }
+        uint64 wns = timer.time_ns();
+
+        wbuf.swap(out[compiled]);
+
+        binstreamconstbuf rbuf(out[compiled]);
+        fmtstreamjson rfmt(rbuf, false);
+        metastream rmeta(rfmt);
+
+        timer.reset();
+        for (int i = 0; i < n; ++i) {
+            T x;
+            rbuf.set(out[compiled]);
+            compiled ? rmeta.xstream_in_compiled(x) : rmeta.xstream_in(x);
+            rmeta.stream_acknowledge();
+        }
+        uint64 rns = timer.time_ns();
+
+        coidlog_info("metastream", name << ' ' << (compiled ? "compiled" : "regular") << " streaming: write "
+            << (wns / n) << "ns, read " << (rns / n) << "ns per object");
+    }
+
+    DASSERT(out[0] == out[1]);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+template <class T>
+static void index_read(const token& text, T& v, bool index)
+{
+    binstreamconstbuf buf(text);
+    fmtstreamjson fmt(buf, false);
+    fmt.set_structural_index(index);
+    metastream meta(fmt);
+
+    meta.xstream_in(v);
+    meta.stream_acknowledge();
+}
+
+///Reading through the structural index must give the same results as the lexer
+static void test_json_index()
+{
+    upper u, ui;
+    const token str = "{ \"norm\" : \"tab\\t quote\\\" back\\\\\", \"spec\" : \"\" }";
+    index_read(str, u, false);
+    index_read(str, ui, true);
+    DASSERT(u.norm == ui.norm && u.spec == ui.spec);
+    DASSERT(ui.norm == "tab\t quote\" back\\");
+
+    //documents with comments fall back to the lexer
+    const token cmt = "{ \"norm\" : \"a\", /* comment */ \"spec\" : \"b\" }";
+    index_read(cmt, ui, true);
+    DASSERT(ui.norm == "a" && ui.spec == "b");
+
+    root rt;
+    for (int i = 0; i < 5000; ++i) {
+        rec* r = rt.records.add();
+        r->pos = {i * 1.5, -i * 2.25, 1e6 + i};
+        r->rot = {0.5f, -0.25f, float(i), 1.0f};
+        r->dir = {float(i), 2.0f, 3.0f};
+        r->weight = float(i & 7);
+        r->speed = 10.0f;
+    }
+
+    binstreambuf buf;
+    fmtstreamjson fmt(buf, false);
+    metastream meta(fmt);
+    meta.xstream_out(rt);
+    meta.stream_flush();
+
+    const token doc = buf;
+
+    uint64 ns[2];
+    for (int index = 0; index < 2; ++index)
+    {
+        root rd;
+        nsec_timer timer;
+        index_read(doc, rd, index != 0);
+        ns[index] = timer.time_ns();
+
+        DASSERT(rd.records.size() == rt.records.size());
+        for (uints i = 0; i < rd.records.size(); ++i)
+            DASSERT(rd.records[i] == rt.records[i]);
+    }
+
+    coidlog_info("metastream", "json read " << (doc.len() / 1024) << "kB: lexer " << (ns[0] / 1000)
+        << "us, structural index " << (ns[1] / 1000) << "us");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+struct binrec_v1
+{
+    int id;
+    float mass;
+    int old;
+    charstr name;
+    dynarray<int> samples;
+
+    friend metastream& operator || (metastream& m, binrec_v1& w)
+    {
+        return m.compound("binrec_v1", [&]()
+        {
+            m.member("id", w.id);
+            m.member("mass", w.mass);
+            m.member("old", w.old);
+            m.member("name", w.name);
+            m.member("samples", w.samples);
+        });
+    }
+};
+
+///Newer version of binrec_v1: reordered and retyped members, obsolete and new ones
+struct binrec_v2
+{
+    charstr name;
+    int64 id;
+    double mass;
+    dynarray<int64> samples;
+    int added;
+
+    friend metastream& operator || (metastream& m, binrec_v2& w)
+    {
+        return m.compound("binrec_v2", [&]()
+        {
+            m.member("name", w.name);
+            m.member("id", w.id);
+            m.member("mass", w.mass);
+            m.member_obsolete<int>("old");
+            m.member("samples", w.samples);
+            m.member("added", w.added, 7);
+        });
+    }
+};
+
+///Compact binary format: round trip, schema evolution and in place access
+static void test_fmtstreambin()
+{
+    root rt;
+    for (int i = 0; i < 100; ++i) {
+        rec* r = rt.records.add();
+        r->pos = {i * 1.5, -i * 2.25, 1e6 + i};
+        r->rot = {0.5f, -0.25f, float(i), 1.0f};
+        r->dir = {float(i), 2.0f, 3.0f};
+        r->weight = float(i & 7);
+        r->speed = 10.0f;
+    }
+
+    binstreambuf buf;
+    fmtstreambin fmt(buf);
+    metastream meta(fmt);
+    meta.xstream_out(rt);
+    meta.stream_flush();
+
+    root rd;
+    binstreamconstbuf rbuf(buf);
+    fmtstreambin rfmt(rbuf);
+    metastream rmeta(rfmt);
+    rmeta.xstream_in(rd);
+    rmeta.stream_acknowledge();
+
+    DASSERT(rd.records.size() == rt.records.size());
+    for (uints i = 0; i < rd.records.size(); ++i)
+        DASSERT(rd.records[i] == rt.records[i]);
+
+    //access in place
+    fmtstreambin::node doc = fmtstreambin::document_root(buf);
+    fmtstreambin::node recs = doc["records"];
+    DASSERT(recs.count() == 100);
+    DASSERT(recs.element(42)["pos"]["z"].get<double>() == 1e6 + 42);
+    DASSERT(*recs.element(3)["dir"]["x"].ptr<float>() == 3.0f);
+    DASSERT(recs.element(3)["missing"].get<int>(5) == 5);
+
+    //read data written by an older version of the type
+    binrec_v1 v1;
+    v1.id = 12;
+    v1.mass = 2.5f;
+    v1.old = 99;
+    v1.name = "old";
+    for (int i = 0; i < 10; ++i)
+        *v1.samples.add() = i * i;
+
+    buf.reset_write();
+    meta.xstream_out(v1);
+    meta.stream_flush();
+
+    binrec_v2 v2;
+    rfmt.set_input(buf);
+    rmeta.xstream_in(v2);
+    rmeta.stream_acknowledge();
+
+    DASSERT(v2.id == 12 && v2.mass == 2.5 && v2.name == "old" && v2.added == 7);
+    DASSERT(v2.samples.size() == 10 && v2.samples[9] == 81);
+
+    fmtstreambin::node d1 = fmtstreambin::document_root(buf);
+    DASSERT(d1["name"].str() == "old");
+    DASSERT(d1["samples"].data<int>().size() == 10);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+///Record set with records generated on write and verified on read, never held in memory
+struct recset
+{
+    int version = 1;
+    uint count = 0;                     //< number of records to generate
+    uint ngen = 0;
+    uint nread = 0;
+    uint nbad = 0;
+    rec tmp;
+
+    static void make(rec& r, uint i)
+    {
+        r.pos = {i * 1.5, -i * 2.25, 1e6 + i};
+        r.rot = {0.5f, -0.25f, float(i), 1.0f};
+        r.dir = {float(i), 2.0f, 3.0f};
+        r.weight = float(i & 7);
+        r.speed = 10.0f;
+    }
+
+    friend metastream& operator || (metastream& m, recset& w)
+    {
+        return m.compound("recset", [&]()
+        {
+            m.member("version", w.version);
+            m.member_stream_array<rec>("records",
+                [&](rec&& r) {
+                    rec x;
+                    make(x, w.nread++);
+                    if (!(r == x))
+                        ++w.nbad;
+                },
+                [&]() -> const rec* {
+                    if (w.ngen == w.count)
+                        return nullptr;
+                    make(w.tmp, w.ngen++);
+                    return &w.tmp;
+                });
+        });
+    }
+};
+
+struct recarray
+{
+    int version;
+    dynarray<rec> records;
+};
+
+COID_METABIN_OP2(recarray, version, records)
+
+template <class FMT>
+static void stream_array_test(FMT& wfmt, FMT& rfmt)
+{
+    binstreambuf buf;
+    wfmt.bind(buf);
+    metastream wmeta(wfmt);
+    metastream rmeta(rfmt);
+
+    recset out;
+    out.count = 1000;
+    wmeta.xstream_out(out);
+    wmeta.stream_flush();
+
+    rec tmp;
+    recset::make(tmp, out.count - 1);
+
+    recset in;
+    in.version = 0;
+    binstreamconstbuf rbuf(buf);
+    rfmt.bind(rbuf);
+    rmeta.xstream_in(in);
+    rmeta.stream_acknowledge();
+
+    DASSERT(in.version == 1 && in.nread == out.count && in.nbad == 0);
+
+    //compatible with regular containers
+    recarray ra;
+    rbuf.set(buf);
+    rfmt.bind(rbuf);
+    rmeta.xstream_in(ra);
+    rmeta.stream_acknowledge();
+
+    DASSERT(ra.records.size() == out.count && ra.records[999] == tmp);
+
+    //top level array
+    buf.reset_write();
+    uint ngen = 0;
+    DASSERT(wmeta.stream_array_out_each<rec>([&]() -> const rec* {
+        if (ngen == 100)
+            return nullptr;
+        recset::make(tmp, ngen++);
+        return &tmp;
+    }) == NOERR);
+    wmeta.stream_flush();
+
+    uints count = 0;
+    double zsum = 0;
+    rbuf.set(buf);
+    rfmt.bind(rbuf);
+    DASSERT(rmeta.stream_array_in_each<rec>([&](rec&& r) { zsum += r.pos.z - 1e6; }, token(), &count) == NOERR);
+    rmeta.stream_acknowledge();
+
+    DASSERT(count == 100 && zsum == 99 * 100 / 2);
+}
+
+///Arrays streamed element by element through the text and binary formats
+static void test_stream_array()
+{
+    {
+        fmtstreamjson wfmt(false), rfmt(false);
+        stream_array_test(wfmt, rfmt);
+    }
+    {
+        fmtstreamcxx wfmt, rfmt;
+        stream_array_test(wfmt, rfmt);
+    }
+    {
+        fmtstreambin wfmt, rfmt;
+        stream_array_test(wfmt, rfmt);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+template <class FMT>
+static void stream_window_test(FMT& wfmt, FMT& rfmt)
+{
+    root rt;
+    for (uint i = 0; i < 300; ++i)
+        recset::make(*rt.records.add(), i);
+
+    binstreambuf buf;
+    wfmt.bind(buf);
+    metastream wmeta(wfmt);
+    wmeta.xstream_out(rt);
+    wmeta.stream_flush();
+
+    for (uints window : {0, 1, 61, 4096})
+    {
+        root rd;
+        binstreamconstbuf rbuf(buf);
+        rfmt.set_stream_window(window);
+        rfmt.bind(rbuf);
+        metastream rmeta(rfmt);
+        rmeta.xstream_in(rd);
+        rmeta.stream_acknowledge();
+
+        DASSERT(rd.records.size() == rt.records.size());
+        for (uints i = 0; i < rd.records.size(); ++i)
+            DASSERT(rd.records[i] == rt.records[i]);
+    }
+}
+
+///Input streamed through a small lexer window must give the same results as the whole input
+static void test_stream_window()
+{
+    {
+        fmtstreamjson wfmt(false), rfmt(false);
+        stream_window_test(wfmt, rfmt);
+    }
+    {
+        fmtstreamcxx wfmt, rfmt;
+        stream_window_test(wfmt, rfmt);
+    }
+
+    //tokens, strings and blocks straddling the window boundary
+    lexer lex;
+    lex.def_group("", " \t\r\n");
+    int lid = lex.def_group("id", "0..9a..zA..Z_");
+    int esc = lex.def_escape("esc", '\\');
+    lex.def_escape_pair(esc, "n", "\n");
+    lex.def_escape_pair(esc, "\"", "\"");
+    lex.def_string("str", "\"", "\"", "esc");
+    lex.def_block("blk", "{", "}", "");
+    lex.def_block(".comment", "/*", "*/", "");
+    lex.def_group_single("ctrl", ",");
+
+    charstr text;
+    for (int i = 0; i < 200; ++i) {
+        text << "identifier_" << i << " \"string\\n " << i << " with \\\"escapes\\\"\", ";
+        text << "/* a longer comment that has to be skipped " << i << " */ { nested_" << i << " }\n";
+    }
+
+    dynarray<charstr> ref;
+    lex.bind(text);
+    for (;;) {
+        const lexer::lextoken& tok = lex.next();
+        if (tok.end())
+            break;
+        charstr& r = *ref.add();
+        r << tok.id << ':' << tok.val;
+    }
+    DASSERT(ref.size() > 1000);
+
+    for (uints window : {1, 40, 97, 1000})
+    {
+        binstreamconstbuf bin(text);
+        lex.bind(bin, window);
+
+        uints n = 0;
+        for (;; ++n) {
+            const lexer::lextoken& tok = lex.next();
+            if (tok.end())
+                break;
+            charstr r;
+            r << tok.id << ':' << tok.val;
+            DASSERT(n < ref.size() && r == ref[n]);
+
+            if (tok.id == lid && tok.val.begins_with("identifier"))
+                DASSERT(lex.follows("\""));
+        }
+        DASSERT(n == ref.size());
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+///Vectorized character class spans must agree with the scalar lookups
+static void test_char_class()
+{
+    uchar data[1000];
+    uint seed = 1;
+    for (uchar& c : data) {
+        seed = seed * 1103515245 + 12345;
+        c = uchar(seed >> 16);
+    }
+
+    for (uint k = 0; k < 8; ++k)
+    {
+        char_class cc;
+        for (uint c = 0; c < 256; ++c)
+            if (((c * 7 + k) % 8) < k || c == k * 31)
+                cc.set(uchar(c));
+
+        for (uints off = 0; off < sizeof(data); ++off)
+        {
+            uints in = off, out = off;
+            while (in < sizeof(data) && cc.has(data[in]))  ++in;
+            while (out < sizeof(data) && !cc.has(data[out]))  ++out;
+
+            DASSERT(cc.count_in(data, off, sizeof(data)) == in);
+            DASSERT(cc.count_notin(data, off, sizeof(data)) == out);
+        }
+    }
+
+    //lexer groups: long runs of whitespace and identifiers
+    charstr text;
+    for (int i = 0; i < 20000; ++i)
+        text << "                        long_identifier_name_" << i << "\t\t= \"a string value with some length " << i << "\";\n";
+
+    lexer lex;
+    lex.def_group("", " \t\r\n");
+    int lid = lex.def_group("id", "0..9a..zA..Z_");
+    int lstr = lex.def_string("str", "\"", "\"", "");
+    lex.def_group_single("ctrl", "=;");
+
+    nsec_timer timer;
+    lex.bind(text);
+    uints nid = 0, nstr = 0;
+    for (;;) {
+        const lexer::lextoken& tok = lex.next();
+        if (tok.end())
+            break;
+        nid += tok == lid;
+        nstr += tok == lstr;
+    }
+    DASSERT(nid == 20000 && nstr == 20000);
+
+    coidlog_info("lexer", "scanned " << (text.len() / 1024) << "kB in " << (timer.time_ns() / 1000) << "us");
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 void metastream_test3()
 {
@@ -646,6 +1275,20 @@ void metastream_test3()
 
     test_nested_compound();
 
+    test_compiled_stream();
+
+    test_compiled_stream_obsolete();
+
+    test_json_index();
+
+    test_fmtstreambin();
+
+    test_stream_array();
+
+    test_stream_window();
+
+    test_char_class();
+
 /*
     dynarray<ref<FooA>> ar;
     ar.add()->create(new FooA(1, 2));
@@ -661,3 +1304,16 @@ void metastream_test3()
     meta.stream_flush();
     //txt.swap(json);*/
 };
+
+////////////////////////////////////////////////////////////////////////////////
+///Throughput of the regular and compiled streaming, not part of the default test run
+void metastream_benchmark3()
+{
+    waypoint w;
+    set_rec(w);
+    benchmark_compiled_stream("waypoint", w, 20000);
+
+    rec r;
+    set_rec(r);
+    benchmark_compiled_stream("rec", r, 20000);
+}
@@ -0,0 +1,501 @@
+
+#include <comm/net_reactor.h>
+#include <comm/net_resolver.h>
+#include <comm/binstream/netstreamtcp.h>
+#include <comm/binstream/binstreambuf.h>
+#include <comm/metastream/metastream.h>
+#include <comm/metastream/fmtstreambin.h>
+#include <comm/timer.h>
+#include <comm/log/logger.h>
+
+using namespace coid;
+
+namespace {
+
+///Connection served by a reactor: echoes back everything it receives
+struct echo_conn
+{
+    netSocket sock;
+    uint64 id = 0;
+
+    echo_conn(uints h) : sock(h) {}
+
+    void on_event(netReactor& r, uint events)
+    {
+        char buf[4096];
+        for (;;) {
+            int n = sock.recv(buf, sizeof(buf));
+            if (n > 0) {
+                sock.send(buf, n);
+                continue;
+            }
+            if (n < 0 && netSocket::isNonBlockingError() && !(events & netReactor::EV_HANGUP))
+                return;
+
+            //closed by peer
+            r.remove(id);
+            delete this;
+            return;
+        }
+    }
+};
+
+///Client side of the ping-pong benchmark
+struct ping_conn
+{
+    netSocket sock;
+    uint64 id = 0;
+    uint got = 0;
+};
+
+///Server side of the stream test: echoes metastream packets in reactor mode
+struct packet_echo
+{
+    netstreamtcp net;
+    fmtstreambin fmt;
+    metastream meta;
+
+    packet_echo(uints h) : net(h), fmt(net), meta(fmt) {}
+
+    void on_data()
+    {
+        while (net.packet_ready()) {
+            dynarray<uint> v;
+            meta.xstream_in(v);
+            meta.stream_acknowledge();
+
+            meta.xstream_out(v);
+            meta.stream_flush();
+        }
+
+        if (net.eof())
+            delete this;
+    }
+};
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+///Loopback benchmark of the reactor: connections/s and ping-pong messages/s
+void test_net_reactor()
+{
+    netSubsystem::instance();
+
+    netReactorGroup server;
+    DASSERT(server.start(2));
+
+    std::atomic<uint> naccepted{0};
+
+    uint16 port = server.listen("127.0.0.1", 0, [&](netReactor& r, uints handle, const netAddress&) {
+        ++naccepted;
+        echo_conn* c = new echo_conn(handle);
+        c->id = r.add(handle, netReactor::EV_READ, [c, &r](uint events) { c->on_event(r, events); });
+    });
+    DASSERT(port != 0);
+
+    //connection rate
+    const uint nconn = 2000;
+    nsec_timer timer;
+
+    for (uint i = 0; i < nconn; ++i) {
+        netSocket s;
+        s.open(true);
+        s.connect("127.0.0.1", port, true);
+        s.setLinger(true, 0);
+    }
+    while (naccepted.load() < nconn && timer.time_ns() < 10000000000ULL)
+        thread::wait(1);
+
+    uint64 cns = timer.time_ns();
+    DASSERT(naccepted.load() == nconn);
+
+    //message rate, with the client connections served by a reactor on this thread
+    const uint nclients = 64;
+    const uint msgsize = 64;
+    const uint nmsg = 200000;
+
+    netReactor client;
+    ping_conn clients[nclients];
+    char msg[msgsize] = {};
+    uint nsent = 0, nrecv = 0;
+
+    for (ping_conn& pc : clients) {
+        pc.sock.open(true);
+        pc.sock.connect("127.0.0.1", port, true);
+        pc.sock.setNoDelay(true);
+        pc.sock.setBlocking(false);
+
+        ping_conn* p = &pc;
+        pc.id = client.add(pc.sock.getHandle(), netReactor::EV_READ, [&, p](uint events) {
+            char buf[4096];
+            int n;
+            while ((n = p->sock.recv(buf, sizeof(buf))) > 0) {
+                p->got += n;
+                for (; p->got >= msgsize; p->got -= msgsize) {
+                    ++nrecv;
+                    if (nsent < nmsg) {
+                        p->sock.send(msg, msgsize);
+                        ++nsent;
+                    }
+                }
+            }
+            if (nrecv == nmsg)
+                client.stop();
+        });
+    }
+
+    timer.reset();
+    for (ping_conn& pc : clients) {
+        pc.sock.send(msg, msgsize);
+        ++nsent;
+    }
+
+    //guard against a stalled run
+    client.add_timer(30000, 0, [&]() { client.stop(); });
+    client.run();
+
+    uint64 mns = timer.time_ns();
+    DASSERT(nrecv == nmsg);
+
+    for (ping_conn& pc : clients)
+        client.remove(pc.id);
+
+    server.stop();
+
+    //stop requested before the loop started isn't lost
+    netReactor early;
+    early.stop();
+    early.run();
+
+    coidlog_info("net", "reactor loopback: " << uint64(nconn * 1e9 / cns) << " connections/s, "
+        << uint64(nrecv * 1e9 / mns) << " messages/s (" << nclients << " connections, " << msgsize << "B ping-pong)");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+///Metastream over netstreamtcp: blocking client against a reactor-driven server
+void test_net_stream()
+{
+    netSubsystem::instance();
+
+    netReactorGroup server;
+    DASSERT(server.start(1));
+
+    uint16 port = server.listen("127.0.0.1", 0, [&](netReactor& r, uints handle, const netAddress&) {
+        packet_echo* c = new packet_echo(handle);
+        c->net.attach(r, [c](netstreamtcp&) { c->on_data(); });
+    });
+    DASSERT(port != 0);
+
+    netSocket s;
+    s.open(true);
+    DASSERT(s.connect("127.0.0.1", port, true) == 0);
+    s.setNoDelay(true);
+
+    netstreamtcp net(s.getHandle());
+    s.setHandleInvalid();
+
+    fmtstreambin fmt(net);
+    metastream meta(fmt);
+
+    //small packets go through the rings, the large ones bypass them
+    const uints sizes[] = {0, 1, 100, 16000, 300000, 5};
+
+    for (uints n : sizes) {
+        dynarray<uint> v;
+        for (uints i = 0; i < n; ++i)
+            *v.add() = uint(i * 2654435761u);
+
+        meta.xstream_out(v);
+        meta.stream_flush();
+
+        dynarray<uint> r;
+        meta.xstream_in(r);
+        meta.stream_acknowledge();
+
+        DASSERT(r.size() == n);
+        DASSERT(n == 0 || ::memcmp(r.ptr(), v.ptr(), n * sizeof(uint)) == 0);
+    }
+
+    //unread data are reported on acknowledge
+    dynarray<uint> v;
+    v.add(3);
+    meta.xstream_out(v);
+    meta.stream_flush();
+
+    uint32 hdr;
+    uints len = sizeof(hdr);
+    DASSERT(net.read_raw(&hdr, len) == NOERR);
+    DASSERT(net.available() > 0 || net.peek_read(1000) == NOERR);
+
+    bool thrown = false;
+    try { net.acknowledge(); }
+    catch (opcd) { thrown = true; }
+    DASSERT(thrown);
+    net.acknowledge(true);
+
+    net.close();
+    server.stop();
+
+    //raw mode with peek access
+    netSocket ls;
+    ls.open(true);
+    ls.setReuseAddr(true);
+    DASSERT(ls.bind("127.0.0.1", 0) == 0 && ls.listen(1) == 0);
+
+    netAddress addr;
+    ls.getLocalAddress(&addr);
+
+    netSocket cs;
+    cs.open(true);
+    DASSERT(cs.connect("127.0.0.1", addr.getPort(), true) == 0);
+
+    netstreamtcp rawin(ls.accept(0), false);
+    netstreamtcp rawout(cs.getHandle(), false);
+    cs.setHandleInvalid();
+
+    rawout.xwrite_token_raw("GET / HTTP/1.1\r\nHost: x\r\n\r\nbody");
+    rawout.flush();
+
+    binstreambuf line;
+    DASSERT(rawin.read_until(substring::crlf(), &line) == NOERR);
+    DASSERT(token(line) == "GET / HTTP/1.1");
+
+    line.reset_all();
+    DASSERT(rawin.read_until(substring("\r\n\r\n", 4, false), &line) == NOERR);
+    DASSERT(token(line) == "Host: x");
+
+    while (rawin.available() < 4)
+        rawin.peek_read(1000);
+    DASSERT(rawin.peek() == "body");
+    rawin.consume(4);
+    DASSERT(rawin.available() == 0);
+
+    //more segments than a single sendmsg takes are sent partially
+    netSocket vs;
+    vs.open(true);
+    DASSERT(vs.connect("127.0.0.1", addr.getPort(), true) == 0);
+    netSocket vr(ls.accept(0));
+
+    const uint nseg = 3000;
+    char data[nseg];
+    dynarray<binstream_iovec> segs;
+    segs.alloc(nseg);
+    for (uint i = 0; i < nseg; ++i) {
+        data[i] = char(i * 7);
+        segs[i].ptr = data + i;
+        segs[i].len = 1;
+    }
+
+    int sent = vs.sendv(segs.ptr(), nseg);
+    DASSERT(sent > 0 && sent <= int(nseg));
+
+    char rdata[nseg];
+    int got = 0;
+    while (got < sent) {
+        int n = vr.recv(rdata + got, sent - got);
+        DASSERT(n > 0);
+        if (n <= 0)
+            break;
+        got += n;
+    }
+    DASSERT(got == sent && ::memcmp(rdata, data, sent) == 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+///Loopback UDP throughput of single datagram calls versus batched ones
+void test_net_udp()
+{
+    netSubsystem::instance();
+
+    netSocket rx, tx;
+    rx.open(false);
+    tx.open(false);
+    DASSERT(rx.bind("127.0.0.1", 0) == 0);
+    rx.setBuffers(1 << 20, 1 << 20);
+    tx.setBuffers(1 << 20, 1 << 20);
+
+    netAddress addr;
+    rx.getLocalAddress(&addr);
+
+    const uint msgsize = 64;
+    const uint batch = 32;
+    const uint nmsg = 320000;
+    char msg[msgsize] = {};
+    char buf[2048];
+
+    //one datagram per call
+    nsec_timer timer;
+    for (uint i = 0; i < nmsg; i += batch) {
+        for (uint k = 0; k < batch; ++k)
+            tx.sendto(msg, msgsize, 0, &addr);
+        for (uint k = 0; k < batch; ++k)
+            DASSERT(rx.recvfrom(buf, sizeof(buf), 0, 0) == int(msgsize));
+    }
+    uint64 sns = timer.time_ns();
+
+    //batched, with pooled batches
+    netDatagramBatch* out = netDatagramBatch::get(batch, msgsize);
+    netDatagramBatch* in = netDatagramBatch::get(batch, 2048);
+
+    for (uint k = 0; k < batch; ++k)
+        out->add()->size = msgsize;
+
+    timer.reset();
+    uint nrecv = 0;
+    for (uint i = 0; i < nmsg; i += batch) {
+        DASSERT(tx.sendmany(*out, 0, &addr) == int(batch));
+        for (uint k = 0; k < batch; ) {
+            int n = rx.recvmany(*in);
+            DASSERT(n > 0);
+            if (n <= 0)
+                break;
+            k += n;
+            nrecv += n;
+        }
+    }
+    uint64 bns = timer.time_ns();
+    DASSERT(nrecv == nmsg);
+
+    coidlog_info("net", "udp loopback: " << uint64(nmsg * 1e9 / sns) << " packets/s single, "
+        << uint64(nmsg * 1e9 / bns) << " packets/s batched (" << batch << " per call, " << msgsize << "B)");
+
+    //segmentation offload: one large datagram split to segments by the kernel
+    const uint segsize = 1200;
+    const uint nseg = 16;
+
+    netDatagramBatch* big = netDatagramBatch::get(1, segsize * nseg);
+    netDatagramBatch::datagram* d = big->add();
+    d->size = segsize * nseg;
+    d->segment = segsize;
+    for (uint i = 0; i < d->size; ++i)
+        d->data[i] = uint8(i / segsize);
+
+    //buffers must fit the coalesced segments
+    in->reserve(batch, 65536);
+    bool gro = rx.setGRO(true);
+
+    if (tx.sendmany(*big, 0, &addr) == 1) {
+        //segments arrive separately or coalesced by GRO
+        uint bytes = 0;
+        while (bytes < segsize * nseg) {
+            int n = rx.recvmany(*in);
+            DASSERT(n > 0);
+            if (n <= 0)
+                break;
+
+            for (const netDatagramBatch::datagram& r : *in) {
+                DASSERT(gro || r.size == segsize);
+                DASSERT(r.segment == 0 || r.segment == segsize);
+                for (uint i = 0; i < r.size; ++i)
+                    DASSERT(r.data[i] == uint8((bytes + i) / segsize));
+                bytes += r.size;
+            }
+        }
+        DASSERT(bytes == segsize * nseg);
+    }
+    else
+        coidlog_info("net", "udp segmentation offload not supported");
+
+    netDatagramBatch::release(big);
+    netDatagramBatch::release(in);
+    netDatagramBatch::release(out);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+///Cached asynchronous host name resolution
+void test_net_resolver()
+{
+    netSubsystem::instance();
+
+    netResolver res(2);
+
+    //numeric addresses complete immediately
+    bool done = false;
+    res.resolve("127.0.0.1:80", 0, false, [&](opcd e, const netAddress& a) {
+        DASSERT(e == NOERR && a.isLocalHost() && a.getPort() == 80);
+        done = true;
+    });
+    DASSERT(done);
+
+    //local host name, resolvable through the hosts file
+    charstr host;
+    netAddress::getLocalHostName(host);
+
+    netAddress addr;
+    std::atomic<int> ndone{0};
+    netAddress async;
+    opcd aerr;
+    nsec_timer timer;
+
+    res.resolve(host, 2000, true, [&](opcd e, const netAddress& a) {
+        aerr = e;
+        async = a;
+        ++ndone;
+    });
+    while (ndone.load() == 0 && timer.time_ns() < 10000000000ULL)
+        thread::wait(1);
+    uint64 missns = timer.time_ns();
+
+    DASSERT(ndone.load() == 1);
+    DASSERT(aerr == NOERR && async.getPort() == 2000 && !async.isAddrAny());
+
+    //served from the cache now, synchronously
+    timer.reset();
+    opcd e = res.lookup(host, 3000, true, addr);
+    uint64 hitns = timer.time_ns();
+
+    DASSERT(e == NOERR && addr.sin_addr == async.sin_addr && addr.getPort() == 3000);
+
+    bool hit = false;
+    res.resolve(host, 0, false, [&](opcd e, const netAddress& a) {
+        hit = e == NOERR && a.sin_addr == async.sin_addr;
+    });
+    DASSERT(hit);
+
+    //failed lookups are cached too
+    const token bad = "nonexistent.invalid";
+    DASSERT(res.resolve_sync(bad, 0, false, addr) != NOERR);
+    e = res.lookup(bad, 0, false, addr);
+    DASSERT(e != NOERR && e != ersRETRY);
+
+    res.clear();
+    DASSERT(res.lookup(bad, 0, false, addr) == ersRETRY);
+
+    //concurrent synchronous misses wait for the same lookup
+    res.clear();
+    netAddress saddr[4];
+    opcd serr[4];
+    thread threads[4];
+
+    for (int i = 0; i < 4; ++i) {
+        threads[i].create_fn([&, i]() -> void* {
+            serr[i] = res.resolve_sync(host, 4000, true, saddr[i]);
+            return 0;
+        }, 0, "resolve_sync");
+    }
+    for (thread& t : threads)
+        thread::join(t);
+
+    for (int i = 0; i < 4; ++i)
+        DASSERT(serr[i] == NOERR && saddr[i].sin_addr == async.sin_addr && saddr[i].getPort() == 4000);
+
+    //the cache is bounded, entries that expire first are dropped
+    res.set_max_entries(8);
+    charstr name;
+
+    for (int i = 0; i < 32; ++i) {
+        name.reset();
+        name << "nonexistent" << i << ".invalid";
+        DASSERT(res.resolve_sync(name, 0, false, addr) != NOERR);
+    }
+    DASSERT(res.lookup("nonexistent0.invalid", 0, false, addr) == ersRETRY);
+    DASSERT(res.lookup(name, 0, false, addr) != ersRETRY);
+
+    //expired entries are served while being refreshed
+    res.set_ttl(0, 0);
+    DASSERT(res.resolve_sync(host, 0, false, addr) == NOERR);
+    DASSERT(res.lookup(host, 0, false, addr) == NOERR);
+    DASSERT(addr.sin_addr == async.sin_addr);
+
+    coidlog_info("net", "resolver: " << missns / 1000 << "us uncached, " << hitns << "ns cached lookup");
+}
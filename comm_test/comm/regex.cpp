@@ -23,4 +23,41 @@ void regex_test()
     RASSERT(sub[2] == "141");
     RASSERT(sub[3] == "423");
 
+    //leftmost-longest match, anchors
+    RASSERT( regex("a*b").find("xaab") == "aab" );
+    RASSERT( regex("a+").match("aab") == "" );
+    RASSERT( regex("a+").leading("aab") == "aa" );
+    RASSERT( regex("x").find("abc").is_null() );
+    RASSERT( regex("^b").find("ab\nb").ptr() == token("ab\nb").ptr() + 3 );
+    RASSERT( regex("b$").find("ba\nb") == "b" );
+    RASSERT( regex("WORLD", false, false, true).find("hello world") == "world" );
+
+    //multibyte characters
+    RASSERT( regex("\xc3\xa9+").find("x\xc3\xa9\xc3\xa9y") == "\xc3\xa9\xc3\xa9" );
+    RASSERT( regex("x.y").find("ax\xe2\x82\xacy") == "x\xe2\x82\xacy" );
+    RASSERT( regex("[^a]b").find("a\xc3\xa9" "b") == "\xc3\xa9" "b" );
+
+    RASSERT( regex("(a|ab)(c|bcd)").find("xabcd", sub.ptr(), 3) == "abcd" );
+    RASSERT( regex("^([a-z]+)=([0-9]+)$").find("#x\nkey=123\nz", sub.ptr(), 3) == "key=123" );
+    RASSERT(sub[1] == "key");
+    RASSERT(sub[2] == "123");
+
+    //pattern sets
+    uint ids[4];
+    regex_set lits;
+    lits.add("he");
+    lits.add("she");
+    lits.add("hers");
+    lits.add("his");
+    RASSERT( lits.find("ushers", ids, 4) == 3 && ids[0] == 0 && ids[1] == 1 && ids[2] == 2 );
+    RASSERT( lits.find("hi", ids, 4) == 0 );
+
+    regex_set rs;
+    rs.add("^[0-9]+$");
+    rs.add("err(or)?");
+    rs.add("WARN", false, false, true);
+    RASSERT( rs.find("warning: error 42", ids, 4) == 2 && ids[0] == 1 && ids[1] == 2 );
+    RASSERT( rs.match("123", ids, 4) == 1 && ids[0] == 0 );
+    RASSERT( rs.match("err", ids, 4) == 1 && ids[0] == 1 );
+
 }
@@ -1,4 +1,8 @@
 #include <comm/token.h>
+#include <comm/strscan.h>
+#include <comm/str.h>
+#include <comm/timer.h>
+#include <comm/log/logger.h>
 static const coid::token src = "foo//bar//baz";
 static const coid::token src_group = "foo/\\bar/\\baz";
 
@@ -966,7 +970,234 @@ void test_token_cuts()
     test_cuts_valid_group();
 }
 
+////////////////////////////////////////////////////////////////////////////////
+static void fill_haystack(coid::charstr& buf, uints len)
+{
+    static const char text[] = "Lorem ipsum dolor sit amet,\r\nconsectetur adipiscing elit\n";
+    char* p = buf.get_buf(len);
+    for (uints i = 0; i < len; ++i)
+        p[i] = text[i % (sizeof(text) - 1)];
+}
+
+void test_strscan()
+{
+    using coid::strscan;
+    const strscan::impl& ref = *strscan::variant(strscan::SCALAR);
+
+    coid::charstr buf;
+    fill_haystack(buf, 1000);
+    buf.append("NEEDLE\r");
+
+    coid::charstr up = buf;
+    up.toupper();
+
+    //nibble tables of a character class, as kept by char_class
+    uint8 lo[16] = {0}, hi[16] = {0};
+    for (uchar c : coid::token("NEq,\r eo\xc3\xa9")) {
+        uint8* tab = c < 128 ? lo : hi;
+        tab[c & 15] |= uint8(1 << ((c >> 4) & 7));
+    }
+    auto in_class = [&](uchar c) {
+        const uint8* tab = c < 128 ? lo : hi;
+        return (tab[c & 15] & (1 << ((c >> 4) & 7))) != 0;
+    };
+
+    for (int l = strscan::SSE42; l <= strscan::AVX2; ++l)
+    {
+        const strscan::impl* v = strscan::variant(strscan::level(l));
+        if (!v)
+            continue;
+
+        //all lengths and alignments around the block boundaries
+        for (uints off = 0; off < 40; ++off) {
+            for (uints len = 0; len + off <= buf.len(); len += len < 80 ? 1 : 61) {
+                const char* p = buf.ptr() + off;
+                const char* pe = p + len;
+
+                DASSERT(v->find_char(p, pe, 'N') == ref.find_char(p, pe, 'N'));
+                DASSERT(v->find_char2(p, pe, 'x', 'g') == ref.find_char2(p, pe, 'x', 'g'));
+                DASSERT(v->find_any(p, pe, "NEq,", 4) == ref.find_any(p, pe, "NEq,", 4));
+                DASSERT(v->find_substring(p, pe, "NEEDLE", 6) == ref.find_substring(p, pe, "NEEDLE", 6));
+                DASSERT(v->find_substring(p, pe, "elit", 4) == ref.find_substring(p, pe, "elit", 4));
+                DASSERT(v->count_newlines(p, pe) == ref.count_newlines(p, pe));
+                DASSERT(v->equal_icase(p, p, len));
+
+                //class spans stop at the first character not matching, or leave the tail to the caller
+                for (int in = 0; in < 2; ++in) {
+                    const uchar* ub = (const uchar*)buf.ptr();
+                    uints e = v->class_span(lo, hi, ub, off, off + len, in != 0);
+                    uints x = off;
+                    while (x < off + len && in_class(ub[x]) == (in != 0))
+                        ++x;
+                    DASSERT(e <= x && (e == x || off + len - e < 16));
+                }
+            }
+        }
+
+        DASSERT(v->equal_icase(buf.ptr(), up.ptr(), buf.len()));
+        DASSERT(!v->equal_icase(buf.ptr(), up.ptr() + 1, buf.len() - 1));
+        DASSERT(!v->equal_icase("@[`{", "`{@[", 4));
+    }
+
+    //wired into token and substring
+    coid::token tok = buf;
+    DASSERT(tok.contains("NEEDLE"_T) == buf.ptre() - 7);
+    DASSERT(tok.contains_icase("needle"_T) == buf.ptre() - 7);
+    DASSERT(tok.count_notchar('N') == buf.len() - 7);
+    DASSERT(tok.count_notchar_icase('n') == 31);
+    DASSERT(tok.count_notingroup("Q\rN"_T) == 27);
+    DASSERT(tok.strichr('l', 1) == tok.ptr() + 14);
+    DASSERT(tok.count_newlines() == 36);
+    DASSERT(tok.cmpeqi(coid::token(up)));
+    DASSERT(coid::token(buf.ptre() - 7, buf.ptre()).cmpeqi("needle\r"_T));
+
+    coid::substring ss("NEEDLE");
+    DASSERT(ss.find(buf.ptr(), buf.len()) == buf.len() - 7);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void benchmark_strscan()
+{
+    using coid::strscan;
+
+    coid::charstr buf;
+    fill_haystack(buf, 1 << 20);
+    buf.append("NEEDLE");
+
+    for (int l = strscan::SCALAR; l <= strscan::AVX2; ++l)
+    {
+        const strscan::impl* v = strscan::variant(strscan::level(l));
+        if (!v)
+            continue;
+
+        //short haystacks, typical for tokens cut from a lexer
+        uints n = 0;
+        coid::nsec_timer timer;
+        for (uints i = 0; i + 24 + 57 < buf.len(); i += 7) {
+            const char* p = buf.ptr() + i;
+            n += v->find_char(p, p + 24, ',') != 0;
+            n += v->find_substring(p, p + 24, "elit", 4) != 0;
+            n += v->equal_icase(p, p + 57, 24);
+        }
+        uint64 tshort = timer.time_ns();
+
+        //long haystacks
+        timer.reset();
+        const char* p = buf.ptr();
+        const char* pe = buf.ptre();
+        for (int k = 0; k < 4; ++k) {
+            n += v->find_char(p, pe, 'N') != 0;
+            n += v->find_char2(p, pe, 'N', 'Q') != 0;
+            n += v->find_any(p, pe, "NQZ", 3) != 0;
+            n += v->find_substring(p, pe, "NEEDLE", 6) != 0;
+            n += v->count_newlines(p, pe);
+        }
+        uint64 tlong = timer.time_ns();
+
+        coidlog_info("strscan", v->name << ": short " << (tshort / 1000) << "us, long "
+            << (tlong / 1000) << "us (" << n << ")");
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static uint64 xorshift(uint64& s)
+{
+    s ^= s << 13;
+    s ^= s >> 7;
+    s ^= s << 17;
+    return s;
+}
+
+void test_number_conversions()
+{
+    uint64 seed = 0x9e3779b97f4a7c15ULL;
+    coid::charstr str;
+
+    for (int i = 0; i < 100000; ++i)
+    {
+        //random bit patterns cover subnormals and extreme exponents
+        uint64 bits = xorshift(seed);
+        double d;
+        ::memcpy(&d, &bits, sizeof(d));
+        if (d != d || d - d != 0)
+            continue;
+
+        str.reset();
+        str += d;
+        DASSERT(str.len() <= coid::fpconv::SHORTEST_MAX);
+
+        coid::token tok = str;
+        double r = tok.todouble_and_shift();
+        DASSERT(tok.is_empty() && ::memcmp(&r, &d, sizeof(d)) == 0);
+
+        float f;
+        uint fbits = uint(bits >> 32);
+        ::memcpy(&f, &fbits, sizeof(f));
+        if (f != f || f - f != 0)
+            continue;
+
+        str.reset();
+        str += f;
+        float fr = coid::token(str).tofloat();
+        DASSERT(::memcmp(&fr, &f, sizeof(f)) == 0);
+
+        //integers
+        int64 n = int64(bits) >> (bits & 63);
+        str.reset();
+        str += n;
+        int64 nr = 0;
+        DASSERT(coid::token(str).toint64_all(nr) && nr == n);
+    }
+
+    DASSERT(coid::charstr(0.1) == "0.1"_T);
+    DASSERT(coid::charstr(100.0) == "100.0"_T);
+    DASSERT(coid::charstr(-2.5e-7) == "-2.5e-7"_T);
+    DASSERT(coid::charstr(1e300) == "1e300"_T);
+    DASSERT(coid::charstr(1.0f / 3) == "0.33333334"_T);
+    DASSERT(coid::charstr(int64(-9223372036854775807LL - 1)) == "-9223372036854775808"_T);
+    DASSERT(coid::charstr(uint64(18446744073709551615ULL)) == "18446744073709551615"_T);
+
+    DASSERT("2.2250738585072011e-308"_T.todouble() == 2.2250738585072011e-308);
+    DASSERT("9007199254740993"_T.todouble() == 9007199254740992.0);
+    DASSERT("0.1000000000000000055511151231257827021181583404541015625"_T.todouble() == 0.1);
+    DASSERT("123456789012"_T.touint64() == 123456789012ULL);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void benchmark_number_conversions()
+{
+    const int N = 200000;
+    uint64 seed = 0x2545f4914f6cdd1dULL;
+
+    coid::charstr str;
+    str.reserve(N * 24);
+
+    coid::nsec_timer timer;
+    for (int i = 0; i < N; ++i) {
+        double d = double(xorshift(seed) >> 11) * 0x1p-53 * 1000.0;
+        str += d;
+        str += ',';
+    }
+    uint64 twrite = timer.time_ns();
+
+    timer.reset();
+    coid::token tok = str;
+    double sum = 0;
+    while (!tok.is_empty()) {
+        sum += tok.todouble_and_shift();
+        ++tok;
+    }
+    uint64 tread = timer.time_ns();
+
+    coidlog_info("numconv", "double write " << (twrite / N) << "ns, read " << (tread / N)
+        << "ns per value (" << sum << ")");
+}
+
 void run_token_tests() 
 {
     test_token_cuts();
+    test_number_conversions();
+    benchmark_number_conversions();
+    test_strscan();
+    benchmark_strscan();
 }
\ No newline at end of file
@@ -16,12 +16,17 @@ void run_uid_tests();
 
 void metastream_test4();
 void metastream_test3();
+void metastream_benchmark3();
 void metastream_test2();
 int main_atomic(int argc, char * argv[]);
 
 void regex_test();
 void test_malloc();
 void test_job_queue();
+void test_net_reactor();
+void test_net_stream();
+void test_net_udp();
+void test_net_resolver();
 
 void float_test()
 {
@@ -279,6 +284,158 @@ void test_slotalloc_virtual()
 #endif
 }
 
+void test_slotalloc_compact()
+{
+    slotalloc_versioning<charstr> data;
+
+    for (int i = 0; i < 1000; ++i)
+        *data.add() << "item" << i;
+    for (uints i = 0; i < 1000; ++i)
+        if (i % 4 != 3)
+            data.del_item(i);
+
+    versionid last = data.get_item_versionid(uints(999));
+    DASSERT(data.compact_pending() == 188);
+
+    //incremental, 32 relocations per call
+    uints moved = 0;
+    versionid relocated;
+    while (uints n = data.compact(32, [&](uints old_id, uints new_id) {
+        if (old_id == 999)
+            relocated = data.get_item_versionid(new_id);
+    })) {
+        moved += n;
+    }
+
+    DASSERT(moved == 188 && data.compact_pending() == 0);
+    DASSERT(!data.is_valid_id(last));
+    DASSERT(data.is_valid_id(relocated) && *data.get_item(relocated) == "item999");
+
+    data.for_each([&](const charstr& v, uints id) {
+        DASSERT(id < data.count());
+    });
+
+    //paged storage with an ext array, trailing pages are released once dense
+    {
+        slotalloc<charstr, int> paged;
+
+        for (int i = 0; i < 1000; ++i) {
+            uints id;
+            *paged.add(&id) << "item" << i;
+            paged.value<0>(id) = i;
+        }
+        for (uints i = 0; i < 1000; ++i)
+            if (i % 4 != 3)
+                paged.del_item(i);
+
+        DASSERT(paged.compact() == 188 && paged.value_array<0>().size() == 250);
+
+        uints n = 0;
+        paged.for_each([&](const charstr& v, uints id) {
+            DASSERT(id < 250);
+            DASSERT(v == (charstr() << "item" << paged.value<0>(id)));
+            ++n;
+        });
+        DASSERT(n == 250);
+
+        //re-adding after the shrink grows the storage again
+        for (int i = 1000; i < 1300; ++i) {
+            uints id;
+            *paged.add(&id) << "item" << i;
+            paged.value<0>(id) = i;
+            DASSERT(id == uints(i - 750));
+        }
+
+        n = 0;
+        paged.for_each([&](const charstr& v, uints id) {
+            DASSERT(v == (charstr() << "item" << paged.value<0>(id)));
+            ++n;
+        });
+        DASSERT(n == 550 && paged.value_array<0>().size() == 550);
+    }
+
+    //pool mode moves items into the constructed objects of free slots
+    {
+        slotalloc_pool<charstr> pool;
+
+        for (int i = 0; i < 1000; ++i)
+            *pool.add() << "item" << i;
+        for (uints i = 0; i < 1000; ++i)
+            if (i % 4 != 3)
+                pool.del_item(i);
+
+        uints moved = pool.compact(UMAXS, [&](uints old_id, uints new_id) {
+            DASSERT(pool[new_id] == (charstr() << "item" << old_id));
+        });
+        DASSERT(moved == 188 && pool.compact_pending() == 0);
+
+        pool.for_each([&](const charstr& v, uints id) {
+            DASSERT(id < pool.count() && v.begins_with("item"));
+        });
+    }
+
+    //tracking reports the old slot as deleted and the new one as modified
+    {
+        slotalloc_tracking<charstr> tracked;
+
+        for (int i = 0; i < 300; ++i)
+            *tracked.add() << "item" << i;
+
+        tracked.advance_frame();
+        tracked.del_item(5);
+        DASSERT(tracked.compact() == 1);
+
+        bool old_deleted = false, new_modified = false;
+        tracked.for_each_modified(slotalloc_detail::changeset::bitplane_mask(0), [&](const charstr* p, size_t id) {
+            if (id == 299)
+                old_deleted = p == 0;
+            else if (id == 5)
+                new_modified = p && *p == "item299";
+        });
+        DASSERT(old_deleted && new_modified);
+    }
+}
+
+void test_slotalloc_snapshot()
+{
+    slotalloc_tracking<charstr> data;
+
+    for (int i = 0; i < 1000; ++i)
+        *data.add() << "item" << i;
+
+    data.advance_frame();
+
+    auto s0 = data.snapshot();
+    DASSERT(s0.count() == 1000 && s0.copied_chunks() == s0.chunk_count());
+
+    //modify one item in the first chunk and delete one in the last chunk
+    *data.get_mutable_item(10) << "x";
+    data.del_item(999);
+    data.advance_frame();
+
+    auto s1 = data.snapshot(&s0);
+    DASSERT(s1.count() == 999 && s1.copied_chunks() == 2);
+    DASSERT(s1[10] == "item10x" && s0[10] == "item10");
+    DASSERT(s1.is_valid_id(998) && !s1.is_valid_id(999) && s0.is_valid_id(999));
+    DASSERT(s1.get_item(500) == s0.get_item(500));
+
+    //the older snapshot can be released while the newer one still shares its chunks
+    s0 = decltype(s0)();
+    DASSERT(*s1.get_item(500) == "item500");
+
+    data.advance_frame();
+
+    auto s2 = data.snapshot(&s1);
+    DASSERT(s2.copied_chunks() == 0);
+
+    uints n = 0;
+    s2.for_each([&](const charstr& v, uints id) {
+        DASSERT(v.begins_with("item"));
+        ++n;
+    });
+    DASSERT(n == 999);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 #ifdef COID_CONSTEXPR_IF
@@ -327,6 +484,8 @@ struct slot : storage<L, Es...>
 
 void data_client_test();
 void binstring_test();
+void binstream_batch_test();
+void binstream_batch_short_write_test();
 
 ////////////////////////////////////////////////////////////////////////////////
 int main( int argc, char* argv[] )
@@ -336,6 +495,8 @@ int main( int argc, char* argv[] )
     run_uid_tests();
     singleton_test();
     binstring_test();
+    binstream_batch_test();
+    binstream_batch_short_write_test();
     //compot();
     data_client_test();
 
@@ -351,6 +512,8 @@ int main( int argc, char* argv[] )
 
     test_malloc();
     test_slotalloc_virtual();
+    test_slotalloc_compact();
+    test_slotalloc_snapshot();
 
     fntest(0);
 
@@ -360,6 +523,11 @@ int main( int argc, char* argv[] )
 
     test_job_queue();
 
+    test_net_reactor();
+    test_net_stream();
+    test_net_udp();
+    test_net_resolver();
+
 #if 0
     static_assert( std::is_trivially_move_constructible<dynarray<char>>::value, "non-trivial move");
     static_assert( std::is_trivially_move_constructible<charstr>::value, "non-trivial move");
@@ -463,6 +631,7 @@ int main( int argc, char* argv[] )
     metastream_test3();
     metastream_test4();
     //metastream_test2();
+    //metastream_benchmark3();
     //float_test();
 
     //main_atomic(argc, argv);
@@ -75,13 +75,6 @@ template <class T> T* __del(T* &ptr, uints nfrom, uints nlen, uints ndel = 1) {
 template <> inline void* __del(void* &ptr, uints nfrom, uints nlen, uints ndel) { return __del<char>((char*&)ptr, nfrom, nlen, ndel); }
 
 
-////////////////////////////////////////////////////////////////////////////////
-enum class reserve_mode
-{
-    memory,                     //< reserve & commit memory to use initially, resizeable with rebase allowed
-    virtual_space,              //< reserve virtual address space for use for the whole lifetime, allocated dynamically
-};
-
 constexpr uint64 abyss_dynarray_size = (1ull << 32) - 1;
 
 template <class T>
@@ -166,8 +159,8 @@ public:
     /// @param mode reservation mode
     explicit dynarray(uints reserve_count, reserve_mode mode = reserve_mode::memory)
     {
-        if (mode == reserve_mode::virtual_space) {
-            _ptr = A::template reserve_virtual<T>(reserve_count);
+        if (mode & reserve_mode::virtual_space) {
+            _ptr = A::template reserve_virtual<T>(reserve_count, mode);
             _set_count(0);
         }
         else {
@@ -255,7 +248,7 @@ public:
 
     ///take control over buffer controlled by \a dest dynarray, \a dest ptr will be set to zero
     template<class COUNT2>
-    dynarray& takeover(dynarray<T, COUNT2>& src)
+    dynarray& takeover(dynarray<T, COUNT2, A>& src)
     {
         discard();
         uints stack_size = src.reserved_stack();
@@ -1230,8 +1223,8 @@ public:
     T* reserve(uints count, reserve_mode mode) {
         discard();
 
-        if (mode == reserve_mode::virtual_space) {
-            _ptr = A::template reserve_virtual<T>(count);
+        if (mode & reserve_mode::virtual_space) {
+            _ptr = A::template reserve_virtual<T>(count, mode);
             _set_count(0);
         }
         else {
@@ -1252,6 +1245,17 @@ public:
         _set_count(0);
     }
 
+    ///Reserve address space for \a nitems of elements in virtual memory with placement options
+    /** @param nitems number of items to reserve
+        @param mode placement options (huge pages, NUMA, prefault), see reserve_mode */
+    void reserve_virtual(uints nitems, reserve_mode mode)
+    {
+        discard();
+
+        _ptr = A::template reserve_virtual<T>(nitems, mode | reserve_mode::virtual_space);
+        _set_count(0);
+    }
+
     ///Reserve stack memory for \a nitems of elements using _alloca
     /** @param nitems number of items to reserve
         @return pointer to the first item of array */
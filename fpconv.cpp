@@ -0,0 +1,758 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is Unix port of the Plan 9 regular expression library.
+ *
+ * The Initial Developer of the Original Code is
+ * Rob Pike
+ * Copyright (C) 2003, Lucent Technologies Inc. and others. All Rights Reserved.
+ *
+ * Contributor(s):
+ * Brano Kemen - modifications required for COID/comm library
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+#include "fpconv.h"
+
+#include <string.h>
+#include <sstream>
+#include <locale>
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+COID_NAMESPACE_BEGIN
+
+namespace fpconv {
+
+////////////////////////////////////////////////////////////////////////////////
+// Generated tables
+// Ryu: 5^-i and 5^i scaled to fixed bit counts, entries for double are 128 bit {low, high}
+// Eisel-Lemire: 5^q normalized to 128 bits for q in <-342, 308>, rounded up for negative q
+
+#include "fpconv_tables.inl"
+
+////////////////////////////////////////////////////////////////////////////////
+struct uint128
+{
+    uint64 lo, hi;
+};
+
+static inline uint128 mul64(uint64 a, uint64 b)
+{
+    uint128 r;
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 p = (unsigned __int128)a * b;
+    r.lo = uint64(p);
+    r.hi = uint64(p >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    r.lo = _umul128(a, b, &r.hi);
+#else
+    uint64 a0 = uint32(a), a1 = a >> 32;
+    uint64 b0 = uint32(b), b1 = b >> 32;
+    uint64 p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+    uint64 mid = (p00 >> 32) + uint32(p01) + uint32(p10);
+    r.lo = (mid << 32) | uint32(p00);
+    r.hi = p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+#endif
+    return r;
+}
+
+static inline uint clz64(uint64 v)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long i;
+    _BitScanReverse64(&i, v);
+    return 63 - i;
+#elif defined(__GNUC__)
+    return __builtin_clzll(v);
+#else
+    uint n = 0;
+    for (; !(v & (uint64(1) << 63)); v <<= 1) ++n;
+    return n;
+#endif
+}
+
+// floor(log2(5^e)) + 1, for e in <0, 3528>
+static inline int pow5bits(int e) {
+    return int((uint(e) * 1217359) >> 19) + 1;
+}
+
+// floor(log10(2^e)), for e in <0, 1650>
+static inline uint log10pow2(int e) {
+    return (uint(e) * 78913) >> 18;
+}
+
+// floor(log10(5^e)), for e in <0, 2620>
+static inline uint log10pow5(int e) {
+    return (uint(e) * 732923) >> 20;
+}
+
+static inline uint pow5factor(uint64 v)
+{
+    uint n = 0;
+    for (; v % 5 == 0; v /= 5) ++n;
+    return n;
+}
+
+static inline bool multiple_of_pow5(uint64 v, uint p) {
+    return pow5factor(v) >= p;
+}
+
+static inline bool multiple_of_pow2(uint64 v, uint p) {
+    return (v & ((uint64(1) << p) - 1)) == 0;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Ryu shortest formatting
+
+///Decimal form of a value: digits * 10^exponent
+struct decimal
+{
+    uint64 digits;
+    int exponent;
+};
+
+static inline uint64 mul_shift64(uint64 m, const uint64* mul, int j)
+{
+    uint128 b0 = mul64(m, mul[0]);
+    uint128 b2 = mul64(m, mul[1]);
+    //(b0 >> 64) + b2, shifted right by j >= 64
+    uint64 lo = b2.lo + b0.hi;
+    uint64 hi = b2.hi + (lo < b2.lo);
+    int s = j - 64;
+    return s == 0 ? lo : (hi << (64 - s)) | (lo >> s);
+}
+
+static decimal ryu_double(uint64 mantissa, uint exponent)
+{
+    const int MBITS = 52;
+    const int BIAS = 1023;
+    const int POW5_INV_BITCOUNT = 125;
+    const int POW5_BITCOUNT = 125;
+
+    int e2;
+    uint64 m2;
+    if (exponent == 0) {
+        e2 = 1 - BIAS - MBITS - 2;
+        m2 = mantissa;
+    }
+    else {
+        e2 = int(exponent) - BIAS - MBITS - 2;
+        m2 = (uint64(1) << MBITS) | mantissa;
+    }
+
+    const bool accept_bounds = (m2 & 1) == 0;
+
+    //interval of values rounding to this one, scaled by 4
+    const uint64 mv = 4 * m2;
+    const uint mmshift = mantissa != 0 || exponent <= 1;
+
+    uint64 vr, vp, vm;
+    int e10;
+    bool vm_trailing_zeros = false, vr_trailing_zeros = false;
+
+    if (e2 >= 0) {
+        const uint q = log10pow2(e2) - (e2 > 3);
+        e10 = int(q);
+        const int k = POW5_INV_BITCOUNT + pow5bits(q) - 1;
+        const int i = -e2 + int(q) + k;
+        const uint64* mul = DOUBLE_POW5_INV_SPLIT[q];
+        vr = mul_shift64(mv, mul, i);
+        vp = mul_shift64(mv + 2, mul, i);
+        vm = mul_shift64(mv - 1 - mmshift, mul, i);
+
+        if (q <= 21) {
+            //only one of mp, mv, and mm can be a multiple of 5, if any
+            if (mv % 5 == 0)
+                vr_trailing_zeros = multiple_of_pow5(mv, q);
+            else if (accept_bounds)
+                vm_trailing_zeros = multiple_of_pow5(mv - 1 - mmshift, q);
+            else
+                vp -= multiple_of_pow5(mv + 2, q);
+        }
+    }
+    else {
+        const uint q = log10pow5(-e2) - (-e2 > 1);
+        e10 = int(q) + e2;
+        const int i = -e2 - int(q);
+        const int k = pow5bits(i) - POW5_BITCOUNT;
+        const int j = int(q) - k;
+        const uint64* mul = DOUBLE_POW5_SPLIT[i];
+        vr = mul_shift64(mv, mul, j);
+        vp = mul_shift64(mv + 2, mul, j);
+        vm = mul_shift64(mv - 1 - mmshift, mul, j);
+
+        if (q <= 1) {
+            //mv has at least q trailing zero bits
+            vr_trailing_zeros = true;
+            if (accept_bounds)
+                vm_trailing_zeros = mmshift == 1;
+            else
+                --vp;
+        }
+        else if (q < 63) {
+            vr_trailing_zeros = multiple_of_pow2(mv, q);
+        }
+    }
+
+    //find the shortest representation in the interval
+    int removed = 0;
+    uint last_removed = 0;
+    uint64 output;
+
+    if (vm_trailing_zeros || vr_trailing_zeros) {
+        //general case, rare
+        for (; vp / 10 > vm / 10; ++removed) {
+            vm_trailing_zeros &= vm % 10 == 0;
+            vr_trailing_zeros &= last_removed == 0;
+            last_removed = uint(vr % 10);
+            vr /= 10; vp /= 10; vm /= 10;
+        }
+        if (vm_trailing_zeros) {
+            for (; vm % 10 == 0; ++removed) {
+                vr_trailing_zeros &= last_removed == 0;
+                last_removed = uint(vr % 10);
+                vr /= 10; vp /= 10; vm /= 10;
+            }
+        }
+        //round to even on exact ties
+        if (vr_trailing_zeros && last_removed == 5 && vr % 2 == 0)
+            last_removed = 4;
+        output = vr + ((vr == vm && (!accept_bounds || !vm_trailing_zeros)) || last_removed >= 5);
+    }
+    else {
+        //common case
+        bool round_up = false;
+        if (vp / 100 > vm / 100) {
+            round_up = vr % 100 >= 50;
+            vr /= 100; vp /= 100; vm /= 100;
+            removed += 2;
+        }
+        for (; vp / 10 > vm / 10; ++removed) {
+            round_up = vr % 10 >= 5;
+            vr /= 10; vp /= 10; vm /= 10;
+        }
+        output = vr + (vr == vm || round_up);
+    }
+
+    decimal d = { output, e10 + removed };
+    return d;
+}
+
+static inline uint mul_shift32(uint m, uint64 factor, int shift)
+{
+    uint64 b0 = uint64(m) * uint32(factor);
+    uint64 b1 = uint64(m) * (factor >> 32);
+    uint64 sum = (b0 >> 32) + b1;
+    return uint(sum >> (shift - 32));
+}
+
+static decimal ryu_float(uint mantissa, uint exponent)
+{
+    const int MBITS = 23;
+    const int BIAS = 127;
+    const int POW5_INV_BITCOUNT = 59;
+    const int POW5_BITCOUNT = 61;
+
+    int e2;
+    uint m2;
+    if (exponent == 0) {
+        e2 = 1 - BIAS - MBITS - 2;
+        m2 = mantissa;
+    }
+    else {
+        e2 = int(exponent) - BIAS - MBITS - 2;
+        m2 = (1u << MBITS) | mantissa;
+    }
+
+    const bool accept_bounds = (m2 & 1) == 0;
+
+    const uint mv = 4 * m2;
+    const uint mp = 4 * m2 + 2;
+    const uint mmshift = mantissa != 0 || exponent <= 1;
+    const uint mm = 4 * m2 - 1 - mmshift;
+
+    uint vr, vp, vm;
+    int e10;
+    bool vm_trailing_zeros = false, vr_trailing_zeros = false;
+    uint last_removed = 0;
+
+    if (e2 >= 0) {
+        const uint q = log10pow2(e2);
+        e10 = int(q);
+        const int k = POW5_INV_BITCOUNT + pow5bits(q) - 1;
+        const int i = -e2 + int(q) + k;
+        vr = mul_shift32(mv, FLOAT_POW5_INV_SPLIT[q], i);
+        vp = mul_shift32(mp, FLOAT_POW5_INV_SPLIT[q], i);
+        vm = mul_shift32(mm, FLOAT_POW5_INV_SPLIT[q], i);
+
+        if (q != 0 && (vp - 1) / 10 <= vm / 10) {
+            //at most one digit gets removed, compute it from a one-less-digit product
+            const int l = POW5_INV_BITCOUNT + pow5bits(q - 1) - 1;
+            last_removed = mul_shift32(mv, FLOAT_POW5_INV_SPLIT[q - 1], -e2 + int(q) - 1 + l) % 10;
+        }
+        if (q <= 9) {
+            if (mv % 5 == 0)
+                vr_trailing_zeros = multiple_of_pow5(mv, q);
+            else if (accept_bounds)
+                vm_trailing_zeros = multiple_of_pow5(mm, q);
+            else
+                vp -= multiple_of_pow5(mp, q);
+        }
+    }
+    else {
+        const uint q = log10pow5(-e2);
+        e10 = int(q) + e2;
+        const int i = -e2 - int(q);
+        const int k = pow5bits(i) - POW5_BITCOUNT;
+        int j = int(q) - k;
+        vr = mul_shift32(mv, FLOAT_POW5_SPLIT[i], j);
+        vp = mul_shift32(mp, FLOAT_POW5_SPLIT[i], j);
+        vm = mul_shift32(mm, FLOAT_POW5_SPLIT[i], j);
+
+        if (q != 0 && (vp - 1) / 10 <= vm / 10) {
+            j = int(q) - 1 - (pow5bits(i + 1) - POW5_BITCOUNT);
+            last_removed = mul_shift32(mv, FLOAT_POW5_SPLIT[i + 1], j) % 10;
+        }
+        if (q <= 1) {
+            vr_trailing_zeros = true;
+            if (accept_bounds)
+                vm_trailing_zeros = mmshift == 1;
+            else
+                --vp;
+        }
+        else if (q < 31) {
+            vr_trailing_zeros = multiple_of_pow2(mv, q - 1);
+        }
+    }
+
+    int removed = 0;
+    uint output;
+
+    if (vm_trailing_zeros || vr_trailing_zeros) {
+        for (; vp / 10 > vm / 10; ++removed) {
+            vm_trailing_zeros &= vm % 10 == 0;
+            vr_trailing_zeros &= last_removed == 0;
+            last_removed = vr % 10;
+            vr /= 10; vp /= 10; vm /= 10;
+        }
+        if (vm_trailing_zeros) {
+            for (; vm % 10 == 0; ++removed) {
+                vr_trailing_zeros &= last_removed == 0;
+                last_removed = vr % 10;
+                vr /= 10; vp /= 10; vm /= 10;
+            }
+        }
+        if (vr_trailing_zeros && last_removed == 5 && vr % 2 == 0)
+            last_removed = 4;
+        output = vr + ((vr == vm && (!accept_bounds || !vm_trailing_zeros)) || last_removed >= 5);
+    }
+    else {
+        for (; vp / 10 > vm / 10; ++removed) {
+            last_removed = vr % 10;
+            vr /= 10; vp /= 10; vm /= 10;
+        }
+        output = vr + (vr == vm || last_removed >= 5);
+    }
+
+    decimal d = { output, e10 + removed };
+    return d;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static char* write_special(char* p, bool sign, bool nan)
+{
+    if (nan) {
+        ::memcpy(p, "nan", 3);
+        return p + 3;
+    }
+    if (sign)
+        *p++ = '-';
+    ::memcpy(p, "inf", 3);
+    return p + 3;
+}
+
+///Write decimal digits*10^exponent
+static char* write_decimal(char* p, bool sign, decimal d)
+{
+    if (sign)
+        *p++ = '-';
+
+    uint n = count_digits(d.digits);
+    int sci = d.exponent + int(n) - 1;
+
+    if (sci < -5 || sci > 15) {
+        //scientific notation d[.ddd]e[-]xx
+        char* end = p + n + (n > 1 ? 1 : 0);
+        write_digits_back(end, d.digits);
+        if (n > 1) {
+            p[0] = p[1];
+            p[1] = '.';
+        }
+        p = end;
+        *p++ = 'e';
+        if (sci < 0) {
+            *p++ = '-';
+            sci = -sci;
+        }
+        return write_digits(p, uint(sci));
+    }
+
+    if (d.exponent >= 0) {
+        //whole number, append zeros and .0
+        p = write_digits(p, d.digits);
+        ::memset(p, '0', d.exponent);
+        p += d.exponent;
+        p[0] = '.';
+        p[1] = '0';
+        return p + 2;
+    }
+
+    int nint = int(n) + d.exponent;
+    if (nint > 0) {
+        //dot inside the digits
+        char* end = p + n + 1;
+        write_digits_back(end, d.digits);
+        ::memmove(p, p + 1, nint);
+        p[nint] = '.';
+        return end;
+    }
+
+    //0.000ddd
+    p[0] = '0';
+    p[1] = '.';
+    ::memset(p + 2, '0', -nint);
+    return write_digits(p + 2 - nint, d.digits);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+char* append_shortest(char* dst, double v)
+{
+    uint64 bits;
+    ::memcpy(&bits, &v, sizeof(bits));
+
+    bool sign = (bits >> 63) != 0;
+    uint64 mantissa = bits & ((uint64(1) << 52) - 1);
+    uint exponent = uint(bits >> 52) & 0x7ff;
+
+    if (exponent == 0x7ff)
+        return write_special(dst, sign, mantissa != 0);
+
+    if (exponent == 0 && mantissa == 0) {
+        if (sign)
+            *dst++ = '-';
+        ::memcpy(dst, "0.0", 3);
+        return dst + 3;
+    }
+
+    return write_decimal(dst, sign, ryu_double(mantissa, exponent));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+char* append_shortest(char* dst, float v)
+{
+    uint bits;
+    ::memcpy(&bits, &v, sizeof(bits));
+
+    bool sign = (bits >> 31) != 0;
+    uint mantissa = bits & ((1u << 23) - 1);
+    uint exponent = (bits >> 23) & 0xff;
+
+    if (exponent == 0xff)
+        return write_special(dst, sign, mantissa != 0);
+
+    if (exponent == 0 && mantissa == 0) {
+        if (sign)
+            *dst++ = '-';
+        ::memcpy(dst, "0.0", 3);
+        return dst + 3;
+    }
+
+    return write_decimal(dst, sign, ryu_float(mantissa, exponent));
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Eisel-Lemire parsing
+
+template<class T> struct binary_format;
+
+template<> struct binary_format<double>
+{
+    typedef uint64 bits_t;
+    enum {
+        MBITS = 52,
+        MIN_EXPONENT = -1023,
+        INFINITE_POWER = 0x7ff,
+        SMALLEST_POW10 = -342,
+        LARGEST_POW10 = 308,
+        MIN_ROUND_EVEN = -4,
+        MAX_ROUND_EVEN = 23,
+        MAX_FAST_POW10 = 22,
+    };
+    static double exact_pow10(int e) {
+        static const double tab[] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+        return tab[e];
+    }
+};
+
+template<> struct binary_format<float>
+{
+    typedef uint bits_t;
+    enum {
+        MBITS = 23,
+        MIN_EXPONENT = -127,
+        INFINITE_POWER = 0xff,
+        SMALLEST_POW10 = -65,
+        LARGEST_POW10 = 38,
+        MIN_ROUND_EVEN = -17,
+        MAX_ROUND_EVEN = 10,
+        MAX_FAST_POW10 = 10,
+    };
+    static float exact_pow10(int e) {
+        static const float tab[] = {
+            1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+        };
+        return tab[e];
+    }
+};
+
+///Compute binary mantissa and exponent of w * 10^q
+/// @return false if the result can't be decided by the fast algorithm
+template<class T>
+static bool lemire(uint64 w, int q, uint64& mantissa, int& power2)
+{
+    typedef binary_format<T> F;
+
+    if (w == 0 || q < F::SMALLEST_POW10) {
+        mantissa = 0;
+        power2 = 0;
+        return true;
+    }
+    if (q > F::LARGEST_POW10) {
+        mantissa = 0;
+        power2 = F::INFINITE_POWER;
+        return true;
+    }
+
+    uint lz = clz64(w);
+    w <<= lz;
+
+    const uint64* pow5 = POW5_128[q + 342];
+    const uint64 precision_mask = ~uint64(0) >> (F::MBITS + 3);
+
+    uint128 first = mul64(w, pow5[1]);
+    if ((first.hi & precision_mask) == precision_mask) {
+        //the lower part of the product may carry into the significant bits
+        uint128 second = mul64(w, pow5[0]);
+        first.lo += second.hi;
+        if (second.hi > first.lo)
+            ++first.hi;
+    }
+
+    //the product is exact enough, apart from this corner case outside the exact range
+    if (first.lo == ~uint64(0) && (q < -27 || q > 55))
+        return false;
+
+    uint upperbit = uint(first.hi >> 63);
+    uint shift = upperbit + 64 - F::MBITS - 3;
+    mantissa = first.hi >> shift;
+    power2 = int(((152170 + 65536) * q) >> 16) + 63 + int(upperbit) - int(lz) - F::MIN_EXPONENT;
+
+    if (power2 <= 0) {
+        //subnormal
+        if (-power2 + 1 >= 64) {
+            mantissa = 0;
+            power2 = 0;
+            return true;
+        }
+        mantissa >>= -power2 + 1;
+        mantissa += mantissa & 1;
+        mantissa >>= 1;
+        power2 = mantissa < (uint64(1) << F::MBITS) ? 0 : 1;
+        return true;
+    }
+
+    //exact halfway values need round-to-even
+    if (first.lo <= 1 && q >= F::MIN_ROUND_EVEN && q <= F::MAX_ROUND_EVEN && (mantissa & 3) == 1) {
+        if ((mantissa << shift) == first.hi)
+            mantissa &= ~uint64(1);
+    }
+
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    if (mantissa >= (uint64(2) << F::MBITS)) {
+        mantissa = uint64(1) << F::MBITS;
+        ++power2;
+    }
+    mantissa &= ~(uint64(1) << F::MBITS);
+
+    if (power2 >= F::INFINITE_POWER) {
+        power2 = F::INFINITE_POWER;
+        mantissa = 0;
+    }
+    return true;
+}
+
+template<class T>
+static T make_float(bool neg, uint64 mantissa, int power2)
+{
+    typedef typename binary_format<T>::bits_t bits_t;
+    const int NBITS = sizeof(bits_t) * 8;
+
+    bits_t bits = bits_t(mantissa) | (bits_t(power2) << binary_format<T>::MBITS);
+    if (neg)
+        bits |= bits_t(1) << (NBITS - 1);
+
+    T v;
+    ::memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+///Slow path using the classic locale stream conversion
+template<class T>
+static T parse_slow(const char* p, const char* pe)
+{
+    std::istringstream is(std::string(p, pe));
+    is.imbue(std::locale::classic());
+    T v = 0;
+    is >> v;
+    return v;
+}
+
+template<class T>
+static const char* parse_float(const char* p, const char* pe, T& val)
+{
+    typedef binary_format<T> F;
+    const char* start = p;
+
+    bool neg = false;
+    if (p < pe && (*p == '-' || *p == '+')) {
+        neg = *p == '-';
+        ++p;
+    }
+
+    //up to 19 significant digits fit into w
+    uint64 w = 0;
+    int ndig = 0;
+    int exp10 = 0;
+    bool truncated = false;
+    bool has_digits = false;
+
+    const char* ps = p;
+    for (; p < pe && *p >= '0' && *p <= '9'; ++p) {
+        if (ndig < 19) {
+            w = w * 10 + uint(*p - '0');
+            ndig += w != 0;
+        }
+        else {
+            ++exp10;
+            truncated |= *p != '0';
+        }
+    }
+    has_digits = p != ps;
+
+    if (p < pe && *p == '.') {
+        const char* pf = ++p;
+        for (; p < pe && *p >= '0' && *p <= '9'; ++p) {
+            if (ndig < 19) {
+                w = w * 10 + uint(*p - '0');
+                ndig += w != 0;
+                --exp10;
+            }
+            else
+                truncated |= *p != '0';
+        }
+        has_digits |= p != pf;
+    }
+
+    if (!has_digits)
+        return start;
+
+    if (p < pe && (*p == 'e' || *p == 'E')) {
+        const char* pe10 = p + 1;
+        bool eneg = false;
+        if (pe10 < pe && (*pe10 == '-' || *pe10 == '+')) {
+            eneg = *pe10 == '-';
+            ++pe10;
+        }
+        if (pe10 < pe && *pe10 >= '0' && *pe10 <= '9') {
+            int e = 0;
+            for (p = pe10; p < pe && *p >= '0' && *p <= '9'; ++p)
+                if (e < 100000) e = e * 10 + (*p - '0');
+            exp10 += eneg ? -e : e;
+        }
+    }
+
+    //exact when both the mantissa and the power of ten are exactly representable
+    if (!truncated && exp10 >= -F::MAX_FAST_POW10 && exp10 <= F::MAX_FAST_POW10
+        && w <= (uint64(2) << F::MBITS))
+    {
+        T v = T(w);
+        v = exp10 < 0 ? v / F::exact_pow10(-exp10) : v * F::exact_pow10(exp10);
+        val = neg ? -v : v;
+        return p;
+    }
+
+    uint64 mantissa;
+    int power2;
+    bool ok = lemire<T>(w, exp10, mantissa, power2);
+
+    if (ok && truncated) {
+        //the value lies between w and w+1, both must round the same
+        uint64 mantissa1;
+        int power21;
+        ok = lemire<T>(w + 1, exp10, mantissa1, power21)
+            && mantissa == mantissa1 && power2 == power21;
+    }
+
+    if (!ok) {
+        T v = parse_slow<T>(start + (neg || *start == '+' ? 1 : 0), p);
+        val = neg ? -v : v;
+        return p;
+    }
+
+    val = make_float<T>(neg, mantissa, power2);
+    return p;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const char* parse(const char* p, const char* pe, double& val) {
+    return parse_float<double>(p, pe, val);
+}
+
+const char* parse(const char* p, const char* pe, float& val) {
+    return parse_float<float>(p, pe, val);
+}
+
+} //namespace fpconv
+
+COID_NAMESPACE_END
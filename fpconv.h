@@ -0,0 +1,142 @@
+#pragma once
+
+/* ***** BEGIN LICENSE BLOCK *****
+* Version: MPL 1.1/GPL 2.0/LGPL 2.1
+*
+* The contents of this file are subject to the Mozilla Public License Version
+* 1.1 (the "License"); you may not use this file except in compliance with
+* the License. You may obtain a copy of the License at
+* http://www.mozilla.org/MPL/
+*
+* Software distributed under the License is distributed on an "AS IS" basis,
+* WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+* for the specific language governing rights and limitations under the
+* License.
+*
+* The Original Code is COID/comm module.
+*
+* The Initial Developer of the Original Code is
+* Outerra.
+* Portions created by the Initial Developer are Copyright (C) 2026
+* the Initial Developer. All Rights Reserved.
+*
+* Contributor(s):
+* Brano Kemen
+*
+* Alternatively, the contents of this file may be used under the terms of
+* either the GNU General Public License Version 2 or later (the "GPL"), or
+* the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+* in which case the provisions of the GPL or the LGPL are applicable instead
+* of those above. If you wish to allow use of your version of this file only
+* under the terms of either the GPL or the LGPL, and not to allow others to
+* use your version of this file under the terms of the MPL, indicate your
+* decision by deleting the provisions above and replace them with the notice
+* and other provisions required by the GPL or the LGPL. If you do not delete
+* the provisions above, a recipient may use your version of this file under
+* the terms of any one of the MPL, the GPL or the LGPL.
+*
+* ***** END LICENSE BLOCK ***** */
+
+#ifndef __COID_COMM_FPCONV__HEADER_FILE__
+#define __COID_COMM_FPCONV__HEADER_FILE__
+
+#include "namespace.h"
+#include "commtypes.h"
+
+COID_NAMESPACE_BEGIN
+
+////////////////////////////////////////////////////////////////////////////////
+///Fast conversions between numbers and their decimal text representation
+/// Floating point numbers are formatted to the shortest string that parses back to the same
+/// value (Ryu), and parsed with correct rounding (Eisel-Lemire, with a slow path for inputs
+/// with more than 19 significant digits that the fast algorithm cannot decide).
+namespace fpconv
+{
+    enum {
+        SHORTEST_MAX = 24,              //< max number of characters written by append_shortest
+    };
+
+    ///Append the shortest representation of a double that round-trips exactly
+    /// @note uses decimal notation for exponents in <-5, 15>, scientific otherwise;
+    ///       whole numbers are written with a trailing .0
+    /// @return position after the written characters
+    char* append_shortest(char* dst, double v);
+
+    ///Append the shortest representation of a float that round-trips exactly
+    char* append_shortest(char* dst, float v);
+
+    ///Parse decimal floating point number [+-]digits[.digits][(e|E)[+-]digits]
+    /// @param val [out] parsed value, untouched if nothing was parsed
+    /// @return pointer past the consumed characters, p if there was no number
+    const char* parse(const char* p, const char* pe, double& val);
+
+    ///Parse decimal floating point number, rounded directly to float
+    const char* parse(const char* p, const char* pe, float& val);
+
+    ///Table of two-digit decimal strings "00" .. "99"
+    inline const char* digit_pairs()
+    {
+        static const char tab[] =
+            "00010203040506070809"
+            "10111213141516171819"
+            "20212223242526272829"
+            "30313233343536373839"
+            "40414243444546474849"
+            "50515253545556575859"
+            "60616263646566676869"
+            "70717273747576777879"
+            "80818283848586878889"
+            "90919293949596979899";
+        return tab;
+    }
+
+    ///Number of decimal digits of a value
+    inline uint count_digits(uint64 v)
+    {
+        uint n = 1;
+        for (;;) {
+            if (v < 10) return n;
+            if (v < 100) return n + 1;
+            if (v < 1000) return n + 2;
+            if (v < 10000) return n + 3;
+            v /= 10000;
+            n += 4;
+        }
+    }
+
+    ///Write decimal digits of a value backwards, two at a time
+    /// @param end position past the last digit
+    /// @return position of the first digit
+    inline char* write_digits_back(char* end, uint64 v)
+    {
+        const char* tab = digit_pairs();
+        while (v >= 100) {
+            uint r = uint(v % 100);
+            v /= 100;
+            end -= 2;
+            end[0] = tab[2 * r];
+            end[1] = tab[2 * r + 1];
+        }
+        if (v >= 10) {
+            end -= 2;
+            end[0] = tab[2 * v];
+            end[1] = tab[2 * v + 1];
+        }
+        else
+            *--end = char('0' + v);
+        return end;
+    }
+
+    ///Write decimal digits of a value
+    /// @return position after the last digit
+    inline char* write_digits(char* dst, uint64 v)
+    {
+        char* end = dst + count_digits(v);
+        write_digits_back(end, v);
+        return end;
+    }
+}
+
+COID_NAMESPACE_END
+
+#endif //__COID_COMM_FPCONV__HEADER_FILE__
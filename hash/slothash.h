@@ -108,6 +108,14 @@ public:
     T* add_uninit(bool*, uints*) = delete;
     T* get_or_create(uints, bool*) = delete;
 
+    //relocation would break the hash chains
+    template<typename Func>
+    uints compact(uints, Func) = delete;
+    uints compact(uints) = delete;
+
+    //snapshots hold only the items, without the hash table for lookups by key
+    slotalloc_snapshot<T> snapshot(const slotalloc_snapshot<T>* = 0) const = delete;
+
     slothash(uint reserve_items = 64)
     {
         reserve(reserve_items);
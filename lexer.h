@@ -47,6 +47,7 @@
 #include "hash/hashkeyset.h"
 #include "hash/hashset.h"
 #include "binstream/binstreambuf.h"
+#include "charclass.h"
 
 COID_NAMESPACE_BEGIN
 
@@ -356,18 +357,28 @@ public:
 
 
     ///Bind input binstream used to read input data
-    void bind(binstream& bin)
+    /// @param bin source stream
+    /// @param window size of the sliding input window, 0 to read the whole input on the first call to next()
+    /// @note in the streaming mode (window > 0) the input is read in chunks as the tokens are consumed, and the
+    ///       data of the previous token are discarded on each call, so the returned lextoken views are valid only
+    ///       until the next call. Backtracking is not supported in streaming mode.
+    void bind(binstream& bin, uints window = 0)
     {
         reset();
         _buf.reset();
 
         _bin = &bin;
+        _window = window;
     }
 
+    /// @return size of the streaming window, 0 if the whole input is read at once
+    uints stream_window() const { return _bin ? _window : 0; }
+
     ///Bind input string to read from
     void bind(const token& tok)
     {
         reset();
+        _window = 0;
         _tok = tok;
 
         static const token BOM = "\xEF\xBB\xBF";
@@ -416,6 +427,12 @@ public:
         _lines = 0;
         _lines_processed = _lines_last = 0;
         _lines_oldchar = 0;
+        _linecut = 0;
+
+        _sbuf.reset();
+        _seof = false;
+        _starved = false;
+        _sdepth = 0;
 
         //resolve nested rules, delayed until all rules are defined
         for (sequence* seq : _stbary) {
@@ -636,6 +653,7 @@ public:
         er->replfn = fn_replace;
 
         _abmap[(uchar)escapechar] |= fGROUP_ESCAPE;
+        _cclass_valid = false;
 
         *_escary.add() = er;
         return g + 1;
@@ -907,6 +925,9 @@ public:
     /// @param consume_trailing_seq true if the trailing sequence should be consumed, false if it should be left in input
     const lextoken& next_as_string(int stringid, bool consume_trailing_seq = true)
     {
+        if (stream_enter())
+            return streamed([&]() -> const lextoken& { return next_as_string(stringid, consume_trailing_seq); });
+
         __assert_valid_sequence(stringid, entity::STRING);
 
         uint sid = -1 - stringid;
@@ -931,6 +952,9 @@ public:
     /// @param consume_trailing_seq true if the trailing sequence should be consumed, false if it should be left in input
     const lextoken& next_as_block(int blockid, bool consume_trailing_seq = true)
     {
+        if (stream_enter())
+            return streamed([&]() -> const lextoken& { return next_as_block(blockid, consume_trailing_seq); });
+
         __assert_valid_sequence(blockid, entity::BLOCK);
 
         uint sid = -1 - blockid;
@@ -962,6 +986,9 @@ public:
     ///Read a complete block for which the opening token was just read
     const lextoken& complete_block()
     {
+        if (stream_enter())
+            return streamed([&]() -> const lextoken& { return complete_block(); });
+
         int blockid = _last.id;
 
         __assert_valid_sequence(blockid, entity::BLOCK);
@@ -1022,6 +1049,9 @@ public:
         **/
     bool matches_block(int seqid, bool complete)
     {
+        if (stream_enter())
+            return streamed([&]() -> bool { return matches_block(seqid, complete); });
+
         __assert_valid_ssb(seqid);
 
         uint sid = -1 - seqid;
@@ -1082,6 +1112,11 @@ public:
     ///Skip group, default skipping whitespace group
     void skip(uint ignoregrp = 1)
     {
+        if (stream_enter()) {
+            streamed([&]() -> bool { skip(ignoregrp); return true; });
+            return;
+        }
+
         if (_pushback)
             return;
 
@@ -1116,7 +1151,10 @@ public:
         **/
     const lextoken& next(int ignoregrp = 1, int enable_seqid = 0, const token* no_pop = 0)
     {
-        if (_tok.is_null() && _bin)
+        if (stream_enter())
+            return streamed([&]() -> const lextoken& { return next(ignoregrp, enable_seqid, no_pop); });
+
+        if (_tok.is_null() && _bin && !_window)
         {
             //first time init from stream
             binstreambuf buf;
@@ -1310,6 +1348,9 @@ public:
     /// @param ignore id of the group that should be skipped beforehand, 0 if nothing shall be skipped
     bool follows(const token& tok, uint ignore = 1)
     {
+        if (stream_enter())
+            return streamed([&]() -> bool { return follows(tok, ignore); });
+
         uints skip = 0;
 
         if (ignore) {
@@ -1322,6 +1363,9 @@ public:
             skip = white.len();
         }
 
+        if (_window && _tok.len() < skip + tok.len())
+            _starved = true;
+
         return _kwds.is_icase()
             ? _tok.begins_with_icase(tok, skip)
             : _tok.begins_with(tok, skip);
@@ -1332,6 +1376,9 @@ public:
     /// @param ignore id of the group that should be skipped beforehand, 0 if nothing shall be skipped
     bool follows(char c, uint ignore = 1)
     {
+        if (stream_enter())
+            return streamed([&]() -> bool { return follows(c, ignore); });
+
         uints skip = 0;
 
         if (ignore) {
@@ -1344,6 +1391,9 @@ public:
             skip = white.len();
         }
 
+        if (_window && _tok.len() <= skip)
+            _starved = true;
+
         return _tok.nth_char(skip) == c;
     }
 
@@ -1891,7 +1941,7 @@ public:
         }
 
         if (col)
-            *col = uint(pstr.ptr() - _lines_last);
+            *col = uint(pstr.ptr() - _lines_last + _linecut);
 
         return _rawline + 1;
     }
@@ -2708,11 +2758,13 @@ protected:
     {
         _abmap[i] &= ~xGROUP;
         _abmap[i] |= val;
+        _cclass_valid = false;
     }
 
     ///Callback for process_set(), add character to trailing bitmap detector of a group
     void fn_trail(int i, uchar val) {
         _trail[i] |= val;
+        _cclass_valid = false;
     }
 
     ///Try to match a set of strings at offset
@@ -3111,10 +3163,58 @@ protected:
         return read_utf8_seq(_tok.ptr(), offs);
     }
 
+    ///Vectorized lookup table of a character class
+    /// @param i group id, or one of CC_* classes
+    /// @note the tables are rebuilt after the rules change
+    const char_class& cclass(uint i) const
+    {
+        if (!_cclass_valid)
+            build_char_classes();
+        return _cclass[i];
+    }
+
+    ///Vectorized lookup table of the characters in a trailing set mask
+    const char_class& trail_class(uchar msk) const
+    {
+        uint b = 0;
+        while (msk > 1) {
+            msk >>= 1;
+            ++b;
+        }
+        return cclass(CC_TRAIL + b);
+    }
+
+    ///Compile character groups and trailing sets into the vectorized lookup tables
+    void build_char_classes() const
+    {
+        for (char_class& cc : _cclass)
+            cc.reset();
+
+        for (uint c = 0; c < 256; ++c)
+        {
+            ushort x = _abmap[c];
+            _cclass[x & xGROUP].set(uchar(c));
+
+            if (x & (fGROUP_ESCAPE | fSEQ_TRAILING))
+                _cclass[CC_ESCAPE].set(uchar(c));
+            if (x & (fSEQ_TRAILING | xSEQ))
+                _cclass[CC_LEADING].set(uchar(c));
+
+            uchar t = _trail.size() ? _trail[c] : 0;
+            for (uint b = 0; t; ++b, t >>= 1)
+                if (t & 1)
+                    _cclass[CC_TRAIL + b].set(uchar(c));
+        }
+
+        _cclass_valid = true;
+    }
+
     ///Count characters until escape character or a possible trailing sequence character
     uints count_notescape(uints off)
     {
         const uchar* pc = (const uchar*)_tok.ptr();
+        off = cclass(CC_ESCAPE).span(pc, off, _tok.len(), false);
+
         for (; off < _tok.len(); ++off)
         {
             const uchar* p = pc + off;
@@ -3127,6 +3227,8 @@ protected:
     uints count_notleading(uints off)
     {
         const uchar* pc = (const uchar*)_tok.ptr();
+        off = cclass(CC_LEADING).span(pc, off, _tok.len(), false);
+
         for (; off < _tok.len(); ++off)
         {
             const uchar* p = pc + off;
@@ -3138,6 +3240,10 @@ protected:
     uints count_intable(const token& tok, token_hash& hash, uchar grp, uints off)
     {
         const uchar* pc = (const uchar*)tok.ptr();
+        uints n = cclass(grp).span(pc, off, tok.len(), true);
+        for (; off < n; ++off)
+            hash.inc_char(_casemap[pc[off]]);
+
         for (; off < tok.len(); ++off)
         {
             const uchar* p = pc + off;
@@ -3152,6 +3258,10 @@ protected:
     uints count_notintable(const token& tok, token_hash& hash, uchar grp, uints off)
     {
         const uchar* pc = (const uchar*)tok.ptr();
+        uints n = cclass(grp).span(pc, off, tok.len(), false);
+        for (; off < n; ++off)
+            hash.inc_char(_casemap[pc[off]]);
+
         for (; off < tok.len(); ++off)
         {
             const uchar* p = pc + off;
@@ -3166,6 +3276,10 @@ protected:
     uints count_inmask(const token& tok, token_hash& hash, uchar msk, uints off)
     {
         const uchar* pc = (const uchar*)tok.ptr();
+        uints n = trail_class(msk).span(pc, off, tok.len(), true);
+        for (; off < n; ++off)
+            hash.inc_char(_casemap[pc[off]]);
+
         for (; off < tok.len(); ++off)
         {
             const uchar* p = pc + off;
@@ -3179,6 +3293,8 @@ protected:
     uints count_intable_nohash(const token& tok, uchar grp, uints off) const
     {
         const uchar* pc = (const uchar*)tok.ptr();
+        off = cclass(grp).span(pc, off, tok.len(), true);
+
         for (; off < tok.len(); ++off)
         {
             uchar c = pc[off];
@@ -3190,6 +3306,8 @@ protected:
     uints count_inmask_nohash(const token& tok, uchar msk, uints off) const
     {
         const uchar* pc = (const uchar*)tok.ptr();
+        off = trail_class(msk).span(pc, off, tok.len(), true);
+
         for (; off < tok.len(); ++off)
         {
             uchar c = pc[off];
@@ -3206,7 +3324,9 @@ protected:
     /// @param off number of leading characters that are already considered belonging to the group
     token scan_group(uchar group, bool ignore, uints off = 0)
     {
-        off = count_intable(_tok, _last.hash, group, off);
+        off = ignore
+            ? count_intable_nohash(_tok, group, off)
+            : count_intable(_tok, _last.hash, group, off);
         if (off >= _tok.len())
         {
             //end of buffer
@@ -3318,6 +3438,7 @@ protected:
             _seqary.add();
             k = (uchar)_seqary.size();
             _abmap[c] |= k << rSEQ;
+            _cclass_valid = false;
         }
 
         return _seqary[k - 1];
@@ -3329,6 +3450,7 @@ protected:
 
         //mark the leading character of trailing token to _abmap
         _abmap[(uchar)trailing.first_char()] |= fSEQ_TRAILING;
+        _cclass_valid = false;
 
         return sob->id;
     }
@@ -3357,11 +3479,13 @@ protected:
             if (c == '\r') {
                 ++newlines;
                 _lines_last = p + 1;
+                _linecut = 0;
             }
             else if (c == '\n') {
                 if (oc != '\r')
                     ++newlines;
                 _lines_last = p + 1;
+                _linecut = 0;
             }
 
             if (p == _rawpos) {
@@ -3392,6 +3516,271 @@ protected:
 
 protected:
 
+    ///Lexer state saved before a streamed operation, to be able to redo it with more input
+    struct stream_point {
+        token tok;
+        token val, outok, intok;
+        int id = 0, termid = 0, state = 0;
+        token_hash hash;
+        charstr tokbuf;                 //< copy of the buffer of a pushed back token
+        bool hasbuf = false;
+        bool valbuf = false;
+        const char* rawpos = 0;
+        dynarray<block_rule*> stack;
+        uints nstrings = 0;
+        int last_string = -1;
+        int pushback = 0;
+    };
+
+    /// @return true if the call should be run through streamed()
+    bool stream_enter() const {
+        return _window && _bin && !_sdepth;
+    }
+
+    ///Run a lexer operation in the streaming mode
+    /// @note the operation is repeated with more data in the window if it reached the end of the window before
+    ///       the end of the stream, so that tokens, strings and blocks can straddle the window boundary
+    template <class Fn>
+    auto streamed(Fn fn) -> decltype(fn())
+    {
+        if (_tok.is_null())
+            stream_start();
+        else {
+            //views of the previous token don't have to be kept anymore
+            _strings.reset();
+
+            if (!_seof && _tok.len() < _window / 2)
+                stream_refill(0);
+        }
+
+        for (;;)
+        {
+            stream_save();
+            _starved = false;
+            ++_sdepth;
+
+            try {
+                decltype(fn()) r = fn();
+                --_sdepth;
+
+                if (_seof || (!_starved && _tok.len() >= _guard))
+                    return r;
+            }
+            catch (lexception& e) {
+                --_sdepth;
+
+                bool early = e.code == lexception::ERR_STRING_TERMINATED_EARLY
+                    || e.code == lexception::ERR_BLOCK_TERMINATED_EARLY
+                    || e.code == lexception::ERR_UNRECOGNIZED_ESCAPE_SEQ;
+
+                if (_seof || !(early || _starved || _tok.len() < _guard))
+                    throw;
+            }
+
+            //redo with at least twice the data
+            stream_restore();
+            stream_refill(_tok.len() > _guard ? _tok.len() : _guard);
+        }
+    }
+
+    ///Minimal lookahead needed to decide on a token in streaming mode
+    uints stream_guard() const
+    {
+        uints n = 4;                    //longest utf-8 sequence
+
+        for (const sequence* seq : _stbary) {
+            if (seq->leading.len() > n)
+                n = seq->leading.len();
+
+            if (!seq->is_string() && !seq->is_block())
+                continue;
+
+            const stringorblock* sb = static_cast<const stringorblock*>(seq);
+            for (const stringorblock::trail& tr : sb->trailing)
+                if (tr.seq.len() > n)
+                    n = tr.seq.len();
+        }
+
+        for (const escape_rule* er : _escary) {
+            for (const escpair& ep : er->pairs)
+                if (ep.code.len() + 1 > n)
+                    n = ep.code.len() + 1;
+        }
+
+        //some slack for custom escape sequence replacement functions
+        return n + 16;
+    }
+
+    ///Read the initial window from the bound stream
+    void stream_start()
+    {
+        _guard = stream_guard();
+        if (_window < 2 * _guard)
+            _window = 2 * _guard;
+
+        _sbuf.reset();
+        do stream_refill(0);
+        while (!_seof && _sbuf.size() < _guard);
+
+        token tok(_sbuf.ptr(), _sbuf.size());
+
+        static const token BOM = "\xEF\xBB\xBF";
+        if (_utf8 && tok.begins_with(BOM))
+            tok.shift_start(BOM.len());
+        _bomread = true;
+
+        _tok = tok;
+        _last.intok.set_empty(_tok.ptr());
+        _last.outok = _last.intok;
+        _last.val = _last.intok;
+        _rawpos = _rawlast = _lines_processed = _lines_last = _tok.ptr();
+    }
+
+    ///Discard consumed input from the window and read more data from the bound stream
+    /// @param grow minimum number of bytes to read over the remaining data
+    void stream_refill(uints grow)
+    {
+        const char* base = _sbuf.ptr();
+        const char* end = base + _sbuf.size();
+        auto inside = [&](const char* p) { return p && p >= base && p <= end; };
+
+        //find the oldest position that has to be kept
+        const char* keep = _tok.ptr() ? _tok.ptr() : base;
+        auto keep_token = [&](const token& t) {
+            if (inside(t.ptr()) && t.ptr() < keep)
+                keep = t.ptr();
+        };
+
+        if (_pushback) {
+            keep_token(_last.intok);
+            keep_token(_last.outok);
+        }
+        for (const backtrack_point& btp : _btpoint)
+            keep_token(btp.tok);
+
+        if (inside(_lines_processed) && _lines_processed < keep)
+            count_newlines(keep);
+        if (inside(_lines_last) && _lines_last < keep) {
+            _linecut += keep - _lines_last;
+            _lines_last = keep;
+        }
+
+        uints cut = keep - base;
+        uints rem = _sbuf.size() - cut;
+        if (cut)
+            ::memmove(_sbuf.ptr(), keep, rem);
+
+        uints size = rem + grow > _window ? rem + grow : _window;
+        _sbuf.realloc(rem);
+        char* dst = _sbuf.realloc(size) + rem;
+
+        uints len = size - rem;
+        opcd e = _bin->read_raw_any(dst, len);
+        if (e == ersNO_MORE)
+            _seof = true;
+        else if (e != NOERR && e != ersRETRY)
+            throw e;
+
+        _sbuf.realloc(size - len);
+
+        //rebase the pointers into the window
+        const char* nbase = _sbuf.ptr();
+        auto rebase = [&](const char*& p) {
+            if (inside(p))
+                p = p < keep ? nbase : nbase + (p - keep);
+        };
+        auto rebase_token = [&](token& t) {
+            if (inside(t._ptr) && inside(t._pte)) {
+                rebase(t._ptr);
+                rebase(t._pte);
+            }
+        };
+
+        if (_tok.ptr())
+            _tok.set(nbase + (_tok.ptr() - keep), nbase + _sbuf.size());
+        _orig.set(nbase, nbase + _sbuf.size());
+
+        rebase(_rawpos);
+        rebase(_rawlast);
+        rebase(_lines_last);
+        rebase(_lines_processed);
+
+        rebase_token(_last.val);
+        rebase_token(_last.outok);
+        rebase_token(_last.intok);
+
+        for (backtrack_point& btp : _btpoint)
+            rebase_token(btp.tok);
+    }
+
+    ///Save lexer state before a streamed operation
+    void stream_save()
+    {
+        stream_point& s = _spoint;
+
+        s.tok = _tok;
+        s.val = _last.val;
+        s.outok = _last.outok;
+        s.intok = _last.intok;
+        s.id = _last.id;
+        s.termid = _last.termid;
+        s.state = _last.state;
+        s.hash = _last.hash;
+
+        s.hasbuf = !_last.tokbuf.is_empty();
+        s.valbuf = s.hasbuf && _last.val.ptr() == _last.tokbuf.ptr();
+        if (_pushback && s.hasbuf)
+            s.tokbuf = _last.tokbuf;
+
+        s.rawpos = _rawpos;
+
+        block_rule** stack = s.stack.realloc(_stack.size());
+        xmemcpy(stack, _stack.ptr(), _stack.byte_size());
+
+        s.nstrings = _strings.size();
+        s.last_string = _last_string;
+        s.pushback = _pushback;
+    }
+
+    ///Restore lexer state saved before a streamed operation
+    void stream_restore()
+    {
+        stream_point& s = _spoint;
+
+        _tok = s.tok;
+        _last.val = s.val;
+        _last.outok = s.outok;
+        _last.intok = s.intok;
+        _last.id = s.id;
+        _last.termid = s.termid;
+        _last.state = s.state;
+        _last.hash = s.hash;
+
+        //the token buffer is either kept as a copy (pushed back token), or was moved into _strings
+        _last.tokbuf.reset();
+        if (s.pushback && s.hasbuf)
+            _last.tokbuf.swap(s.tokbuf);
+        else if (s.hasbuf && _strings.size() > s.nstrings)
+            _last.tokbuf.swap(_strings[s.nstrings]);
+        else if (s.hasbuf)
+            _last.val = _last.intok;
+
+        if (s.valbuf && _last.tokbuf)
+            _last.val = _last.tokbuf;
+
+        _rawpos = s.rawpos;
+
+        block_rule** stack = _stack.realloc(s.stack.size());
+        xmemcpy(stack, s.stack.ptr(), s.stack.byte_size());
+
+        _strings.realloc(s.nstrings);
+        _last_string = s.last_string;
+        _pushback = s.pushback;
+
+        _err = 0;
+        _errtext.reset();
+    }
+
     struct alias_record {
         charstr alias;
         charstr target;
@@ -3423,6 +3812,17 @@ protected:
     dynarray<uchar> _trail;             //< mask arrays for customized group's trailing set
     uint _ntrails;                      //< number of trailing sets defined
 
+    ///Vectorized character classes, besides the groups
+    enum {
+        CC_ESCAPE = 16,                 //< escape characters and leading characters of trailing sequences
+        CC_LEADING,                     //< leading characters of sequences and trailing sequences
+        CC_TRAIL,                       //< first of 8 trailing sets
+        CC_COUNT = CC_TRAIL + 8,
+    };
+
+    mutable char_class _cclass[CC_COUNT];
+    mutable bool _cclass_valid = false; //< character classes match current rules
+
     typedef dynarray<sequence*> TAsequence;
     dynarray<TAsequence> _seqary;       //< sequence (or string or block) groups with common leading character
 
@@ -3455,9 +3855,19 @@ protected:
     const char* _rawlast;               //< line on which the last token lies
     int _rawline;                       //< original starting line of last token
 
+    uints _linecut;                     //< characters of the current line already discarded from the window
+
     token _tok;                         //< source string to process, can point to an external source or into the _binbuf
     charstr _buf;
-    binstream* _bin;                    //< source stream
+    binstream* _bin = 0;                //< source stream
+
+    uints _window = 0;                  //< streaming window size, 0 if the whole input is read at once
+    uints _guard = 0;                   //< lookahead needed to decide on a token in the streaming mode
+    uint _sdepth;                       //< nesting level of streamed operations
+    bool _seof;                         //< bound stream has no more data
+    bool _starved;                      //< streamed operation needed more data than available in the window
+    dynarray<char> _sbuf;               //< streaming window
+    stream_point _spoint;               //< state saved before a streamed operation
 
     token _orig;                        //< original token
     dynarray<charstr> _strings;         //< parsed strings
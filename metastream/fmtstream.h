@@ -146,6 +146,11 @@ public:
         return _binw->write_raw(p, len);
     }
 
+    virtual opcd write_rawv(const binstream_iovec* iov, uints niov, uints& len) override
+    {
+        return _binw->write_rawv(iov, niov, len);
+    }
+
     virtual opcd read_raw(void* p, uints& len) override
     {
         return _binr->read_raw(p, len);
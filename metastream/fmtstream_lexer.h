@@ -100,10 +100,21 @@ public:
         fmtstream::bind(bin, io);
         
         if(_binr)
-            _tokenizer.bind( *_binr );
+            _tokenizer.bind( *_binr, _window );
         return 0;
     }
 
+    ///Set size of the sliding window the input is streamed through, 0 to read whole input at once
+    /// @note tokens are valid only until the next token is read in the streaming mode
+    void set_stream_window( uints window )
+    {
+        _window = window;
+        if(_binr)
+            _tokenizer.bind( *_binr, _window );
+    }
+
+    uints get_stream_window() const { return _window; }
+
     virtual void acknowledge( bool eat = false )
     {
         if( !eat && !_tokenizer.end() && !_tokenizer.next().end() )
@@ -139,6 +150,7 @@ public:
 protected:
 
     fmt_lexer _tokenizer;               //< lexer for the format
+    uints _window = 0;                  //< streaming window size, 0 to read the whole input at once
 };
 
 
@@ -0,0 +1,1060 @@
+#pragma once
+
+/* ***** BEGIN LICENSE BLOCK *****
+* Version: MPL 1.1/GPL 2.0/LGPL 2.1
+*
+* The contents of this file are subject to the Mozilla Public License Version
+* 1.1 (the "License"); you may not use this file except in compliance with
+* the License. You may obtain a copy of the License at
+* http://www.mozilla.org/MPL/
+*
+* Software distributed under the License is distributed on an "AS IS" basis,
+* WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+* for the specific language governing rights and limitations under the
+* License.
+*
+* The Original Code is COID/comm module.
+*
+* The Initial Developer of the Original Code is
+* Outerra.
+* Portions created by the Initial Developer are Copyright (C) 2026
+* the Initial Developer. All Rights Reserved.
+*
+* Contributor(s):
+* Brano Kemen
+*
+* Alternatively, the contents of this file may be used under the terms of
+* either the GNU General Public License Version 2 or later (the "GPL"), or
+* the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+* in which case the provisions of the GPL or the LGPL are applicable instead
+* of those above. If you wish to allow use of your version of this file only
+* under the terms of either the GPL or the LGPL, and not to allow others to
+* use your version of this file under the terms of the MPL, indicate your
+* decision by deleting the provisions above and replace them with the notice
+* and other provisions required by the GPL or the LGPL. If you do not delete
+* the provisions above, a recipient may use your version of this file under
+* the terms of any one of the MPL, the GPL or the LGPL.
+*
+* ***** END LICENSE BLOCK ***** */
+
+#ifndef __COID_COMM_FMTSTREAMBIN__HEADER_FILE__
+#define __COID_COMM_FMTSTREAMBIN__HEADER_FILE__
+
+#include "fmtstream.h"
+#include "../binstream/binstreambuf.h"
+#include "../hash/hashmap.h"
+#include "../bitrange.h"
+#include "../range.h"
+
+COID_NAMESPACE_BEGIN
+
+////////////////////////////////////////////////////////////////////////////////
+///Compact binary formatting stream with random access to the written data
+/**
+    Structs are written as offset tables and arrays as element counts followed by the elements,
+    so that a written document can be accessed in place (for example from a memory mapped file)
+    through fmtstreambin::node, without deserializing it.
+
+    All values are little endian and aligned to their natural alignment. A value is written
+    before the struct or array that references it, the root is referenced from the trailer:
+
+        header          "CBIN", uint32 version
+        slot            uint32 value, tag; primitive values of up to 4 bytes are stored inline in
+                        the value field, other values are referenced by their offset
+        struct          uint32 count, { uint32 name, slot }[count]
+        array           uint32 count, tag of elements, elements (offsets for compound elements)
+        string, name    T_CHAR array, with a terminating zero not included in the count
+        trailer         root slot, uint32 document size
+
+    When read back through metastream the members are looked up by name, so that reordered,
+    missing (defaulted) and obsolete members behave the same as with the text formats. Numeric
+    values are converted if the member type changed.
+**/
+class fmtstreambin : public fmtstream
+{
+public:
+
+    static const uint32 VERSION = 1;
+
+    ///Type tag of a stored value
+    struct tag
+    {
+        uint16 size = 0;                //< byte size of a primitive value or an array element
+        uint8 type = bstype::kind::T_COMPOUND;  //< bstype::kind type, T_COMPOUND for structs
+        uint8 flags = 0;
+
+        enum : uint8 {
+            fARRAY = 1,
+        };
+
+        tag() {}
+        tag(uint16 size, uint8 type, uint8 flags = 0) : size(size), type(type), flags(flags) {}
+
+        bool is_array() const { return (flags & fARRAY) != 0; }
+        bool is_struct() const { return !is_array() && type == bstype::kind::T_COMPOUND; }
+        bool is_primitive() const { return !is_array() && type != bstype::kind::T_COMPOUND; }
+
+        ///Primitive values up to 4 bytes are stored inline in slots
+        bool is_inline() const { return is_primitive() && size <= 4; }
+
+        ///@return byte size of the value when stored as an array element
+        uint stride() const { return is_primitive() ? size : 4; }
+
+        ///@return alignment of the value when stored as an array element
+        uint align() const {
+            uint s = stride();
+            return s >= 8 ? 8 : (s >= 4 ? 4 : (s >= 2 ? 2 : 1));
+        }
+
+        bool operator == (const tag& t) const {
+            return size == t.size && type == t.type && flags == t.flags;
+        }
+    };
+
+    ///Value reference in struct tables and in the trailer
+    struct slot {
+        uint32 value;
+        tag t;
+    };
+
+    ///Struct table entry
+    struct entry {
+        uint32 name;
+        slot s;
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////
+    ///Reference to a value in a compact binary document, accessed in place
+    class node
+    {
+    public:
+
+        node() {}
+
+        bool is_valid() const { return _ptr != 0; }
+        bool is_struct() const { return _ptr && _tag.is_struct(); }
+        bool is_array() const { return _ptr && _tag.is_array(); }
+        bool is_primitive() const { return _ptr && _tag.is_primitive(); }
+
+        const tag& value_tag() const { return _tag; }
+
+        ///@return number of struct members or array elements
+        uint count() const {
+            return is_struct() || is_array() ? *reinterpret_cast<const uint32*>(_ptr) : 0;
+        }
+
+        ///@return tag of array elements
+        tag element_tag() const {
+            return is_array() ? *reinterpret_cast<const tag*>(_ptr + 4) : tag();
+        }
+
+        ///@return name of the i-th struct member
+        token name(uint i) const
+        {
+            if (!is_struct() || i >= count())
+                return token();
+
+            return make(_doc, _len, slot{table()[i].name, tag(1, type::T_CHAR, tag::fARRAY)}, 0).str();
+        }
+
+        ///@return the i-th struct member
+        node member(uint i) const
+        {
+            if (!is_struct() || i >= count())
+                return node();
+
+            const entry& e = table()[i];
+            return make(_doc, _len, e.s, reinterpret_cast<const uint8*>(&e.s.value));
+        }
+
+        ///@return index of struct member with given name, or UMAX32 if not found
+        /// @param hint index where to start the search (the next member when reading sequentially)
+        uint find(const token& name, uint hint = 0) const
+        {
+            uint n = count();
+            if (hint >= n)
+                hint = 0;
+
+            for (uint i = hint; i < n; ++i)
+                if (this->name(i) == name)
+                    return i;
+
+            for (uint i = 0; i < hint; ++i)
+                if (this->name(i) == name)
+                    return i;
+
+            return UMAX32;
+        }
+
+        ///@return struct member with given name, invalid node if not found
+        node member(const token& name) const {
+            uint i = find(name);
+            return i == UMAX32 ? node() : member(i);
+        }
+
+        node operator [] (const token& name) const { return member(name); }
+
+        ///@return the i-th array element
+        node element(uint i) const
+        {
+            if (!is_array() || i >= count())
+                return node();
+
+            tag et = element_tag();
+            const uint8* data = _ptr + 8;
+
+            if (et.is_primitive()) {
+                node r;
+                r._doc = _doc;
+                r._len = _len;
+                r._ptr = data + uints(i) * et.size;
+                r._tag = et;
+                return r;
+            }
+
+            return make(_doc, _len, slot{reinterpret_cast<const uint32*>(data)[i], et}, 0);
+        }
+
+        ///@return string content (zero terminated) of a character array
+        token str() const
+        {
+            if (!is_array() || element_tag().type != type::T_CHAR)
+                return token();
+
+            return token(reinterpret_cast<const char*>(_ptr + 8), count());
+        }
+
+        ///@return pointer to the primitive value in place, if it's stored as type T
+        template <class T>
+        const T* ptr() const
+        {
+            return is_primitive() && _tag.type == bstype::t_type<T>().type && _tag.size == sizeof(T)
+                ? reinterpret_cast<const T*>(_ptr)
+                : 0;
+        }
+
+        ///@return primitive array content in place, if the elements are stored as type T
+        template <class T>
+        range<const T> data() const
+        {
+            tag et = element_tag();
+            if (!is_array() || et.type != bstype::t_type<T>().type || et.size != sizeof(T))
+                return range<const T>();
+
+            return range<const T>(reinterpret_cast<const T*>(_ptr + 8), count());
+        }
+
+        ///@return primitive value converted to type T, or the default value if not present or not convertible
+        template <class T>
+        T get(const T& defval = T()) const
+        {
+            T v;
+            return read_value(&v, bstype::t_type<T>()) ? v : defval;
+        }
+
+        ///Read primitive value into given type, converting between numeric types
+        /// @return false if the value is not primitive or not convertible
+        bool read_value(void* dst, type t) const
+        {
+            if (!is_primitive())
+                return false;
+
+            if (_tag.type == t.type && _tag.size == t.get_size()) {
+                ::memcpy(dst, _ptr, _tag.size);
+                return true;
+            }
+
+            bool fsrc = _tag.type == type::T_FLOAT;
+            int64 i = 0;
+            double d = 0;
+
+            switch (_tag.type) {
+            case type::T_INT:
+            case type::T_CHAR:
+                switch (_tag.size) {
+                case 1: i = *reinterpret_cast<const int8*>(_ptr); break;
+                case 2: i = *reinterpret_cast<const int16*>(_ptr); break;
+                case 4: i = *reinterpret_cast<const int32*>(_ptr); break;
+                case 8: i = *reinterpret_cast<const int64*>(_ptr); break;
+                default: return false;
+                }
+                break;
+            case type::T_UINT:
+            case type::T_BOOL:
+                switch (_tag.size) {
+                case 1: i = *reinterpret_cast<const uint8*>(_ptr); break;
+                case 2: i = *reinterpret_cast<const uint16*>(_ptr); break;
+                case 4: i = *reinterpret_cast<const uint32*>(_ptr); break;
+                case 8: i = int64(*reinterpret_cast<const uint64*>(_ptr)); break;
+                default: return false;
+                }
+                break;
+            case type::T_FLOAT:
+                switch (_tag.size) {
+                case 4: d = *reinterpret_cast<const float*>(_ptr); break;
+                case 8: d = *reinterpret_cast<const double*>(_ptr); break;
+                default: return false;
+                }
+                break;
+            default:
+                return false;
+            }
+
+            switch (t.type) {
+            case type::T_INT:
+            case type::T_UINT:
+            case type::T_CHAR:
+                if (fsrc)
+                    i = int64(d);
+                switch (t.get_size()) {
+                case 1: *static_cast<int8*>(dst) = int8(i); break;
+                case 2: *static_cast<int16*>(dst) = int16(i); break;
+                case 4: *static_cast<int32*>(dst) = int32(i); break;
+                case 8: *static_cast<int64*>(dst) = i; break;
+                default: return false;
+                }
+                break;
+            case type::T_BOOL:
+                if (t.get_size() != sizeof(bool))
+                    return false;
+                *static_cast<bool*>(dst) = fsrc ? d != 0 : i != 0;
+                break;
+            case type::T_FLOAT:
+                if (!fsrc)
+                    d = _tag.type == type::T_UINT ? double(uint64(i)) : double(i);
+                switch (t.get_size()) {
+                case 4: *static_cast<float*>(dst) = float(d); break;
+                case 8: *static_cast<double*>(dst) = d; break;
+                default: return false;
+                }
+                break;
+            default:
+                return false;
+            }
+
+            return true;
+        }
+
+    private:
+
+        friend class fmtstreambin;
+
+        const entry* table() const {
+            return reinterpret_cast<const entry*>(_ptr + 4);
+        }
+
+        ///Create node referenced by a slot, checking that it lies within the document
+        /// @param inl address of the slot value field, for inline values
+        static node make(const uint8* doc, uints len, const slot& s, const uint8* inl)
+        {
+            node r;
+            const tag& t = s.t;
+
+            if (t.is_inline()) {
+                if (!inl)
+                    return r;
+                r._ptr = inl;
+            }
+            else {
+                uint64 ofs = s.value;
+                uint64 size;
+
+                if (t.is_primitive())
+                    size = t.size;
+                else if (ofs + 8 > len || (ofs & 3) != 0)
+                    return r;
+                else if (t.is_struct())
+                    size = 4 + uint64(*reinterpret_cast<const uint32*>(doc + ofs)) * sizeof(entry);
+                else {
+                    const tag& et = *reinterpret_cast<const tag*>(doc + ofs + 4);
+                    size = 8 + uint64(*reinterpret_cast<const uint32*>(doc + ofs)) * et.stride()
+                        + (et.type == type::T_CHAR ? 1 : 0);
+                }
+
+                if (ofs + size > len)
+                    return r;
+
+                r._ptr = doc + ofs;
+            }
+
+            r._doc = doc;
+            r._len = len;
+            r._tag = t;
+            return r;
+        }
+
+        const uint8* _doc = 0;          //< document start
+        uints _len = 0;                 //< document size
+        const uint8* _ptr = 0;          //< primitive value, struct table or array header
+        tag _tag;
+    };
+
+    ///Get the root value of a compact binary document
+    /// @param doc document data, should be 8 byte aligned
+    /// @return invalid node if the data is not a valid compact binary document
+    static node document_root(const token& doc)
+    {
+        const uint8* p = reinterpret_cast<const uint8*>(doc.ptr());
+        uints len = doc.len();
+
+        if (len < 8 + sizeof(slot) + 4 || len > UMAX32 || !doc.begins_with("CBIN"))
+            return node();
+        if (*reinterpret_cast<const uint32*>(p + 4) != VERSION)
+            return node();
+
+        const uint8* trailer = p + len - sizeof(slot) - 4;
+        if (*reinterpret_cast<const uint32*>(trailer + sizeof(slot)) != len)
+            return node();
+
+        const slot& s = *reinterpret_cast<const slot*>(trailer);
+        return node::make(p, len, s, reinterpret_cast<const uint8*>(&s.value));
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    fmtstreambin() {}
+    fmtstreambin(binstream& b) { init(&b, &b); }
+    fmtstreambin(binstream* br, binstream* bw) { init(br, bw); }
+
+    ~fmtstreambin() {}
+
+    virtual token fmtstream_name() override { return "fmtstreambin"; }
+    virtual void fmtstream_file_name(const token& file_name) override {}
+
+    virtual uint binstream_attributes(bool in0out1) const override { return 0; }
+
+    ///Read the next document directly from given memory, instead of the bound input stream
+    /// @note the memory has to persist until the document is read
+    void set_input(const token& doc)
+    {
+        reset_read_state();
+        _rdoc = doc;
+    }
+
+    virtual opcd bind(binstream& bin, int io = 0) override
+    {
+        if (io <= 0)
+            reset_read_state();
+        if (io >= 0)
+            reset_write_state();
+
+        return fmtstream::bind(bin, io);
+    }
+
+    virtual void flush() override
+    {
+        if (!_binw)
+            return;
+
+        if (_wdepth == 0 && _wroot_set) {
+            //trailer referencing the root value
+            uint32 size = uint32(align_pos(4) + sizeof(slot) + 4);
+            emit(&_wroot, sizeof(slot), 4);
+            emit(&size, 4, 1);
+
+            reset_write_state();
+        }
+
+        flush_buffer();
+        _binw->flush();
+    }
+
+    virtual void acknowledge(bool eat = false) override
+    {
+        bool streamed = _rstreamed;
+        reset_read_state();
+
+        //finish the packet on handshaking streams
+        if (streamed)
+            _binr->acknowledge(eat);
+    }
+
+    virtual void reset_read() override
+    {
+        reset_read_state();
+        fmtstream::reset_read();
+    }
+
+    virtual void reset_write() override
+    {
+        reset_write_state();
+        fmtstream::reset_write();
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////
+    virtual opcd write_key(const token& key, int kmember) override
+    {
+        wframe* f = top_frame();
+        if (!f || f->array)
+            return ersIMPROPER_STATE "key outside of a struct";
+
+        entry* e = f->entries.add();
+        e->name = name_offset(key);
+        e->s.value = 0;
+        e->s.t = tag();
+        return 0;
+    }
+
+    virtual opcd read_key(charstr& key, int kmember, const token& expected_key) override
+    {
+        opcd e = load_input();
+        if (e != NOERR)
+            return e;
+
+        rframe* f = _rstack.last();
+        if (!f || !f->n.is_struct())
+            return ersIMPROPER_STATE "key outside of a struct";
+
+        uint n = f->n.count();
+        uint i;
+
+        if (n <= 64) {
+            //look the expected member up directly, fall back to the first unread one
+            i = expected_key.is_empty() ? UMAX32 : f->n.find(expected_key, f->next);
+
+            if (i == UMAX32 || (f->seen >> i) & 1) {
+                uint64 left = ~f->seen & (n == 64 ? UMAX64 : (uint64(1) << n) - 1);
+                if (!left)
+                    return ersNO_MORE;
+                i = lsb_bit_set(left);
+            }
+            f->seen |= uint64(1) << i;
+        }
+        else {
+            if (f->next >= n)
+                return ersNO_MORE;
+            i = f->next;
+        }
+
+        f->cur = i;
+        f->next = i + 1;
+        key = f->n.name(i);
+        return 0;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////
+    virtual opcd write(const void* p, type t) override
+    {
+        if (_wpos == 0 && _bufw.len() == 0)
+            write_header();
+
+        if (t.type == type::T_SEPARATOR)
+            return 0;
+
+        if (t.type == type::T_STRUCTBGN) {
+            push_frame(false);
+            return 0;
+        }
+
+        if (t.type == type::T_STRUCTEND)
+        {
+            wframe* f = top_frame();
+            if (!f || f->array)
+                return ersIMPROPER_STATE "unbalanced struct end";
+
+            uint32 n = f->entries.size();
+            uint32 pos = emit(&n, 4, 4);
+            emit(f->entries.ptr(), n * sizeof(entry), 1);
+
+            --_wdepth;
+            return put_ref(pos, tag());
+        }
+
+        if (t.is_array_start())
+        {
+            wframe* f = push_frame(true);
+            f->elem = tag(0, t.type == type::T_KEY ? uint8(type::T_CHAR) : t.type);
+            f->count = t.get_count(p);
+            return 0;
+        }
+
+        if (t.is_array_end())
+        {
+            wframe* f = top_frame();
+            if (!f || !f->array)
+                return ersIMPROPER_STATE "unbalanced array end";
+
+            uint32 pos = f->ofs;
+            if (pos == UMAX32) {
+                if (f->elem.is_primitive())
+                    pos = emit_array(f->elem, f->elem.size ? f->data.size() / f->elem.size : 0, f->data.ptr());
+                else
+                    pos = emit_array(f->elem, f->refs.size(), f->refs.ptr());
+            }
+
+            tag at = f->elem;
+            at.flags |= tag::fARRAY;
+
+            --_wdepth;
+            return put_ref(pos, at);
+        }
+
+        if (t.is_no_size())
+            return 0;
+
+        return put_primitive(p, tag(t.get_size(), t.type == type::T_KEY ? uint8(type::T_CHAR) : t.type));
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////
+    virtual opcd read(void* p, type t) override
+    {
+        opcd e = load_input();
+        if (e != NOERR)
+            return e;
+
+        if (t.type == type::T_SEPARATOR)
+            return 0;
+
+        if (t.type == type::T_STRUCTEND) {
+            rframe* f = _rstack.last();
+            if (!f || !f->n.is_struct())
+                return ersIMPROPER_STATE "unbalanced struct end";
+            _rstack.pop();
+            return 0;
+        }
+
+        if (t.is_array_end()) {
+            rframe* f = _rstack.last();
+            if (!f || !f->n.is_array())
+                return ersIMPROPER_STATE "unbalanced array end";
+            _rstack.pop();
+            return 0;
+        }
+
+        node v;
+        e = current_node(v);
+        if (e != NOERR)
+            return e;
+
+        if (t.type == type::T_STRUCTBGN)
+        {
+            if (!v.is_struct())
+                return ersMISMATCHED "expected struct";
+
+            rframe* f = _rstack.add();
+            f->n = v;
+            return 0;
+        }
+
+        if (t.is_array_start())
+        {
+            if (!v.is_array())
+                return ersMISMATCHED "expected array";
+
+            rframe* f = _rstack.add();
+            f->n = v;
+            t.set_count(v.count(), p);
+            return 0;
+        }
+
+        if (t.is_no_size())
+            return 0;
+
+        return v.read_value(p, t) ? opcd(0) : ersMISMATCHED "incompatible value type";
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////
+    virtual opcd write_array_separator(type t, uchar end) override
+    {
+        return 0;
+    }
+
+    virtual opcd read_array_separator(type t) override
+    {
+        rframe* f = _rstack.last();
+        if (!f || !f->n.is_array())
+            return ersIMPROPER_STATE "array separator outside of an array";
+
+        if (f->next >= f->n.count())
+            return ersNO_MORE;
+
+        f->cur = f->next++;
+        return 0;
+    }
+
+    virtual opcd write_array_content(binstream_container_base& c, uints* count, metastream* m) override
+    {
+        type t = c._type;
+        if (!t.is_primitive())
+            return write_compound_array_content(c, count, m);
+
+        wframe* f = top_frame();
+        if (!f || !f->array)
+            return ersIMPROPER_STATE "array content outside of an array";
+
+        tag et(t.get_size(), t.type == type::T_KEY ? uint8(type::T_CHAR) : t.type);
+        uints n = c.count();
+
+        if (c.is_continuous() && n != UMAXS && f->data.size() == 0) {
+            //the whole array can be written right away
+            f->elem = et;
+            f->ofs = emit_array(et, n, n ? c.extract(n) : 0);
+            *count = n;
+            return 0;
+        }
+
+        uints k = 0;
+        for (; n > 0; --n, ++k) {
+            const void* p = c.extract(1);
+            if (!p)
+                break;
+
+            opcd e = put_primitive(p, et);
+            if (e != NOERR)
+                return e;
+        }
+
+        *count = k;
+        return 0;
+    }
+
+    virtual opcd read_array_content(binstream_container_base& c, uints n, uints* count, metastream* m) override
+    {
+        type t = c._type;
+        if (!t.is_primitive())
+            return read_compound_array_content(c, n, count, m);
+
+        rframe* f = _rstack.last();
+        if (!f || !f->n.is_array())
+            return ersIMPROPER_STATE "array content outside of an array";
+
+        const node& a = f->n;
+        uint na = a.count() - f->next;
+        if (n == UMAXS || n > na)
+            n = na;
+
+        tag et = a.element_tag();
+
+        if (c.is_continuous() && et.type == t.type && et.size == t.get_size()) {
+            if (n)
+                ::memcpy(c.insert(n, 0), a._ptr + 8 + uints(f->next) * et.size, n * et.size);
+        }
+        else {
+            for (uint i = 0; i < n; ++i) {
+                void* p = c.insert(1, 0);
+                if (!p)
+                    return ersNOT_ENOUGH_MEM;
+                if (!a.element(f->next + i).read_value(p, t.get_array_element()))
+                    return ersMISMATCHED "incompatible array element type";
+            }
+        }
+
+        f->next += uint(n);
+        *count = n;
+        return 0;
+    }
+
+    ///Raw writes are accepted only as a primitive array content (when metastream writes from its cache)
+    virtual opcd write_raw(const void* p, uints& len) override
+    {
+        wframe* f = top_frame();
+        if (!f || !f->array || !f->elem.is_primitive())
+            return ersNOT_IMPLEMENTED;
+
+        if (f->elem.size == 0) {
+            if (f->count == 0 || f->count == UMAXS)
+                return ersIMPROPER_STATE "unknown array element size";
+            f->elem.size = uint16(len / f->count);
+        }
+
+        ::memcpy(f->data.add(len), p, len);
+        len = 0;
+        return 0;
+    }
+
+    ///Raw reads are accepted only as a primitive array content (when metastream reads into its cache)
+    /// @note the element size is derived from the requested size and the array count
+    virtual opcd read_raw(void* p, uints& len) override
+    {
+        rframe* f = _rstack.last();
+        if (!f || !f->n.is_array() || !f->n.element_tag().is_primitive())
+            return ersNOT_IMPLEMENTED;
+
+        const node& a = f->n;
+        tag et = a.element_tag();
+        uint na = a.count() - f->next;
+        if (len == 0)
+            return 0;
+        if (na == 0 || len % na)
+            return ersMISMATCHED "array size mismatch";
+
+        uints size = len / na;
+        if (size == et.size)
+            ::memcpy(p, a._ptr + 8 + uints(f->next) * et.size, len);
+        else {
+            type t(et.type, ushort(size));
+            for (uint i = 0; i < na; ++i)
+                if (!a.element(f->next + i).read_value(static_cast<uint8*>(p) + i * size, t))
+                    return ersMISMATCHED "incompatible array element type";
+        }
+
+        f->next += na;
+        len = 0;
+        return 0;
+    }
+
+protected:
+
+    ///Struct or array being written
+    struct wframe
+    {
+        bool array = false;
+        tag elem;                       //< array element tag
+        uints count = UMAXS;            //< array size announced at the array start
+        uint32 ofs = UMAX32;            //< offset of an array written directly
+
+        dynarray<entry> entries;        //< struct members
+        dynarray<uint32> refs;          //< offsets of compound array elements
+        dynarray<uint8> data;           //< primitive array elements
+    };
+
+    ///Struct or array being read
+    struct rframe
+    {
+        node n;
+        uint next = 0;                  //< next member or element to read
+        uint cur = UMAX32;              //< current member or element
+        uint64 seen = 0;                //< members already read, for structs with up to 64 members
+    };
+
+    wframe* top_frame() {
+        return _wdepth ? &_wstack[_wdepth - 1] : 0;
+    }
+
+    ///Push a frame, reusing the buffers of the previously used ones
+    wframe* push_frame(bool array)
+    {
+        if (_wdepth == _wstack.size())
+            _wstack.add();
+
+        wframe* f = &_wstack[_wdepth++];
+        f->array = array;
+        f->elem = tag();
+        f->count = UMAXS;
+        f->ofs = UMAX32;
+        f->entries.reset();
+        f->refs.reset();
+        f->data.reset();
+        return f;
+    }
+
+    ///Assign a value written elsewhere to the current member, array element or root
+    opcd put_ref(uint32 pos, const tag& t)
+    {
+        wframe* f = top_frame();
+        if (!f) {
+            _wroot.value = pos;
+            _wroot.t = t;
+            _wroot_set = true;
+        }
+        else if (f->array) {
+            if (f->refs.size() == 0 && f->data.size() == 0)
+                f->elem = t;
+            else if (!(f->elem == t) && !(f->elem.is_array() && t.is_array()))
+                return ersMISMATCHED "mixed array element types";
+            *f->refs.add() = pos;
+        }
+        else {
+            if (f->entries.size() == 0)
+                return ersIMPROPER_STATE "value without a key";
+            f->entries.last()->s.value = pos;
+            f->entries.last()->s.t = t;
+        }
+        return 0;
+    }
+
+    ///Write primitive value to the current member, array element or root
+    opcd put_primitive(const void* p, const tag& t)
+    {
+        wframe* f = top_frame();
+        if (f && f->array) {
+            if (f->data.size() == 0 && f->refs.size() == 0)
+                f->elem = t;
+            else if (!(f->elem == t))
+                return ersMISMATCHED "mixed array element types";
+            ::memcpy(f->data.add(t.size), p, t.size);
+            return 0;
+        }
+
+        slot s;
+        s.t = t;
+        s.value = 0;
+
+        if (t.is_inline())
+            ::memcpy(&s.value, p, t.size);
+        else
+            s.value = emit(p, t.size, t.align());
+
+        if (!f) {
+            _wroot = s;
+            _wroot_set = true;
+        }
+        else {
+            if (f->entries.size() == 0)
+                return ersIMPROPER_STATE "value without a key";
+            f->entries.last()->s = s;
+        }
+        return 0;
+    }
+
+    uint32 name_offset(const token& key)
+    {
+        const uint32* pos = _names.find_value(key);
+        if (pos)
+            return *pos;
+
+        uint32 ofs = emit_array(tag(1, type::T_CHAR), key.len(), key.ptr());
+        _names.insert_key_value(key, ofs);
+        return ofs;
+    }
+
+    void write_header()
+    {
+        uint32 version = VERSION;
+        emit("CBIN", 4, 1);
+        emit(&version, 4, 1);
+    }
+
+    uints align_pos(uint align) const {
+        return (_wpos + align - 1) & ~uints(align - 1);
+    }
+
+    ///Append data to the document
+    /// @return offset of the data in the document
+    uint32 emit(const void* p, uints len, uint align)
+    {
+        uints pos = align_pos(align);
+        if (pos + len > UMAX32)
+            throw ersOUT_OF_RANGE "compact binary document too large";
+
+        if (pos > _wpos)
+            _bufw.appendn(pos - _wpos, 0);
+
+        if (len >= 8192) {
+            flush_buffer();
+            uints n = len;
+            opcd e = _binw->write_raw(p, n);
+            if (e != NOERR)
+                throw e;
+        }
+        else {
+            _bufw.add_from(static_cast<const char*>(p), len);
+            if (_bufw.len() >= 8192)
+                flush_buffer();
+        }
+
+        _wpos = pos + len;
+        return uint32(pos);
+    }
+
+    ///Append array header and elements
+    uint32 emit_array(const tag& et, uints n, const void* data)
+    {
+        //align the header so that the elements following it are aligned as well
+        uint32 hdr[2] = {uint32(n), 0};
+        ::memcpy(hdr + 1, &et, sizeof(tag));
+
+        uint32 pos = emit(hdr, sizeof(hdr), et.align() > 4 ? et.align() : 4);
+        if (n)
+            emit(data, n * et.stride(), 1);
+        if (et.type == type::T_CHAR && et.is_primitive())
+            emit("", 1, 1);
+
+        return pos;
+    }
+
+    void flush_buffer()
+    {
+        uints len = _bufw.len();
+        if (len) {
+            opcd e = _binw->write_raw(_bufw.ptr(), len);
+            _bufw.reset();
+            if (e != NOERR)
+                throw e;
+        }
+    }
+
+    void reset_write_state()
+    {
+        _wpos = 0;
+        _wdepth = 0;
+        _wroot_set = false;
+        _names.clear();
+    }
+
+    void reset_read_state()
+    {
+        _rstate = 0;
+        _rstreamed = false;
+        _rdoc.set_empty();
+        _rstack.reset();
+    }
+
+    ///Make the whole input document available for random access
+    opcd load_input()
+    {
+        if (_rstate)
+            return 0;
+
+        if (_rdoc.is_empty()) {
+            if (!_binr)
+                return ersIMPROPER_STATE "no input stream";
+
+            _rbuf.reset_write();
+            opcd e = _rbuf.transfer_from(*_binr);
+            if (e != NOERR)
+                return e;
+
+            _rstreamed = true;
+
+            _rdoc = _rbuf;
+        }
+
+        _rroot = document_root(_rdoc);
+        if (!_rroot.is_valid())
+            return ersINVALID_TYPE "not a compact binary document";
+
+        _rstate = 1;
+        return 0;
+    }
+
+    ///Get the value the next read applies to: root, current struct member or array element
+    opcd current_node(node& v)
+    {
+        rframe* f = _rstack.last();
+
+        if (!f) {
+            if (_rstate > 1)
+                return ersNO_MORE "root value already read";
+            _rstate = 2;
+            v = _rroot;
+        }
+        else if (f->cur == UMAX32)
+            return ersIMPROPER_STATE "no current member";
+        else
+            v = f->n.is_struct() ? f->n.member(f->cur) : f->n.element(f->cur);
+
+        return v.is_valid() ? opcd(0) : ersSYNTAX_ERROR "invalid document data";
+    }
+
+
+    uints _wpos = 0;                    //< current write offset in the document
+    uint _wdepth = 0;                   //< number of active write frames
+    bool _wroot_set = false;
+    slot _wroot;                        //< root value reference written in the trailer
+    dynarray<wframe> _wstack;
+    hash_map<charstr, uint32, hasher<token>> _names; //< offsets of member names written so far
+
+    int8 _rstate = 0;                   //< 0 input not loaded, 1 loaded, 2 root value read
+    bool _rstreamed = false;            //< input document was read from the bound stream
+    token _rdoc;                        //< input document
+    binstreambuf _rbuf;                 //< input document read from the bound stream
+    node _rroot;
+    dynarray<rframe> _rstack;
+};
+
+static_assert(sizeof(fmtstreambin::tag) == 4, "unexpected tag size");
+static_assert(sizeof(fmtstreambin::entry) == 12, "unexpected struct entry size");
+
+COID_NAMESPACE_END
+
+#endif //__COID_COMM_FMTSTREAMBIN__HEADER_FILE__
@@ -291,10 +291,10 @@ public:
             case type::T_FLOAT:
                 switch (t.get_size()) {
                 case 4:
-                    _bufw.append_float(*(const float*)p, 6);
+                    _bufw.append_shortest(*(const float*)p);
                     break;
                 case 8:
-                    _bufw.append_double(*(const double*)p, 10);
+                    _bufw.append_shortest(*(const double*)p);
                     break;
 
                 default: throw ersSYNTAX_ERROR "unknown type"; break;
@@ -574,15 +574,14 @@ public:
 
             case type::T_FLOAT:
             {
-                double v = tok.todouble_and_shift();
-                if (!tok.is_empty())
-                    return ersSYNTAX_ERROR "unrecognized characters after number";
-
                 switch (t.get_size())
                 {
-                case 4: *(float*)p = (float)v;  break;
-                case 8: *(double*)p = v;  break;
+                case 4: *(float*)p = tok.tofloat_and_shift();  break;
+                case 8: *(double*)p = tok.todouble_and_shift();  break;
                 }
+
+                if (!tok.is_empty())
+                    return ersSYNTAX_ERROR "unrecognized characters after number";
             }
             break;
 
@@ -41,6 +41,7 @@
 #include "../namespace.h"
 #include "../bitrange.h"
 #include "fmtstream_lexer.h"
+#include "json_index.h"
 
 
 
@@ -63,6 +64,20 @@ protected:
     int8 _sesinitw = 0;
     bool _ext_esc_string = false;
 
+    int lexctl = 0;
+    bool _use_index = true;                 //< read plain json documents through the structural index
+    int8 _istate = 0;                       //< input read via: 0 not decided yet, 1 structural index, -1 lexer
+    bool _ipushback = false;                //< last index token was pushed back
+    uints _ipos = 0;                        //< next position in the structural index
+    uints _ilast = 0;                       //< offset of the last index token in the document
+    uints _ibol = 0;                        //< offset of the line start found by the last error report
+    uint _iline = 1;                        //< line number at _ibol
+
+    json_structural_index _index;
+    binstreambuf _ibuf;                     //< input document read from the bound stream
+    token _idoc;                            //< indexed document
+    lexer::lextoken _itok;                  //< last token produced from the structural index
+
 public:
     fmtstreamjson(bool enable_esc_strings, bool utf8 = true) : fmtstream_lexer(utf8)
     {
@@ -138,7 +153,7 @@ public:
         _tokenizer.def_block(".blkcomment", "/*", "*/", ".blkcomment");
 
         //characters that correspond to struct and array control tokens
-        _tokenizer.def_group_single("ctrl", "(){}[],:");
+        lexctl = _tokenizer.def_group_single("ctrl", "(){}[],:");
 
         set_default_separators();
     }
@@ -148,6 +163,92 @@ public:
     uint get_indent() const { return _indent; }
     void set_indent(uint indent) { _indent = indent; }
 
+    ///Enable or disable reading of plain json input through the SIMD structural index
+    /// @note documents using extensions (comments, single quoted strings, escaped strings mode)
+    ///       are always read by the lexer, as well as input streamed through a window (set_stream_window)
+    void set_structural_index(bool enable) { _use_index = enable; }
+    bool get_structural_index() const { return _use_index; }
+
+    virtual opcd bind(binstream& bin, int io = 0) override
+    {
+        if (io <= 0)
+            reset_index();
+
+        return fmtstream_lexer::bind(bin, io);
+    }
+
+    virtual opcd read_raw(void* p, uints& len) override
+    {
+        if (_istate <= 0)
+            return fmtstream_lexer::read_raw(p, len);
+
+        token t = _itok.val;
+
+        if (len != UMAXS && len > t.len())
+            return ersNO_MORE;
+
+        if (t.len() < len)
+            len = t.len();
+        xmemcpy(p, t.ptr(), len);
+        len = 0;
+        return 0;
+    }
+
+    virtual void fmtstream_err(charstr& dst, bool add_context = true) override
+    {
+        if (_istate <= 0)
+            return fmtstream_lexer::fmtstream_err(dst, add_context);
+
+        //locate the last token in the indexed document, continuing from the previous report
+        // since warnings can be reported many times during a single read
+        const char* pos = _idoc.ptr() + _ilast;
+        if (_ibol > _ilast) {
+            _ibol = 0;
+            _iline = 1;
+        }
+
+        const char* bol = _idoc.ptr() + _ibol;
+
+        for (const char* p = bol; p < pos; ++p) {
+            if (*p == '\n') {
+                ++_iline;
+                bol = p + 1;
+            }
+        }
+        _ibol = bol - _idoc.ptr();
+
+        charstr& txt = _tokenizer.prepare_exception(_iline);
+        txt << dst;
+
+        if (add_context) {
+            //same layout as lexer::on_error_suffix
+            token text(bol, _idoc.ptre());
+            text = text.cut_left_group("\r\n");
+            uint col = uint(pos - bol);
+
+            if (text.len() > 80) {
+                int start = int_max(0, int(col - 40));
+                int end = int_min(int(text.len()), start + 80);
+
+                text.shift_end(end - (ints)text.len());
+                text.shift_start(start);
+
+                col -= start;
+            }
+
+            txt << "\n" << text;
+            txt << "\n";
+
+            if (col < text.len()) {
+                txt.appendn(col, ' ');
+                txt << "^\n";
+            }
+        }
+
+        std::swap(dst, txt);
+        txt.reset();
+    }
+
     virtual void flush() override
     {
         if (_binw == NULL)
@@ -174,15 +275,15 @@ public:
     {
         if (!eat)
         {
-            token tok = _tokenizer.next();
+            token tok = next_token();
             if (_sesinitr > 0 && tok != '}')
                 throw ersSYNTAX_ERROR "closing } not found";
 
-            tok = _tokenizer.next();
+            tok = next_token();
             if (tok == ')')
-                tok = _tokenizer.next();
+                tok = next_token();
 
-            if (!_tokenizer.end())
+            if (!input_end())
                 throw ersIO_ERROR "data left in received block";
         }
         reset_read();
@@ -192,6 +293,7 @@ public:
     {
         _tokenizer.reset();
         _sesinitr = 0;
+        reset_index();
     }
 
     virtual void reset_write() override
@@ -300,10 +402,10 @@ public:
             case type::T_FLOAT:
                 switch (t.get_size()) {
                 case 4:
-                    _bufw.append_float(*(const float*)p, 6);
+                    _bufw.append_shortest(*(const float*)p);
                     break;
                 case 8:
-                    _bufw.append_double(*(const double*)p, 10);
+                    _bufw.append_shortest(*(const double*)p);
                     break;
 
                 default: throw ersSYNTAX_ERROR "unknown type"; break;
@@ -380,12 +482,12 @@ public:
     {
         if (!_sesinitr)
         {
-            token tok = _tokenizer.next();
+            token tok = next_token();
             if (tok == '(')
-                tok = _tokenizer.next();
+                tok = next_token();
 
             if (!t.is_struct_start()) {
-                _tokenizer.push_back();
+                push_back_token();
                 _sesinitr = -1;
             }
             else {
@@ -395,7 +497,7 @@ public:
             }
         }
 
-        const lexer::lextoken& tk = _tokenizer.next();
+        const lexer::lextoken& tk = next_token();
         token tok = tk;
 
         opcd e = 0;
@@ -408,20 +510,20 @@ public:
                 if (e == NOERR)
                     t.set_count((t.type == type::T_BINARY) ? tok.len() / 2 : tok.len(), p);
 
-                _tokenizer.push_back();
+                push_back_token();
             }
             else if (t.type == type::T_KEY)
             {
                 if (tk == lexstr || tk == lexstre || tk == lexid)
                     t.set_count(tok.len(), p);
-                else if (tok == char('}') || _tokenizer.end())
+                else if (tok == char('}') || tk.end())
                     e = ersNO_MORE;
                 else
                     e = ersSYNTAX_ERROR "expected identifier";
                 if (e == NOERR)
                     t.set_count(tok.len(), p);
 
-                _tokenizer.push_back();
+                push_back_token();
             }
             else if (t.type == type::T_COMPOUND)
             {/*
@@ -435,7 +537,7 @@ public:
                         else if( s != tok )     //otherwise compare
                             return ersSYNTAX_ERROR "class name mismatch";
                     }
-                    tok = _tokenizer.next();
+                    tok = next_token();
                 }*/
                 e = (tok == char('[')) ? opcd(0) : ersSYNTAX_ERROR "expected [";
             }
@@ -452,7 +554,7 @@ public:
                 if (!(tk == lexstr || tk == lexstre || tk == lexid))
                     return ersSYNTAX_ERROR "expected identifier";
 
-                tok = _tokenizer.next();
+                tok = next_token();
                 e = (tok == char(':')) ? opcd(0) : ersSYNTAX_ERROR "expected :";
             }
             else
@@ -461,14 +563,14 @@ public:
         else if (t.type == type::T_STRUCTEND)
         {
             if (t.is_nameless())
-                _tokenizer.push_back();
+                push_back_token();
             else
                 e = (tok == char('}')) ? opcd(0) : ersSYNTAX_ERROR "expected }";
         }
         else if (t.type == type::T_STRUCTBGN)
         {
             if (t.is_nameless())
-                _tokenizer.push_back();
+                push_back_token();
             else {/*
                 if( _tokenizer.last_string_delimiter() == '(' )
                 {
@@ -480,7 +582,7 @@ public:
                         else if( s != tok )     //otherwise compare
                             return ersSYNTAX_ERROR "class name mismatch";
                     }
-                    tok = _tokenizer.next();
+                    tok = next_token();
                 }*/
 
                 e = (tok == char('{')) ? opcd(0) : ersSYNTAX_ERROR "expected {";
@@ -489,13 +591,13 @@ public:
         else if (t.type == type::T_SEPARATOR)
         {
             if (trSep.is_empty())
-                _tokenizer.push_back();
+                push_back_token();
             else {
                 bool has = tok == trSep;
                 if (has)
-                    tok = _tokenizer.next();
+                    tok = next_token();
 
-                _tokenizer.push_back();
+                push_back_token();
 
                 if (tok == char('}'))
                     e = ersNO_MORE;
@@ -576,15 +678,14 @@ public:
 
             case type::T_FLOAT:
             {
-                double v = tok.todouble_and_shift();
-                if (!tok.is_empty())
-                    return ersSYNTAX_ERROR "unrecognized characters after number";
-
                 switch (t.get_size())
                 {
-                case 4: *(float*)p = (float)v;  break;
-                case 8: *(double*)p = v;  break;
+                case 4: *(float*)p = tok.tofloat_and_shift();  break;
+                case 8: *(double*)p = tok.todouble_and_shift();  break;
                 }
+
+                if (!tok.is_empty())
+                    return ersSYNTAX_ERROR "unrecognized characters after number";
             }
             break;
 
@@ -667,12 +768,12 @@ public:
     {
         DASSERT(t.type != type::T_CHAR && t.type != type::T_KEY && t.type != type::T_BINARY);
 
-        token tok = _tokenizer.next();
+        token tok = next_token();
         bool has = tok == trArraySep;
         if (has)
-            tok = _tokenizer.next();
+            tok = next_token();
 
-        _tokenizer.push_back();
+        push_back_token();
 
         if (tok == char(']'))
             return ersNO_MORE;
@@ -748,7 +849,7 @@ public:
         if (t.type != type::T_CHAR && t.type != type::T_KEY && t.type != type::T_BINARY)
             return read_compound_array_content(c, n, count, m);
 
-        const lexer::lextoken& tk = _tokenizer.next();
+        const lexer::lextoken& tk = next_token();
         token tok = tk;
 
         if (!(tk == lexstr || tk == lexstre || tk == lexid))
@@ -774,7 +875,7 @@ public:
         }
 
         //push back so the trailing delimiter would match
-        _tokenizer.push_back();
+        push_back_token();
         return e;
     }
 
@@ -807,6 +908,135 @@ public:
     }
 
 protected:
+
+    ///Get next input token, either from the structural index or from the lexer
+    const lexer::lextoken& next_token()
+    {
+        if (_istate == 0)
+            index_input();
+
+        return _istate > 0 ? index_next() : _tokenizer.next();
+    }
+
+    void push_back_token()
+    {
+        if (_istate > 0)
+            _ipushback = true;
+        else
+            _tokenizer.push_back();
+    }
+
+    bool input_end() const {
+        return _istate > 0 ? _itok.end() : _tokenizer.end();
+    }
+
+    void reset_index()
+    {
+        _istate = 0;
+        _ipushback = false;
+        _ipos = _ilast = _ibol = 0;
+        _iline = 1;
+        _idoc.set_empty();
+        _index.reset();
+        _ibuf.reset_write();
+    }
+
+    ///Read the whole input block and build its structural index, or hand the data over to the lexer
+    /// if the index can't be used
+    void index_input()
+    {
+        bool seps = (trSep.is_empty() || trSep == ',') && (trArraySep.is_empty() || trArraySep == ',');
+
+        //streamed input goes through the lexer window
+        if (!_use_index || _ext_esc_string || !seps || !_binr || _window) {
+            _istate = -1;
+            return;
+        }
+
+        //the lexer also reads the whole block on its first token
+        _ibuf.reset_write();
+        _ibuf.transfer_from(*_binr);
+
+        _idoc = _ibuf;
+
+        static const token BOM = "\xEF\xBB\xBF";
+        if (_tokenizer.is_utf8() && _idoc.begins_with(BOM))
+            _idoc.shift_start(BOM.len());
+
+        if (_index.build(_idoc)) {
+            _istate = 1;
+            _ipos = 0;
+        }
+        else {
+            _istate = -1;
+            _index.reset();
+            _tokenizer.bind(token(_ibuf));
+        }
+    }
+
+    ///Produce next token from the structural index
+    const lexer::lextoken& index_next()
+    {
+        if (_ipushback) {
+            _ipushback = false;
+            return _itok;
+        }
+
+        lexer::lextoken& tk = _itok;
+        const char* doc = _idoc.ptr();
+
+        if (_ipos >= _index.size()) {
+            tk.id = 0;
+            tk.val.set_empty(_idoc.ptre());
+            return tk;
+        }
+
+        uint32 p = _index[_ipos++];
+        char c = doc[p];
+        _ilast = p;
+
+        if (c == '"') {
+            //the closing quote follows, unterminated strings fail the index build
+            uint32 e = _index[_ipos++];
+            tk.id = lexstr;
+            tk.val.set(doc + p + 1, doc + e);
+
+            const char* bs = (const char*)::memchr(tk.val.ptr(), '\\', tk.val.len());
+            if (bs) {
+                //replace escape sequences, validated by the index build
+                const char* end = tk.val.ptre();
+                charstr& buf = tk.tokbuf;
+                buf.reset();
+                buf.add_from(tk.val.ptr(), bs - tk.val.ptr());
+
+                for (const char* q = bs; q < end; ++q) {
+                    if (*q == '\\')
+                        buf.append(char(json_structural_index::unescape(*++q)));
+                    else
+                        buf.append(*q);
+                }
+
+                tk.val = buf;
+            }
+        }
+        else if (json_structural_index::is_structural(c)) {
+            tk.id = lexctl;
+            tk.val.set(doc + p, 1);
+        }
+        else {
+            const char* a = doc + p;
+            const char* end = _idoc.ptre();
+            const char* b = a + 1;
+            while (b < end && json_structural_index::is_ident(*b))
+                ++b;
+
+            tk.id = lexid;
+            tk.val.set(a, b);
+        }
+
+        return tk;
+    }
+
     token tEol;                         //< separator between struct open/close and members
     token tTab;                         //< indentation
     token tSep, trSep;                  //< separator between entries
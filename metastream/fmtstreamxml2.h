@@ -512,14 +512,12 @@ public:
 
                     /////////////////////////////////////////////////////////////////////////////////////
                 case type::T_FLOAT: {
-                    double d = tok.todouble_and_shift();
-
                     switch (t.get_size()) {
                         case 4:
-                            *(float*)p = (float)d;
+                            *(float*)p = tok.tofloat_and_shift();
                             break;
                         case 8:
-                            *(double*)p = d;
+                            *(double*)p = tok.todouble_and_shift();
                             break;
 
                         default:
@@ -0,0 +1,271 @@
+#pragma once
+
+/* ***** BEGIN LICENSE BLOCK *****
+* Version: MPL 1.1/GPL 2.0/LGPL 2.1
+*
+* The contents of this file are subject to the Mozilla Public License Version
+* 1.1 (the "License"); you may not use this file except in compliance with
+* the License. You may obtain a copy of the License at
+* http://www.mozilla.org/MPL/
+*
+* Software distributed under the License is distributed on an "AS IS" basis,
+* WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+* for the specific language governing rights and limitations under the
+* License.
+*
+* The Original Code is COID/comm module.
+*
+* The Initial Developer of the Original Code is
+* Outerra.
+* Portions created by the Initial Developer are Copyright (C) 2026
+* the Initial Developer. All Rights Reserved.
+*
+* Contributor(s):
+* Brano Kemen
+*
+* Alternatively, the contents of this file may be used under the terms of
+* either the GNU General Public License Version 2 or later (the "GPL"), or
+* the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+* in which case the provisions of the GPL or the LGPL are applicable instead
+* of those above. If you wish to allow use of your version of this file only
+* under the terms of either the GPL or the LGPL, and not to allow others to
+* use your version of this file under the terms of the MPL, indicate your
+* decision by deleting the provisions above and replace them with the notice
+* and other provisions required by the GPL or the LGPL. If you do not delete
+* the provisions above, a recipient may use your version of this file under
+* the terms of any one of the MPL, the GPL or the LGPL.
+*
+* ***** END LICENSE BLOCK ***** */
+
+#ifndef __COID_COMM_JSON_INDEX__HEADER_FILE__
+#define __COID_COMM_JSON_INDEX__HEADER_FILE__
+
+#include "../namespace.h"
+#include "../commtypes.h"
+#include "../bitrange.h"
+#include "../dynarray.h"
+#include "../token.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define COID_JSON_INDEX_SSE2
+#endif
+
+COID_NAMESPACE_BEGIN
+
+////////////////////////////////////////////////////////////////////////////////
+///Structural index of a JSON document
+/// Contains positions of structural characters ({}[],:), string quotes and starts of unquoted
+/// atoms (numbers, literals, identifiers) that lie outside of strings. The document is classified
+/// in 64 byte blocks using SIMD compares and bit masks, strings are tracked by prefix-xor of the
+/// quote mask.
+class json_structural_index
+{
+public:
+
+    ///Build the index of a document
+    /// @return false if the document cannot be indexed: it contains an unterminated string,
+    ///         an unsupported escape sequence, or characters outside of strings that are not part
+    ///         of the plain JSON syntax (comments, single quoted strings ...)
+    bool build(const token& doc)
+    {
+        _pos.reset();
+
+        const char* p = doc.ptr();
+        uints n = doc.len();
+        if (n >= 0xffffffffU)
+            return false;
+
+        _pos.reserve(n / 4, false);
+
+        uint64 prev_escaped = 0;        //< first byte of the block is escaped by a backslash ending the previous one
+        uint64 prev_inside = 0;         //< all ones if the previous block ended inside a string
+        uint64 prev_ident = 0;          //< 1 if the previous block ended with an atom character
+
+        char tail[64];
+
+        for (uints base = 0; base < n; base += 64)
+        {
+            const char* src = p + base;
+            if (n - base < 64) {
+                ::memset(tail, ' ', 64);
+                ::memcpy(tail, src, n - base);
+                src = tail;
+            }
+
+            block_masks m;
+            classify(src, m);
+
+            //escaped characters, backslashes are rare enough to be resolved one by one
+            uint64 escaped = prev_escaped;
+            prev_escaped = 0;
+
+            for (uint64 b = m.backslash; b; b &= b - 1) {
+                uint8 i = lsb_bit_set(b);
+                if (escaped & (uint64(1) << i))
+                    continue;
+
+                if (i == 63)
+                    prev_escaped = 1;
+                else
+                    escaped |= uint64(1) << (i + 1);
+            }
+
+            uint64 quote = m.quote & ~escaped;
+            uint64 inside = prefix_xor(quote) ^ prev_inside;
+            prev_inside = uint64(int64(inside) >> 63);
+
+            //escape sequences in strings must be the ones understood by fmtstreamjson
+            for (uint64 e = escaped & inside; e; e &= e - 1) {
+                if (unescape(src[lsb_bit_set(e)]) < 0)
+                    return false;
+            }
+
+            uint64 outside = ~(inside | quote);
+            if (~(m.structural | m.space | m.ident) & outside)
+                return false;
+
+            uint64 ident = m.ident & outside;
+            uint64 atoms = ident & ~((ident << 1) | prev_ident);
+            prev_ident = ident >> 63;
+
+            uint64 bits = (m.structural & outside) | quote | atoms;
+
+            uints k = _pos.size();
+            uint32* dst = _pos.add(64);
+            uint32* dst0 = dst;
+
+            for (; bits; bits &= bits - 1)
+                *dst++ = uint32(base + lsb_bit_set(bits));
+
+            _pos.set_size(k + (dst - dst0));
+        }
+
+        return prev_inside == 0 && prev_escaped == 0;
+    }
+
+    void reset() { _pos.reset(); }
+
+    uints size() const { return _pos.size(); }
+
+    uint32 operator [] (uints i) const { return _pos[i]; }
+
+    ///@return true for characters that can be a part of an unquoted atom
+    static bool is_ident(char c) {
+        return (c >= '0' && c <= '9') || ((c | 0x20) >= 'a' && (c | 0x20) <= 'z')
+            || c == '_' || c == '.' || c == '+' || c == '-';
+    }
+
+    ///@return true for structural characters
+    static bool is_structural(char c) {
+        return c == '{' || c == '}' || c == '[' || c == ']' || c == ',' || c == ':';
+    }
+
+    ///@return character represented by an escape sequence, -1 if the sequence is not supported
+    static int unescape(char c)
+    {
+        switch (c) {
+        case '"':   return '"';
+        case '\\':  return '\\';
+        case 'b':   return '\b';
+        case 'f':   return '\f';
+        case 'n':   return '\n';
+        case 'r':   return '\r';
+        case 't':   return '\t';
+        case '0':   return 0;
+        default:    return -1;
+        }
+    }
+
+private:
+
+    ///Character class masks of a 64 byte block
+    struct block_masks {
+        uint64 quote = 0;
+        uint64 backslash = 0;
+        uint64 structural = 0;
+        uint64 space = 0;
+        uint64 ident = 0;
+    };
+
+    ///@return mask with bits set from each odd quote up to (not including) the following one
+    static uint64 prefix_xor(uint64 x)
+    {
+        x ^= x << 1;
+        x ^= x << 2;
+        x ^= x << 4;
+        x ^= x << 8;
+        x ^= x << 16;
+        x ^= x << 32;
+        return x;
+    }
+
+#ifdef COID_JSON_INDEX_SSE2
+
+    static void classify(const char* p, block_masks& m)
+    {
+        const __m128i lcase = _mm_set1_epi8(0x20);
+
+        for (int i = 0; i < 64; i += 16)
+        {
+            __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+            __m128i l = _mm_or_si128(c, lcase);
+
+            __m128i quote = _mm_cmpeq_epi8(c, _mm_set1_epi8('"'));
+            __m128i bslash = _mm_cmpeq_epi8(c, _mm_set1_epi8('\\'));
+
+            //{ } [ ] differ from each other by the 0x20 bit
+            __m128i st = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(l, _mm_set1_epi8('{')), _mm_cmpeq_epi8(l, _mm_set1_epi8('}'))),
+                _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8(',')), _mm_cmpeq_epi8(c, _mm_set1_epi8(':'))));
+
+            __m128i sp = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(c, _mm_set1_epi8('\t'))),
+                _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('\r')), _mm_cmpeq_epi8(c, _mm_set1_epi8('\n'))));
+
+            //signed compares, bytes >= 0x80 fall out of the ranges
+            __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(c, _mm_set1_epi8('9' + 1)));
+            __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(l, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(l, _mm_set1_epi8('z' + 1)));
+            __m128i other = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('_')), _mm_cmpeq_epi8(c, _mm_set1_epi8('.'))),
+                _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('+')), _mm_cmpeq_epi8(c, _mm_set1_epi8('-'))));
+            __m128i id = _mm_or_si128(_mm_or_si128(digit, alpha), other);
+
+            m.quote |= uint64(uint16(_mm_movemask_epi8(quote))) << i;
+            m.backslash |= uint64(uint16(_mm_movemask_epi8(bslash))) << i;
+            m.structural |= uint64(uint16(_mm_movemask_epi8(st))) << i;
+            m.space |= uint64(uint16(_mm_movemask_epi8(sp))) << i;
+            m.ident |= uint64(uint16(_mm_movemask_epi8(id))) << i;
+        }
+    }
+
+#else
+
+    static void classify(const char* p, block_masks& m)
+    {
+        for (int i = 0; i < 64; ++i)
+        {
+            char c = p[i];
+            uint64 b = uint64(1) << i;
+
+            if (c == '"')
+                m.quote |= b;
+            else if (c == '\\')
+                m.backslash |= b;
+            else if (is_structural(c))
+                m.structural |= b;
+            else if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
+                m.space |= b;
+            else if (is_ident(c))
+                m.ident |= b;
+        }
+    }
+
+#endif
+
+    dynarray<uint32> _pos;              //< positions of indexed characters
+};
+
+COID_NAMESPACE_END
+
+#endif //__COID_COMM_JSON_INDEX__HEADER_FILE__
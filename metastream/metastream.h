@@ -473,8 +473,10 @@ public:
             if (!used)
                 v = static_cast<const T&>(defval);
         }
-        else
+        else {
             meta_variable_optional<T>(name, &v);
+            meta_variable_default<T>(defval, true, false);
+        }
 
         return used;
     }
@@ -499,8 +501,10 @@ public:
             if (!used)
                 v = static_cast<const T&>(defval);
         }
-        else
+        else {
             meta_variable_optional<T>(name, &v);
+            meta_variable_default<T>(defval, true, !write_default);
+        }
 
         return used;
     }
@@ -855,6 +859,28 @@ public:
     }
 
 
+    ///Define an array member streamed element by element, without holding the whole array in memory
+    /// @param name variable name, used as a key in output formats
+    /// @param set void function(T&&) receiving each element as soon as it's been read from stream
+    /// @param get const T* function() called to provide the next element to write, nullptr at the end
+    /// @note declared as dynarray<T>, so the streamed data are compatible with dynarray members
+    template<typename T, typename FnIn, typename FnOut>
+    metastream& member_stream_array(const token& name, FnIn set, FnOut get)
+    {
+        if (_binw) {
+            binstream_container_callback_out<T, FnOut> bc(get);
+            write_container(bc);
+        }
+        else if (_binr) {
+            binstream_container_callback_in<T, FnIn> bc(set);
+            read_container(bc);
+            bc.flush();
+        }
+        else
+            meta_variable<dynarray<T>>(name, 0);
+        return *this;
+    }
+
     ///Define an optional variable. On read, value doesn't get overwritten if it wasn't present in the input stream
     /// @param name variable name, used as a key in output formats
     /// @param write false if value should not be written
@@ -911,8 +937,10 @@ public:
         else if (_binr) {
             used = read_optional(v);
         }
-        else
+        else {
             meta_variable_optional<T>(name, &v);
+            meta_variable_default<T>(defval, false, true);
+        }
 
         return used;
     }
@@ -1798,6 +1826,37 @@ public:
         return e;
     }
 
+    ///Read object of type T from the currently bound formatting stream using a compiled streaming program
+    /// @note the program is built once per type (and thread) from the metastream description and streams
+    ///       the members directly by their offsets; types that cannot be compiled are streamed regularly
+    /// @note metastream operators of T and of its nested compounds must only declare members, any other
+    ///       code there (post-processing on read etc.) is not executed by the compiled program
+    template<class T>
+    opcd stream_in_compiled(T& x, const token& name = token())
+    {
+        opcd e;
+        try {
+            xstream_in_compiled(x, name);
+        }
+        catch (opcd ee) { e = ee; }
+        catch (exception&) { e = ersEXCEPTION; }
+        return e;
+    }
+
+    ///Write object of type T to the currently bound formatting stream using a compiled streaming program
+    /// @note see stream_in_compiled
+    template<class T>
+    opcd stream_out_compiled(const T& x, const token& name = token())
+    {
+        opcd e;
+        try {
+            xstream_out_compiled(x, name);
+        }
+        catch (opcd ee) { e = ee; }
+        catch (exception&) { e = ersEXCEPTION; }
+        return e;
+    }
+
     ///Prepare streaming of a named type
     opcd stream_out_named(const token& type, const token& name, bool cache = false)
     {
@@ -1913,6 +1972,34 @@ public:
     }
 
 
+    ///Read array of objects of type T from the currently bound formatting stream, element by element
+    /// @param fn void function(T&&) receiving each element as soon as it's been read
+    /// @param count [out] optional number of elements read
+    /// @note memory use doesn't depend on the array size
+    template<class T, class Fn>
+    opcd stream_array_in_each(Fn fn, const token& name = token(), uints* count = 0)
+    {
+        binstream_container_callback_in<T, Fn> bc(fn);
+        opcd e = stream_array_in(bc, name);
+        if (e == NOERR) {
+            try { bc.flush(); }
+            catch (opcd ee) { e = ee; }
+            catch (exception&) { e = ersEXCEPTION; }
+        }
+        if (count)
+            *count = bc.delivered();
+        return e;
+    }
+
+    ///Write array of objects of type T to the currently bound formatting stream, element by element
+    /// @param fn const T* function() called to provide the next element to write, nullptr at the end
+    template<class T, class Fn>
+    opcd stream_array_out_each(Fn fn, const token& name = token())
+    {
+        binstream_container_callback_out<T, Fn> bc(fn);
+        return stream_array_out(bc, name);
+    }
+
     template<class T>
     void xstream_in(T& x, const token& name = token())
     {
@@ -1991,6 +2078,65 @@ public:
         xstream_or_cache_out_fn(x, true, fn, name);
     }
 
+    template<class T>
+    void xstream_in_compiled(T& x, const token& name = token())
+    {
+        typedef typename resolve_stream_enum<T>::type B;
+        _xthrow(prepare_type(x, name, false, READ_MODE));
+
+        _binr = true;
+        MetaDesc* desc = _root.desc;
+
+        if (compiled_program(desc)) {
+            _xthrow(movein_process_key(READ_MODE));
+
+            if (!cache_prepared()) {
+                _rvarname.reset();
+
+                movein_struct(READ_MODE);
+                compiled_read(desc->program, 0, uint(desc->program.size()), (uchar*)&x);
+                moveout_struct(READ_MODE);
+            }
+            else    //root found in the cache
+                *this || (B&)x;
+        }
+        else
+            *this || (B&)x;
+
+        _binr = false;
+    }
+
+    template<class T>
+    void xstream_out_compiled(const T& x, const token& name = token())
+    {
+        typedef typename resolve_stream_enum<T>::type B;
+        _xthrow(prepare_type((B&)x, name, false, WRITE_MODE));
+
+        _binw = true;
+        MetaDesc* desc = _root.desc;
+
+        if (compiled_program(desc)) {
+            _xthrow(movein_process_key(WRITE_MODE));
+            _rvarname.reset();
+
+            movein_struct(WRITE_MODE);
+            compiled_write(desc->program, 0, uint(desc->program.size()), (const uchar*)&x);
+            moveout_struct(WRITE_MODE);
+        }
+        else
+            *this || (B&)x;
+
+        _binw = false;
+    }
+
+    ///Check if objects of type T are streamed by a compiled program
+    /// @return false if xstream_in_compiled/xstream_out_compiled fall back to regular streaming of T
+    template<class T>
+    bool is_compiled()
+    {
+        return compiled_program(const_cast<MetaDesc*>(get_type_desc<T>()));
+    }
+
 
     void stream_acknowledge(bool eat = false)
     {
@@ -2384,6 +2530,29 @@ public:
         _last_var->optional = true;
     }
 
+    ///Remember default value declared for the last defined member, used by compiled streaming
+    /// @param apply true if the default is assigned when the member is missing on input
+    /// @param nowrite true if the member equal to the default is not written
+    template<class T, class D>
+    void meta_variable_default(const D& defval, bool apply, bool nowrite)
+    {
+        _last_var->defval_apply = apply;
+        _last_var->defval_nowrite = nowrite;
+
+        if (_last_var->desc->is_primitive() && !_last_var->desc->is_array())
+            meta_plain_default<T>(_last_var->plain_defval, defval, std::is_trivially_copyable<T>());
+    }
+
+    template<class T, class D>
+    static void meta_plain_default(dynarray<uchar>& dst, const D& defval, std::true_type)
+    {
+        const T val = static_cast<const T&>(defval);
+        ::memcpy(dst.alloc(sizeof(T)), &val, sizeof(T));
+    }
+
+    template<class T, class D>
+    static void meta_plain_default(dynarray<uchar>&, const D&, std::false_type) {}
+
     template<class T>
     void meta_variable_obsolete(const token& varname)
     {
@@ -3984,6 +4153,257 @@ private:
         return 0;
     }
 
+    ////////////////////////////////////////////////////////////////////////////////
+    /// @{ compiled streaming
+
+    ///Get compiled streaming program of given type, building it on first use
+    /// @return false if the type cannot be streamed by a compiled program
+    static bool compiled_program(MetaDesc* desc)
+    {
+        if (desc->program_state == 0) {
+            bool ok = desc->is_compound() && !desc->is_pointer
+                && desc->streaming_type == desc
+                && compile_members(desc, 0, desc->program);
+
+            if (!ok)
+                desc->program.discard();
+            desc->program_state = ok ? 1 : -1;
+        }
+
+        return desc->program_state > 0;
+    }
+
+    ///Append ops for members of a compound type
+    /// @param base offset of the compound from the root object
+    /// @return false if some member cannot be compiled
+    static bool compile_members(const MetaDesc* desc, int base, dynarray<MetaDesc::Op>& prog)
+    {
+        //unseen members are tracked in a 64 bit mask during reading
+        if (desc->children.size() > 64)
+            return false;
+
+        for (const MetaDesc::Var& v : desc->children)
+        {
+            const MetaDesc* d = v.desc;
+            bool primitive = d->is_primitive() && !d->is_array() && !d->is_pointer;
+
+            if (v.varname.is_empty() || v.singleref || d->streaming_type != d)
+                return false;
+
+            uint i = uint(prog.size());
+            MetaDesc::Op* op = prog.add();
+            op->var = &v;
+            op->btype = d->btype;
+
+            if (v.obsolete) {
+                if (!primitive)
+                    return false;
+                op->code = MetaDesc::Op::SKIP;
+                continue;
+            }
+
+            //nonmembers and members with custom setters/getters have no offset
+            if (v.offset < 0)
+                return false;
+
+            //optional members without a declared default may be handled conditionally by the operator
+            bool hasdef = v.defval_apply || v.defval_nowrite;
+            if (v.optional && !hasdef)
+                return false;
+
+            op->offset = base + v.offset;
+
+            if (primitive) {
+                if (hasdef && v.plain_defval.size() != d->get_size())
+                    return false;
+                op->code = MetaDesc::Op::VALUE;
+            }
+            else if (d->is_compound() && !d->is_pointer && !v.optional) {
+                op->code = MetaDesc::Op::STRUCT;
+                if (!compile_members(d, base + v.offset, prog))
+                    return false;
+                prog[i].end = uint(prog.size());
+            }
+            else
+                return false;
+        }
+
+        return true;
+    }
+
+    ///Compare primitive values, floating point ones by value
+    static bool compiled_equal(const void* a, const void* b, type t)
+    {
+        if (t.type == type::T_FLOAT) {
+            if (t.size == sizeof(float))
+                return *(const float*)a == *(const float*)b;
+            if (t.size == sizeof(double))
+                return *(const double*)a == *(const double*)b;
+        }
+
+        return ::memcmp(a, b, t.get_size()) == 0;
+    }
+
+    ///Throw exception for an error encountered in compiled streaming
+    void compiled_error(const MetaDesc::Var& var, const char* what, opcd e, bool read)
+    {
+        dump_stack(_err, 0);
+        _err << " - error " << what << " variable '" << var.varname << "'";
+        if (e != NOERR)
+            _err << ": " << opcd_formatter(e);
+
+        if (read)
+            before_exception_throw();
+        throw exception(_err);
+    }
+
+    ///Write members in the range of program ops
+    void compiled_write(const dynarray<MetaDesc::Op>& prog, uint first, uint last, const uchar* obj)
+    {
+        int kth = 0;
+
+        for (uint i = first; i < last; i = prog[i].next(i))
+        {
+            const MetaDesc::Op& op = prog[i];
+            const MetaDesc::Var& v = *op.var;
+            const uchar* p = obj + op.offset;
+
+            if (op.code == MetaDesc::Op::SKIP)
+                continue;
+            if (v.defval_nowrite && compiled_equal(p, v.plain_defval.ptr(), op.btype))
+                continue;
+
+            opcd e = _fmtstreamwr->write_key(v.varname, kth++);
+            if (e != NOERR)
+                compiled_error(v, "writing the name of", e, WRITE_MODE);
+
+            if (op.code == MetaDesc::Op::VALUE) {
+                e = _fmtstreamwr->write(p, op.btype);
+            }
+            else {
+                e = _fmtstreamwr->write_struct_open(false, &v.desc->type_name);
+                if (e == NOERR) {
+                    compiled_write(prog, i + 1, op.end, obj);
+                    e = _fmtstreamwr->write_struct_close(false, &v.desc->type_name);
+                }
+            }
+
+            if (e != NOERR)
+                compiled_error(v, "writing", e, WRITE_MODE);
+        }
+    }
+
+    ///Read members in the range of program ops, accepting them in any order
+    void compiled_read(const dynarray<MetaDesc::Op>& prog, uint first, uint last, uchar* obj)
+    {
+        uint child[64];
+        uint n = 0;
+
+        for (uint i = first; i < last; i = prog[i].next(i))
+            child[n++] = i;
+
+        const uint64 all = n < 64 ? (uint64(1) << n) - 1 : ~uint64(0);
+        uint64 seen = 0;
+        uint expected = 0;
+        int kth = 0;
+
+        while (seen != all)
+        {
+            //members are expected in the declared order
+            while (seen & (uint64(1) << expected))
+                ++expected;
+
+            const MetaDesc::Var* ev = prog[child[expected]].var;
+
+            opcd e = _fmtstreamrd->read_key(_rvarname, kth++, ev->varname);
+            if (e == ersNO_MORE)
+                break;
+            if (e != NOERR)
+                compiled_error(*ev, "seeking for", e, READ_MODE);
+
+            uint k = expected;
+            if (_rvarname != ev->varname) {
+                //out of order member
+                for (k = 0; k < n; ++k) {
+                    if (!(seen & (uint64(1) << k)) && _rvarname == prog[child[k]].var->varname)
+                        break;
+                }
+
+                if (k == n) {
+                    dump_stack(_err, 0);
+                    bool redundant = false;
+                    for (uint j = 0; j < n && !redundant; ++j)
+                        redundant = _rvarname == prog[child[j]].var->varname;
+
+                    if (redundant)
+                        _err << " - data for member: " << _rvarname << " specified more than once";
+                    else
+                        _err << " - member variable: " << _rvarname << " not defined";
+                    before_exception_throw();
+                    throw exception(_err);
+                }
+            }
+
+            seen |= uint64(1) << k;
+            compiled_read_member(prog, child[k], obj);
+        }
+
+        //members missing in the input
+        for (uint k = 0; k < n; ++k)
+        {
+            if (seen & (uint64(1) << k))
+                continue;
+
+            const MetaDesc::Op& op = prog[child[k]];
+            const MetaDesc::Var& v = *op.var;
+
+            if (op.code == MetaDesc::Op::SKIP)
+                continue;
+            else if (v.defval_apply)
+                ::memcpy(obj + op.offset, v.plain_defval.ptr(), v.plain_defval.size());
+            else if (!v.optional) {
+                dump_stack(_err, 0);
+                _err << " - variable '" << v.varname << "' not found and no default value provided";
+                before_exception_throw();
+                throw exception(_err);
+            }
+        }
+
+        _rvarname.reset();
+    }
+
+    ///Read member at given program op, after its key was read
+    void compiled_read_member(const dynarray<MetaDesc::Op>& prog, uint i, uchar* obj)
+    {
+        const MetaDesc::Op& op = prog[i];
+        const MetaDesc::Var& v = *op.var;
+        opcd e;
+
+        if (op.code == MetaDesc::Op::VALUE) {
+            e = _fmtstreamrd->read(obj + op.offset, op.btype);
+        }
+        else if (op.code == MetaDesc::Op::SKIP) {
+            uint64 temp[4];
+            DASSERT(op.btype.get_size() <= sizeof(temp));
+
+            e = _fmtstreamrd->read(temp, op.btype);
+            if (e == NOERR)
+                warn_obsolete(v.varname);
+        }
+        else {
+            e = _fmtstreamrd->read_struct_open(false, &v.desc->type_name);
+            if (e == NOERR) {
+                compiled_read(prog, i + 1, op.end, obj);
+                e = _fmtstreamrd->read_struct_close(false, &v.desc->type_name);
+            }
+        }
+
+        if (e != NOERR)
+            compiled_error(v, "reading", e, READ_MODE);
+    }
+
+    /// @}
+
 
     ///Fill intermediate cache, _rvarname contains the key read, and
     /// _curvar.var->varname the key requested
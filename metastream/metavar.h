@@ -62,11 +62,14 @@ struct MetaDesc
         int offset = 0;                 //< offset in parent
 
         dynarray<uchar> defval;         //< default value for reading if not found in input stream
+        dynarray<uchar> plain_defval;   //< default value of a primitive member as declared in metastream operator (compiled streaming)
 
         bool nameless_root = false;     //< true if the variable is a nameless root
         bool obsolete = false;          //< variable is only read, not written
         bool optional = false;          //< variable is optional
         bool singleref = false;         //< desc refers to a pointer type pointing to a single object, not an array
+        bool defval_apply = false;      //< declared default value is assigned if the member is missing on input
+        bool defval_nowrite = false;    //< member equal to the declared default value is not written
 
         MetaDesc* stream_desc() const { DASSERT(desc->streaming_type); return desc->streaming_type; }
 
@@ -107,6 +110,25 @@ struct MetaDesc
     };
 
 
+    ///Operation of a compiled streaming program
+    struct Op
+    {
+        enum : uint8 {
+            VALUE,                      //< primitive member
+            SKIP,                       //< obsolete primitive member, read and discarded
+            STRUCT,                     //< nested compound member, its members follow up to the end index
+        };
+
+        uint8 code = VALUE;
+        type btype;                     //< type of a primitive member
+        int offset = 0;                 //< offset from the streamed root object
+        uint end = 0;                   //< index of the op following the last member of a nested compound
+        const Var* var = 0;             //< member variable
+
+        uint next(uint i) const { return code == STRUCT ? end : i + 1; }
+    };
+
+
     dynarray<Var> children;             //< member variables
     uints array_size = 0;               //< array size, UMAXS for dynamic arrays
 
@@ -146,6 +168,9 @@ struct MetaDesc
 
     stream_func fnstream = 0;           //< metastream streaming function
 
+    dynarray<Op> program;               //< compiled streaming program, flattened members of the whole compound tree
+    int8 program_state = 0;             //< 0 not compiled yet, 1 compiled, -1 cannot be compiled
+
 
 
     bool is_array() const { return is_array_type; }
@@ -36,6 +36,8 @@
  * ***** END LICENSE BLOCK ***** */
 
 #include "net.h"
+#include "net_resolver.h"
+#include "atomic/pool_base.h"
 
 
  ////////////////////////////////////////////////////////////////////////////////
@@ -68,6 +70,8 @@
 # include <unistd.h>
 # include <sys/types.h>
 # include <sys/socket.h>
+# include <sys/uio.h>
+# include <limits.h>
 # include <arpa/inet.h>
 # include <netinet/tcp.h>
 # include <time.h>
@@ -82,6 +86,22 @@
 
 #endif
 
+#ifdef SYSTYPE_LINUX
+# include <netinet/udp.h>
+# ifndef SOL_UDP
+#  define SOL_UDP 17
+# endif
+# ifndef UDP_SEGMENT
+#  define UDP_SEGMENT 103
+# endif
+# ifndef UDP_GRO
+#  define UDP_GRO 104
+# endif
+
+///Control data space per datagram, fits UDP_GRO (int) and UDP_SEGMENT (uint16)
+static const uint UDP_CTL_SPACE = CMSG_SPACE(sizeof(int));
+#endif
+
 
 #if defined(SYSTYPE_WIN) && !defined(socklen_t)
 #define socklen_t int
@@ -329,23 +349,40 @@ void netAddress::set(uint addr, uint16 port)
 
 ////////////////////////////////////////////////////////////////////////////////
 void netAddress::set(const token& host, uint16 port, bool portoverride)
+{
+    token name = set_numeric(host, port, portoverride);
+    if (name.is_empty())
+        return;
+
+    //resolved through the cache of the global resolver
+    netAddress addr;
+    if (netResolver::instance().resolve_sync(name, port, true, addr) == NOERR)
+        sin_addr = addr.sin_addr;
+    else
+        sin_addr = 0;//INADDR_ANY;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+token netAddress::set_numeric(const token& host, uint16 port, bool portoverride)
 {
     memset(this, 0, sizeof(netAddress));
 
     sin_family = 2;//AF_INET;
 
     /* Convert a string specifying a host name or one of a few symbolic
-    ** names to a numeric IP address.  This usually calls gethostbyname()
-    ** to do the work; the names "" and "<broadcast>" are special.
+    ** names to a numeric IP address. The names "" and "<broadcast>" are
+    ** special, other names are returned to be resolved.
     */
 
     if (host.is_empty() || host[0] == '\0')
     {
         sin_addr = 0;   //INADDR_ANY;
         sin_port = ::htons(port);
-        return;
+        return token();
     }
 
+    token name;
+
     if (host == "<broadcast>")
     {
         sin_addr = UMAX32;//INADDR_BROADCAST;
@@ -359,7 +396,7 @@ void netAddress::set(const token& host, uint16 port, bool portoverride)
 
         token namehost = hostx.cut_left('/');
         token nameport = namehost.cut_right('@');
-        token name = nameport.cut_left(':', token::cut_trait_keep_sep_with_source_default_full());
+        name = nameport.cut_left(':', token::cut_trait_keep_sep_with_source_default_full());
 
 
         uint16 p = 0;
@@ -371,28 +408,23 @@ void netAddress::set(const token& host, uint16 port, bool portoverride)
                 port = p;
         }
 
-        if (name == "localhost")
+        if (name == "localhost") {
             sin_addr = htonl(0x7f000001);
+            name.set_empty();
+        }
         else
         {
             charstr nameh = name;
             sin_addr = inet_addr(nameh.ptr());
-            if (sin_addr == UMAX32)//INADDR_NONE )
-            {
-                struct hostent* hp = gethostbyname(nameh.ptr());
-                if (hp != NULL)
-                {
-                    xmemcpy((char*)&sin_addr, hp->h_addr, hp->h_length);
-                }
-                else  //failure
-                {
-                    sin_addr = 0;//INADDR_ANY;
-                }
-            }
+            if (sin_addr != UMAX32)//INADDR_NONE )
+                name.set_empty();
+            else
+                sin_addr = 0;//INADDR_ANY;
         }
     }
 
     sin_port = ::htons(port);
+    return name;
 }
 
 
@@ -657,6 +689,48 @@ void netSocket::setReuseAddr(bool reuse)
 #endif
 }
 
+////////////////////////////////////////////////////////////////////////////////
+bool netSocket::setReusePort(bool reuse)
+{
+    if (handle == UMAXS)
+        throw ersDISCONNECTED;  //invalid handle
+
+#if defined(SO_REUSEPORT) && !defined(SYSTYPE_WIN)
+    int one = reuse;
+    return ::setsockopt(handle, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) == 0;
+#else
+    return false;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool netSocket::setGSO(uint16 segment)
+{
+    if (handle == UMAXS)
+        throw ersDISCONNECTED;  //invalid handle
+
+#ifdef SYSTYPE_LINUX
+    int val = segment;
+    return ::setsockopt(handle, SOL_UDP, UDP_SEGMENT, &val, sizeof(val)) == 0;
+#else
+    return false;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool netSocket::setGRO(bool enable)
+{
+    if (handle == UMAXS)
+        throw ersDISCONNECTED;  //invalid handle
+
+#ifdef SYSTYPE_LINUX
+    int val = enable;
+    return ::setsockopt(handle, SOL_UDP, UDP_GRO, &val, sizeof(val)) == 0;
+#else
+    return false;
+#endif
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 void netSocket::setLinger(bool blinger, ushort sec)
 {
@@ -738,6 +812,42 @@ int netSocket::send(const void* buffer, int size, int flags)
     return ::send(handle, (const char*)buffer, size, flags);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+int netSocket::sendv(const binstream_iovec* iov, uint niov, int flags)
+{
+    if (handle == UMAXS)
+        throw ersDISCONNECTED;  //invalid handle
+
+#ifdef SYSTYPE_WIN
+    //no scatter-gather send in winsock 1.1
+    int total = 0;
+    for (uint i = 0; i < niov; ++i)
+    {
+        int k = ::send(handle, (const char*)iov[i].ptr, (int)iov[i].len, flags);
+        if (k < 0)
+            return total ? total : k;
+
+        total += k;
+        if (uints(k) < iov[i].len)
+            break;
+    }
+    return total;
+#else
+#ifdef IOV_MAX
+    //more segments fail with EMSGSIZE, transfer what fits and let the caller continue
+    if (niov > IOV_MAX)
+        niov = IOV_MAX;
+#endif
+
+    msghdr msg;
+    ::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = (::iovec*)iov;
+    msg.msg_iovlen = niov;
+
+    return (int)::sendmsg(handle, &msg, flags);
+#endif
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 int netSocket::sendto(const void* buffer, int size, int flags, const netAddress* to)
 {
@@ -756,6 +866,33 @@ int netSocket::recv(void* buffer, int size, int flags)
     return ::recv(handle, (char*)buffer, size, flags);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+int netSocket::recvv(const binstream_iovec* iov, uint niov, int flags)
+{
+    if (handle == UMAXS)
+        throw ersDISCONNECTED;  //invalid handle
+
+#ifdef SYSTYPE_WIN
+    //no scatter-gather receive in winsock 1.1, a second recv could block after the first segment was filled
+    if (niov == 0)
+        return 0;
+    return ::recv(handle, (char*)iov[0].ptr, (int)iov[0].len, flags);
+#else
+#ifdef IOV_MAX
+    //more segments fail with EMSGSIZE, transfer what fits and let the caller continue
+    if (niov > IOV_MAX)
+        niov = IOV_MAX;
+#endif
+
+    msghdr msg;
+    ::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = (::iovec*)iov;
+    msg.msg_iovlen = niov;
+
+    return (int)::recvmsg(handle, &msg, flags);
+#endif
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 int netSocket::recvfrom(void* buffer, int size, int flags, netAddress* from)
 {
@@ -766,6 +903,149 @@ int netSocket::recvfrom(void* buffer, int size, int flags, netAddress* from)
     return ::recvfrom(handle, (char*)buffer, size, flags, (sockaddr*)from, &fromlen);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+int netSocket::recvmany(netDatagramBatch& batch, bool wait)
+{
+    if (handle == UMAXS)
+        throw ersDISCONNECTED;  //invalid handle
+
+    batch._count = 0;
+    uint n = batch.capacity();
+
+#ifdef SYSTYPE_LINUX
+    mmsghdr* hdr = (mmsghdr*)batch._msgs.ptr();
+    ::iovec* iov = (::iovec*)(hdr + n);
+    uint8* ctl = (uint8*)(iov + n);
+
+    for (uint i = 0; i < n; ++i) {
+        netDatagramBatch::datagram& d = batch._items[i];
+        iov[i].iov_base = d.data;
+        iov[i].iov_len = batch._bufsize;
+
+        msghdr& m = hdr[i].msg_hdr;
+        m.msg_name = &d.addr;
+        m.msg_namelen = sizeof(netAddress);
+        m.msg_iov = iov + i;
+        m.msg_iovlen = 1;
+        m.msg_control = ctl + i * UDP_CTL_SPACE;
+        m.msg_controllen = UDP_CTL_SPACE;
+        m.msg_flags = 0;
+    }
+
+    int r = ::recvmmsg(handle, hdr, n, wait ? MSG_WAITFORONE : MSG_DONTWAIT, 0);
+    if (r < 0)
+        return -1;
+
+    for (int i = 0; i < r; ++i) {
+        netDatagramBatch::datagram& d = batch._items[i];
+        d.size = hdr[i].msg_len;
+        d.segment = 0;
+
+        msghdr& m = hdr[i].msg_hdr;
+        for (cmsghdr* c = CMSG_FIRSTHDR(&m); c; c = CMSG_NXTHDR(&m, c)) {
+            if (c->cmsg_level == SOL_UDP && c->cmsg_type == UDP_GRO) {
+                int seg;
+                ::memcpy(&seg, CMSG_DATA(c), sizeof(seg));
+                d.segment = uint16(seg);
+            }
+        }
+    }
+
+    batch._count = r;
+    return r;
+#else
+    //one datagram per call, further ones only while available
+    for (uint i = 0; i < n; ++i) {
+        if (i > 0 || !wait) {
+            if (wait_read(0) <= 0)
+                break;
+        }
+
+        netDatagramBatch::datagram& d = batch._items[i];
+        int k = recvfrom(d.data, batch._bufsize, 0, &d.addr);
+        if (k < 0) {
+            if (i == 0)
+                return -1;
+            break;
+        }
+
+        d.size = k;
+        d.segment = 0;
+        ++batch._count;
+    }
+
+    return batch._count;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int netSocket::sendmany(netDatagramBatch& batch, uint first, const netAddress* to)
+{
+    if (handle == UMAXS)
+        throw ersDISCONNECTED;  //invalid handle
+
+    if (first >= batch._count)
+        return 0;
+    uint n = batch._count - first;
+
+#ifdef SYSTYPE_LINUX
+    uint cap = batch.capacity();
+    mmsghdr* hdr = (mmsghdr*)batch._msgs.ptr();
+    ::iovec* iov = (::iovec*)(hdr + cap);
+    uint8* ctl = (uint8*)(iov + cap);
+
+    for (uint i = 0; i < n; ++i) {
+        netDatagramBatch::datagram& d = batch._items[first + i];
+        iov[i].iov_base = d.data;
+        iov[i].iov_len = d.size;
+
+        //datagrams without a port go to the connected address
+        const netAddress* addr = to ? to : (d.addr.sin_port ? &d.addr : 0);
+
+        msghdr& m = hdr[i].msg_hdr;
+        m.msg_name = (void*)addr;
+        m.msg_namelen = addr ? sizeof(netAddress) : 0;
+        m.msg_iov = iov + i;
+        m.msg_iovlen = 1;
+        m.msg_control = 0;
+        m.msg_controllen = 0;
+        m.msg_flags = 0;
+
+        if (d.segment && d.size > d.segment) {
+            cmsghdr* c = (cmsghdr*)(ctl + i * UDP_CTL_SPACE);
+            m.msg_control = c;
+            m.msg_controllen = CMSG_SPACE(sizeof(uint16));
+            c->cmsg_level = SOL_UDP;
+            c->cmsg_type = UDP_SEGMENT;
+            c->cmsg_len = CMSG_LEN(sizeof(uint16));
+            ::memcpy(CMSG_DATA(c), &d.segment, sizeof(uint16));
+        }
+    }
+
+    return ::sendmmsg(handle, hdr, n, 0);
+#else
+    for (uint i = 0; i < n; ++i) {
+        netDatagramBatch::datagram& d = batch._items[first + i];
+        const netAddress* addr = to ? to : (d.addr.sin_port ? &d.addr : 0);
+
+        //no segmentation offload, split the segments here
+        uint seg = d.segment && d.size > d.segment ? d.segment : d.size;
+        for (uint off = 0; off < d.size || off == 0; off += seg) {
+            int len = int(d.size - off < seg ? d.size - off : seg);
+            int k = addr
+                ? sendto(d.data + off, len, 0, addr)
+                : send(d.data + off, len, 0);
+            if (k < 0)
+                return i > 0 ? int(i) : -1;
+            if (seg == 0)
+                break;
+        }
+    }
+
+    return int(n);
+#endif
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 void netSocket::close()
 {
@@ -864,6 +1144,51 @@ int netSocket::wait_write(int timeout)
     return ::select(FD_SETSIZE, 0, &fdsr, 0, timeout < 0 ? 0 : &tv);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+netDatagramBatch* netDatagramBatch::get(uint count, uint bufsize)
+{
+    netDatagramBatch* b = pool<netDatagramBatch>::global().create_item();
+    b->reserve(count, bufsize);
+    return b;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void netDatagramBatch::release(netDatagramBatch*& batch)
+{
+    batch->clear();
+    pool<netDatagramBatch>::global().release_item(batch);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void netDatagramBatch::reserve(uint count, uint bufsize)
+{
+    _count = 0;
+    if (count <= _items.size() && bufsize <= _bufsize)
+        return;
+
+    if (count < _items.size())
+        count = uint(_items.size());
+    if (bufsize < _bufsize)
+        bufsize = _bufsize;
+
+    //buffers aligned to cache lines
+    _bufsize = bufsize;
+    uints stride = align_to_chunks(bufsize, 64) * 64;
+
+    _items.alloc(count);
+    _data.alloc(count * stride + 64);
+
+    uint8* p = (uint8*)align_value_to_power2((uints)_data.ptr(), 6);
+    for (datagram& d : _items) {
+        d.data = p;
+        p += stride;
+    }
+
+#ifdef SYSTYPE_LINUX
+    _msgs.calloc(count * (sizeof(mmsghdr) + sizeof(::iovec) + UDP_CTL_SPACE));
+#endif
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 int netSocket::connected() const
 {
@@ -115,6 +115,11 @@ public:
     ///       overrides any potential port number specified in the \a host.
     void set(const token& host, uint16 port, bool portoverride);
 
+    ///Set up the network address from string without resolving host names
+    /// @return host name that needs to be resolved (see netResolver), or an empty token
+    ///         if the address was fully set up
+    token set_numeric(const token& host, uint16 port, bool portoverride);
+
     void set(uint addr, uint16 port);
 
     bool isLocalHost() const;
@@ -232,6 +237,82 @@ inline char* netaddr2String( char* _astr, const netaddr* ba)
 }
 */
 
+////////////////////////////////////////////////////////////////////////////////
+///Preallocated datagram slots for batched UDP I/O (netSocket::recvmany/sendmany)
+/**
+    Buffers, addresses and the system message headers are allocated once, so the batches
+    can be reused without allocations. Use get()/release() to take the batches from
+    a global pool.
+**/
+class netDatagramBatch
+{
+public:
+
+    struct datagram
+    {
+        uint8* data = 0;                //< datagram buffer of bufsize() bytes
+        uint size = 0;                  //< received size or size to send
+        uint16 segment = 0;             //< GSO/GRO segment size, 0 if not segmented
+        netAddress addr;                //< source or destination address
+    };
+
+    ///Get a batch from the pool
+    /// @param count number of datagram slots
+    /// @param bufsize size of datagram buffers, with GSO/GRO up to 65507 bytes
+    static netDatagramBatch* get(uint count, uint bufsize);
+
+    ///Return batch to the pool
+    static void release(netDatagramBatch*& batch);
+
+    netDatagramBatch() {}
+    netDatagramBatch(uint count, uint bufsize) {
+        reserve(count, bufsize);
+    }
+
+    ///Make sure there are at least count slots with bufsize buffers, clears the batch
+    void reserve(uint count, uint bufsize);
+
+    /// @return number of datagram slots
+    uint capacity() const { return uint(_items.size()); }
+
+    /// @return size of datagram buffers
+    uint bufsize() const { return _bufsize; }
+
+    /// @return number of valid datagrams
+    uint size() const { return _count; }
+
+    void clear() { _count = 0; }
+
+    ///Append a datagram to send
+    /// @return slot to fill or nullptr if the batch is full
+    datagram* add()
+    {
+        if (_count >= _items.size())
+            return 0;
+
+        datagram* d = _items.ptr() + _count++;
+        d->size = 0;
+        d->segment = 0;
+        return d;
+    }
+
+    datagram& operator [] (uint i) { return _items[i]; }
+    const datagram& operator [] (uint i) const { return _items[i]; }
+
+    datagram* begin() { return _items.ptr(); }
+    datagram* end() { return _items.ptr() + _count; }
+
+private:
+
+    friend class netSocket;
+
+    dynarray<datagram> _items;
+    dynarray<uint8> _data;              //< datagram buffers
+    dynarray<uint8> _msgs;              //< system message headers and control data
+    uint _bufsize = 0;
+    uint _count = 0;
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 ///Socket type
 class netSocket
@@ -265,10 +346,32 @@ public:
     int   connect(const token& host, uint16 port, bool portoverride);
     int   connect(const netAddress& addr);
     int   send(const void* buffer, int size, int flags = 0);
+    ///Send multiple memory segments with a single call (sendmsg)
+    /// @note sends at most IOV_MAX segments, the rest is left for the next call
+    /// @return number of bytes sent or -1 on error
+    int   sendv(const binstream_iovec* iov, uint niov, int flags = 0);
     int   sendto(const void* buffer, int size, int flags, const netAddress* to);
     int   recv(void* buffer, int size, int flags = 0);
+    ///Receive into multiple memory segments with a single call (recvmsg)
+    /// @note fills at most IOV_MAX segments
+    /// @return number of bytes received, 0 if the connection was closed or -1 on error
+    int   recvv(const binstream_iovec* iov, uint niov, int flags = 0);
     int   recvfrom(void* buffer, int size, int flags, netAddress* from);
 
+    ///Receive multiple datagrams with a single call (recvmmsg)
+    /// @param batch datagram slots to fill, on return batch.size() is the number of datagrams received
+    /// @param wait block until at least one datagram arrives, otherwise return what's available
+    /// @return number of datagrams received or -1 on error
+    /// @note with GRO enabled a datagram can hold multiple coalesced segments of datagram::segment size
+    int   recvmany(netDatagramBatch& batch, bool wait = true);
+
+    ///Send multiple datagrams with a single call (sendmmsg)
+    /// @param batch datagrams to send, starting at index first
+    /// @param to destination of all datagrams, or null to use the datagram addresses
+    /// @return number of datagrams sent or -1 on error
+    /// @note datagrams with a nonzero segment size are split to segments by the kernel (GSO)
+    int   sendmany(netDatagramBatch& batch, uint first = 0, const netAddress* to = 0);
+
     /// @return 1 if connected, 0 if unknow yet, -1 if connection failed
     int   connected() const;
 
@@ -281,7 +384,16 @@ public:
     void setBroadcast(bool broadcast);
     void setNoDelay(bool nodelay);
     void setReuseAddr(bool reuse);
+    ///Allow multiple sockets to bind the same port, the kernel distributes incoming connections among them
+    /// @return false if not supported on the platform
+    bool setReusePort(bool reuse);
     void setLinger(bool linger, ushort sec);
+    ///Set UDP segment size for generic segmentation offload of all sends
+    /// @return false if not supported on the platform
+    bool setGSO(uint16 segment);
+    ///Enable UDP generic receive offload, coalescing received datagrams of a flow
+    /// @return false if not supported on the platform
+    bool setGRO(bool enable);
 
     static bool isNonBlockingError();
     static int select(netSocket** reads, netSocket** writes, int timeout);
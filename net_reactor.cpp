@@ -0,0 +1,632 @@
+/* ***** BEGIN LICENSE BLOCK *****
+* Version: MPL 1.1/GPL 2.0/LGPL 2.1
+*
+* The contents of this file are subject to the Mozilla Public License Version
+* 1.1 (the "License"); you may not use this file except in compliance with
+* the License. You may obtain a copy of the License at
+* http://www.mozilla.org/MPL/
+*
+* Software distributed under the License is distributed on an "AS IS" basis,
+* WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+* for the specific language governing rights and limitations under the
+* License.
+*
+* The Original Code is COID/comm module.
+*
+* The Initial Developer of the Original Code is
+* Outerra.
+* Portions created by the Initial Developer are Copyright (C) 2026
+* the Initial Developer. All Rights Reserved.
+*
+* Contributor(s):
+* Brano Kemen
+*
+* Alternatively, the contents of this file may be used under the terms of
+* either the GNU General Public License Version 2 or later (the "GPL"), or
+* the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+* in which case the provisions of the GPL or the LGPL are applicable instead
+* of those above. If you wish to allow use of your version of this file only
+* under the terms of either the GPL or the LGPL, and not to allow others to
+* use your version of this file under the terms of the MPL, indicate your
+* decision by deleting the provisions above and replace them with the notice
+* and other provisions required by the GPL or the LGPL. If you do not delete
+* the provisions above, a recipient may use your version of this file under
+* the terms of any one of the MPL, the GPL or the LGPL.
+*
+* ***** END LICENSE BLOCK ***** */
+
+#include "net_reactor.h"
+#include "taskmaster.h"
+#include "timer.h"
+
+#include <algorithm>
+
+#ifdef SYSTYPE_WIN
+
+#define WIN32_LEAN_AND_MEAN
+#include <winsock.h>
+
+#else
+
+# include <unistd.h>
+# include <sys/select.h>
+
+# ifdef SYSTYPE_LINUX
+#  include <sys/epoll.h>
+#  include <sys/eventfd.h>
+#  define COID_NET_EPOLL
+# endif
+
+#endif
+
+
+COID_NAMESPACE_BEGIN
+
+#ifdef COID_NET_EPOLL
+
+static uint to_epoll_events(uint events)
+{
+    uint e = EPOLLET | EPOLLRDHUP;
+    if (events & netReactor::EV_READ)  e |= EPOLLIN;
+    if (events & netReactor::EV_WRITE) e |= EPOLLOUT;
+    return e;
+}
+
+static uint from_epoll_events(uint e)
+{
+    uint events = 0;
+    if (e & EPOLLIN)                events |= netReactor::EV_READ;
+    if (e & EPOLLOUT)               events |= netReactor::EV_WRITE;
+    if (e & (EPOLLRDHUP | EPOLLHUP)) events |= netReactor::EV_HANGUP;
+    if (e & EPOLLERR)               events |= netReactor::EV_ERROR;
+    return events;
+}
+
+#else
+
+///Max wait when the loop can't be woken by post()
+static const int SELECT_POLL_MS = 10;
+
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+netReactor::netReactor()
+    : _post_sync(500, false)
+    , _woken(false)
+    , _stop(false)
+{
+#ifdef COID_NET_EPOLL
+    _epfd = ::epoll_create1(EPOLL_CLOEXEC);
+    _evfd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if (_epfd >= 0 && _evfd >= 0) {
+        epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.u64 = 0;
+        ::epoll_ctl(_epfd, EPOLL_CTL_ADD, _evfd, &ev);
+    }
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+netReactor::~netReactor()
+{
+#ifdef COID_NET_EPOLL
+    if (_evfd >= 0) ::close(_evfd);
+    if (_epfd >= 0) ::close(_epfd);
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool netReactor::is_valid() const
+{
+#ifdef COID_NET_EPOLL
+    return _epfd >= 0 && _evfd >= 0;
+#else
+    return true;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+netReactor::entry* netReactor::get_entry(uint64 id)
+{
+    uint slot = id_slot(id);
+    if (slot >= _entries.size())
+        return 0;
+
+    entry& e = _entries[slot];
+    return e.gen == id_gen(id) && e.handle != UMAXS ? &e : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+netReactor::timer* netReactor::get_timer(uint64 id)
+{
+    uint slot = id_slot(id);
+    if (slot >= _timers.size())
+        return 0;
+
+    timer& t = _timers[slot];
+    return t.gen == id_gen(id) && t.active ? &t : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint64 netReactor::add(uints handle, uint events, handler_fn&& fn)
+{
+    if (handle == UMAXS)
+        return 0;
+
+    uint slot;
+    if (!_free.pop(slot)) {
+        slot = uint(_entries.size());
+        _entries.add();
+    }
+
+    entry& e = _entries[slot];
+    e.handle = handle;
+    e.events = events;
+    e.fn = std::move(fn);
+
+    uint64 id = make_id(slot, e.gen);
+
+#ifdef COID_NET_EPOLL
+    epoll_event ev;
+    ev.events = to_epoll_events(events);
+    ev.data.u64 = id;
+
+    if (::epoll_ctl(_epfd, EPOLL_CTL_ADD, int(handle), &ev) != 0) {
+        e.handle = UMAXS;
+        _dead.push(std::move(e.fn));
+        ++e.gen;
+        *_free.add() = slot;
+        return 0;
+    }
+#else
+    if (_nactive >= FD_SETSIZE) {
+        e.handle = UMAXS;
+        _dead.push(std::move(e.fn));
+        ++e.gen;
+        *_free.add() = slot;
+        return 0;
+    }
+#endif
+
+    ++_nactive;
+    return id;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool netReactor::modify(uint64 id, uint events)
+{
+    entry* e = get_entry(id);
+    if (!e)
+        return false;
+
+    e->events = events;
+
+#ifdef COID_NET_EPOLL
+    epoll_event ev;
+    ev.events = to_epoll_events(events);
+    ev.data.u64 = id;
+
+    return ::epoll_ctl(_epfd, EPOLL_CTL_MOD, int(e->handle), &ev) == 0;
+#else
+    return true;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void netReactor::remove(uint64 id)
+{
+    entry* e = get_entry(id);
+    if (!e)
+        return;
+
+#ifdef COID_NET_EPOLL
+    epoll_event ev;
+    ::epoll_ctl(_epfd, EPOLL_CTL_DEL, int(e->handle), &ev);
+#endif
+
+    //the handler may be running right now
+    _dead.push(std::move(e->fn));
+
+    e->handle = UMAXS;
+    e->events = 0;
+    ++e->gen;
+    *_free.add() = id_slot(id);
+    --_nactive;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint64 netReactor::add_timer(uint ms, uint period, task_fn&& fn)
+{
+    uint slot;
+    if (!_free_timers.pop(slot)) {
+        slot = uint(_timers.size());
+        _timers.add();
+    }
+
+    timer& t = _timers[slot];
+    t.due = nsec_timer::current_time_ns() + uint64(ms) * 1000000;
+    t.period = period;
+    t.active = true;
+    t.fn = std::move(fn);
+
+    timer_ref* r = _heap.add();
+    r->due = t.due;
+    r->id = make_id(slot, t.gen);
+    std::push_heap(_heap.ptr(), _heap.ptre());
+
+    return r->id;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void netReactor::cancel_timer(uint64 id)
+{
+    timer* t = get_timer(id);
+    if (!t)
+        return;
+
+    //the heap entry is skipped once the generation doesn't match
+    _dead_timers.push(std::move(t->fn));
+    t->active = false;
+    ++t->gen;
+    *_free_timers.add() = id_slot(id);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void netReactor::post(task_fn&& fn)
+{
+    {
+        GUARDTHIS(_post_sync);
+        _posted.push(std::move(fn));
+    }
+    wake();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void netReactor::stop()
+{
+    _stop.store(true, std::memory_order_release);
+    wake();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void netReactor::wake()
+{
+    if (_woken.exchange(true))
+        return;
+
+#ifdef COID_NET_EPOLL
+    uint64 one = 1;
+    ssize_t r = ::write(_evfd, &one, sizeof(one));
+    (void)r;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void netReactor::run()
+{
+    while (!_stop.load(std::memory_order_acquire))
+        run_once(-1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int netReactor::run_once(int timeout)
+{
+    if (_heap.size()) {
+        uint64 now = nsec_timer::current_time_ns();
+        uint64 due = _heap[0].due;
+        int ms = due > now ? int((due - now + 999999) / 1000000) : 0;
+
+        if (timeout < 0 || ms < timeout)
+            timeout = ms;
+    }
+
+    int n = wait_events(timeout);
+    n += run_timers();
+    run_posted();
+
+    _dead.reset();
+    _dead_timers.reset();
+
+    return n;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int netReactor::wait_events(int timeout)
+{
+#ifdef COID_NET_EPOLL
+
+    static const int MAX_EVENTS = 256;
+    epoll_event evs[MAX_EVENTS];
+
+    if (_woken.load(std::memory_order_relaxed))
+        timeout = 0;
+
+    int n = ::epoll_wait(_epfd, evs, MAX_EVENTS, timeout);
+    int ndispatched = 0;
+
+    for (int i = 0; i < n; ++i)
+    {
+        uint64 id = evs[i].data.u64;
+        if (id == 0) {
+            uint64 v;
+            ssize_t r = ::read(_evfd, &v, sizeof(v));
+            (void)r;
+            continue;
+        }
+
+        //may have been removed by a previous handler in this batch
+        entry* e = get_entry(id);
+        if (!e)
+            continue;
+
+        e->fn(from_epoll_events(evs[i].events));
+        ++ndispatched;
+    }
+
+    return ndispatched;
+
+#else
+
+    if (_nactive == 0) {
+        if (timeout < 0 || timeout > SELECT_POLL_MS)
+            timeout = SELECT_POLL_MS;
+        if (!_woken.load(std::memory_order_relaxed))
+            thread::wait(timeout);
+        return 0;
+    }
+
+    fd_set r, w, x;
+    FD_ZERO(&r);
+    FD_ZERO(&w);
+    FD_ZERO(&x);
+
+    ints maxfd = 0;
+    for (const entry& e : _entries) {
+        if (e.handle == UMAXS)
+            continue;
+        if (e.events & EV_READ)  FD_SET(e.handle, &r);
+        if (e.events & EV_WRITE) FD_SET(e.handle, &w);
+        FD_SET(e.handle, &x);
+        if (ints(e.handle) > maxfd)
+            maxfd = e.handle;
+    }
+
+    if (timeout < 0 || timeout > SELECT_POLL_MS)
+        timeout = SELECT_POLL_MS;
+    if (_woken.load(std::memory_order_relaxed))
+        timeout = 0;
+
+    timeval tv;
+    tv.tv_sec = timeout / 1000;
+    tv.tv_usec = (timeout % 1000) * 1000;
+
+    if (::select(int(maxfd + 1), &r, &w, &x, &tv) <= 0)
+        return 0;
+
+    int ndispatched = 0;
+    uints n = _entries.size();
+
+    for (uints i = 0; i < n; ++i)
+    {
+        entry& e = _entries[i];
+        if (e.handle == UMAXS)
+            continue;
+
+        uint events = 0;
+        if (FD_ISSET(e.handle, &r)) events |= EV_READ;
+        if (FD_ISSET(e.handle, &w)) events |= EV_WRITE;
+        if (FD_ISSET(e.handle, &x)) events |= EV_ERROR;
+
+        if (events) {
+            _entries[i].fn(events);
+            ++ndispatched;
+        }
+    }
+
+    return ndispatched;
+
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int netReactor::run_timers()
+{
+    if (!_heap.size())
+        return 0;
+
+    uint64 now = nsec_timer::current_time_ns();
+    int n = 0;
+
+    while (_heap.size() && _heap[0].due <= now)
+    {
+        std::pop_heap(_heap.ptr(), _heap.ptre());
+        uint64 id = _heap.last()->id;
+        _heap.pop();
+
+        timer* t = get_timer(id);
+        if (!t)
+            continue;   //cancelled
+
+        if (t->period) {
+            t->due += uint64(t->period) * 1000000;
+            if (t->due < now)
+                t->due = now;
+
+            timer_ref* r = _heap.add();
+            r->due = t->due;
+            r->id = id;
+            std::push_heap(_heap.ptr(), _heap.ptre());
+
+            t->fn();
+        }
+        else {
+            //one-shot timer is released before invoking, so it can reschedule itself
+            task_fn fn = std::move(t->fn);
+            t->active = false;
+            ++t->gen;
+            *_free_timers.add() = id_slot(id);
+
+            fn();
+        }
+        ++n;
+    }
+
+    return n;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void netReactor::run_posted()
+{
+    if (!_woken.load(std::memory_order_relaxed))
+        return;
+
+    {
+        GUARDTHIS(_post_sync);
+        _woken = false;
+        _running.swap(_posted);
+    }
+
+    for (task_fn& fn : _running)
+        fn();
+
+    _running.reset();
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+bool netReactorGroup::start(uint n)
+{
+    if (_reactors.size() || n == 0)
+        return false;
+
+    for (uint i = 0; i < n; ++i)
+        *_reactors.add() = new netReactor;
+
+    for (uint i = 0; i < n; ++i) {
+        netReactor* r = _reactors[i];
+        _threads.add()->create_fn([r]() -> void* {
+            r->run();
+            return 0;
+        }, 0, "netReactor");
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool netReactorGroup::start(taskmaster& tm, uint n)
+{
+    if (_reactors.size() || n == 0)
+        return false;
+
+    _uses_tm = true;
+
+    for (uint i = 0; i < n; ++i)
+        *_reactors.add() = new netReactor;
+
+    for (uint i = 0; i < n; ++i) {
+        ++_running;
+        netReactor* r = _reactors[i];
+        tm.push(taskmaster::EPriority::LOW, 0, [this, r]() {
+            r->run();
+            --_running;
+        });
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void netReactorGroup::stop()
+{
+    for (netReactor* r : _reactors)
+        r->stop();
+
+    for (thread& t : _threads)
+        thread::join(t);
+
+    if (_uses_tm) {
+        while (_running.load() > 0)
+            thread::wait(1);
+    }
+
+    _listeners.reset();
+
+    for (netReactor* r : _reactors)
+        delete r;
+
+    _reactors.reset();
+    _threads.reset();
+    _uses_tm = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint16 netReactorGroup::listen(const token& host, uint16 port, accept_fn&& fn, int backlog)
+{
+    uint n = size();
+    if (n == 0 || _listeners.size())
+        return 0;
+
+    _accept = std::move(fn);
+
+    charstr hostz = host;
+
+    for (uint i = 0; i < n; ++i)
+    {
+        netSocket& s = *_listeners.add();
+        if (!s.open(true))
+            return 0;
+
+        s.setReuseAddr(true);
+        bool sharded = s.setReusePort(true);
+
+        if (s.bind(hostz.c_str(), port) != 0 || s.listen(backlog) != 0) {
+            _listeners.reset();
+            return 0;
+        }
+        s.setBlocking(false);
+
+        if (port == 0) {
+            netAddress addr;
+            s.getLocalAddress(&addr);
+            port = addr.getPort();
+        }
+
+        uints handle = s.getHandle();
+        _reactors[i]->post([this, i, handle]() {
+            _reactors[i]->add(handle, netReactor::EV_READ, [this, i](uint) {
+                accept_all(i);
+            });
+        });
+
+        if (!sharded)
+            break;
+    }
+
+    return port;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void netReactorGroup::accept_all(uint i)
+{
+    netSocket& s = _listeners[i];
+    netReactor& r = *_reactors[i];
+
+    for (;;)
+    {
+        netAddress addr;
+        uints h = s.accept(&addr);
+        if (h == UMAXS)
+            break;
+
+        netSocket c(h);
+        c.setBlocking(false);
+        c.setHandleInvalid();
+
+        _accept(r, h, addr);
+    }
+}
+
+COID_NAMESPACE_END
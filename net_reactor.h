@@ -0,0 +1,260 @@
+#pragma once
+
+/* ***** BEGIN LICENSE BLOCK *****
+* Version: MPL 1.1/GPL 2.0/LGPL 2.1
+*
+* The contents of this file are subject to the Mozilla Public License Version
+* 1.1 (the "License"); you may not use this file except in compliance with
+* the License. You may obtain a copy of the License at
+* http://www.mozilla.org/MPL/
+*
+* Software distributed under the License is distributed on an "AS IS" basis,
+* WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+* for the specific language governing rights and limitations under the
+* License.
+*
+* The Original Code is COID/comm module.
+*
+* The Initial Developer of the Original Code is
+* Outerra.
+* Portions created by the Initial Developer are Copyright (C) 2026
+* the Initial Developer. All Rights Reserved.
+*
+* Contributor(s):
+* Brano Kemen
+*
+* Alternatively, the contents of this file may be used under the terms of
+* either the GNU General Public License Version 2 or later (the "GPL"), or
+* the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+* in which case the provisions of the GPL or the LGPL are applicable instead
+* of those above. If you wish to allow use of your version of this file only
+* under the terms of either the GPL or the LGPL, and not to allow others to
+* use your version of this file under the terms of the MPL, indicate your
+* decision by deleting the provisions above and replace them with the notice
+* and other provisions required by the GPL or the LGPL. If you do not delete
+* the provisions above, a recipient may use your version of this file under
+* the terms of any one of the MPL, the GPL or the LGPL.
+*
+* ***** END LICENSE BLOCK ***** */
+#ifndef __COID_COMM_NET_REACTOR__HEADER_FILE__
+#define __COID_COMM_NET_REACTOR__HEADER_FILE__
+
+#include "namespace.h"
+#include "net.h"
+#include "dynarray.h"
+#include "function.h"
+#include "pthreadx.h"
+#include "sync/mutex.h"
+
+#include <atomic>
+
+COID_NAMESPACE_BEGIN
+
+class taskmaster;
+
+////////////////////////////////////////////////////////////////////////////////
+///Event loop dispatching socket readiness notifications and timers
+/**
+    Sockets are registered together with a handler that's invoked with the set of ready
+    events. On Linux the reactor uses edge-triggered epoll, so the handler must consume
+    everything available (recv/accept until netSocket::isNonBlockingError()) before it
+    returns, otherwise it won't be notified again until new data arrive. Registered
+    sockets should be in non-blocking mode.
+    On other platforms it falls back to select(), limited to FD_SETSIZE sockets.
+
+    The reactor is single-threaded: add/modify/remove and timer methods must be called
+    from the thread running the loop (handlers included). Other threads can use post()
+    to run code on the reactor thread, and stop() to end the loop.
+
+    Usage:
+        netReactor reactor;
+        reactor.add(sock.getHandle(), netReactor::EV_READ, [&](uint events) {
+            while ((n = sock.recv(buf, size)) > 0) ...
+        });
+        reactor.run();
+**/
+class netReactor
+{
+public:
+
+    enum EEvent {
+        EV_READ = 1,
+        EV_WRITE = 2,
+        EV_HANGUP = 4,                  //< peer closed the connection
+        EV_ERROR = 8,
+    };
+
+    typedef function<void(uint events)> handler_fn;
+    typedef function<void()> task_fn;
+
+    netReactor();
+    ~netReactor();
+
+    /// @return true if the reactor was initialized successfully
+    bool is_valid() const;
+
+    ///Register socket for readiness notifications
+    /// @param handle socket handle (netSocket::getHandle())
+    /// @param events combination of EV_READ and EV_WRITE flags
+    /// @param fn handler receiving the ready events
+    /// @return registration id, 0 on error
+    uint64 add(uints handle, uint events, handler_fn&& fn);
+
+    ///Change the set of events the socket is registered for
+    bool modify(uint64 id, uint events);
+
+    ///Unregister socket, can be called from within its handler
+    /// @note doesn't close the socket
+    void remove(uint64 id);
+
+    ///Schedule a timer
+    /// @param ms delay in milliseconds
+    /// @param period repeat period in milliseconds, 0 for a one-shot timer
+    /// @return timer id
+    uint64 add_timer(uint ms, uint period, task_fn&& fn);
+
+    ///Cancel timer, can be called from within its handler
+    void cancel_timer(uint64 id);
+
+    ///Run function on the reactor thread during the next loop iteration
+    /// @note can be called from any thread
+    void post(task_fn&& fn);
+
+    ///Wait for and dispatch ready events, expired timers and posted functions
+    /// @param timeout max time to wait in milliseconds, -1 infinite
+    /// @return number of dispatched events and timers
+    int run_once(int timeout);
+
+    ///Run the loop until stop() is called
+    /// @note returns immediately if stop() was called already, a stopped reactor stays stopped
+    void run();
+
+    ///Make run() return, can be called from any thread
+    void stop();
+
+    /// @return number of registered sockets
+    uints count() const { return _nactive; }
+
+private:
+
+    struct entry
+    {
+        uints handle = UMAXS;
+        uint events = 0;
+        uint gen = 0;
+        handler_fn fn;
+    };
+
+    struct timer
+    {
+        uint64 due = 0;                 //< due time in ns
+        uint period = 0;
+        uint gen = 0;
+        bool active = false;
+        task_fn fn;
+    };
+
+    ///Heap of pending timers ordered by due time
+    struct timer_ref
+    {
+        uint64 due;
+        uint64 id;
+
+        bool operator < (const timer_ref& t) const { return due > t.due; }
+    };
+
+    static uint64 make_id(uint slot, uint gen) { return (uint64(gen) << 32) | (slot + 1); }
+    static uint id_slot(uint64 id) { return uint(id) - 1; }
+    static uint id_gen(uint64 id) { return uint(id >> 32); }
+
+    entry* get_entry(uint64 id);
+    timer* get_timer(uint64 id);
+
+    int wait_events(int timeout);
+    int run_timers();
+    void run_posted();
+    void wake();
+
+    dynarray<entry> _entries;
+    dynarray<uint> _free;               //< free slots in _entries
+    uints _nactive = 0;
+
+    dynarray<timer> _timers;
+    dynarray<uint> _free_timers;
+    dynarray<timer_ref> _heap;
+
+    dynarray<handler_fn> _dead;         //< handlers of removed sockets, released after dispatch
+    dynarray<task_fn> _dead_timers;
+
+    comm_mutex _post_sync;
+    dynarray<task_fn> _posted;
+    dynarray<task_fn> _running;
+
+    std::atomic_bool _woken;
+    std::atomic_bool _stop;
+
+    int _epfd = -1;                     //< epoll descriptor
+    int _evfd = -1;                     //< eventfd for wakeups
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+///Set of reactors, one per thread, with accept sharding
+/**
+    Each reactor runs on its own thread, either spawned by the group or borrowed from
+    a taskmaster. listen() opens one listening socket per reactor on the same port with
+    SO_REUSEPORT, so the kernel spreads incoming connections across the reactors without
+    a shared accept queue. Accepted connections are handed to the accept callback on the
+    reactor that accepted them, which should register them with that reactor.
+    Where SO_REUSEPORT isn't available, a single listening socket on the first reactor
+    is used.
+**/
+class netReactorGroup
+{
+public:
+
+    ///Accept callback, receives the reactor and the handle of the accepted socket (in non-blocking mode)
+    typedef function<void(netReactor& reactor, uints handle, const netAddress& addr)> accept_fn;
+
+    netReactorGroup() {}
+    ~netReactorGroup() { stop(); }
+
+    ///Start reactors on new threads
+    /// @param n number of reactors
+    bool start(uint n);
+
+    ///Start reactors as long running tasks on the taskmaster
+    /// @param n number of reactors, should not exceed the number of low priority threads
+    ///         of the taskmaster, since each one occupies a worker until stop() is called
+    bool start(taskmaster& tm, uint n);
+
+    ///Stop all reactors and wait for them to finish
+    void stop();
+
+    ///Listen on given address, with accepted connections distributed across reactors
+    /// @param host local address to bind to
+    /// @param port port to listen on, 0 for an ephemeral port
+    /// @param fn callback invoked for each accepted connection
+    /// @return port number the group is listening on, 0 on error
+    uint16 listen(const token& host, uint16 port, accept_fn&& fn, int backlog = 1024);
+
+    uint size() const { return uint(_reactors.size()); }
+
+    netReactor& reactor(uint i) { return *_reactors[i]; }
+
+private:
+
+    void accept_all(uint i);
+
+    dynarray<netReactor*> _reactors;
+    dynarray<thread> _threads;
+    dynarray<netSocket> _listeners;
+    accept_fn _accept;
+
+    std::atomic<uint32> _running{0};    //< running taskmaster reactors
+    bool _uses_tm = false;
+};
+
+COID_NAMESPACE_END
+
+#endif //__COID_COMM_NET_REACTOR__HEADER_FILE__
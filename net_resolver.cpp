@@ -0,0 +1,439 @@
+/* ***** BEGIN LICENSE BLOCK *****
+* Version: MPL 1.1/GPL 2.0/LGPL 2.1
+*
+* The contents of this file are subject to the Mozilla Public License Version
+* 1.1 (the "License"); you may not use this file except in compliance with
+* the License. You may obtain a copy of the License at
+* http://www.mozilla.org/MPL/
+*
+* Software distributed under the License is distributed on an "AS IS" basis,
+* WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+* for the specific language governing rights and limitations under the
+* License.
+*
+* The Original Code is COID/comm module.
+*
+* The Initial Developer of the Original Code is
+* Outerra.
+* Portions created by the Initial Developer are Copyright (C) 2026
+* the Initial Developer. All Rights Reserved.
+*
+* Contributor(s):
+* Brano Kemen
+*
+* Alternatively, the contents of this file may be used under the terms of
+* either the GNU General Public License Version 2 or later (the "GPL"), or
+* the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+* in which case the provisions of the GPL or the LGPL are applicable instead
+* of those above. If you wish to allow use of your version of this file only
+* under the terms of either the GPL or the LGPL, and not to allow others to
+* use your version of this file under the terms of the MPL, indicate your
+* decision by deleting the provisions above and replace them with the notice
+* and other provisions required by the GPL or the LGPL. If you do not delete
+* the provisions above, a recipient may use your version of this file under
+* the terms of any one of the MPL, the GPL or the LGPL.
+*
+* ***** END LICENSE BLOCK ***** */
+
+#include "net_resolver.h"
+#include "taskmaster.h"
+#include "timer.h"
+
+#include <algorithm>
+
+#ifdef SYSTYPE_WIN
+
+#define WIN32_LEAN_AND_MEAN
+#include <winsock.h>
+
+#else
+
+# include <sys/types.h>
+# include <sys/socket.h>
+# include <netinet/in.h>
+# include <netdb.h>
+
+#endif
+
+COID_NAMESPACE_BEGIN
+
+////////////////////////////////////////////////////////////////////////////////
+netResolver& netResolver::instance()
+{
+    static netResolver _resolver;
+    return _resolver;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+netResolver::netResolver(uint nthreads)
+    : _mutex(0, false)
+    , _maxthreads(nthreads ? nthreads : 1)
+{}
+
+////////////////////////////////////////////////////////////////////////////////
+netResolver::~netResolver()
+{
+    _mutex.lock();
+    _stop = true;
+    _mutex.unlock();
+    _cv.notify_all();
+
+    for (thread& t : _threads)
+        thread::join(t);
+
+    //requests still waiting for a lookup
+    for (auto& p : _cache) {
+        for (waiter& w : p.second->waiters)
+            complete(ersABORT, w.addr, w.fn, w.tm);
+        delete p.second;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void netResolver::set_ttl(uint ttl, uint negative_ttl)
+{
+    _mutex.lock();
+    _ttl_ns = ttl * 1000000000ULL;
+    _negative_ttl_ns = negative_ttl * 1000000000ULL;
+    _mutex.unlock();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void netResolver::set_max_entries(uint n)
+{
+    _mutex.lock();
+    _max_entries = n ? n : 1;
+    if (_cache.size() > _max_entries)
+        prune();
+    _mutex.unlock();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void netResolver::resolve(const token& host, uint16 port, bool portoverride, result_fn&& fn, taskmaster* tm)
+{
+    netAddress addr;
+    token name = addr.set_numeric(host, port, portoverride);
+    if (name.is_empty()) {
+        complete(0, addr, fn, tm);
+        return;
+    }
+
+    waiter w;
+    w.addr = addr;
+    w.fn = std::move(fn);
+    w.tm = tm;
+
+    opcd err;
+    bool queued = false;
+
+    _mutex.lock();
+    ECached c = find(name, addr, err, &w, queued);
+    _mutex.unlock();
+
+    if (queued)
+        _cv.notify_one();
+
+    if (c == ECached::HIT)
+        complete(0, addr, w.fn, tm);
+    else if (c == ECached::NEGATIVE)
+        complete(err, addr, w.fn, tm);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+opcd netResolver::lookup(const token& host, uint16 port, bool portoverride, netAddress& addr)
+{
+    token name = addr.set_numeric(host, port, portoverride);
+    if (name.is_empty())
+        return 0;
+
+    opcd err;
+    bool queued = false;
+
+    _mutex.lock();
+    ECached c = find(name, addr, err, 0, queued);
+    _mutex.unlock();
+
+    if (queued)
+        _cv.notify_one();
+
+    return c == ECached::HIT ? opcd(0)
+        : (c == ECached::NEGATIVE ? err : ersRETRY);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+opcd netResolver::resolve_sync(const token& host, uint16 port, bool portoverride, netAddress& addr)
+{
+    token name = addr.set_numeric(host, port, portoverride);
+    if (name.is_empty())
+        return 0;
+
+    opcd err;
+    bool queued = false;
+    bool done = false;
+
+    waiter w;
+    w.addr = addr;
+    w.fn = [this, &err, &addr, &done](opcd e, const netAddress& a) {
+        _mutex.lock();
+        err = e;
+        addr = a;
+        done = true;
+        _mutex.unlock();
+        _sync_cv.notify_all();
+    };
+
+    _mutex.lock();
+    ECached c = find(name, addr, err, &w, queued);
+    _mutex.unlock();
+
+    if (queued)
+        _cv.notify_one();
+
+    if (c == ECached::HIT)
+        return 0;
+    if (c == ECached::NEGATIVE)
+        return err;
+
+    //wait for the lookup, shared with other requests for the host
+    _mutex.lock();
+    while (!done)
+        _sync_cv.wait(_mutex);
+    _mutex.unlock();
+
+    return err;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void netResolver::prefetch(const token& host)
+{
+    netAddress addr;
+    lookup(host, 0, false, addr);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void netResolver::clear()
+{
+    _mutex.lock();
+
+    //entries with lookups in progress are kept for their waiters
+    for (auto it = _cache.begin(); it != _cache.end(); ) {
+        entry* e = (*it).second;
+        if (!e->pending) {
+            delete e;
+            _cache.erase(it);
+        }
+        else
+            ++it;
+    }
+
+    _mutex.unlock();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void netResolver::prune()
+{
+    dynarray<uint64> expires;
+    for (auto& p : _cache)
+        if (!p.second->pending)
+            *expires.add() = p.second->expires;
+
+    if (expires.size() == 0)
+        return;
+
+    uint64 now = nsec_timer::current_time_ns();
+    uints n = std::count_if(expires.begin(), expires.end(), [now](uint64 t) { return t <= now; });
+    if (n < expires.size() / 4)
+        n = expires.size() / 4;
+    if (n == 0)
+        n = 1;
+
+    std::nth_element(expires.begin(), expires.begin() + (n - 1), expires.end());
+    uint64 limit = expires[n - 1];
+
+    for (auto it = _cache.begin(); it != _cache.end(); ) {
+        entry* e = (*it).second;
+        if (!e->pending && e->expires <= limit) {
+            delete e;
+            _cache.erase(it);
+        }
+        else
+            ++it;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+opcd netResolver::system_resolve(const token& name, uint32& addr)
+{
+    charstr namez = name;
+
+#ifdef SYSTYPE_WIN
+    //winsock uses thread local storage for the result
+    hostent* hp = ::gethostbyname(namez.ptr());
+    if (!hp)
+        return WSAGetLastError() == WSAHOST_NOT_FOUND ? ersNOT_FOUND : ersFAILED;
+
+    ::memcpy(&addr, hp->h_addr, sizeof(addr));
+    return 0;
+#else
+    addrinfo hints;
+    ::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    addrinfo* res = 0;
+    int rc = ::getaddrinfo(namez.ptr(), 0, &hints, &res);
+    if (rc != 0 || !res)
+        return rc == EAI_NONAME ? ersNOT_FOUND : ersFAILED;
+
+    addr = ((const sockaddr_in*)res->ai_addr)->sin_addr.s_addr;
+    ::freeaddrinfo(res);
+    return 0;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+netResolver::ECached netResolver::find(const token& name, netAddress& addr, opcd& err, waiter* w, bool& queued)
+{
+    charstr key = name;
+    entry* e;
+
+    entry** pe = _cache.find_value(key);
+    if (pe)
+        e = *pe;
+    else {
+        if (_cache.size() >= _max_entries)
+            prune();
+
+        e = new entry;
+        _cache.insert_key_value(key, e);
+    }
+
+    bool fresh = nsec_timer::current_time_ns() < e->expires;
+
+    if (e->err == NOERR) {
+        //expired entries are served while being refreshed
+        addr.sin_addr = e->addr;
+        if (!fresh)
+            queued = queue_lookup(e, key);
+        return ECached::HIT;
+    }
+
+    if (fresh) {
+        err = e->err;
+        return ECached::NEGATIVE;
+    }
+
+    if (w)
+        *e->waiters.add() = std::move(*w);
+    queued = queue_lookup(e, key);
+
+    return ECached::MISS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool netResolver::queue_lookup(entry* e, const charstr& name)
+{
+    if (e->pending)
+        return false;
+
+    e->pending = true;
+    *_queue.add() = name;
+
+    if (_idle == 0 && _threads.size() < _maxthreads) {
+        _threads.add()->create_fn([this]() -> void* {
+            return worker();
+        }, 0, "netResolver");
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void netResolver::update(entry* e, opcd err, uint32 addr)
+{
+    uint64 now = nsec_timer::current_time_ns();
+
+    if (err == NOERR) {
+        e->addr = addr;
+        e->err = 0;
+        e->expires = now + _ttl_ns;
+    }
+    else if (e->err == NOERR && err != ersNOT_FOUND) {
+        //transient failure, keep serving the old address for a while
+        e->expires = now + _negative_ttl_ns;
+    }
+    else {
+        e->err = err;
+        e->expires = now + _negative_ttl_ns;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void netResolver::complete(opcd e, const netAddress& addr, result_fn& fn, taskmaster* tm)
+{
+    if (!fn)
+        return;
+
+    if (tm) {
+        result_fn f = std::move(fn);
+        tm->push(taskmaster::EPriority::NORMAL, 0, [f, e, addr]() {
+            f(e, addr);
+        });
+    }
+    else
+        fn(e, addr);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void* netResolver::worker()
+{
+    _mutex.lock();
+
+    for (;;)
+    {
+        while (_qfirst >= _queue.size() && !_stop) {
+            ++_idle;
+            _cv.wait(_mutex);
+            --_idle;
+        }
+
+        if (_stop)
+            break;
+
+        charstr name;
+        name.swap(_queue[_qfirst++]);
+        if (_qfirst == _queue.size()) {
+            _queue.reset();
+            _qfirst = 0;
+        }
+
+        _mutex.unlock();
+
+        uint32 a = 0;
+        opcd err = system_resolve(name, a);
+
+        dynarray<waiter> waiters;
+
+        _mutex.lock();
+        entry** pe = _cache.find_value(name);
+        if (pe) {
+            entry* e = *pe;
+            e->pending = false;
+            update(e, err, a);
+            waiters.swap(e->waiters);
+        }
+        _mutex.unlock();
+
+        for (waiter& w : waiters) {
+            w.addr.sin_addr = err == NOERR ? a : 0;
+            complete(err, w.addr, w.fn, w.tm);
+        }
+
+        _mutex.lock();
+    }
+
+    _mutex.unlock();
+    return 0;
+}
+
+COID_NAMESPACE_END
@@ -0,0 +1,192 @@
+#pragma once
+
+/* ***** BEGIN LICENSE BLOCK *****
+* Version: MPL 1.1/GPL 2.0/LGPL 2.1
+*
+* The contents of this file are subject to the Mozilla Public License Version
+* 1.1 (the "License"); you may not use this file except in compliance with
+* the License. You may obtain a copy of the License at
+* http://www.mozilla.org/MPL/
+*
+* Software distributed under the License is distributed on an "AS IS" basis,
+* WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+* for the specific language governing rights and limitations under the
+* License.
+*
+* The Original Code is COID/comm module.
+*
+* The Initial Developer of the Original Code is
+* Outerra.
+* Portions created by the Initial Developer are Copyright (C) 2026
+* the Initial Developer. All Rights Reserved.
+*
+* Contributor(s):
+* Brano Kemen
+*
+* Alternatively, the contents of this file may be used under the terms of
+* either the GNU General Public License Version 2 or later (the "GPL"), or
+* the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+* in which case the provisions of the GPL or the LGPL are applicable instead
+* of those above. If you wish to allow use of your version of this file only
+* under the terms of either the GPL or the LGPL, and not to allow others to
+* use your version of this file under the terms of the MPL, indicate your
+* decision by deleting the provisions above and replace them with the notice
+* and other provisions required by the GPL or the LGPL. If you do not delete
+* the provisions above, a recipient may use your version of this file under
+* the terms of any one of the MPL, the GPL or the LGPL.
+*
+* ***** END LICENSE BLOCK ***** */
+#ifndef __COID_COMM_NET_RESOLVER__HEADER_FILE__
+#define __COID_COMM_NET_RESOLVER__HEADER_FILE__
+
+#include "namespace.h"
+#include "net.h"
+#include "dynarray.h"
+#include "function.h"
+#include "pthreadx.h"
+#include "hash/hashmap.h"
+#include "sync/_mutex.h"
+#include "sync/condition_variable.h"
+
+COID_NAMESPACE_BEGIN
+
+class taskmaster;
+
+////////////////////////////////////////////////////////////////////////////////
+///Asynchronous host name resolver with an in-process cache
+/**
+    Host names are resolved on a small pool of resolver threads, so callers never block
+    on the system resolver. Results are cached: successful lookups for ttl seconds and
+    failed ones for negative_ttl seconds. Expired successful entries keep being served
+    while a refresh runs in the background, so only the very first lookup of a host
+    waits for a resolver round trip. Concurrent requests for the same host share one
+    lookup.
+
+    The cache holds at most max_entries hosts (see set_max_entries). When it's full, expired
+    entries and then the ones that expire first are dropped.
+
+    Numeric addresses, "localhost" and empty host names are handled immediately without
+    touching the cache or the threads.
+
+    Completion callbacks are invoked with the resolved address (including the port) or
+    an error (ersNOT_FOUND for unknown hosts). If a taskmaster is given, the callback is
+    pushed to it as a task, otherwise cache hits complete immediately on the calling thread
+    and misses on a resolver thread.
+
+    Usage:
+        netResolver::instance().resolve("server.net:4000", 0, false, [](opcd e, const netAddress& a) {
+            if (!e) sock.connect(a);
+        });
+**/
+class netResolver
+{
+public:
+
+    ///Completion callback, receives the error code and the resolved address
+    typedef function<void(opcd, const netAddress&)> result_fn;
+
+    ///Global resolver, used by netAddress::set for host names
+    static netResolver& instance();
+
+    /// @param nthreads maximum number of resolver threads, started on demand
+    explicit netResolver(uint nthreads = 2);
+    ~netResolver();
+
+    ///Set cache lifetime of resolved entries
+    /// @param ttl seconds to consider successful lookups fresh
+    /// @param negative_ttl seconds to remember failed lookups
+    void set_ttl(uint ttl, uint negative_ttl);
+
+    ///Set maximum number of cached host names
+    void set_max_entries(uint n);
+
+    ///Resolve asynchronously
+    /// @param host address in the format [proto://]server[:port]
+    /// @param port port number to use
+    /// @param portoverride true if port overrides the port specified in host
+    /// @param fn completion callback
+    /// @param tm optional taskmaster to run the completion callback on
+    void resolve(const token& host, uint16 port, bool portoverride, result_fn&& fn, taskmaster* tm = 0);
+
+    ///Resolve from the cache without blocking
+    /// @return 0 if resolved, ersNOT_FOUND if known to fail, ersRETRY if not cached (the lookup was started)
+    opcd lookup(const token& host, uint16 port, bool portoverride, netAddress& addr);
+
+    ///Resolve and wait for the result, served from the cache when possible
+    /// @note a miss waits for the lookup shared with other requests for the host
+    /// @return 0 if resolved, ersNOT_FOUND if the host is unknown
+    opcd resolve_sync(const token& host, uint16 port, bool portoverride, netAddress& addr);
+
+    ///Start resolving host names in the background to have them cached when needed
+    void prefetch(const token& host);
+
+    ///Drop all cached entries, except the ones with lookups in progress
+    void clear();
+
+    ///Resolve host name directly with the system resolver, blocking
+    /// @param name host name
+    /// @param addr [out] IPv4 address in network byte order
+    static opcd system_resolve(const token& name, uint32& addr);
+
+private:
+
+    struct waiter
+    {
+        netAddress addr;                //< address with port set
+        result_fn fn;
+        taskmaster* tm = 0;
+    };
+
+    struct entry
+    {
+        uint32 addr = 0;                //< resolved address in network byte order
+        opcd err = ersUNAVAILABLE;      //< result of the last lookup, ersUNAVAILABLE if none yet
+        uint64 expires = 0;             //< expiration time of the result in ns
+        bool pending = false;           //< lookup queued or running
+        dynarray<waiter> waiters;       //< requests waiting for the lookup
+    };
+
+    enum class ECached {
+        HIT,
+        NEGATIVE,
+        MISS,
+    };
+
+    ///Look up the cache and queue a lookup if needed, called with the lock held
+    /// @param w waiter to register on a miss, or null
+    /// @param queued [out] set to true if a lookup was queued and the workers should be notified
+    ECached find(const token& name, netAddress& addr, opcd& err, waiter* w, bool& queued);
+
+    ///Drop expired entries, or at least a quarter of the idle ones that expire first, called with the lock held
+    void prune();
+
+    bool queue_lookup(entry* e, const charstr& name);
+
+    ///Store a lookup result, called with the lock held
+    void update(entry* e, opcd err, uint32 addr);
+
+    static void complete(opcd e, const netAddress& addr, result_fn& fn, taskmaster* tm);
+
+    void* worker();
+
+    hash_map<charstr, entry*, hasher<token>> _cache;
+    dynarray<charstr> _queue;           //< host names to resolve
+    uint _qfirst = 0;                   //< first unprocessed item of _queue
+
+    _comm_mutex _mutex;
+    condition_variable _cv;
+    condition_variable _sync_cv;        //< signals completed lookups to resolve_sync
+
+    dynarray<thread> _threads;
+    uint _maxthreads;
+    uint _idle = 0;                     //< threads waiting for work
+    bool _stop = false;
+
+    uint64 _ttl_ns = 60 * 1000000000ULL;
+    uint64 _negative_ttl_ns = 10 * 1000000000ULL;
+    uint _max_entries = 1024;
+};
+
+COID_NAMESPACE_END
+
+#endif //__COID_COMM_NET_RESOLVER__HEADER_FILE__
@@ -42,13 +42,16 @@
 COID_NAMESPACE_BEGIN
 
 struct regex_program;
+struct regex_set_program;
 struct token;
 
 //template<class T, class COUNT=uints, class A=comm_array_allocator<T> > class dynarray;
 
 ///Regular expression class
 /**
-    Uses multiple-state implementation of NFA.
+    Match boundaries are found with a lazily built DFA that caches the states on demand,
+    with a fallback to multiple-state implementation of NFA. The NFA is also used to extract
+    the subexpressions from the matched part. The leftmost and then the longest match is returned.
 
     Syntax:
      metacharacters: .*+?[]()|\^$ must be escaped by \ when used as literals
@@ -100,6 +103,51 @@ private:
     regex_program* _prog;
 };
 
+///Set of regular expressions matched in a single pass over the input
+/**
+    Patterns are joined into one automaton that reports the ids of all the patterns that
+    matched. A set consisting of plain literals with the same case sensitivity is searched
+    with an Aho-Corasick automaton.
+**/
+struct regex_set
+{
+    regex_set();
+    ~regex_set();
+
+    ///Add pattern to the set
+    /// @return pattern id, patterns are numbered from 0 in the order they were added
+    uint add(token rt,
+        bool literal = false,
+        bool star_match_newline = false,
+        bool icase = false);
+
+    ///Build the combined automaton
+    /// @note done on first use after adding patterns, call it explicitly before sharing the set between threads
+    void build();
+
+    ///Number of patterns in the set
+    uint size() const;
+
+    ///Find patterns that occur in the string
+    /// @param ids array receiving the ids of patterns found, in ascending order
+    /// @param nids size of the ids array
+    /// @return number of patterns found, can be more than nids
+    uint find( token bol, uint* ids, uint nids ) const;
+
+    ///Find patterns that match the whole string
+    /// @param ids array receiving the ids of patterns matched, in ascending order
+    /// @param nids size of the ids array
+    /// @return number of patterns matched, can be more than nids
+    uint match( token bol, uint* ids, uint nids ) const;
+
+private:
+
+    regex_set(const regex_set&) = delete;
+    regex_set& operator = (const regex_set&) = delete;
+
+    regex_set_program* _set;
+};
+
 COID_NAMESPACE_END
 
 #include "token.h"
@@ -46,6 +46,7 @@ COID_NAMESPACE_BEGIN
 ////////////////////////////////////////////////////////////////////////////////
 Reinst* regex_compiler::create(Reinst::OP type) {
     Reinst* r = new Reinst(type);
+    r->id = int(_prog->rinst.size());
     *_prog->rinst.add() = r;
     return r;
 }
@@ -411,6 +412,7 @@ regex_program* regex_compiler::compile(token s, bool literal, bool icase, Reinst
     _andstack.reset();
 
     prg->optimize();
+    prg->dfa = Redfa::create(*prg);
 
     return prg.eject();
 }
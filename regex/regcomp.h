@@ -35,7 +35,12 @@
  * ***** END LICENSE BLOCK ***** */
 
 #include "../token.h"
+#include "../str.h"
+#include "../substring.h"
+#include "../charclass.h"
 #include "../commexception.h"
+#include "../hash/hashmap.h"
+#include <atomic>
 
 COID_NAMESPACE_BEGIN
 
@@ -75,6 +80,7 @@ struct Reinst {
     };
 
     OP	type;               // < 0200 ==> literal, otherwise action
+    int id = 0;             // index in regex_program::rinst
 
     union {
         Reclass* cp;        // class pointer
@@ -247,6 +253,127 @@ struct Reljunk
     }
 };
 
+////////////////////////////////////////////////////////////////////////////////
+/// Lazy DFA state, a set of NFA positions reached after some input
+struct Redfa_state
+{
+    dynarray<uint> kernel;          //< sorted NFA positions, inst id << 3 | pending utf8 bytes
+    int next[256];                  //< target state << 1 | match ends before the byte, -1 unknown
+    int8 final = -1;                //< match ends at the end of input, -1 unknown
+    bool bol = false;               //< position at the beginning of a line
+    bool search = false;            //< unanchored, start instruction is added after each character
+    uint8 pend = 0;                 //< unanchored, trailing bytes of the current character
+    bool accv[2] = { false, false };//< acc sets computed, by eol
+    dynarray<uint> acc[2];          //< ids of END instructions in the closure, by eol
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// Lazily built DFA over UTF-8 input bytes, used to find match boundaries
+/// @note states are built on demand from the NFA program and cached, once the cache
+///       grows over MAX_STATES it's flushed and the current match falls back to the NFA
+struct Redfa
+{
+    enum {
+        MAX_STATES = 2048,
+        MAX_FLUSHES = 8,            //< disable the DFA for a program that keeps flushing
+        DEAD = 0,                   //< state with no NFA positions
+        FALLBACK = -2,              //< cache overflow, use NFA
+    };
+
+    ///Create DFA for given program
+    /// @return 0 if the program uses constructs the DFA doesn't handle
+    static Redfa* create(const regex_program& prog);
+
+    ~Redfa();
+
+    ///Try to acquire the DFA for exclusive use by the calling thread
+    bool lock() {
+        if (_busy.load(std::memory_order_relaxed) || _busy.exchange(true, std::memory_order_acquire))
+            return false;
+
+        //flush count is modified by the lock owner only
+        if (_nflushes >= MAX_FLUSHES) {
+            unlock();
+            return false;
+        }
+        return true;
+    }
+    void unlock() { _busy.store(false, std::memory_order_release); }
+
+    ///Run the match using the DFA
+    /// @param result [out] matched token
+    /// @return false if the NFA has to be used instead
+    bool exec(const token& bol, Reljunk::MatchStyle style, token& result);
+
+    ///Run the DFA of a combined program of a regex set
+    /// @param whole true to match the whole string, false to find occurrences
+    /// @param hits [inout] per-pattern flags, set for patterns that matched
+    /// @return false if the NFA has to be used instead
+    bool exec_set(const token& bol, bool whole, dynarray<uchar>& hits);
+
+private:
+
+    Redfa(const regex_program& prog) : _prog(prog)
+    {}
+
+    bool prepare();
+    void find_literals();
+
+    ///Longest match anchored at given offset
+    /// @return end offset of the match, -1 if there's none or FALLBACK
+    ints anchored(const char* p, uints len, uints start);
+
+    ///Unanchored scan for the earliest match end
+    /// @return end offset of the match, -1 if there's none or FALLBACK
+    ints search_end(const char* p, uints len);
+
+    int init_state(bool search, bool bol);
+    int step(int st, uchar c);
+    bool final(int st);
+    bool closure(const dynarray<uint>& kernel, bool bol, bool eol);
+    int add_state(const dynarray<uint>& kernel, bool bol, bool search, uint pend);
+    bool build_first();
+    void flush();
+    bool overflow();
+
+    uint next_gen() {
+        if (++_gen == 0) {
+            ::memset(_mark.ptr(), 0, _mark.byte_size());
+            _gen = 1;
+        }
+        return _gen;
+    }
+
+private:
+
+    const regex_program& _prog;
+
+    dynarray<Redfa_state*> _states;
+    hash_map<charstr, int, hasher<charstr>> _map;   //< binary state key -> index in _states
+    int _init[2][2];                //< initial states by search mode and bol, -1 unknown
+
+    charstr _prefix;                //< literal every match starts with
+    charstr _required;              //< literal every match contains
+    substring _prefix_ss;
+    substring _required_ss;
+
+    char_class _first;              //< bytes that can start a match
+    bool _first_valid = false;
+
+    bool _has_bol = false;          //< program contains BOL instructions
+    uint _nflushes = 0;             //< guarded by _busy
+    std::atomic_bool _busy{ false };
+
+    //work buffers
+    charstr _key;
+    dynarray<uint> _stack;
+    dynarray<uint> _clos;
+    dynarray<uint> _tmp;
+    dynarray<uint> _mark;
+    dynarray<uint> _acc;            //< END instruction ids from the last closure
+    uint _gen = 0;
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 /// Regex program representation
 struct regex_program
@@ -257,6 +384,10 @@ struct regex_program
         : icase(icase)
     {}
 
+    ~regex_program() {
+        delete dfa;
+    }
+
 
 private:
 
@@ -266,6 +397,10 @@ private:
 private:
 
     friend struct regex_compiler;
+    friend struct regex_set_program;
+    friend struct Redfa;
+
+    Redfa* dfa = 0;                 // lazy DFA, 0 if the program needs the NFA
 
     Reinst* startinst = 0;          // start pc
     dynarray<Reclass*> rclass;
@@ -273,5 +408,68 @@ private:
     bool icase;
 };
 
+////////////////////////////////////////////////////////////////////////////////
+/// Aho-Corasick automaton for sets of literal patterns
+struct Reaho
+{
+    bool icase = false;             //< literals are lowercase, input is folded
+
+    Reaho() {
+        clear();
+    }
+
+    void clear();
+
+    ///Add literal to the automaton
+    void add(const token& lit, uint id);
+
+    ///Compute failure transitions, must be called after the literals were added
+    void build();
+
+    ///Scan the string for the literals
+    /// @param hits [inout] per-pattern flags, set for literals found, scan stops when all are set
+    void find(const token& bol, dynarray<uchar>& hits) const;
+
+private:
+
+    int add_node();
+
+    dynarray<int> _next;            //< 256 transitions per node, -1 missing before build()
+    dynarray<int> _link;            //< nearest proper suffix node with literals, 0 none
+    dynarray<int> _ids;             //< first literal id ending at the node, -1 none
+    dynarray<int> _idnext;          //< next literal id ending at the same node, -1 none
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// Compiled regex set
+struct regex_set_program
+{
+    ~regex_set_program();
+
+    void add(regex_program* prog);
+
+    uint size() const { return uint(_progs.size()); }
+    bool built() const { return _built; }
+
+    ///Build the combined automaton
+    void build();
+
+    ///Find or match the patterns
+    /// @return number of patterns matched
+    uint exec(const token& bol, bool whole, uint* ids, uint nids) const;
+
+private:
+
+    bool literal_of(const regex_program* prog, charstr& lit) const;
+    void free_combined();
+
+    dynarray<regex_program*> _progs;
+
+    regex_program* _comb = 0;       //< union of the programs, END instructions carry the pattern ids
+    Reaho* _aho = 0;                //< set of literal patterns
+
+    bool _built = false;
+};
+
 
 COID_NAMESPACE_END
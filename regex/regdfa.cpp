@@ -0,0 +1,686 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is Unix port of the Plan 9 regular expression library.
+ *
+ * The Initial Developer of the Original Code is
+ * Rob Pike
+ * Copyright (C) 2003, Lucent Technologies Inc. and others. All Rights Reserved.
+ *
+ * Contributor(s):
+ * Brano Kemen - modifications required for COID/comm library
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+#include "../token.h"
+#include "../tutf8.h"
+#include "../local.h"
+
+#include "../regex.h"
+#include "regcomp.h"
+
+COID_NAMESPACE_BEGIN
+
+////////////////////////////////////////////////////////////////////////////////
+static bool _ascii_class(const Reclass* cp)
+{
+    const ucs4* pb = cp->spans.ptr();
+    const ucs4* pe = cp->spans.ptre();
+
+    for (; pb < pe; pb += 2)
+        if (pb[1] >= 0x80)
+            return false;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static bool _in_class(const Reclass* cp, ucs4 r)
+{
+    const ucs4* pb = cp->spans.ptr();
+    const ucs4* pe = cp->spans.ptre();
+
+    for (; pb < pe; pb += 2)
+        if (r >= pb[0] && r <= pb[1])
+            return true;
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+///Number of trailing bytes the NFA consumes after given leading byte
+static uint _utf8_trailing(uchar c)
+{
+    if (c < 0xc0 || c >= 254)
+        return 0;
+    return get_utf8_seq_expected_bytes((const char*)&c) - 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+Redfa* Redfa::create(const regex_program& prog)
+{
+    local<Redfa> dfa = new Redfa(prog);
+    if (!dfa->prepare())
+        return 0;
+
+    return dfa.eject();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+Redfa::~Redfa()
+{
+    for (uints i = 0; i < _states.size(); ++i)
+        delete _states[i];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool Redfa::prepare()
+{
+    const Reinst* start = _prog.startinst;
+    if (!start || start->type == Reinst::END)
+        return false;
+
+    uints n = _prog.rinst.size();
+    if (n >= (1U << 28))
+        return false;
+
+    //classes with non-ascii ranges would need utf8 decoding, leave them to the NFA
+    for (uints i = 0; i < n; ++i) {
+        const Reinst* in = _prog.rinst[i];
+        if (in->type == Reinst::CCLASS || in->type == Reinst::NCCLASS) {
+            if (!_ascii_class(in->cp))
+                return false;
+        }
+        else if (in->type == Reinst::BOL)
+            _has_bol = true;
+    }
+
+    _mark.calloc(n << 3, true);
+    _gen = 0;
+
+    find_literals();
+    flush();
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+///Find literal prefix and the longest literal that must be present in every match
+/// @note a literal is a chain of RUNE instructions, it's required if its first instruction
+///       dominates the END instruction in the program graph
+void Redfa::find_literals()
+{
+    uints n = _prog.rinst.size();
+    if (n > 1024)
+        return;
+
+    const Reinst* const* rinst = _prog.rinst.ptr();
+    const uint start = _prog.startinst->id;
+
+    //dominator sets, n bits each
+    uints nw = (n + 31) / 32;
+    dynarray<uint> dom;
+    dom.calloc(n * nw, true);
+
+    uint* ds = dom.ptr() + start * nw;
+    ::memset(ds, 0, nw * sizeof(uint));
+    ds[start / 32] = 1U << (start % 32);
+
+    auto meet = [&](uint succ, const uint* pd, bool& changed) {
+        if (succ == start)
+            return;
+        uint* sd = dom.ptr() + succ * nw;
+        //intersect with the predecessor, keeping the node itself
+        for (uints w = 0; w < nw; ++w) {
+            uint v = sd[w] & (pd[w] | (w == succ / 32 ? 1U << (succ % 32) : 0));
+            if (v != sd[w]) {
+                sd[w] = v;
+                changed = true;
+            }
+        }
+    };
+
+    //reachable nodes only propagate their sets, unreachable ones keep full sets
+    dynarray<uchar> reach;
+    reach.calloc(n, true);
+    reach[start] = 1;
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (uints i = 0; i < n; ++i) {
+            if (!reach[i])
+                continue;
+
+            const Reinst* in = rinst[i];
+            const uint* pd = dom.ptr() + i * nw;
+
+            if (in->type == Reinst::END)
+                continue;
+
+            const Reinst* succ[2] = { in->next, in->type == Reinst::OR ? in->right : 0 };
+            for (int k = 0; k < 2; ++k) {
+                if (!succ[k])
+                    continue;
+                uint s = succ[k]->id;
+                if (!reach[s]) {
+                    reach[s] = 1;
+                    changed = true;
+                }
+                meet(s, pd, changed);
+            }
+        }
+    }
+
+    uint end = uint(n - 1);
+    if (rinst[end]->type != Reinst::END || !reach[end])
+        return;
+
+    const uint* de = dom.ptr() + end * nw;
+
+    auto chain = [&](const Reinst* in, charstr& dst) {
+        dst.reset();
+        for (; in->type == Reinst::RUNE; in = in->next) {
+            char seq[8];
+            uchar nb = write_utf8_seq(in->cd, seq);
+            dst.add_from(seq, nb);
+        }
+    };
+
+    //literal prefix, skipping zero-width instructions at the start
+    const Reinst* in = _prog.startinst;
+    while (in->type == Reinst::LBRA || in->type == Reinst::RBRA || in->type == Reinst::BOL)
+        in = in->next;
+    if (in->type == Reinst::RUNE)
+        chain(in, _prefix);
+
+    charstr lit;
+    for (uint i = 0; i < end; ++i) {
+        if (rinst[i]->type != Reinst::RUNE || !(de[i / 32] & (1U << (i % 32))))
+            continue;
+
+        chain(rinst[i], lit);
+        if (lit.len() > _required.len())
+            _required.swap(lit);
+    }
+
+    bool icase = _prog.icase;
+
+    if (_prefix.len())
+        _prefix_ss.set(_prefix.ptr(), _prefix.len(), icase);
+
+    //prefix search already checks the required literal if it's the same or shorter
+    if (_required.len() <= _prefix.len())
+        _required.reset();
+    else
+        _required_ss.set(_required.ptr(), _required.len(), icase);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Redfa::flush()
+{
+    for (uints i = 0; i < _states.size(); ++i)
+        delete _states[i];
+    _states.reset();
+    _map.clear();
+
+    //dead state, no transitions out
+    Redfa_state* s = new Redfa_state;
+    ::memset(s->next, 0, sizeof(s->next));
+    s->final = 0;
+    *_states.add() = s;
+
+    _init[0][0] = _init[0][1] = _init[1][0] = _init[1][1] = -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int Redfa::add_state(const dynarray<uint>& kernel, bool bol, bool search, uint pend)
+{
+    if (kernel.size() == 0 && !search)
+        return DEAD;
+
+    uchar flags = uchar(bol) | uchar(search << 1) | uchar(pend << 2);
+
+    _key.reset();
+    _key.add_from((const char*)&flags, 1);
+    _key.add_from((const char*)kernel.ptr(), kernel.byte_size());
+
+    int* pi = _map.find_value(_key);
+    if (pi)
+        return *pi;
+
+    if (_states.size() >= MAX_STATES)
+        return -1;
+
+    Redfa_state* s = new Redfa_state;
+    s->kernel = kernel;
+    ::memset(s->next, 0xff, sizeof(s->next));
+    s->bol = bol;
+    s->search = search;
+    s->pend = uint8(pend);
+
+    int id = int(_states.size());
+    *_states.add() = s;
+    _map.insert_key_value(_key, id);
+
+    return id;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int Redfa::init_state(bool search, bool bol)
+{
+    bol = bol && _has_bol;
+
+    int& st = _init[search][bol];
+    if (st < 0) {
+        _tmp.reset();
+        *_tmp.add() = uint(_prog.startinst->id) << 3;
+        st = add_state(_tmp, bol, search, 0);
+    }
+
+    return st < 0 ? FALLBACK : st;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+///Compute epsilon closure of kernel positions into _clos
+/// @return true if the closure contains END
+bool Redfa::closure(const dynarray<uint>& kernel, bool bol, bool eol)
+{
+    const Reinst* const* rinst = _prog.rinst.ptr();
+    uint gen = next_gen();
+    bool accept = false;
+
+    _clos.reset();
+    _stack.reset();
+    _acc.reset();
+
+    auto visit = [&](uint e) {
+        if (_mark[e] != gen) {
+            _mark[e] = gen;
+            *_stack.add() = e;
+        }
+    };
+
+    for (uints i = 0; i < kernel.size(); ++i)
+        visit(kernel[i]);
+
+    while (_stack.size()) {
+        uint e = *_stack.last();
+        _stack.resize(-1);
+
+        //position inside of a multibyte character
+        if (e & 7) {
+            *_clos.add() = e;
+            continue;
+        }
+
+        const Reinst* in = rinst[e >> 3];
+        switch (in->type) {
+        case Reinst::LBRA:
+        case Reinst::RBRA:
+        case Reinst::NOP:
+            visit(uint(in->next->id) << 3);
+            break;
+        case Reinst::OR:
+            visit(uint(in->left->id) << 3);
+            visit(uint(in->right->id) << 3);
+            break;
+        case Reinst::BOL:
+            if (bol)
+                visit(uint(in->next->id) << 3);
+            break;
+        case Reinst::EOL:
+            if (eol)
+                visit(uint(in->next->id) << 3);
+            break;
+        case Reinst::END:
+            accept = true;
+            *_acc.add() = uint(in->subid);
+            break;
+        default:
+            *_clos.add() = e;
+        }
+    }
+
+    return accept;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int Redfa::step(int st, uchar c)
+{
+    Redfa_state* s = _states[st];
+    bool accept = closure(s->kernel, s->bol, c == '\n' || c == 0);
+
+    const Reinst* const* rinst = _prog.rinst.ptr();
+    bool icase = _prog.icase;
+    uint gen = next_gen();
+
+    _tmp.reset();
+
+    auto follow = [&](uint e) {
+        if (_mark[e] != gen) {
+            _mark[e] = gen;
+            *_tmp.add() = e;
+        }
+    };
+
+    for (uints i = 0; i < _clos.size(); ++i)
+    {
+        uint e = _clos[i];
+        uint aux = e & 7;
+        const Reinst* in = rinst[e >> 3];
+
+        if (in->type == Reinst::RUNE) {
+            if (in->cd < 0x80) {
+                if (c == in->cd || (icase && (ucs4)::tolower(c) == in->cd))
+                    follow(uint(in->next->id) << 3);
+            }
+            else {
+                //aux is the number of bytes of the sequence matched so far
+                char seq[8];
+                uchar nb = write_utf8_seq(in->cd, seq);
+                if (c == (uchar)seq[aux])
+                    follow(aux + 1 < nb ? e + 1 : uint(in->next->id) << 3);
+            }
+            continue;
+        }
+
+        //trailing bytes of a character already accepted, consumed blindly like in the NFA
+        if (aux) {
+            follow(aux > 1 ? e - 1 : uint(in->next->id) << 3);
+            continue;
+        }
+
+        bool ok;
+        uint nb = 0;
+
+        if (c < 0x80) {
+            switch (in->type) {
+            case Reinst::ANY:     ok = c != 0; break;
+            case Reinst::ANYNL:   ok = true; break;
+            case Reinst::CCLASS:  ok = _in_class(in->cp, c); break;
+            case Reinst::NCCLASS: ok = !_in_class(in->cp, c); break;
+            default:              ok = false;
+            }
+        }
+        else {
+            //non-ascii or invalid character, classes are ascii-only here
+            nb = _utf8_trailing(c);
+            ok = in->type != Reinst::CCLASS;
+        }
+
+        if (ok)
+            follow(nb ? e + nb : uint(in->next->id) << 3);
+    }
+
+    //unanchored mode restarts at each character boundary
+    uint pend = 0;
+    if (s->search) {
+        pend = s->pend ? s->pend - 1 : _utf8_trailing(c);
+        if (pend == 0)
+            follow(uint(_prog.startinst->id) << 3);
+    }
+
+    //sort the kernel so that equal sets produce the same key
+    uint* pk = _tmp.ptr();
+    for (uints i = 1; i < _tmp.size(); ++i) {
+        uint v = pk[i];
+        uints k = i;
+        for (; k > 0 && pk[k - 1] > v; --k)
+            pk[k] = pk[k - 1];
+        pk[k] = v;
+    }
+
+    int t = add_state(_tmp, _has_bol && c == '\n', s->search, pend);
+    if (t < 0)
+        return FALLBACK;
+
+    t = (t << 1) | int(accept);
+    s->next[c] = t;
+    return t;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool Redfa::final(int st)
+{
+    Redfa_state* s = _states[st];
+    if (s->final < 0)
+        s->final = closure(s->kernel, s->bol, true) ? 1 : 0;
+
+    return s->final != 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+ints Redfa::anchored(const char* p, uints len, uints start)
+{
+    int st = init_state(false, start == 0 || p[start - 1] == '\n');
+    if (st < 0)
+        return FALLBACK;
+
+    const uchar* s = (const uchar*)p;
+    ints last = -1;
+
+    for (uints i = start; i < len; ++i) {
+        int t = _states[st]->next[s[i]];
+        if (t < 0 && (t = step(st, s[i])) < 0)
+            return FALLBACK;
+
+        if (t & 1)
+            last = ints(i);
+
+        st = t >> 1;
+        if (st == DEAD)
+            return last;
+    }
+
+    return final(st) ? ints(len) : last;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+ints Redfa::search_end(const char* p, uints len)
+{
+    int st = init_state(true, true);
+    if (st < 0)
+        return FALLBACK;
+
+    const uchar* s = (const uchar*)p;
+
+    for (uints i = 0; i < len; ++i) {
+        int t = _states[st]->next[s[i]];
+        if (t < 0 && (t = step(st, s[i])) < 0)
+            return FALLBACK;
+
+        if (t & 1)
+            return ints(i);
+
+        st = t >> 1;
+    }
+
+    return final(st) ? ints(len) : -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+///Collect bytes on which a match can start, from both initial states
+bool Redfa::build_first()
+{
+    if (_first_valid)
+        return true;
+
+    _first.reset();
+
+    for (int b = 0; b < 2; ++b)
+    {
+        if (b && !_has_bol)
+            break;
+
+        int st = init_state(false, b != 0);
+        if (st < 0)
+            return false;
+
+        //continuation bytes never start a character
+        for (uint c = 0; c < 256; ++c) {
+            if (c >= 0x80 && c < 0xc0)
+                continue;
+
+            int t = _states[st]->next[c];
+            if (t < 0 && (t = step(st, uchar(c))) < 0)
+                return false;
+
+            if (t != 0)
+                _first.set(uchar(c));
+        }
+    }
+
+    _first_valid = true;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool Redfa::overflow()
+{
+    flush();
+    ++_nflushes;
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool Redfa::exec(const token& bol, Reljunk::MatchStyle style, token& result)
+{
+    const char* p = bol.ptr();
+    uints len = bol.len();
+    ints e;
+
+    result.set_null();
+
+    if (style != Reljunk::SEARCH) {
+        e = anchored(p, len, 0);
+        if (e == FALLBACK)
+            return overflow();
+
+        if (e >= 0) {
+            if (style == Reljunk::FOLLOWS || uints(e) == len)
+                result.set(p, p + e);
+            else
+                //only a part matched, return empty token pointing to the remaining part
+                result.set(p + e, (uints)0);
+        }
+        return true;
+    }
+
+    if (_required.len() && _required_ss.find(p, len) == len)
+        return true;
+
+    if (_prefix.len()) {
+        //try the occurrences of the literal prefix
+        for (uints off = 0; off < len; ) {
+            uints k = _prefix_ss.find(p + off, len - off);
+            if (k == len - off)
+                break;
+
+            uints start = off + k;
+            e = anchored(p, len, start);
+            if (e == FALLBACK)
+                return overflow();
+
+            if (e >= 0) {
+                result.set(p + start, p + e);
+                return true;
+            }
+            off = start + 1;
+        }
+        return true;
+    }
+
+    //the leftmost match starts at or before the earliest match end
+    ints end = search_end(p, len);
+    if (end == FALLBACK || (end >= 0 && !build_first()))
+        return overflow();
+
+    for (uints start = 0; ints(start) <= end; ++start) {
+        start = _first.count_notin((const uchar*)p, start, uints(end));
+
+        e = anchored(p, len, start);
+        if (e == FALLBACK)
+            return overflow();
+
+        if (e >= 0) {
+            result.set(p + start, p + e);
+            return true;
+        }
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool Redfa::exec_set(const token& bol, bool whole, dynarray<uchar>& hits)
+{
+    const uchar* s = (const uchar*)bol.ptr();
+    uints len = bol.len();
+    uint nleft = 0;
+
+    for (uints i = 0; i < hits.size(); ++i)
+        nleft += hits[i] == 0;
+
+    auto collect = [&](int st, bool eol) {
+        Redfa_state* S = _states[st];
+        if (!S->accv[eol]) {
+            closure(S->kernel, S->bol, eol);
+            S->acc[eol] = _acc;
+            S->accv[eol] = true;
+        }
+
+        const dynarray<uint>& acc = S->acc[eol];
+        for (uints i = 0; i < acc.size(); ++i) {
+            uchar& h = hits[acc[i]];
+            if (!h) {
+                h = 1;
+                --nleft;
+            }
+        }
+    };
+
+    int st = init_state(!whole, true);
+    if (st < 0)
+        return overflow();
+
+    uints i;
+    for (i = 0; i < len && nleft > 0; ++i) {
+        int t = _states[st]->next[s[i]];
+        if (t < 0 && (t = step(st, s[i])) < 0)
+            return overflow();
+
+        if ((t & 1) && !whole)
+            collect(st, s[i] == '\n' || s[i] == 0);
+
+        st = t >> 1;
+        if (st == DEAD)
+            return true;
+    }
+
+    if (i == len && final(st))
+        collect(st, true);
+
+    return true;
+}
+
+COID_NAMESPACE_END
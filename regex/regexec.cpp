@@ -80,6 +80,46 @@ token regex::leading(token rt, token* sub, uint nsub) const
     return _prog->match(rt, sub, nsub, Reljunk::FOLLOWS);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+regex_set::regex_set() {
+    _set = new regex_set_program;
+}
+
+regex_set::~regex_set() {
+    delete _set;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint regex_set::add(token rt, bool literal, bool star_match_newline, bool icase)
+{
+    Reljunk* j = thread_object<Reljunk>(tk_regex);
+    _set->add(j->comp.compile(rt, literal, icase, star_match_newline ? Reinst::ANYNL : Reinst::ANY));
+    return _set->size() - 1;
+}
+
+void regex_set::build() {
+    _set->build();
+}
+
+uint regex_set::size() const {
+    return _set->size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint regex_set::find(token rt, uint* ids, uint nids) const
+{
+    if (!_set->built())
+        _set->build();
+    return _set->exec(rt, false, ids, nids);
+}
+
+uint regex_set::match(token rt, uint* ids, uint nids) const
+{
+    if (!_set->built())
+        _set->build();
+    return _set->exec(rt, true, ids, nids);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 token regex_program::match(
     const token& bol,	    // string to run machine on
@@ -87,6 +127,30 @@ token regex_program::match(
     Reljunk::MatchStyle style
 ) const
 {
+    //the DFA finds match boundaries, falls back to NFA when busy in another thread or overflown
+    if (dfa && dfa->lock()) {
+        token result;
+        bool done = dfa->exec(bol, style, result);
+        dfa->unlock();
+
+        if (done) {
+            for (uint i = 0; i < nsub; ++i)
+                sub[i].set_null();
+
+            bool matched = !result.is_null() && (style != Reljunk::MATCH || result.len() == bol.len());
+
+            if (nsub && matched) {
+                //run NFA on the matched part to get the subexpressions
+                Reljunk* j = thread_object<Reljunk>(tk_regex);
+                j->reset(Reljunk::MATCH, startinst);
+
+                regexec(result, sub, nsub, j);
+                sub[0] = result;
+            }
+            return result;
+        }
+    }
+
     Reljunk* j = thread_object<Reljunk>(tk_regex);
 
     j->reset(style, startinst);
@@ -251,10 +315,12 @@ token regex_program::regexec(
                     }
                     break;
                 case Reinst::LBRA:
-                    tlp->sub[inst->subid].set(s.ptr(), (uints)0);
+                    if ((uint)inst->subid < nsub)
+                        tlp->sub[inst->subid].set(s.ptr(), (uints)0);
                     continue;
                 case Reinst::RBRA:
-                    tlp->sub[inst->subid]._pte = s.ptr();
+                    if ((uint)inst->subid < nsub)
+                        tlp->sub[inst->subid]._pte = s.ptr();
                     continue;
                 case Reinst::ANY:
                     if (r != j->any_except)
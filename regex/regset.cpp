@@ -0,0 +1,365 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is Unix port of the Plan 9 regular expression library.
+ *
+ * The Initial Developer of the Original Code is
+ * Rob Pike
+ * Copyright (C) 2003, Lucent Technologies Inc. and others. All Rights Reserved.
+ *
+ * Contributor(s):
+ * Brano Kemen - modifications required for COID/comm library
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+#include "../token.h"
+#include "../tutf8.h"
+#include "../local.h"
+
+#include "../regex.h"
+#include "regcomp.h"
+
+COID_NAMESPACE_BEGIN
+
+////////////////////////////////////////////////////////////////////////////////
+void Reaho::clear()
+{
+    _next.reset();
+    _link.reset();
+    _ids.reset();
+    _idnext.reset();
+
+    add_node();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int Reaho::add_node()
+{
+    int node = int(_ids.size());
+    ::memset(_next.add(256), 0xff, 256 * sizeof(int));
+    *_link.add() = 0;
+    *_ids.add() = -1;
+
+    return node;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Reaho::add(const token& lit, uint id)
+{
+    int node = 0;
+    for (uints i = 0; i < lit.len(); ++i) {
+        uchar c = lit[i];
+        if (icase)
+            c = (uchar)::tolower(c);
+
+        int nx = _next[node * 256 + c];
+        if (nx < 0) {
+            nx = add_node();
+            _next[node * 256 + c] = nx;
+        }
+        node = nx;
+    }
+
+    while (_idnext.size() <= id)
+        *_idnext.add() = -1;
+
+    _idnext[id] = _ids[node];
+    _ids[node] = int(id);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Reaho::build()
+{
+    uints n = _ids.size();
+
+    dynarray<int> fail;
+    fail.calloc(n, false);
+
+    dynarray<int> queue;
+    queue.reserve(n, false);
+
+    int* next = _next.ptr();
+
+    for (uint c = 0; c < 256; ++c) {
+        int v = next[c];
+        if (v < 0)
+            next[c] = 0;
+        else
+            *queue.add() = v;
+    }
+
+    //breadth first, so that the rows of the failure nodes are complete
+    for (uints qi = 0; qi < queue.size(); ++qi)
+    {
+        int u = queue[qi];
+        int* row = next + u * 256;
+        const int* frow = next + fail[u] * 256;
+
+        for (uint c = 0; c < 256; ++c) {
+            int v = row[c];
+            int f = frow[c];
+
+            if (v < 0)
+                row[c] = f;
+            else {
+                fail[v] = f;
+                _link[v] = _ids[f] >= 0 ? f : _link[f];
+                *queue.add() = v;
+            }
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Reaho::find(const token& bol, dynarray<uchar>& hits) const
+{
+    uint nleft = 0;
+    for (uints i = 0; i < hits.size(); ++i)
+        nleft += hits[i] == 0;
+
+    auto report = [&](int node) {
+        for (int id = _ids[node]; id >= 0; id = _idnext[id]) {
+            if (!hits[id]) {
+                hits[id] = 1;
+                --nleft;
+            }
+        }
+    };
+
+    //empty literals
+    if (_ids[0] >= 0)
+        report(0);
+
+    const uchar* s = (const uchar*)bol.ptr();
+    const uchar* e = (const uchar*)bol.ptre();
+    const int* next = _next.ptr();
+    int st = 0;
+
+    for (; s < e && nleft > 0; ++s)
+    {
+        uchar c = *s;
+        if (icase)
+            c = (uchar)::tolower(c);
+
+        st = next[st * 256 + c];
+
+        for (int node = _ids[st] >= 0 ? st : _link[st]; node > 0; node = _link[node])
+            report(node);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+regex_set_program::~regex_set_program()
+{
+    free_combined();
+    delete _aho;
+
+    for (uints i = 0; i < _progs.size(); ++i)
+        delete _progs[i];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void regex_set_program::add(regex_program* prog)
+{
+    *_progs.add() = prog;
+    _built = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+///Get the literal if the program is a plain sequence of characters
+bool regex_set_program::literal_of(const regex_program* prog, charstr& lit) const
+{
+    lit.reset();
+
+    const Reinst* in = prog->startinst;
+    for (; in->type == Reinst::RUNE; in = in->next) {
+        char seq[8];
+        uchar nb = write_utf8_seq(in->cd, seq);
+        lit.add_from(seq, nb);
+    }
+
+    return in->type == Reinst::END;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void regex_set_program::free_combined()
+{
+    if (!_comb)
+        return;
+
+    for (uints i = 0; i < _comb->rinst.size(); ++i)
+        delete _comb->rinst[i];
+    for (uints i = 0; i < _comb->rclass.size(); ++i)
+        delete _comb->rclass[i];
+
+    delete _comb;
+    _comb = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void regex_set_program::build()
+{
+    free_combined();
+    delete _aho;
+    _aho = 0;
+
+    _built = true;
+
+    uint n = uint(_progs.size());
+    if (n == 0)
+        return;
+
+    //literal patterns with the same case sensitivity go to Aho-Corasick automaton
+    local<Reaho> aho = new Reaho;
+    aho->icase = _progs[0]->icase;
+
+    charstr lit;
+    uint k;
+    for (k = 0; k < n; ++k) {
+        if (_progs[k]->icase != aho->icase || !literal_of(_progs[k], lit))
+            break;
+        aho->add(lit, k);
+    }
+
+    if (k == n) {
+        aho->build();
+        _aho = aho.eject();
+    }
+
+    //combined program, copies of the programs joined by alternation
+    _comb = new regex_program(false);
+    dynarray<Reinst*>& rinst = _comb->rinst;
+
+    dynarray<Reinst*> starts;
+
+    for (k = 0; k < n; ++k)
+    {
+        const regex_program* prog = _progs[k];
+        const Reinst* const* src = prog->rinst.ptr();
+        uints nsrc = prog->rinst.size();
+        int base = int(rinst.size());
+
+        for (uints i = 0; i < nsrc; ++i) {
+            Reinst* in = new Reinst(*src[i]);
+            in->id = base + src[i]->id;
+            *rinst.add() = in;
+        }
+
+        Reinst** dst = rinst.ptr() + base;
+
+        for (uints i = 0; i < nsrc; ++i)
+        {
+            Reinst* in = dst[i];
+
+            switch (in->type) {
+            case Reinst::END:
+                in->subid = int(k);
+                continue;
+            case Reinst::OR:
+                in->right = dst[in->right->id];
+                break;
+            case Reinst::RUNE:
+                //case folding is per program, turn letters to classes
+                if (prog->icase && in->cd < 0x80 && ::isalpha(in->cd)) {
+                    Reclass* cls = *_comb->rclass.add() = new Reclass;
+                    ucs4* sp = cls->spans.add(4);
+                    sp[0] = sp[1] = (ucs4)::toupper(in->cd);
+                    sp[2] = sp[3] = in->cd;
+                    in->type = Reinst::CCLASS;
+                    in->cp = cls;
+                }
+                break;
+            default:;
+            }
+
+            in->next = dst[in->next->id];
+        }
+
+        *starts.add() = dst[prog->startinst->id];
+    }
+
+    Reinst* start = starts[n - 1];
+    for (uints i = n - 1; i > 0; --i) {
+        Reinst* in = new Reinst(Reinst::OR);
+        in->id = int(rinst.size());
+        *rinst.add() = in;
+
+        in->right = starts[i - 1];
+        in->left = start;
+        start = in;
+    }
+
+    _comb->startinst = start;
+    _comb->dfa = Redfa::create(*_comb);
+
+    if (!_comb->dfa)
+        free_combined();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+uint regex_set_program::exec(const token& bol, bool whole, uint* ids, uint nids) const
+{
+    uint n = uint(_progs.size());
+
+    dynarray<uchar> hits;
+    hits.calloc(n, false);
+
+    bool done = false;
+
+    if (_aho && !whole) {
+        _aho->find(bol, hits);
+        done = true;
+    }
+    else if (_comb && _comb->dfa->lock()) {
+        done = _comb->dfa->exec_set(bol, whole, hits);
+        _comb->dfa->unlock();
+    }
+
+    //empty pattern matches anything, like a single regex does
+    for (uint k = 0; k < n; ++k)
+        if (_progs[k]->startinst->type == Reinst::END)
+            hits[k] = 1;
+
+    if (!done) {
+        //one pattern at a time
+        for (uint k = 0; k < n; ++k) {
+            token m = _progs[k]->match(bol, 0, 0, whole ? Reljunk::MATCH : Reljunk::SEARCH);
+            hits[k] = !m.is_null() && (!whole || (m.ptr() == bol.ptr() && m.len() == bol.len()));
+        }
+    }
+
+    uint count = 0;
+    for (uint k = 0; k < n; ++k) {
+        if (hits[k]) {
+            if (count < nids)
+                ids[count] = k;
+            ++count;
+        }
+    }
+
+    return count;
+}
+
+COID_NAMESPACE_END
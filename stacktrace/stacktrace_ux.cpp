@@ -1,6 +1,40 @@
 #include "stacktrace.h"
+#include "../atomic/pool.h"
+
+#if defined(__GLIBC__)
+#include <execinfo.h>
+#endif
 
 coid::stacktrace coid::stacktrace::get_current_stack_trace()
 {
-    return stacktrace();
-}
\ No newline at end of file
+    stacktrace result;
+
+#if defined(__GLIBC__)
+    constexpr int max_frames_to_capture = 128;
+    void* trace[max_frames_to_capture];
+
+    int frame_count = backtrace(trace, max_frames_to_capture);
+
+    stack_frame* previous_frame = nullptr;
+    for (int i = 0; i < frame_count; i++)
+    {
+        stack_frame* new_frame = pool<stack_frame>::global().create_item();
+        new_frame->reset();
+
+        new_frame->_frame_address = trace[i];
+
+        if (i == 0)
+        {
+            result._first_frame = new_frame;
+        }
+        else
+        {
+            previous_frame->_next_frame = new_frame;
+        }
+
+        previous_frame = new_frame;
+    }
+#endif
+
+    return result;
+}
@@ -577,8 +577,8 @@ public:
     charstr& operator += (ulong i) { append_num(10, (uints)i); return *this; }
 #endif
 
-    charstr& operator += (float d) { append_float(d, 6); return *this; }
-    charstr& operator += (double d) { append_double(d, 10); return *this; }
+    charstr& operator += (float d) { return append_shortest(d); }
+    charstr& operator += (double d) { return append_shortest(d); }
 
     ///Formatted numbers - int/uint
     template<int WIDTH, uint BASE, int ALIGN, class NUM>
@@ -694,6 +694,16 @@ public:
     /// @return offset past the last non-padding character
     uint append_num_unsigned(int BaseN, uint64 n, int sgn, uints minsize = 0, EAlignNum align = ALIGN_NUM_RIGHT)
     {
+        if (BaseN == 10 && minsize == 0) {
+            //write directly without the intermediate buffer
+            uint nd = fpconv::count_digits(n);
+            char* p = get_append_buf(nd + (sgn ? 1 : 0));
+            if (sgn)
+                *p++ = sgn < 0 ? '-' : '+';
+            fpconv::write_digits_back(p + nd, n);
+            return uint(p + nd - ptr());
+        }
+
         char buf[128];
         uints i = charstrconv::num_formatter<uint64>::precompute(buf, n, BaseN, sgn);
 
@@ -981,6 +991,24 @@ public:
         return resize(end - ptr());
     }
 
+    ///Append the shortest representation of a double that parses back to the same value
+    charstr& append_shortest(double d)
+    {
+        char* buf = get_append_buf(fpconv::SHORTEST_MAX);
+        char* end = fpconv::append_shortest(buf, d);
+
+        return resize(end - ptr());
+    }
+
+    ///Append the shortest representation of a float that parses back to the same value
+    charstr& append_shortest(float d)
+    {
+        char* buf = get_append_buf(fpconv::SHORTEST_MAX);
+        char* end = fpconv::append_shortest(buf, d);
+
+        return resize(end - ptr());
+    }
+
     ///Append floating point number
     /// @param nfrac number of decimal places: >0 maximum, <0 precisely -nfrac places
     charstr& append_float(float d, int nfrac, uints maxsize = 0)
@@ -1542,22 +1570,20 @@ public:
         const char* pe = str.ptre();
         const char* ps = p;
 
-        for (; p < pe; ++p) {
-            if (*p == '\\') {
-                char v = unescape_char(p[1]);
+        while ((p = strscan::find_char(p, pe, '\\')) != 0) {
+            char v = unescape_char(p[1]);
 
-                ints len = p - ps;
-                char* dst = alloc_append_buf(len + 1);
-                xmemcpy(dst, ps, len);
-                dst += len;
-                dst[0] = v;
-                p++;
-                ps = p + 1;
-            }
+            ints len = p - ps;
+            char* dst = alloc_append_buf(len + 1);
+            xmemcpy(dst, ps, len);
+            dst += len;
+            dst[0] = v;
+            p += 2;
+            ps = p;
         }
 
-        if (p > ps)
-            add_from(ps, p - ps);
+        if (pe > ps)
+            add_from(ps, pe - ps);
         return *this;
     }
 
@@ -1810,12 +1836,10 @@ public:
     uint replace(char from, char to)
     {
         uint n = 0;
-        char* pe = (char*)ptre();
-        for (char* p = (char*)ptr(); p < pe; ++p) {
-            if (*p == from) {
-                *p = to;
-                ++n;
-            }
+        const char* pe = ptre();
+        for (const char* p = ptr(); (p = strscan::find_char(p, pe, from)) != 0; ++p) {
+            *(char*)p = to;
+            ++n;
         }
 
         return n;
@@ -2251,7 +2275,7 @@ public:
     {
         if (len() != str.len())
             return 0;
-        return 0 == xstrncasecmp(_tstr.ptr(), str.ptr(), str.len());
+        return strscan::equal_icase(_tstr.ptr(), str.ptr(), str.len());
     }
 
     bool cmpeqc(const token& str, bool casecmp) const { return casecmp ? cmpeq(str) : cmpeqi(str); }
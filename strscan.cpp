@@ -0,0 +1,572 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * Version: MPL 1.1/GPL 2.0/LGPL 2.1
+ *
+ * The contents of this file are subject to the Mozilla Public License Version
+ * 1.1 (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+ * for the specific language governing rights and limitations under the
+ * License.
+ *
+ * The Original Code is Unix port of the Plan 9 regular expression library.
+ *
+ * The Initial Developer of the Original Code is
+ * Rob Pike
+ * Copyright (C) 2003, Lucent Technologies Inc. and others. All Rights Reserved.
+ *
+ * Contributor(s):
+ * Brano Kemen - modifications required for COID/comm library
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * either the GNU General Public License Version 2 or later (the "GPL"), or
+ * the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+ * in which case the provisions of the GPL or the LGPL are applicable instead
+ * of those above. If you wish to allow use of your version of this file only
+ * under the terms of either the GPL or the LGPL, and not to allow others to
+ * use your version of this file under the terms of the MPL, indicate your
+ * decision by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL or the LGPL. If you do not delete
+ * the provisions above, a recipient may use your version of this file under
+ * the terms of any one of the MPL, the GPL or the LGPL.
+ *
+ * ***** END LICENSE BLOCK ***** */
+
+#include "strscan.h"
+#include "bitrange.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define COID_STRSCAN_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define STRSCAN_TARGET(x)
+#else
+#define STRSCAN_TARGET(x) __attribute__((target(x)))
+#endif
+#endif
+
+COID_NAMESPACE_BEGIN
+
+////////////////////////////////////////////////////////////////////////////////
+// scalar implementation, also used for the tails of vectorized loops
+
+static const char* scalar_find_char(const char* p, const char* pe, char c)
+{
+    return p < pe ? (const char*)::memchr(p, c, pe - p) : 0;
+}
+
+static const char* scalar_find_char2(const char* p, const char* pe, char c1, char c2)
+{
+    for (; p < pe; ++p)
+        if (*p == c1 || *p == c2)  return p;
+    return 0;
+}
+
+static const char* scalar_find_any(const char* p, const char* pe, const char* set, uints nset)
+{
+    uint8 map[256];
+    ::memset(map, 0, sizeof(map));
+    for (uints i = 0; i < nset; ++i)
+        map[uchar(set[i])] = 1;
+
+    for (; p < pe; ++p)
+        if (map[uchar(*p)])  return p;
+    return 0;
+}
+
+static const char* scalar_find_substring(const char* p, const char* pe, const char* s, uints n)
+{
+    if (n == 0)
+        return p;
+    if (uints(pe - p) < n)
+        return 0;
+
+    const char* last = pe - n;
+    while (p <= last) {
+        p = (const char*)::memchr(p, s[0], last + 1 - p);
+        if (!p)
+            return 0;
+        if (::memcmp(p + 1, s + 1, n - 1) == 0)
+            return p;
+        ++p;
+    }
+    return 0;
+}
+
+static bool scalar_equal_icase(const char* a, const char* b, uints n)
+{
+    for (uints i = 0; i < n; ++i)
+        if (a[i] != b[i] && strscan::lower(a[i]) != strscan::lower(b[i]))  return false;
+    return true;
+}
+
+static uints scalar_count_newlines_after(const char* p, const char* pe, char oc)
+{
+    uints n = 0;
+    for (; p < pe; ++p) {
+        char c = *p;
+        if (c == '\r') ++n;
+        else if (c == '\n' && oc != '\r') ++n;
+        oc = c;
+    }
+    return n;
+}
+
+static uints scalar_count_newlines(const char* p, const char* pe)
+{
+    return scalar_count_newlines_after(p, pe, 0);
+}
+
+static uints scalar_class_span(const uint8*, const uint8*, const uchar*, uints off, uints, bool)
+{
+    //the caller checks the remaining characters
+    return off;
+}
+
+static const strscan::impl _scalar = {
+    &scalar_find_char,
+    &scalar_find_char2,
+    &scalar_find_any,
+    &scalar_find_substring,
+    &scalar_equal_icase,
+    &scalar_count_newlines,
+    &scalar_class_span,
+    strscan::SCALAR,
+    "scalar"
+};
+
+
+#ifdef COID_STRSCAN_X86
+
+////////////////////////////////////////////////////////////////////////////////
+// SSE4.2 implementation
+// Loops process 16 byte blocks, the remainder is handled with an overlapping load of the last
+// block when the input is at least one block long.
+
+STRSCAN_TARGET("sse4.2,popcnt")
+static const char* sse42_find_char(const char* p, const char* pe, char c)
+{
+    if (pe - p < 16)
+        return scalar_find_char(p, pe, c);
+
+    __m128i vc = _mm_set1_epi8(c);
+
+    for (; p + 16 <= pe; p += 16) {
+        uint m = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)p), vc));
+        if (m)
+            return p + lsb_bit_set(m);
+    }
+
+    if (p < pe) {
+        p = pe - 16;
+        uint m = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)p), vc));
+        if (m)
+            return p + lsb_bit_set(m);
+    }
+    return 0;
+}
+
+STRSCAN_TARGET("sse4.2,popcnt")
+static const char* sse42_find_char2(const char* p, const char* pe, char c1, char c2)
+{
+    if (pe - p < 16)
+        return scalar_find_char2(p, pe, c1, c2);
+
+    __m128i v1 = _mm_set1_epi8(c1);
+    __m128i v2 = _mm_set1_epi8(c2);
+
+    for (;; p += 16) {
+        if (p + 16 > pe) {
+            if (p == pe)
+                break;
+            p = pe - 16;
+        }
+
+        __m128i v = _mm_loadu_si128((const __m128i*)p);
+        uint m = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, v1), _mm_cmpeq_epi8(v, v2)));
+        if (m)
+            return p + lsb_bit_set(m);
+        if (p + 16 == pe)
+            break;
+    }
+    return 0;
+}
+
+STRSCAN_TARGET("sse4.2,popcnt")
+static const char* sse42_find_any(const char* p, const char* pe, const char* set, uints nset)
+{
+    if (nset > 16 || pe - p < 16)
+        return scalar_find_any(p, pe, set, nset);
+    if (nset == 0)
+        return 0;
+
+    char buf[16] = {0};
+    ::memcpy(buf, set, nset);
+    __m128i vs = _mm_loadu_si128((const __m128i*)buf);
+    int ns = int(nset);
+
+    const int mode = _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_LEAST_SIGNIFICANT;
+
+    for (;; p += 16) {
+        if (p + 16 > pe) {
+            if (p == pe)
+                break;
+            p = pe - 16;
+        }
+
+        int i = _mm_cmpestri(vs, ns, _mm_loadu_si128((const __m128i*)p), 16, mode);
+        if (i < 16)
+            return p + i;
+        if (p + 16 == pe)
+            break;
+    }
+    return 0;
+}
+
+STRSCAN_TARGET("sse4.2,popcnt")
+static const char* sse42_find_substring(const char* p, const char* pe, const char* s, uints n)
+{
+    if (n < 2 || uints(pe - p) < n + 16)
+        return scalar_find_substring(p, pe, s, n);
+
+    //filter candidates by the first and the last byte of the substring
+    __m128i vf = _mm_set1_epi8(s[0]);
+    __m128i vl = _mm_set1_epi8(s[n - 1]);
+
+    for (; p + n - 1 + 16 <= pe; p += 16) {
+        __m128i ef = _mm_cmpeq_epi8(vf, _mm_loadu_si128((const __m128i*)p));
+        __m128i el = _mm_cmpeq_epi8(vl, _mm_loadu_si128((const __m128i*)(p + n - 1)));
+        uint m = _mm_movemask_epi8(_mm_and_si128(ef, el));
+
+        while (m) {
+            uint i = lsb_bit_set(m);
+            if (::memcmp(p + i + 1, s + 1, n - 2) == 0)
+                return p + i;
+            m &= m - 1;
+        }
+    }
+
+    return scalar_find_substring(p, pe, s, n);
+}
+
+STRSCAN_TARGET("sse4.2,popcnt")
+static inline __m128i sse42_lower(__m128i v)
+{
+    //uppercase letters map to the lowest 26 values of the signed range after the shift
+    __m128i t = _mm_add_epi8(v, _mm_set1_epi8(char(0x80 - 'A')));
+    __m128i up = _mm_cmplt_epi8(t, _mm_set1_epi8(char(0x80 + 26)));
+    return _mm_or_si128(v, _mm_and_si128(up, _mm_set1_epi8(0x20)));
+}
+
+STRSCAN_TARGET("sse4.2,popcnt")
+static bool sse42_equal_icase(const char* a, const char* b, uints n)
+{
+    if (n < 16)
+        return scalar_equal_icase(a, b, n);
+
+    for (uints i = 0;; i += 16) {
+        if (i + 16 > n)
+            i = n - 16;
+
+        __m128i va = sse42_lower(_mm_loadu_si128((const __m128i*)(a + i)));
+        __m128i vb = sse42_lower(_mm_loadu_si128((const __m128i*)(b + i)));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) != 0xffff)
+            return false;
+        if (i + 16 == n)
+            break;
+    }
+    return true;
+}
+
+STRSCAN_TARGET("sse4.2,popcnt")
+static uints sse42_count_newlines(const char* p, const char* pe)
+{
+    __m128i vcr = _mm_set1_epi8('\r');
+    __m128i vlf = _mm_set1_epi8('\n');
+    uints n = 0;
+    uint carry = 0;
+
+    //\r\n pairs are counted by both masks, subtract the \n preceded by \r
+    for (; p + 16 <= pe; p += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)p);
+        uint mcr = _mm_movemask_epi8(_mm_cmpeq_epi8(v, vcr));
+        uint mlf = _mm_movemask_epi8(_mm_cmpeq_epi8(v, vlf));
+        uint pair = mlf & ((mcr << 1) | carry);
+        n += __popcnt(mcr) + __popcnt(mlf) - __popcnt(pair);
+        carry = mcr >> 15;
+    }
+
+    return n + scalar_count_newlines_after(p, pe, carry ? '\r' : 0);
+}
+
+///Classify 16 characters with pshufb lookups into the nibble tables
+/// @return mask of characters belonging to the class
+STRSCAN_TARGET("sse4.2,popcnt")
+static inline uint sse42_class_mask(__m128i c, __m128i lo, __m128i hi)
+{
+    const __m128i bits = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+
+    __m128i t = _mm_or_si128(
+        _mm_shuffle_epi8(lo, c),
+        _mm_shuffle_epi8(hi, _mm_xor_si128(c, _mm_set1_epi8(-128))));
+    __m128i b = _mm_shuffle_epi8(bits, _mm_and_si128(_mm_srli_epi16(c, 4), _mm_set1_epi8(7)));
+    return uint(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(t, b), b)));
+}
+
+STRSCAN_TARGET("sse4.2,popcnt")
+static uints sse42_class_span(const uint8* plo, const uint8* phi, const uchar* p, uints off, uints len, bool in)
+{
+    const __m128i lo = _mm_loadu_si128((const __m128i*)plo);
+    const __m128i hi = _mm_loadu_si128((const __m128i*)phi);
+    const uint inv = in ? 0xffffU : 0;
+
+    for (; off + 16 <= len; off += 16) {
+        uint stop = sse42_class_mask(_mm_loadu_si128((const __m128i*)(p + off)), lo, hi) ^ inv;
+        if (stop)
+            return off + lsb_bit_set(stop);
+    }
+    return off;
+}
+
+static const strscan::impl _sse42 = {
+    &sse42_find_char,
+    &sse42_find_char2,
+    &sse42_find_any,
+    &sse42_find_substring,
+    &sse42_equal_icase,
+    &sse42_count_newlines,
+    &sse42_class_span,
+    strscan::SSE42,
+    "sse4.2"
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+// AVX2 implementation, 32 byte blocks
+// Set search uses the SSE4.2 code, pcmpestri has no wider variant
+
+STRSCAN_TARGET("avx2,bmi,popcnt")
+static const char* avx2_find_char(const char* p, const char* pe, char c)
+{
+    if (pe - p < 32)
+        return sse42_find_char(p, pe, c);
+
+    __m256i vc = _mm256_set1_epi8(c);
+
+    for (;; p += 32) {
+        if (p + 32 > pe) {
+            if (p == pe)
+                break;
+            p = pe - 32;
+        }
+
+        uint m = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)p), vc));
+        if (m)
+            return p + lsb_bit_set(m);
+        if (p + 32 == pe)
+            break;
+    }
+    return 0;
+}
+
+STRSCAN_TARGET("avx2,bmi,popcnt")
+static const char* avx2_find_char2(const char* p, const char* pe, char c1, char c2)
+{
+    if (pe - p < 32)
+        return sse42_find_char2(p, pe, c1, c2);
+
+    __m256i v1 = _mm256_set1_epi8(c1);
+    __m256i v2 = _mm256_set1_epi8(c2);
+
+    for (;; p += 32) {
+        if (p + 32 > pe) {
+            if (p == pe)
+                break;
+            p = pe - 32;
+        }
+
+        __m256i v = _mm256_loadu_si256((const __m256i*)p);
+        uint m = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, v1), _mm256_cmpeq_epi8(v, v2)));
+        if (m)
+            return p + lsb_bit_set(m);
+        if (p + 32 == pe)
+            break;
+    }
+    return 0;
+}
+
+STRSCAN_TARGET("avx2,bmi,popcnt")
+static const char* avx2_find_substring(const char* p, const char* pe, const char* s, uints n)
+{
+    if (n < 2 || uints(pe - p) < n + 32)
+        return sse42_find_substring(p, pe, s, n);
+
+    __m256i vf = _mm256_set1_epi8(s[0]);
+    __m256i vl = _mm256_set1_epi8(s[n - 1]);
+
+    for (; p + n - 1 + 32 <= pe; p += 32) {
+        __m256i ef = _mm256_cmpeq_epi8(vf, _mm256_loadu_si256((const __m256i*)p));
+        __m256i el = _mm256_cmpeq_epi8(vl, _mm256_loadu_si256((const __m256i*)(p + n - 1)));
+        uint m = _mm256_movemask_epi8(_mm256_and_si256(ef, el));
+
+        while (m) {
+            uint i = lsb_bit_set(m);
+            if (::memcmp(p + i + 1, s + 1, n - 2) == 0)
+                return p + i;
+            m &= m - 1;
+        }
+    }
+
+    return sse42_find_substring(p, pe, s, n);
+}
+
+STRSCAN_TARGET("avx2,bmi,popcnt")
+static inline __m256i avx2_lower(__m256i v)
+{
+    __m256i t = _mm256_add_epi8(v, _mm256_set1_epi8(char(0x80 - 'A')));
+    __m256i up = _mm256_cmpgt_epi8(_mm256_set1_epi8(char(0x80 + 26)), t);
+    return _mm256_or_si256(v, _mm256_and_si256(up, _mm256_set1_epi8(0x20)));
+}
+
+STRSCAN_TARGET("avx2,bmi,popcnt")
+static bool avx2_equal_icase(const char* a, const char* b, uints n)
+{
+    if (n < 32)
+        return sse42_equal_icase(a, b, n);
+
+    for (uints i = 0;; i += 32) {
+        if (i + 32 > n)
+            i = n - 32;
+
+        __m256i va = avx2_lower(_mm256_loadu_si256((const __m256i*)(a + i)));
+        __m256i vb = avx2_lower(_mm256_loadu_si256((const __m256i*)(b + i)));
+        if (uint(_mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb))) != 0xffffffffU)
+            return false;
+        if (i + 32 == n)
+            break;
+    }
+    return true;
+}
+
+STRSCAN_TARGET("avx2,bmi,popcnt")
+static uints avx2_count_newlines(const char* p, const char* pe)
+{
+    __m256i vcr = _mm256_set1_epi8('\r');
+    __m256i vlf = _mm256_set1_epi8('\n');
+    uints n = 0;
+    uint carry = 0;
+
+    for (; p + 32 <= pe; p += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)p);
+        uint mcr = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, vcr));
+        uint mlf = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, vlf));
+        uint pair = mlf & ((mcr << 1) | carry);
+        n += __popcnt(mcr) + __popcnt(mlf) - __popcnt(pair);
+        carry = mcr >> 31;
+    }
+
+    return n + scalar_count_newlines_after(p, pe, carry ? '\r' : 0);
+}
+
+STRSCAN_TARGET("avx2,bmi,popcnt")
+static uints avx2_class_span(const uint8* plo, const uint8* phi, const uchar* p, uints off, uints len, bool in)
+{
+    const __m256i lo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)plo));
+    const __m256i hi = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)phi));
+    const __m256i bits = _mm256_setr_epi8(
+        1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+        1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+    const __m256i x80 = _mm256_set1_epi8(-128);
+    const __m256i x07 = _mm256_set1_epi8(7);
+    const uint inv = in ? 0xffffffffU : 0;
+
+    for (; off + 32 <= len; off += 32) {
+        __m256i c = _mm256_loadu_si256((const __m256i*)(p + off));
+        __m256i t = _mm256_or_si256(
+            _mm256_shuffle_epi8(lo, c),
+            _mm256_shuffle_epi8(hi, _mm256_xor_si256(c, x80)));
+        __m256i b = _mm256_shuffle_epi8(bits, _mm256_and_si256(_mm256_srli_epi16(c, 4), x07));
+
+        uint stop = uint(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(t, b), b))) ^ inv;
+        if (stop)
+            return off + lsb_bit_set(stop);
+    }
+
+    //one more half block
+    return sse42_class_span(plo, phi, p, off, len, in);
+}
+
+static const strscan::impl _avx2 = {
+    &avx2_find_char,
+    &avx2_find_char2,
+    &sse42_find_any,
+    &avx2_find_substring,
+    &avx2_equal_icase,
+    &avx2_count_newlines,
+    &avx2_class_span,
+    strscan::AVX2,
+    "avx2"
+};
+
+////////////////////////////////////////////////////////////////////////////////
+static bool cpu_supports(strscan::level lvl)
+{
+#ifdef _MSC_VER
+    int r[4];
+    __cpuid(r, 0);
+    int nids = r[0];
+
+    __cpuid(r, 1);
+    bool sse42 = (r[2] & (1 << 20)) != 0 && (r[2] & (1 << 23)) != 0;
+    if (lvl == strscan::SSE42)
+        return sse42;
+
+    //AVX needs the OS to save the ymm registers
+    bool osavx = (r[2] & (1 << 27)) != 0 && (r[2] & (1 << 28)) != 0
+        && (_xgetbv(0) & 6) == 6;
+    if (!sse42 || !osavx || nids < 7)
+        return false;
+
+    __cpuidex(r, 7, 0);
+    return (r[1] & (1 << 5)) != 0 && (r[1] & (1 << 3)) != 0;
+#else
+    __builtin_cpu_init();
+    bool sse42 = __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt");
+    if (lvl == strscan::SSE42)
+        return sse42;
+
+    return sse42 && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi");
+#endif
+}
+
+#endif //COID_STRSCAN_X86
+
+////////////////////////////////////////////////////////////////////////////////
+const strscan::impl* strscan::variant(level lvl)
+{
+    switch (lvl) {
+    case SCALAR: return &_scalar;
+#ifdef COID_STRSCAN_X86
+    case SSE42: return cpu_supports(SSE42) ? &_sse42 : 0;
+    case AVX2:  return cpu_supports(AVX2) ? &_avx2 : 0;
+#endif
+    default: return 0;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const strscan::impl& strscan::select()
+{
+    const impl* p = variant(AVX2);
+    if (!p)
+        p = variant(SSE42);
+
+    return p ? *p : _scalar;
+}
+
+COID_NAMESPACE_END
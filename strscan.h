@@ -0,0 +1,178 @@
+#pragma once
+
+/* ***** BEGIN LICENSE BLOCK *****
+* Version: MPL 1.1/GPL 2.0/LGPL 2.1
+*
+* The contents of this file are subject to the Mozilla Public License Version
+* 1.1 (the "License"); you may not use this file except in compliance with
+* the License. You may obtain a copy of the License at
+* http://www.mozilla.org/MPL/
+*
+* Software distributed under the License is distributed on an "AS IS" basis,
+* WITHOUT WARRANTY OF ANY KIND, either express or implied. See the License
+* for the specific language governing rights and limitations under the
+* License.
+*
+* The Original Code is COID/comm module.
+*
+* The Initial Developer of the Original Code is
+* Outerra.
+* Portions created by the Initial Developer are Copyright (C) 2026
+* the Initial Developer. All Rights Reserved.
+*
+* Contributor(s):
+* Brano Kemen
+*
+* Alternatively, the contents of this file may be used under the terms of
+* either the GNU General Public License Version 2 or later (the "GPL"), or
+* the GNU Lesser General Public License Version 2.1 or later (the "LGPL"),
+* in which case the provisions of the GPL or the LGPL are applicable instead
+* of those above. If you wish to allow use of your version of this file only
+* under the terms of either the GPL or the LGPL, and not to allow others to
+* use your version of this file under the terms of the MPL, indicate your
+* decision by deleting the provisions above and replace them with the notice
+* and other provisions required by the GPL or the LGPL. If you do not delete
+* the provisions above, a recipient may use your version of this file under
+* the terms of any one of the MPL, the GPL or the LGPL.
+*
+* ***** END LICENSE BLOCK ***** */
+
+#ifndef __COID_COMM_STRSCAN__HEADER_FILE__
+#define __COID_COMM_STRSCAN__HEADER_FILE__
+
+#include "namespace.h"
+#include "commtypes.h"
+
+COID_NAMESPACE_BEGIN
+
+////////////////////////////////////////////////////////////////////////////////
+///String scanning primitives with SSE4.2 and AVX2 implementations, selected at runtime
+/// by the CPU features. Short inputs are handled inline, the vectorized code is reached
+/// through a table of functions for inputs of at least MIN_VECTOR bytes.
+struct strscan
+{
+    enum {
+        MIN_VECTOR = 16,            //< shorter inputs use inline scalar loops
+    };
+
+    enum level {
+        SCALAR = 0,
+        SSE42,
+        AVX2,
+    };
+
+    ///Table of implementations
+    struct impl
+    {
+        const char* (*find_char)(const char* p, const char* pe, char c);
+        const char* (*find_char2)(const char* p, const char* pe, char c1, char c2);
+        const char* (*find_any)(const char* p, const char* pe, const char* set, uints nset);
+        const char* (*find_substring)(const char* p, const char* pe, const char* s, uints n);
+        bool (*equal_icase)(const char* a, const char* b, uints n);
+        uints (*count_newlines)(const char* p, const char* pe);
+
+        ///Vectorized part of char_class span, see char_class::span
+        /// @param lo,hi nibble membership tables of the class
+        uints (*class_span)(const uint8* lo, const uint8* hi, const uchar* p, uints off, uints len, bool in);
+
+        level lvl;
+        const char* name;
+    };
+
+    ///Implementation used on this CPU
+    static const impl& get() {
+        static const impl& _impl = select();
+        return _impl;
+    }
+
+    ///Implementation of specified level
+    /// @return 0 if the level isn't supported by the CPU or the build
+    static const impl* variant(level lvl);
+
+
+    ///Find character
+    /// @return pointer to the first occurrence or 0 if not found
+    static const char* find_char(const char* p, const char* pe, char c)
+    {
+        if (pe - p >= MIN_VECTOR)
+            return get().find_char(p, pe, c);
+
+        for (; p < pe; ++p)
+            if (*p == c)  return p;
+        return 0;
+    }
+
+    ///Find any of two characters
+    /// @return pointer to the first occurrence or 0 if not found
+    static const char* find_char2(const char* p, const char* pe, char c1, char c2)
+    {
+        if (pe - p >= MIN_VECTOR)
+            return get().find_char2(p, pe, c1, c2);
+
+        for (; p < pe; ++p)
+            if (*p == c1 || *p == c2)  return p;
+        return 0;
+    }
+
+    ///Find any character from a set
+    /// @return pointer to the first occurrence or 0 if not found
+    static const char* find_any(const char* p, const char* pe, const char* set, uints nset)
+    {
+        if (pe - p >= MIN_VECTOR)
+            return get().find_any(p, pe, set, nset);
+
+        const char* se = set + nset;
+        for (; p < pe; ++p)
+            for (const char* s = set; s < se; ++s)
+                if (*p == *s)  return p;
+        return 0;
+    }
+
+    ///Find substring
+    /// @return pointer to the first occurrence or 0 if not found
+    static const char* find_substring(const char* p, const char* pe, const char* s, uints n)
+    {
+        return get().find_substring(p, pe, s, n);
+    }
+
+    ///Compare strings of equal length, ignoring case of ascii letters
+    static bool equal_icase(const char* a, const char* b, uints n)
+    {
+        if (n >= MIN_VECTOR)
+            return get().equal_icase(a, b, n);
+
+        for (uints i = 0; i < n; ++i)
+            if (a[i] != b[i] && lower(a[i]) != lower(b[i]))  return false;
+        return true;
+    }
+
+    ///Count newline sequences \r, \n and \r\n
+    static uints count_newlines(const char* p, const char* pe)
+    {
+        if (pe - p >= MIN_VECTOR)
+            return get().count_newlines(p, pe);
+
+        uints n = 0;
+        char oc = 0;
+        for (; p < pe; ++p) {
+            char c = *p;
+            if (c == '\r') ++n;
+            else if (c == '\n' && oc != '\r') ++n;
+            oc = c;
+        }
+        return n;
+    }
+
+    ///Lowercase ascii letter
+    static char lower(char c) {
+        return c >= 'A' && c <= 'Z' ? char(c + 'a' - 'A') : c;
+    }
+
+private:
+
+    static const impl& select();
+};
+
+COID_NAMESPACE_END
+
+#endif //__COID_COMM_STRSCAN__HEADER_FILE__
@@ -37,6 +37,7 @@
 
 #include "namespace.h"
 #include "commtypes.h"
+#include "strscan.h"
 
 #include <cctype>
 #include <cstring>
@@ -102,6 +103,12 @@ public:
         if( _len == 1 )
             return find_onechar(ptr,len);
 
+        if( !_icase && _len > 1 ) {
+            //vectorized first/last byte filter beats the skip table on all but long patterns
+            const char* p = strscan::find_substring(ptr, ptr+len, (const char*)_subs, _len);
+            return p ? p - ptr : len;
+        }
+
         uints off = 0;
         uints rlen = len;
 
@@ -110,7 +117,7 @@ public:
             if( rlen >= _len )
             {
                 int cmp = _icase
-                    ? xstrncasecmp(ptr+off, (const char*)_subs, _len)
+                    ? !strscan::equal_icase(ptr+off, (const char*)_subs, _len)
                     : ::memcmp(ptr+off, _subs, _len);
                 if(cmp == 0)
                     return off;
@@ -155,12 +162,12 @@ protected:
     uints find_onechar( const char* ptr, uints len ) const
     {
         char c = _subs[0];
-        uints i;
-        for( i=0; i<len; ++i)
-            if( ptr[i] == c || (_icase && ::tolower(ptr[i]) == c) )
-                break;
+        char u = c >= 'a' && c <= 'z' ? char(c - 'a' + 'A') : c;
+        const char* p = _icase
+            ? strscan::find_char2(ptr, ptr+len, c, u)
+            : strscan::find_char(ptr, ptr+len, c);
 
-        return i;
+        return p ? p - ptr : len;
     }
 };
 
@@ -41,6 +41,8 @@
 
 #include "regex.h"
 #include "substring.h"
+#include "strscan.h"
+#include "fpconv.h"
 #include "tutf8.h"
 #include "commtime.h"
 #include "hash/hashfunc.h"
@@ -407,7 +409,7 @@ struct token
     {
         if (lens() != str.lens())
             return 0;
-        return 0 == xstrncasecmp(ptr(), str.ptr(), lens());
+        return strscan::equal_icase(ptr(), str.ptr(), lens());
     }
 
     bool cmpeqc(const token& str, bool casecmp) const
@@ -1349,12 +1351,10 @@ struct token
     uint count_notingroup(const token& sep, uints off = 0) const
     {
         const char* p = _ptr + off;
-        for (; p < _pte; ++p)
-        {
-            const char* ps = sep._ptr;
-            for (; ps < sep._pte; ++ps)
-                if (*p == *ps)
-                    return uint(p - _ptr);
+        if (p < _pte) {
+            p = strscan::find_any(p, _pte, sep._ptr, sep.lens());
+            if (!p)
+                p = _pte;
         }
         return uint(p - _ptr);
     }
@@ -1420,33 +1420,28 @@ struct token
     uint count_notchar(char sep, uints off = 0) const
     {
         const char* p = _ptr + off;
-        for (; p < _pte; ++p)
-        {
-            if (*p == sep)
-                break;
+        if (p < _pte) {
+            p = strscan::find_char(p, _pte, sep);
+            if (!p)
+                p = _pte;
         }
         return uint(p - _ptr);
     }
 
     uint count_notchar_icase(char sep, uints off = 0) const
     {
-        sep = (char)tolower(sep);
-        const char* p = _ptr + off;
-        for (; p < _pte; ++p)
-        {
-            if (tolower(*p) == sep)
-                break;
-        }
-        return uint(p - _ptr);
+        char lo = strscan::lower(sep);
+        char up = lo >= 'a' && lo <= 'z' ? char(lo - 'a' + 'A') : lo;
+        return count_notchars(lo, up, off);
     }
 
     uint count_notchars(char sep1, char sep2, uints off = 0) const
     {
         const char* p = _ptr + off;
-        for (; p < _pte; ++p)
-        {
-            if (*p == sep1 || *p == sep2)
-                break;
+        if (p < _pte) {
+            p = strscan::find_char2(p, _pte, sep1, sep2);
+            if (!p)
+                p = _pte;
         }
         return uint(p - _ptr);
     }
@@ -1716,17 +1711,9 @@ struct token
     }
 
     const char* contains(const token& str, uints off = 0) const {
-        if (len() < str.len())
+        if (len() < str.len() || off > len() - str.len())
             return 0;
-        uints tot = len() - str.len();
-        char c = str.first_char();
-
-        while (off <= tot && (off = count_notchar(c, off)) <= tot) {
-            if (0 == ::memcmp(_ptr + off, str._ptr, str.len()))
-                return _ptr + off;
-            ++off;
-        }
-        return 0;
+        return strscan::find_substring(_ptr + off, _pte, str._ptr, str.lens());
     }
 
     ///Return position where the case-insensitive character is located
@@ -1743,7 +1730,7 @@ struct token
         char C = (char)toupper(str.first_char());
 
         while (off <= tot && (off = count_notchars(c, C, off)) <= tot) {
-            if (0 == xstrncasecmp(_ptr + off, str._ptr, str.len()))
+            if (strscan::equal_icase(_ptr + off, str._ptr, str.len()))
                 return _ptr + off;
             ++off;
         }
@@ -1771,20 +1758,7 @@ struct token
     ///Returns number of newline sequences found, detects \r \n and \r\n
     uint count_newlines() const
     {
-        uint n = 0;
-        char oc = 0;
-        const char* p = ptr();
-        const char* pe = ptre();
-
-        for (; p < pe; ++p) {
-            char c = *p;
-            if (c == '\r') ++n;
-            else if (c == '\n' && oc != '\r') ++n;
-
-            oc = c;
-        }
-
-        return n;
+        return uint(strscan::count_newlines(ptr(), ptre()));
     }
 
     ///Trims trailing \r\n, \r or \n sequence
@@ -2044,18 +2018,12 @@ struct token
 
     const char* strchr(char c, uints off = 0) const
     {
-        const char* p = _ptr + off;
-        for (; p < _pte; ++p)
-            if (*p == c)  return p;
-        return 0;
+        return strscan::find_char(_ptr + off, _pte, c);
     }
 
     const char* strchr2(char c1, char c2, uints off = 0) const
     {
-        const char* p = _ptr + off;
-        for (; p < _pte; ++p)
-            if (*p == c1 || *p == c2)  return p;
-        return 0;
+        return strscan::find_char2(_ptr + off, _pte, c1, c2);
     }
 
     const char* strrchr(char c, uints off = 0) const
@@ -2073,10 +2041,8 @@ struct token
 
     const char* strichr(char c, uints off = 0) const
     {
-        const char* p = _ptr + off;
-        for (; p < _pte; ++p)
-            if (::tolower(*p) == c)  return p;
-        return 0;
+        uints k = count_notchar_icase(c, off);
+        return k < len() ? _ptr + k : 0;
     }
 
     /// @return the length of common prefix between two strings
@@ -2344,6 +2310,25 @@ struct token
             if (maxchars > 0 && uints(pe - p) > maxchars)
                 pe = p + maxchars;
 
+            if (base == 10) {
+                //eight digits at a time (SWAR)
+                for (; pe - p >= 8; p += 8) {
+                    uint64 v;
+                    ::memcpy(&v, p, 8);
+                    if (((v & 0xf0f0f0f0f0f0f0f0ULL) | (((v + 0x0606060606060606ULL) & 0xf0f0f0f0f0f0f0f0ULL) >> 4))
+                        != 0x3333333333333333ULL)
+                        break;
+
+                    v -= 0x3030303030303030ULL;
+                    v = v * 10 + (v >> 8);
+                    v = (((v & 0x000000ff000000ffULL) * (100 + (1000000ULL << 32)))
+                        + (((v >> 16) & 0x000000ff000000ffULL) * (1 + (10000ULL << 32)))) >> 32;
+
+                    r = T(uint64(r) * 100000000 + v);
+                    success = true;
+                }
+            }
+
             for (; p < pe; ++p)
             {
                 char k = *p;
@@ -2584,7 +2569,7 @@ struct token
     bool toint64_all(int64& val, uint base = 10)
     {
         token tmp = *this;
-        return tonum<int64>::toint_and_shift(tmp, val, base) && tmp.is_empty_or_whitespace();
+        return tonum<int64>::toint_and_shift(tmp, val, 0, base) && tmp.is_empty_or_whitespace();
     }
 
     ///Convert a hexadecimal, decimal, octal or binary token to unsigned int using as much digits as possible
@@ -2742,7 +2727,8 @@ struct token
 
     ///Convert token to a float value, consuming as much as possible
     float tofloat(float defval = 0.0f) const {
-        return float(todouble(defval));
+        token t = *this;
+        return t.tofloat_and_shift(defval);
     }
 
     /// @brief Convert token to double precision floating point value
@@ -2765,47 +2751,21 @@ struct token
 
     ///Convert token to a double value, shifting the consumed part
     /// @param defval
+    /// @note correctly rounded, unconsumed if there's no number (returns defval)
     double todouble_and_shift(double defval = 0.0)
     {
-        bool invsign = false;
-
-        if (first_char() == '-') { ++_ptr; invsign = true; }
-        else if (first_char() == '+') { ++_ptr; }
-
-        const char* p = _ptr;
-        double val = (double)touint64_and_shift();
-
-        bool has_num = p != _ptr;
-
-        if (first_char() == '.')
-        {
-            ++_ptr;
-
-            uints plen = lens();
-            uint64 dec = touint64_and_shift();
-            plen -= lens();
-            if (plen && dec)
-                val += double(dec) * pow(10.0, -(int)plen);
-        }
-        else if (!has_num) {
-            //unconsumed, use default
-            return defval;
-        }
-
-        if (first_char() == 'e' || first_char() == 'E')
-        {
-            ++_ptr;
-
-            int m = toint_and_shift();
-            val *= pow(10.0, m);
-        }
-
-        return invsign ? -val : val;
+        double val = defval;
+        _ptr = fpconv::parse(_ptr, _pte, val);
+        return val;
     }
 
     ///Convert token to a float value, shifting the consumed part
-    float tofloat_and_shift(float defval = 0.0f) {
-        return float(todouble_and_shift(defval));
+    /// @note rounded directly to float, not through double
+    float tofloat_and_shift(float defval = 0.0f)
+    {
+        float val = defval;
+        _ptr = fpconv::parse(_ptr, _pte, val);
+        return val;
     }
 
     ///Convert string (in local time) to datetime value
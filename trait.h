@@ -125,6 +125,9 @@ struct has_trivial_destructor {
     static const bool value = std::is_trivially_destructible<T>::value;
 };
 
+///Relocation trait: types are by default assumed to survive a bitwise move (memmove,
+/// or mremap moving the pages of large arrays), declare the ones that don't with
+/// COID_TYPE_NONTRIVIAL_REBASE to have them move-constructed on reallocation
 template<class T>
 struct has_trivial_rebase {
     static const bool value = true;
@@ -40,6 +40,7 @@
 
 #include "namespace.h"
 #include "token.h"
+#include "fpconv.h"
 #include "commassert.h"
 
 COID_NAMESPACE_BEGIN
@@ -333,7 +334,23 @@ namespace charstrconv
         static uints precompute(char* buf, uint64 n, int BaseN, int sgn)
         {
             uints i = 0;
-            if (n) {
+            if (BaseN == 10) {
+                //two digits per division
+                const char* tab = fpconv::digit_pairs();
+                for (; n >= 100; ) {
+                    uint r = uint(n % 100);
+                    n /= 100;
+                    buf[i++] = tab[2 * r + 1];
+                    buf[i++] = tab[2 * r];
+                }
+                if (n >= 10) {
+                    buf[i++] = tab[2 * n + 1];
+                    buf[i++] = tab[2 * n];
+                }
+                else
+                    buf[i++] = char('0' + n);
+            }
+            else if (n) {
                 for (; n; ) {
                     uint64 d = n / BaseN;
                     uint64 m = n % BaseN;